@@ -8,7 +8,6 @@
 #define MAX_VIEW_NUM              1024   
 
 typedef uint8_t  byte;
-typedef uint16_t px_t;
 
 #define MCBUF_LUMA_PAD_X        32
 #define MCBUF_LUMA_PAD_Y        12
@@ -24,12 +24,14 @@ using vio::h264::mb_t;
 namespace vio {
 namespace h264 {
 struct nal_unit_t;
+class thread_pool_t;
 }
 }
 using vio::h264::nal_unit_t;
 using vio::h264::sps_t;
 using vio::h264::pps_t;
 using vio::h264::sub_sps_t;
+using vio::h264::thread_pool_t;
 
 
 enum {
@@ -65,6 +67,9 @@ struct tone_mapping_struct_s;
 struct picture_t;
 using pic_t = picture_t;
 struct storable_picture;
+struct picture_pool_t;
+struct output_queue_t;
+struct decode_pipeline_t;
 
 struct sei_params;
 
@@ -119,11 +124,7 @@ struct VideoParameters {
 
     nal_unit_t*     nalu;
 
-    struct {
-        uint8_t* pY;
-        uint8_t* pU;
-        uint8_t* pV;
-    } pDecOuputPic;
+    output_queue_t* output;
     pps_t*      pNextPPS;
 
 
@@ -194,6 +195,10 @@ struct VideoParameters {
 
     // Error parameters
     ercVariables_t* erc_errorVar;
+
+    thread_pool_t*  threads;
+    decode_pipeline_t* pipeline;
+    picture_pool_t* pic_pool;
     // picture error concealment
     // concealment_head points to first node in list, concealment_end points to
     // last node in list. Initialize both to NULL, meaning no nodes in list yet
@@ -204,7 +209,6 @@ struct VideoParameters {
     concealment_node* concealment_head;
     concealment_node* concealment_end;
 
-    ImageData   tempData3;
     //control;
     int         last_dec_layer_id;
     int         dpb_layer_id;
@@ -227,6 +231,7 @@ extern void free_layer_buffers(VideoParameters *p_Vid, int layer_id);
 
 void init_picture(slice_t* currSlice);
 void exit_picture(VideoParameters *p_Vid);
+void release_picture(VideoParameters *p_Vid, storable_picture *p);
 
 #if (MVC_EXTENSION_ENABLE)
 extern int GetVOIdx(VideoParameters *p_Vid, int iViewId);
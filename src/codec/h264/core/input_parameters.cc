@@ -103,6 +103,10 @@ Mapping Map[] = {
 #endif
     {"DPBPLUS0",         &cfgparams.dpb_plus[0],        0, 1.0, 1, -16.0,  16.0,               },
     {"DPBPLUS1",         &cfgparams.dpb_plus[1],        0, 0.0, 1, -16.0,  16.0,               },
+    {"NumThreads",       &cfgparams.num_threads,        0, 0.0, 2,   0.0,   0.0,               },
+    {"DirectOutput",     &cfgparams.direct_output,      0, 0.0, 1,   0.0,   1.0,               },
+    {"PadReferences",    &cfgparams.pad_references,     0, 1.0, 1,   0.0,   1.0,               },
+    {"PipelineDecode",   &cfgparams.pipeline,           0, 1.0, 1,   0.0,   1.0,               },
     {NULL,               NULL,                         -1, 0.0, 0,   0.0,   0.0,               }
 };
 
@@ -460,7 +464,8 @@ static void JMDecHelpExit (void)
     "   -f :  read <curencM.cfg> for reseting selected encoder parameters.\n"
     "         Multiple files could be used that set different parameters\n"
     "   -p :  Set parameter <DecParamM> to <DecValueM>.\n"
-    "         See default decoder.cfg file for description of all parameters.\n\n"
+    "         See default decoder.cfg file for description of all parameters.\n"
+    "   -t :  Number of decoding threads, 0 uses one per core.\n\n"
 
     "## Examples of usage:\n"
     "   ldecod\n"
@@ -565,6 +570,11 @@ void InputParameters::ParseCommand(int ac, char* av[])
       strncpy(this->outfile, av[CLcount+1], FILE_NAME_SIZE);
       CLcount += 2;
     } 
+    else if (0 == strncmp (av[CLcount], "-t", 2) || 0 == strncmp (av[CLcount], "-T", 2))  // Number of decoding threads
+    {
+      this->num_threads = atoi(av[CLcount+1]);
+      CLcount += 2;
+    } 
     else
     {
       error(300, "Error in command line, ac %d, around string '%s', missing -f or -p parameters?", CLcount, av[CLcount]);
@@ -33,6 +33,10 @@ struct InputParameters {
 
     int         bDisplayDecParams;
     int         dpb_plus[2];
+    int         num_threads;      //!< decoding threads, 0 for one per core
+    int         direct_output;    //!< write the output file with O_DIRECT where possible
+    int         pad_references;   //!< pad reference pictures instead of clamping blocks crossing their border
+    int         pipeline;         //!< parse pictures ahead of their reconstruction on separate threads
 
     void        ParseCommand(int ac, char* av[]);
 };
@@ -15,6 +15,8 @@
 
 #include "erc_api.h"
 #include "output.h"
+#include "thread_pool.h"
+#include "pipeline.h"
 
 #include <fcntl.h>
 #include <stdio.h>
@@ -56,7 +58,7 @@ VideoParameters::VideoParameters()
 
     // Allocate new dpb buffer
     for (int i = 0; i < MAX_NUM_DPB_LAYERS; i++) {
-        this->p_Dpb_layer[i] = new dpb_t;
+        this->p_Dpb_layer[i] = new dpb_t {};
         this->p_Dpb_layer[i]->layer_id = i;
         this->p_Dpb_layer[i]->p_Vid = this;
         this->p_Dpb_layer[i]->init_done = 0;
@@ -74,9 +76,7 @@ VideoParameters::VideoParameters()
 
     this->pNextSlice            = new slice_t;
     this->nalu                  = new nal_unit_t();
-    this->pDecOuputPic.pY       = nullptr;
-    this->pDecOuputPic.pU       = nullptr;
-    this->pDecOuputPic.pV       = nullptr;
+    this->output                = nullptr;
     this->pNextPPS              = new pps_t;
 
     this->recovery_flag         = 0;
@@ -104,6 +104,9 @@ VideoParameters::VideoParameters()
     this->last_dec_layer_id     = -1;
 
     this->erc_errorVar          = nullptr;
+    this->threads               = nullptr;
+    this->pipeline              = nullptr;
+    this->pic_pool              = new picture_pool_t;
 }
 
 VideoParameters::~VideoParameters()
@@ -126,9 +129,10 @@ VideoParameters::~VideoParameters()
     if (this->pNextSlice)
         delete this->pNextSlice;
     delete this->nalu;
-    if (this->pDecOuputPic.pY)
-        delete []this->pDecOuputPic.pY;
     delete this->pNextPPS;
+
+    // last, pictures freed above return their buffers to the pool
+    delete this->pic_pool;
 }
 
 #if (MVC_EXTENSION_ENABLE)
@@ -142,6 +146,7 @@ void VideoParameters::OpenOutputFiles(int view0_id, int view1_id)
         if (pch)
             *pch = '\0';
         if (strcmp("nul", chBuf)) {
+            flush_output_queue(this);
             sprintf(out_ViewFileName[0], "%s_ViewId%04d.yuv", chBuf, view0_id);
             sprintf(out_ViewFileName[1], "%s_ViewId%04d.yuv", chBuf, view1_id);
             if (this->p_out_mvc[0] >= 0) {
@@ -174,6 +179,11 @@ void DecoderParams::OpenDecoder(InputParameters *p_Inp)
     memcpy(this->p_Inp, p_Inp, sizeof(InputParameters));
     this->p_Vid->conceal_mode         = p_Inp->conceal_mode;
     this->p_Vid->snr->idr_psnr_number = p_Inp->ref_offset;
+    this->p_Vid->threads              = new thread_pool_t(p_Inp->num_threads);
+    // error concealment and layered decoding stay on the serial path
+    if (p_Inp->pipeline && this->p_Vid->threads->size() > 1 &&
+        !p_Inp->DecodeAllLayers && p_Inp->conceal_mode == 0)
+        this->p_Vid->pipeline = new decode_pipeline_t(this->p_Vid);
 
     // Set defaults
     this->p_Vid->p_out = -1;
@@ -190,6 +200,7 @@ void DecoderParams::OpenDecoder(InputParameters *p_Inp)
         }
         this->p_Vid->p_out = this->p_Vid->p_out_mvc[0];
     }
+    open_output_queue(this->p_Vid);
 
     if (strlen(this->p_Inp->reffile) > 0 && strcmp(this->p_Inp->reffile, "\"\"")) {
         if ((this->p_Vid->p_ref = open(this->p_Inp->reffile, O_RDONLY)) == -1) {
@@ -202,7 +213,8 @@ void DecoderParams::OpenDecoder(InputParameters *p_Inp)
     this->p_Vid->bitstream.open(
         this->p_Inp->infile,
         this->p_Inp->FileFormat ? bitstream_t::type::RTP : bitstream_t::type::ANNEX_B,
-        this->p_Vid->nalu->max_size);
+        this->p_Vid->nalu->max_size,
+        this->p_Vid->threads->size() > 1);
 
     this->p_Vid->active_sps = NULL;
     this->p_Vid->active_subset_sps = NULL;
@@ -230,6 +242,8 @@ int DecoderParams::DecodeOneFrame()
 
 void DecoderParams::FinitDecoder()
 {
+    if (this->p_Vid->pipeline)
+        this->p_Vid->pipeline->drain();
 #if (MVC_EXTENSION_ENABLE)
     this->p_Vid->p_Dpb_layer[0]->flush();
     this->p_Vid->p_Dpb_layer[1]->flush();
@@ -266,15 +280,13 @@ static void free_global_buffers(VideoParameters *p_Vid)
         delete p_Vid->dec_picture;
         p_Vid->dec_picture = nullptr;
     }
-#if MVC_EXTENSION_ENABLE
-    if (p_Vid->active_subset_sps && p_Vid->active_subset_sps->sps.Valid &&
-        (p_Vid->active_subset_sps->sps.profile_idc == MVC_HIGH || p_Vid->active_subset_sps->sps.profile_idc == STEREO_HIGH))
-        free_img_data(p_Vid, &p_Vid->tempData3);
-#endif
 }
 
 void DecoderParams::CloseDecoder()
 {
+    if (this->p_Vid->pipeline)
+        this->p_Vid->pipeline->drain();
+
     this->p_Vid->report();
 
     free_layer_buffers(this->p_Vid, 0);
@@ -282,6 +294,7 @@ void DecoderParams::CloseDecoder()
     free_global_buffers(this->p_Vid);
 
     this->p_Vid->bitstream.close();
+    close_output_queue(this->p_Vid);
 
 #if (MVC_EXTENSION_ENABLE)
     for (int i = 0; i < MAX_VIEW_NUM; i++) {
@@ -298,6 +311,10 @@ void DecoderParams::CloseDecoder()
         delete this->p_Vid->erc_errorVar;
 #endif
 
+    if (this->p_Vid->pipeline)
+        delete this->p_Vid->pipeline;
+    delete this->p_Vid->threads;
+
     for (int i = 0; i < MAX_NUM_DPB_LAYERS; i++)
         this->p_Vid->p_Dpb_layer[i]->free();
 
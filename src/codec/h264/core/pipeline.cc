@@ -0,0 +1,381 @@
+#include <algorithm>
+
+#include "global.h"
+#include "slice.h"
+#include "picture.h"
+#include "decoder.h"
+#include "erc_api.h"
+#include "pipeline.h"
+
+using namespace vio::h264;
+
+
+decode_pipeline_t::decode_pipeline_t(VideoParameters* p_Vid) :
+    p_Vid     { p_Vid },
+    current   { nullptr },
+    parsed    { nullptr },
+    submitted { 0 },
+    completed { 0 },
+    stop      { false }
+{
+    for (job_t& job : this->jobs) {
+        job.num_mbs = 0;
+        job.pic     = nullptr;
+        job.pad     = false;
+        job.busy    = false;
+    }
+
+    this->recon_thread   = std::thread(&decode_pipeline_t::reconstruct_loop, this);
+    this->deblock_thread = std::thread(&decode_pipeline_t::deblock_loop, this);
+}
+
+decode_pipeline_t::~decode_pipeline_t()
+{
+    this->drain();
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stop = true;
+    }
+    this->filled.notify_all();
+
+    this->recon_thread.join();
+    this->deblock_thread.join();
+
+    // the slices of the last picture are still in ppSliceList
+    for (job_t& job : this->jobs) {
+        for (slice_t* slice : job.slices) {
+            if (std::find(this->handed.begin(), this->handed.end(), slice) == this->handed.end())
+                delete slice;
+        }
+    }
+    for (slice_t* slice : this->spare)
+        delete slice;
+}
+
+// Returns the macroblocks of a free slot for the next picture to be parsed
+// into, waiting for one when all of them are in flight.
+mb_t* decode_pipeline_t::acquire_mbs(int size)
+{
+    job_t* job = nullptr;
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->done.wait(lock, [&] {
+            if (this->current)
+                job = this->current;
+            for (int i = 0; i < NUM_SLOTS && !job; ++i) {
+                if (!this->jobs[i].busy)
+                    job = &this->jobs[i];
+            }
+            return job != nullptr;
+        });
+    }
+
+    if (job->num_mbs < size) {
+        job->mbs.reset(new mb_t[size]);
+        job->num_mbs = size;
+    }
+
+    for (slice_t* slice : job->slices) {
+        if (std::find(this->handed.begin(), this->handed.end(), slice) == this->handed.end())
+            this->spare.push_back(slice);
+    }
+    job->slices.clear();
+    job->pic = nullptr;
+
+    this->current = job;
+    this->parsed  = nullptr;
+
+    this->collect();
+    return job->mbs.get();
+}
+
+// Parses the slices of a picture set up by decode_slice_datas(), leaving its
+// reconstruction to submit(). Pictures the threads cannot take as they are
+// return false once the pipeline is drained, for the caller to decode them.
+bool decode_pipeline_t::parse(storable_picture* pic)
+{
+    VideoParameters* p_Vid = this->p_Vid;
+    slice_t& first_slice = *pic->slice_headers[0];
+
+    bool eligible = this->current && p_Vid->mb_data == this->current->mbs.get() &&
+                    !first_slice.active_sps->separate_colour_plane_flag &&
+                    first_slice.layer_id == 0 &&
+                    first_slice.active_pps->num_slice_groups_minus1 == 0 &&
+                    pic->slice_headers.size() == (size_t)p_Vid->iSliceNumOfCurrPic;
+    for (size_t i = 0; i < pic->slice_headers.size() && eligible; ++i) {
+        slice_t* slice = pic->slice_headers[i];
+        eligible = slice == p_Vid->ppSliceList[i] &&
+                   slice->header.slice_type != SP_slice &&
+                   slice->header.slice_type != SI_slice &&
+                   slice->header.redundant_pic_cnt == 0;
+    }
+    if (!eligible) {
+        this->drain();
+        return false;
+    }
+
+    job_t& job = *this->current;
+    job.coefs.clear();
+    job.order.clear();
+    for (slice_t* slice : pic->slice_headers)
+        this->parse(*slice, job);
+
+    this->parsed = pic;
+    return true;
+}
+
+// slice_t::decode() without the reconstruction. The residuals of a coded
+// macroblock are packed away and its coefficients cleared for the next one.
+void decode_pipeline_t::parse(slice_t& slice, job_t& job)
+{
+    const sps_t& sps = *slice.active_sps;
+    shr_t& shr = slice.header;
+    int (*cof)[16][16] = slice.decoder.transform->cof;
+
+    bool end_of_slice = false;
+
+    while (!end_of_slice) {
+        mb_t& mb = slice.neighbour.mb_data[slice.parser.current_mb_nr];
+        mb.init(slice);
+        slice.parser.parse(mb);
+
+        int offset = -1;
+        if (mb.mb_type == I_PCM || mb.mb_type == I_16x16 || sps.ChromaArrayType == 3 ||
+            mb.CodedBlockPatternLuma != 0 || mb.CodedBlockPatternChroma != 0) {
+            offset = job.coefs.size();
+            job.coefs.insert(job.coefs.end(), &cof[0][0][0], &cof[0][0][0] + 16 * 16);
+            if (sps.chroma_format_idc != CHROMA_FORMAT_400) {
+                for (int uv = 1; uv < 3; ++uv) {
+                    for (int y = 0; y < sps.MbHeightC; ++y)
+                        job.coefs.insert(job.coefs.end(), cof[uv][y], cof[uv][y] + sps.MbWidthC);
+                }
+            }
+            memset(cof, 0, 3 * 16 * 16 * sizeof(int));
+        }
+        job.order.emplace_back(mb.mbAddrX, offset);
+
+        if (shr.MbaffFrameFlag && mb.mb_field_decoding_flag) {
+            shr.num_ref_idx_l0_active_minus1 = ((shr.num_ref_idx_l0_active_minus1 + 1) >> 1) - 1;
+            shr.num_ref_idx_l1_active_minus1 = ((shr.num_ref_idx_l1_active_minus1 + 1) >> 1) - 1;
+        }
+
+#if (DISABLE_ERC == 0)
+        this->p_Vid->erc_errorVar->ercWriteMBMODEandMV(mb, shr.slice_type, slice.dec_picture);
+#endif
+
+        end_of_slice = mb.close(slice);
+
+        ++slice.num_dec_mb;
+    }
+}
+
+// Hands the picture parsed last to the threads. Pictures with macroblocks
+// to conceal are reconstructed here instead and left to exit_picture().
+bool decode_pipeline_t::submit(storable_picture* pic, bool pad)
+{
+    VideoParameters* p_Vid = this->p_Vid;
+
+    if (pic != this->parsed) {
+        this->drain();
+        return false;
+    }
+    this->parsed = nullptr;
+
+    job_t& job = *this->current;
+
+    bool inline_decode = false;
+    for (auto& entry : job.order)
+        inline_decode = inline_decode || job.mbs[entry.first].ei_flag;
+    // exit_picture() of a picture left incomplete runs once the next one's
+    // slices have taken over ppSliceList
+    for (size_t i = 0; i < pic->slice_headers.size(); ++i)
+        inline_decode = inline_decode || pic->slice_headers[i] != p_Vid->ppSliceList[i];
+
+    if (inline_decode) {
+        this->drain();
+        if (pic->px_size == 1)
+            this->reconstruct<uint8_t >(job);
+        else
+            this->reconstruct<uint16_t>(job);
+        return false;
+    }
+
+    pic->padded = pad;
+    if (!pic->progress) {
+        pic->progress = std::make_shared<row_progress_t>();
+        // the other field in these planes is decoded already
+        if (pic->slice.structure != FRAME && pic->planes.use_count() > 1)
+            pic->progress->rows[pic->slice.structure == TOP_FIELD ? 1 : 0] = pic->size_y;
+    }
+
+    job.pic    = pic;
+    job.pad    = pad;
+    job.slices = pic->slice_headers;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        ++this->submitted;
+        job.busy = true;
+        this->recon_queue.push_back(&job);
+    }
+    this->filled.notify_all();
+
+    this->handed  = job.slices;
+    this->current = nullptr;
+    return true;
+}
+
+// Swaps the slices of the last submitted picture out of ppSliceList, called
+// before the next picture's headers are read into them.
+void decode_pipeline_t::replace_slices(std::vector<slice_t*>& slices)
+{
+    for (size_t i = 0; i < this->handed.size() && i < slices.size(); ++i) {
+        if (slices[i] != this->handed[i])
+            continue;
+
+        slice_t* slice;
+        if (this->spare.empty())
+            slice = new slice_t;
+        else {
+            slice = this->spare.back();
+            this->spare.pop_back();
+        }
+        // the history of correctly decoded references goes with the position
+        memcpy(slice->ref_flag, slices[i]->ref_flag, sizeof(slice->ref_flag));
+        slices[i] = slice;
+    }
+    this->handed.clear();
+}
+
+// Deletes a picture once every picture submitted so far is done.
+void decode_pipeline_t::retire(storable_picture* pic)
+{
+    if (!pic)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->completed != this->submitted) {
+            this->retired.emplace_back(this->submitted, pic);
+            return;
+        }
+    }
+    delete pic;
+}
+
+void decode_pipeline_t::drain()
+{
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->done.wait(lock, [this] { return this->completed == this->submitted; });
+    }
+    this->collect();
+}
+
+void decode_pipeline_t::collect()
+{
+    unsigned completed;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        completed = this->completed;
+    }
+
+    size_t n = 0;
+    for (auto& entry : this->retired) {
+        if (entry.first <= completed)
+            delete entry.second;
+        else
+            this->retired[n++] = entry;
+    }
+    this->retired.resize(n);
+}
+
+template <typename px_t>
+void decode_pipeline_t::reconstruct(job_t& job)
+{
+    for (auto& entry : job.order) {
+        mb_t& mb = job.mbs[entry.first];
+        slice_t& slice = *mb.p_Slice;
+        const sps_t& sps = *slice.active_sps;
+        int (*cof)[16][16] = slice.decoder.transform->cof;
+
+        if (entry.second >= 0) {
+            const int* coefs = &job.coefs[entry.second];
+            memcpy(cof[0], coefs, 16 * 16 * sizeof(int));
+            coefs += 16 * 16;
+            if (sps.chroma_format_idc != CHROMA_FORMAT_400) {
+                for (int uv = 1; uv < 3; ++uv) {
+                    for (int y = 0; y < sps.MbHeightC; ++y) {
+                        memcpy(cof[uv][y], coefs, sps.MbWidthC * sizeof(int));
+                        coefs += sps.MbWidthC;
+                    }
+                }
+            }
+        }
+
+        slice.decoder.decode<px_t>(mb);
+
+        if (entry.second >= 0)
+            memset(cof, 0, 3 * 16 * 16 * sizeof(int));
+    }
+}
+
+// Deblocks and pads the picture, publishing its rows as they become final.
+void decode_pipeline_t::deblock(job_t& job)
+{
+    storable_picture* pic = job.pic;
+    slice_t& first_slice = *pic->slice_headers[0];
+
+    if (!first_slice.decoder.deblock_filter(first_slice, pic, job.pad)) {
+        if (job.pad)
+            pic->pad_rows(0, pic->size_y);
+        pic->publish_rows(pic->size_y);
+    }
+}
+
+void decode_pipeline_t::reconstruct_loop()
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    while (true) {
+        this->filled.wait(lock, [this] { return this->stop || !this->recon_queue.empty(); });
+        if (this->recon_queue.empty())
+            break;
+
+        job_t* job = this->recon_queue.front();
+        this->recon_queue.pop_front();
+
+        lock.unlock();
+        if (job->pic->px_size == 1)
+            this->reconstruct<uint8_t >(*job);
+        else
+            this->reconstruct<uint16_t>(*job);
+        lock.lock();
+
+        this->deblock_queue.push_back(job);
+        this->filled.notify_all();
+    }
+}
+
+// The only user of the thread pool while pictures are in flight.
+void decode_pipeline_t::deblock_loop()
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    while (true) {
+        this->filled.wait(lock, [this] { return this->stop || !this->deblock_queue.empty(); });
+        if (this->deblock_queue.empty())
+            break;
+
+        job_t* job = this->deblock_queue.front();
+        this->deblock_queue.pop_front();
+
+        lock.unlock();
+        this->deblock(*job);
+        lock.lock();
+
+        job->busy = false;
+        ++this->completed;
+        this->done.notify_all();
+    }
+}
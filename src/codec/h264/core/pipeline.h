@@ -0,0 +1,90 @@
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "global.h"
+
+
+// Decodes pictures in three stages. The decoding thread parses the slices of
+// a picture into macroblocks and packed coefficients, one thread reconstructs
+// them and another deblocks and pads the picture, so the next picture is
+// parsed while the previous ones are still being reconstructed and filtered.
+// Pictures predicting from one still on the pipeline wait for the rows they
+// read to be final (storable_picture::wait_rows()).
+//
+// Each picture in flight keeps the macroblocks and slices it was parsed into.
+// Slices are taken over from ppSliceList and replaced by others before the
+// next picture's headers are read. Pictures freed while others are in flight
+// are deleted once those are done, anything overwriting what the threads read
+// (parameter sets, the DPB on IDR) drains the pipeline first.
+
+struct decode_pipeline_t {
+    static const int NUM_SLOTS = 3;
+
+                decode_pipeline_t(VideoParameters* p_Vid);
+                ~decode_pipeline_t();
+
+    mb_t*       acquire_mbs(int size);
+    bool        parse (storable_picture* pic);
+    bool        submit(storable_picture* pic, bool pad);
+
+    void        replace_slices(std::vector<slice_t*>& slices);
+    void        retire(storable_picture* pic);
+    void        drain ();
+
+private:
+    struct job_t {
+        std::unique_ptr<mb_t[]> mbs;
+        int                     num_mbs;
+        std::vector<int>        coefs;  //!< residuals of the coded macroblocks
+        std::vector<std::pair<int, int>> order; //!< macroblocks in decoding order, offset into coefs or -1
+        std::vector<slice_t*>   slices;
+        storable_picture*       pic;
+        bool                    pad;
+        bool                    busy;
+    };
+
+    void        parse(slice_t& slice, job_t& job);
+    template <typename px_t>
+    void        reconstruct(job_t& job);
+    void        deblock    (job_t& job);
+
+    void        reconstruct_loop();
+    void        deblock_loop    ();
+    void        collect();
+
+    VideoParameters*  p_Vid;
+
+    job_t             jobs[NUM_SLOTS];
+    job_t*            current;  //!< slot of the picture being parsed
+    storable_picture* parsed;   //!< picture parsed into current
+
+    std::vector<slice_t*> handed; //!< slices of the last submitted picture, still in ppSliceList
+    std::vector<slice_t*> spare;
+
+    std::thread       recon_thread;
+    std::thread       deblock_thread;
+
+    std::mutex              mutex;
+    std::condition_variable filled;
+    std::condition_variable done;
+
+    std::deque<job_t*> recon_queue;
+    std::deque<job_t*> deblock_queue;
+
+    unsigned          submitted;
+    unsigned          completed;
+    std::vector<std::pair<unsigned, storable_picture*>> retired;
+    bool              stop;
+};
+
+
+#endif /* _PIPELINE_H_ */
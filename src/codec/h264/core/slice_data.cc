@@ -15,6 +15,7 @@
 #include "macroblock.h"
 #include "neighbour.h"
 #include "decoder.h"
+#include "pipeline.h"
 
 using vio::h264::mb_t;
 
@@ -140,8 +141,8 @@ static void copy_dec_picture_JV(VideoParameters *p_Vid, storable_picture *dst, s
     dst->tonemapped_bit_depth  = src->tonemapped_bit_depth;
     if (src->tone_mapping_lut) {
         int coded_data_bit_max = (1 << p_Vid->seiToneMapping->coded_data_bit_depth);
-        dst->tone_mapping_lut = new px_t[coded_data_bit_max];
-        memcpy(dst->tone_mapping_lut, src->tone_mapping_lut, sizeof(px_t) * coded_data_bit_max);
+        dst->tone_mapping_lut = new uint16_t[coded_data_bit_max];
+        memcpy(dst->tone_mapping_lut, src->tone_mapping_lut, sizeof(uint16_t) * coded_data_bit_max);
     }
 }
 
@@ -195,8 +196,11 @@ void init_picture(slice_t* currSlice)
                 /* Advanced Error Concealment would be called here to combat unintentional loss of pictures. */
                 error(100, "An unintentional loss of pictures occurs! Exit\n");
         }
-        if (p_Vid->conceal_mode == 0)
+        if (p_Vid->conceal_mode == 0) {
+            if (p_Vid->pipeline)
+                p_Vid->pipeline->drain();
             fill_frame_num_gap(p_Vid, currSlice);
+        }
     }
 
     if (currSlice->nal_ref_idc)
@@ -214,9 +218,30 @@ void init_picture(slice_t* currSlice)
     if (!shr.field_pic_flag || !shr.bottom_field_flag)
         p_Vid->snr->start_time = std::chrono::system_clock::now();
 
-    storable_picture* dec_picture = p_Vid->dec_picture = new storable_picture(p_Vid, shr.structure,
-        sps.PicWidthInMbs * 16, sps.FrameHeightInMbs * 16,
-        sps.PicWidthInMbs * sps.MbWidthC, sps.FrameHeightInMbs * sps.MbHeightC, 1);
+    // The second field of a pair is decoded into the rows its first field
+    // leaves free, so that the pair forms its frame without copies. Should
+    // the fields not pair up after all, they are copied as before.
+    storable_picture* first_field = nullptr;
+    for (pic_t* fs : {p_Dpb->last_picture, p_Vid->out_buffer}) {
+        if (!fs || first_field || (fs->is_orig_reference != 0) != (currSlice->nal_ref_idc != 0))
+            continue;
+        if (shr.structure == TOP_FIELD && fs->is_used == 2)
+            first_field = fs->bottom_field;
+        if (shr.structure == BOTTOM_FIELD && fs->is_used == 1)
+            first_field = fs->top_field;
+    }
+    if (first_field && (first_field->frame_num != shr.frame_num || first_field->planes.use_count() != 1 ||
+                        first_field->size_x != (int)sps.PicWidthInMbs * 16 ||
+                        first_field->size_y != (int)sps.FrameHeightInMbs * 8 ||
+                        first_field->size_y_cr != (int)sps.FrameHeightInMbs * sps.MbHeightC / 2 ||
+                        first_field->size_x_cr != (int)sps.PicWidthInMbs * sps.MbWidthC))
+        first_field = nullptr;
+
+    storable_picture* dec_picture = p_Vid->dec_picture = first_field ?
+        new storable_picture(p_Vid, shr.structure, first_field) :
+        new storable_picture(p_Vid, shr.structure,
+            sps.PicWidthInMbs * 16, sps.FrameHeightInMbs * 16,
+            sps.PicWidthInMbs * sps.MbWidthC, sps.FrameHeightInMbs * sps.MbHeightC, 1);
     dec_picture->sps = currSlice->active_sps;
     dec_picture->pps = currSlice->active_pps;
     dec_picture->slice_headers.push_back(currSlice);
@@ -265,6 +290,9 @@ void init_picture(slice_t* currSlice)
                 reset_mbs(currMB++);
         }
     } else {
+        // pictures in flight keep their macroblocks, this one is parsed into others
+        if (p_Vid->pipeline)
+            p_Vid->mb_data = p_Vid->pipeline->acquire_mbs(sps.PicWidthInMbs * sps.FrameHeightInMbs);
         mb_t* currMB = p_Vid->mb_data;
         for (int i = 0; i < shr.PicSizeInMbs; ++i)
             reset_mbs(currMB++);
@@ -285,8 +313,8 @@ void init_picture(slice_t* currSlice)
         dec_picture->seiHasTone_mapping    = 1;
         dec_picture->tone_mapping_model_id = p_Vid->seiToneMapping->model_id;
         dec_picture->tonemapped_bit_depth  = p_Vid->seiToneMapping->sei_bit_depth;
-        dec_picture->tone_mapping_lut      = new px_t[coded_data_bit_max];
-        memcpy(dec_picture->tone_mapping_lut, p_Vid->seiToneMapping->lut, sizeof(px_t) * coded_data_bit_max);
+        dec_picture->tone_mapping_lut      = new uint16_t[coded_data_bit_max];
+        memcpy(dec_picture->tone_mapping_lut, p_Vid->seiToneMapping->lut, sizeof(uint16_t) * coded_data_bit_max);
         update_tone_mapping_sei(p_Vid->seiToneMapping);
     } else
         dec_picture->seiHasTone_mapping = 0;
@@ -353,6 +381,8 @@ void activate_sps(VideoParameters *p_Vid, sps_t *sps)
 
         if (p_Vid->dec_picture)
             exit_picture(p_Vid);
+        if (p_Vid->pipeline)
+            p_Vid->pipeline->drain();
         p_Vid->active_sps = sps;
 
         if (p_Vid->dpb_layer_id == 0 && is_BL_profile(sps->profile_idc) && !p_Vid->p_Dpb_layer[0]->init_done) {
@@ -483,15 +513,19 @@ void macroblock_t::init(slice_t& slice)
     mb.CodedBlockPatternLuma   = 0;
     mb.CodedBlockPatternChroma = 0;
 
+    // Neighbours are at most a macroblock (pair) row above, so four rows
+    // of parse context are enough even for MBAFF
+    mb.ctx = &slice.mb_ctx[(mb.mb.y % 4) * sps.PicWidthInMbs + mb.mb.x];
+
     // Reset syntax element entries in MB struct
     if (shr.slice_type != I_slice) {
-        memset(mb.mvd_l0, 0, sizeof(mb.mvd_l0));
+        memset(mb.ctx->mvd_l0, 0, sizeof(mb.ctx->mvd_l0));
         if (shr.slice_type == B_slice)
-            memset(mb.mvd_l1, 0, sizeof(mb.mvd_l1));
+            memset(mb.ctx->mvd_l1, 0, sizeof(mb.ctx->mvd_l1));
     }
 
     memset(mb.cbp_blks, 0, sizeof(mb.cbp_blks));
-    memset(mb.cbp_bits, 0, sizeof(mb.cbp_bits));
+    memset(mb.ctx->cbp_bits, 0, sizeof(mb.ctx->cbp_bits));
 
     if (!slice.parser.is_reset_coeff) {
         memset(slice.decoder.transform->cof[0][0], 0, 16 * 16 * sizeof(int));
@@ -502,22 +536,32 @@ void macroblock_t::init(slice_t& slice)
         slice.parser.is_reset_coeff = 1;
     }
 
+    // Neighbours of the macroblock (pair), looked up once here for every
+    // later prediction and context derivation. Nothing before the slice
+    // start is touched as another thread may still be decoding it.
+    int pairs  = 1 + shr.MbaffFrameFlag;
+    int mbAddr = mb.mbAddrX / pairs;
+    int width  = sps.PicWidthInMbs;
+    auto nb_mb = [&](bool avail, int addr) -> mb_t* {
+        if (!avail || addr < (int)shr.first_mb_in_slice)
+            return nullptr;
+        mb_t* nb = &slice.neighbour.mb_data[addr * pairs];
+        return nb->slice_nr == mb.slice_nr ? nb : nullptr;
+    };
+    mb.mbA = nb_mb(mb.mb.x > 0, mbAddr - 1);
+    mb.mbB = nb_mb(mbAddr >= width, mbAddr - width);
+    mb.mbC = nb_mb(mbAddr >= width && mb.mb.x < width - 1, mbAddr - width + 1);
+    mb.mbD = nb_mb(mbAddr >= width && mb.mb.x > 0, mbAddr - width - 1);
+
     mb.mb_field_decoding_flag = 0;
     if (shr.MbaffFrameFlag) {
         bool prevMbSkipped = (mb.mbAddrX % 2 == 1) ?
             slice.neighbour.mb_data[mb.mbAddrX - 1].mb_skip_flag : 0;
         if (mb.mbAddrX % 2 == 0 || prevMbSkipped) {
-            int topMbAddr = mb.mbAddrX & ~1;
-
-            mb_t* mbA = slice.neighbour.get_mb(&slice, false, topMbAddr, {-1, 0});
-            mb_t* mbB = slice.neighbour.get_mb(&slice, false, topMbAddr, {0, -1});
-            mbA = mbA && mbA->slice_nr == mb.slice_nr ? mbA : nullptr;
-            mbB = mbB && mbB->slice_nr == mb.slice_nr ? mbB : nullptr;
-
-            if (mbA)
-                mb.mb_field_decoding_flag = mbA->mb_field_decoding_flag;
-            else if (mbB)
-                mb.mb_field_decoding_flag = mbB->mb_field_decoding_flag;
+            if (mb.mbA)
+                mb.mb_field_decoding_flag = mb.mbA->mb_field_decoding_flag;
+            else if (mb.mbB)
+                mb.mb_field_decoding_flag = mb.mbB->mb_field_decoding_flag;
         } else
             mb.mb_field_decoding_flag = slice.neighbour.mb_data[mb.mbAddrX - 1].mb_field_decoding_flag;
     }
@@ -570,8 +614,6 @@ bool macroblock_t::close(slice_t& slice)
 
 slice_t::slice_t()
 {
-    get_mem3Dpel(&this->mb_pred, 3, 16, 16);
-
 #if (MVC_EXTENSION_ENABLE)
     this->view_id         = -1;
     this->inter_view_flag = 0;
@@ -587,12 +629,7 @@ slice_t::slice_t()
     }
 }
 
-slice_t::~slice_t()
-{
-    free_mem3Dpel(this->mb_pred);
-}
-
-void slice_t::init()
+void slice_t::init(const slice_t* same)
 {
     VideoParameters *p_Vid = this->p_Vid;
     p_Vid->active_sps = this->active_sps;
@@ -604,6 +641,7 @@ void slice_t::init()
         this->parser.cabac[0].init(&this->parser.partArr[0]);
 
     this->num_dec_mb = 0;
+    this->mb_ctx.resize(4 * this->active_sps->PicWidthInMbs);
 
     if (this->active_sps->separate_colour_plane_flag) {
         p_Vid->mb_data     = p_Vid->mb_data_JV    [shr.colour_plane_id];
@@ -612,21 +650,52 @@ void slice_t::init()
     this->neighbour.mb_data = p_Vid->mb_data;
     this->dec_picture = p_Vid->dec_picture;
 
-    this->init_ref_lists();
+    // An earlier slice of the picture with the same list defining header
+    // fields has built these lists already, take them over together with
+    // what is derived from them
+    if (same)
+        this->copy_ref_lists(*same);
+    else {
+        this->init_ref_lists();
+
+        // Motion vectors store references as ids into the picture's table, so
+        // look every list entry up once here rather than per macroblock
+        for (int j = 0; j < 2; ++j) {
+            for (int i = 0; i < MAX_LIST_SIZE; ++i) {
+                storable_picture* ref = this->RefPicList[j][i];
+                this->RefPicId[j][0][i] = this->dec_picture->ref_pic_id(ref);
+                this->RefPicId[j][1][i] = shr.MbaffFrameFlag && ref ? this->dec_picture->ref_pic_id(ref->top_field) : 0;
+                this->RefPicId[j][2][i] = shr.MbaffFrameFlag && ref ? this->dec_picture->ref_pic_id(ref->bottom_field) : 0;
+            }
+        }
+
+        this->init_list_factors();
+    }
+
+    // update reference flags and set current p_Vid->ref_flag
+    if (!(shr.redundant_pic_cnt != 0 && p_Vid->previous_frame_num == shr.frame_num)) {
+        for (int i = 16; i > 0; i--)
+            this->ref_flag[i] = this->ref_flag[i-1];
+    }
+    this->ref_flag[0] = shr.redundant_pic_cnt == 0 ? p_Vid->Is_primary_correct : p_Vid->Is_redundant_correct;
 
     this->parser.init(*this);
     this->decoder.init(*this);
     //this->decoder.assign_quant_params(*this);
 
-    if (shr.slice_type != I_slice && shr.slice_type != SI_slice) {
+    if (!same && shr.slice_type != I_slice && shr.slice_type != SI_slice) {
         if (!this->active_sps->separate_colour_plane_flag || shr.colour_plane_id == 0) {
             storable_picture* vidref = p_Vid->no_reference_picture;
             int noref = (shr.PicOrderCnt < p_Vid->recovery_poc);
             for (int j = 0; j < 2; ++j) {
                 for (int i = 0; i < MAX_LIST_SIZE; ++i) {
                     storable_picture* curr_ref = this->RefPicList[j][i];
-                    if (curr_ref)
+                    // pictures in flight may be predicting from curr_ref
+                    if (curr_ref && curr_ref->no_ref != (noref && curr_ref == vidref)) {
+                        if (p_Vid->pipeline)
+                            p_Vid->pipeline->drain();
                         curr_ref->no_ref = noref && (curr_ref == vidref);
+                    }
                 }
             }
         }
@@ -638,12 +707,16 @@ void slice_t::decode()
     shr_t& shr = this->header;
 
     bool end_of_slice = 0;
+    bool wide = this->dec_picture->px_size == 2;
 
     while (!end_of_slice) { // loop over macroblocks
         mb_t& mb = this->neighbour.mb_data[this->parser.current_mb_nr]; 
         mb.init(*this);
         this->parser.parse(mb);
-        this->decoder.decode(mb);
+        if (wide)
+            this->decoder.decode<uint16_t>(mb);
+        else
+            this->decoder.decode<uint8_t>(mb);
 
         if (shr.MbaffFrameFlag && mb.mb_field_decoding_flag) {
             shr.num_ref_idx_l0_active_minus1 = ((shr.num_ref_idx_l0_active_minus1 + 1) >> 1) - 1;
@@ -651,7 +724,7 @@ void slice_t::decode()
         }
 
 #if (DISABLE_ERC == 0)
-        this->p_Vid->erc_errorVar->ercWriteMBMODEandMV(mb, shr.slice_type, this->p_Vid->dec_picture);
+        this->p_Vid->erc_errorVar->ercWriteMBMODEandMV(mb, shr.slice_type, this->dec_picture);
 #endif
 
         end_of_slice = mb.close(*this);
@@ -14,6 +14,7 @@
 #include "memalloc.h"
 #include "macroblock.h"
 #include "neighbour.h"
+#include "pipeline.h"
 
 using namespace vio::h264;
 
@@ -273,7 +274,7 @@ static int parse_dpa(slice_t *currSlice)
 
     // continue with reading next DP
     p_Vid->bitstream >> nal;
-    if (0 == nal.num_bytes_in_rbsp)
+    if (0 == nal.num_bytes_in_nal_unit)
         return current_header;
 
     if (nal_unit_t::NALU_TYPE_DPB == nal.nal_unit_type) {
@@ -295,7 +296,7 @@ static int parse_dpa(slice_t *currSlice)
 
             // we're finished with DP_B, so let's continue with next DP
             p_Vid->bitstream >> nal;
-            if (0 == nal.num_bytes_in_rbsp)
+            if (0 == nal.num_bytes_in_nal_unit)
                 return current_header;
         }
     } else
@@ -340,7 +341,7 @@ static int read_new_slice(slice_t *currSlice)
 
     for (;;) {
         p_Vid->bitstream >> nal;
-        if (0 == nal.num_bytes_in_rbsp)
+        if (0 == nal.num_bytes_in_nal_unit)
             return EOS;
 
 process_nalu:
@@ -399,6 +400,8 @@ process_nalu:
                         }
                     }
                 }
+                if (p_Vid->pipeline)
+                    p_Vid->pipeline->drain();
                 p_Vid->PicParSet[pps->pic_parameter_set_id] = *pps;
 
                 delete dp;
@@ -423,6 +426,8 @@ process_nalu:
                             }
                         }
                     }
+                    if (p_Vid->pipeline)
+                        p_Vid->pipeline->drain();
                     p_Vid->SeqParSet[sps->seq_parameter_set_id] = *sps;
                     if (p_Vid->profile_idc < (int) sps->profile_idc)
                         p_Vid->profile_idc = sps->profile_idc;
@@ -512,7 +517,7 @@ process_nalu:
         default:
             if (!p_Inp->silent)
                 printf ("Found NALU type %d, len %d undefined, ignore NALU, moving on\n",
-                        (int) nal.nal_unit_type, (int) nal.num_bytes_in_rbsp);
+                        (int) nal.nal_unit_type, (int) nal.num_bytes_in_nal_unit);
             break;
         }
     }
@@ -528,8 +533,14 @@ int DecoderParams::decode_slice_headers()
     p_Vid->iSliceNumOfCurrPic = 0;
     p_Vid->num_dec_mb = 0;
 
+    // the slices of the picture submitted last stay with the pipeline
+    if (p_Vid->pipeline)
+        p_Vid->pipeline->replace_slices(ppSliceList);
+
     if (p_Vid->newframe) {
         if (p_Vid->pNextPPS->Valid) {
+            if (p_Vid->pipeline)
+                p_Vid->pipeline->drain();
             p_Vid->PicParSet[p_Vid->pNextPPS->pic_parameter_set_id] = *(p_Vid->pNextPPS);
             p_Vid->pNextPPS->Valid = 0;
         }
@@ -736,6 +747,23 @@ bool operator==(const pps_t& l, const pps_t& r)
 
 } }
 
+// Lists are built from the DPB state, which is the same for all slices of a
+// picture, and the fields compared here. The slices of a picture may refer
+// to different PPSs, and the implicit weights shared along with the lists
+// depend on weighted_bipred_idc.
+bool slice_t::same_ref_lists(const slice_t& slice) const
+{
+    const shr_t& shr = slice.header;
+
+    return this->header.slice_type                   == shr.slice_type &&
+           this->header.colour_plane_id              == shr.colour_plane_id &&
+           this->header.num_ref_idx_l0_active_minus1 == shr.num_ref_idx_l0_active_minus1 &&
+           this->header.num_ref_idx_l1_active_minus1 == shr.num_ref_idx_l1_active_minus1 &&
+           !this->header.ref_pic_list_modification_flag_l0 && !shr.ref_pic_list_modification_flag_l0 &&
+           !this->header.ref_pic_list_modification_flag_l1 && !shr.ref_pic_list_modification_flag_l1 &&
+           this->active_pps->weighted_bipred_idc     == slice.active_pps->weighted_bipred_idc;
+}
+
 bool slice_t::operator!=(const slice_t& slice)
 {
     const sps_t& sps = *slice.active_sps;
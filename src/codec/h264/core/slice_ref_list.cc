@@ -75,271 +75,6 @@ static void gen_pic_list_from_frame_list(bool bottom_field_flag, pic_t **fs_list
     }
 }
 
-static void init_lists_i_slice(slice_t *currSlice)
-{
-#if (MVC_EXTENSION_ENABLE)
-    currSlice->listinterviewidx0 = 0;
-    currSlice->listinterviewidx1 = 0;
-#endif
-    currSlice->RefPicSize[0] = 0;
-    currSlice->RefPicSize[1] = 0;
-}
-
-static void init_lists_p_slice(slice_t *currSlice)
-{
-    VideoParameters *p_Vid = currSlice->p_Vid;
-    dpb_t *p_Dpb = currSlice->p_Dpb;
-    shr_t& shr = currSlice->header;
-
-#if (MVC_EXTENSION_ENABLE)
-    currSlice->listinterviewidx0 = 0;
-    currSlice->listinterviewidx1 = 0;
-#endif
-
-    if (!shr.field_pic_flag) {
-        int list0idx = 0;
-        for (int i = 0; i < p_Dpb->ref_frames_in_buffer; i++) {
-            if (p_Dpb->fs_ref[i]->is_used == 3) {
-                if (p_Dpb->fs_ref[i]->frame->used_for_reference && !p_Dpb->fs_ref[i]->frame->is_long_term)
-                    currSlice->RefPicList[0][list0idx++] = p_Dpb->fs_ref[i]->frame;
-            }
-        }
-
-        // order list 0 by PicNum
-        std::qsort(currSlice->RefPicList[0], list0idx, sizeof(storable_picture*), [](const void* a, const void* b) {
-            int pic_num1 = (*(storable_picture**)a)->PicNum;
-            int pic_num2 = (*(storable_picture**)b)->PicNum;
-            //int pic_num1 = (*(reinterpret_cast<const storable_picture**>(a)))->PicNum;
-            //int pic_num2 = (*(reinterpret_cast<const storable_picture**>(b)))->PicNum;
-            return pic_num2 - pic_num1;
-        });
-        currSlice->RefPicSize[0] = (char) list0idx;
-
-        // long term handling
-        for (int i = 0; i < p_Dpb->ltref_frames_in_buffer; i++) {
-            if (p_Dpb->fs_ltref[i]->is_used == 3) {
-                if (p_Dpb->fs_ltref[i]->frame->is_long_term)
-                    currSlice->RefPicList[0][list0idx++] = p_Dpb->fs_ltref[i]->frame;
-            }
-        }
-
-        std::qsort(&currSlice->RefPicList[0][(short) currSlice->RefPicSize[0]], list0idx - currSlice->RefPicSize[0],
-                   sizeof(storable_picture*), [](const void* a, const void* b) {
-            int pic_num1 = (*(storable_picture**)a)->LongTermPicNum;
-            int pic_num2 = (*(storable_picture**)b)->LongTermPicNum;
-            return pic_num1 - pic_num2;
-        });
-        currSlice->RefPicSize[0] = (char) list0idx;
-    } else {
-        pic_t** fs_list0  = new pic_t*[p_Dpb->size];
-        pic_t** fs_listlt = new pic_t*[p_Dpb->size];
-
-        int list0idx = 0;
-        for (int i = 0; i < p_Dpb->ref_frames_in_buffer; i++) {
-            if (p_Dpb->fs_ref[i]->is_reference)
-                fs_list0[list0idx++] = p_Dpb->fs_ref[i];
-        }
-
-        std::qsort(fs_list0, list0idx, sizeof(pic_t*), [](const void* a, const void* b) {
-            int pic_num1 = (*(pic_t**)a)->FrameNumWrap;
-            int pic_num2 = (*(pic_t**)b)->FrameNumWrap;
-            return pic_num2 - pic_num1;
-        });
-
-        currSlice->RefPicSize[0] = 0;
-        gen_pic_list_from_frame_list(shr.bottom_field_flag, fs_list0, list0idx, currSlice->RefPicList[0], &currSlice->RefPicSize[0], 0);
-
-        // long term handling
-        int listltidx = 0;
-        for (int i = 0; i < p_Dpb->ltref_frames_in_buffer; i++)
-            fs_listlt[listltidx++]=p_Dpb->fs_ltref[i];
-
-        std::qsort(fs_listlt, listltidx, sizeof(pic_t*), [](const void* a, const void* b) {
-            int idx1 = (*(pic_t**)a)->LongTermFrameIdx;
-            int idx2 = (*(pic_t**)b)->LongTermFrameIdx;
-            return idx1 - idx2;
-        });
-
-        gen_pic_list_from_frame_list(shr.bottom_field_flag, fs_listlt, listltidx, currSlice->RefPicList[0], &currSlice->RefPicSize[0], 1);
-
-        delete []fs_list0;
-        delete []fs_listlt;
-    }
-
-    // set max size
-    currSlice->RefPicSize[0] = (char) min<int>(currSlice->RefPicSize[0], shr.num_ref_idx_l0_active_minus1 + 1);
-    currSlice->RefPicSize[1] = 0;
-
-    // set the unused list entries to NULL
-    for (int i = currSlice->RefPicSize[0]; i < MAX_LIST_SIZE; i++)
-        currSlice->RefPicList[0][i] = p_Vid->no_reference_picture;
-    for (int i = currSlice->RefPicSize[1]; i < MAX_LIST_SIZE; i++)
-        currSlice->RefPicList[1][i] = p_Vid->no_reference_picture;
-}
-
-static void init_lists_b_slice(slice_t *currSlice)
-{
-    VideoParameters *p_Vid = currSlice->p_Vid;
-    dpb_t *p_Dpb = currSlice->p_Dpb;
-    shr_t& shr = currSlice->header;
-
-#if (MVC_EXTENSION_ENABLE)
-    currSlice->listinterviewidx0 = 0;
-    currSlice->listinterviewidx1 = 0;
-#endif
-
-    // B-slice_t
-    if (!shr.field_pic_flag) {
-        int list0idx = 0;
-        for (int i = 0; i < p_Dpb->ref_frames_in_buffer; i++) {
-            if (p_Dpb->fs_ref[i]->is_used == 3) {
-                if (p_Dpb->fs_ref[i]->frame->used_for_reference && !p_Dpb->fs_ref[i]->frame->is_long_term) {
-                    if (shr.PicOrderCnt >= p_Dpb->fs_ref[i]->frame->poc) //!KS use >= for error concealment
-                        currSlice->RefPicList[0][list0idx++] = p_Dpb->fs_ref[i]->frame;
-                }
-            }
-        }
-        std::qsort(currSlice->RefPicList[0], list0idx, sizeof(storable_picture*), [](const void* a, const void* b) {
-            int poc1 = (*(storable_picture**)a)->poc;
-            int poc2 = (*(storable_picture**)b)->poc;
-            return (poc1 < poc2) ? 1 : (poc1 > poc2) ? -1 : 0;
-        });
-
-        //get the backward reference picture (POC>current POC) in list0;
-        int list0idx_1 = list0idx;
-        for (int i = 0; i < p_Dpb->ref_frames_in_buffer; i++) {
-            if (p_Dpb->fs_ref[i]->is_used == 3) {
-                if (p_Dpb->fs_ref[i]->frame->used_for_reference && !p_Dpb->fs_ref[i]->frame->is_long_term) {
-                    if (shr.PicOrderCnt < p_Dpb->fs_ref[i]->frame->poc)
-                        currSlice->RefPicList[0][list0idx++] = p_Dpb->fs_ref[i]->frame;
-                }
-            }
-        }
-        std::qsort(&currSlice->RefPicList[0][list0idx_1], list0idx-list0idx_1, sizeof(storable_picture*), [](const void* a, const void* b) {
-            int poc1 = (*(storable_picture**)a)->poc;
-            int poc2 = (*(storable_picture**)b)->poc;
-            return (poc1 < poc2) ? -1 : (poc1 > poc2) ? 1 : 0;
-        });
-
-        for (int j = 0; j < list0idx_1; j++)
-            currSlice->RefPicList[1][list0idx - list0idx_1 + j] = currSlice->RefPicList[0][j];
-        for (int j = list0idx_1; j < list0idx; j++)
-            currSlice->RefPicList[1][j - list0idx_1] = currSlice->RefPicList[0][j];
-
-        currSlice->RefPicSize[0] = currSlice->RefPicSize[1] = list0idx;
-
-        // long term handling
-        for (int i = 0; i < p_Dpb->ltref_frames_in_buffer; i++) {
-            if (p_Dpb->fs_ltref[i]->is_used == 3) {
-                if (p_Dpb->fs_ltref[i]->frame->is_long_term) {
-                    currSlice->RefPicList[0][list0idx]   = p_Dpb->fs_ltref[i]->frame;
-                    currSlice->RefPicList[1][list0idx++] = p_Dpb->fs_ltref[i]->frame;
-                }
-            }
-        }
-        std::qsort(&currSlice->RefPicList[0][(int)currSlice->RefPicSize[0]], list0idx - currSlice->RefPicSize[0],
-                   sizeof(storable_picture*), [](const void* a, const void* b) {
-            int pic_num1 = (*(storable_picture**)a)->LongTermPicNum;
-            int pic_num2 = (*(storable_picture**)b)->LongTermPicNum;
-            return (pic_num1 < pic_num2) ? -1 : (pic_num1 > pic_num2) ? 1 : 0;
-        });
-        std::qsort(&currSlice->RefPicList[1][(int)currSlice->RefPicSize[0]], list0idx - currSlice->RefPicSize[0],
-                   sizeof(storable_picture*), [](const void* a, const void* b) {
-            int pic_num1 = (*(storable_picture**)a)->LongTermPicNum;
-            int pic_num2 = (*(storable_picture**)b)->LongTermPicNum;
-            return (pic_num1 < pic_num2) ? -1 : (pic_num1 > pic_num2) ? 1 : 0;
-        });
-        currSlice->RefPicSize[0] = currSlice->RefPicSize[1] = (char) list0idx;
-    } else {
-        pic_t** fs_list0  = new pic_t*[p_Dpb->size];
-        pic_t** fs_list1  = new pic_t*[p_Dpb->size];
-        pic_t** fs_listlt = new pic_t*[p_Dpb->size];
-
-        currSlice->RefPicSize[0] = 0;
-        currSlice->RefPicSize[1] = 1;
-
-        int list0idx = 0;
-        for (int i = 0; i < p_Dpb->ref_frames_in_buffer; i++) {
-            if (p_Dpb->fs_ref[i]->is_used) {
-                if (shr.PicOrderCnt >= p_Dpb->fs_ref[i]->poc)
-                    fs_list0[list0idx++] = p_Dpb->fs_ref[i];
-            }
-        }
-        std::qsort(fs_list0, list0idx, sizeof(pic_t*), [](const void* a, const void* b) {
-            int poc1 = (*(pic_t**)a)->poc;
-            int poc2 = (*(pic_t**)b)->poc;
-            return (poc1 < poc2) ? 1 : (poc1 > poc2) ? -1 : 0;
-        });
-
-        int list0idx_1 = list0idx;
-        for (int i = 0; i < p_Dpb->ref_frames_in_buffer; i++) {
-            if (p_Dpb->fs_ref[i]->is_used) {
-                if (shr.PicOrderCnt < p_Dpb->fs_ref[i]->poc)
-                    fs_list0[list0idx++] = p_Dpb->fs_ref[i];
-            }
-        }
-        std::qsort(&fs_list0[list0idx_1], list0idx-list0idx_1, sizeof(pic_t*), [](const void* a, const void* b) {
-            int poc1 = (*(pic_t**)a)->poc;
-            int poc2 = (*(pic_t**)b)->poc;
-            return (poc1 < poc2) ? -1 : (poc1 > poc2) ? 1 : 0;
-        });
-
-        for (int j = 0; j < list0idx_1; j++)
-            fs_list1[list0idx - list0idx_1 + j] = fs_list0[j];
-        for (int j = list0idx_1; j < list0idx; j++)
-            fs_list1[j - list0idx_1] = fs_list0[j];
-
-        currSlice->RefPicSize[0] = 0;
-        currSlice->RefPicSize[1] = 0;
-        gen_pic_list_from_frame_list(shr.bottom_field_flag, fs_list0, list0idx, currSlice->RefPicList[0], &currSlice->RefPicSize[0], 0);
-        gen_pic_list_from_frame_list(shr.bottom_field_flag, fs_list1, list0idx, currSlice->RefPicList[1], &currSlice->RefPicSize[1], 0);
-
-        // long term handling
-        int listltidx = 0;
-        for (int i = 0; i < p_Dpb->ltref_frames_in_buffer; i++)
-            fs_listlt[listltidx++] = p_Dpb->fs_ltref[i];
-
-        std::qsort(fs_listlt, listltidx, sizeof(pic_t*), [](const void* a, const void* b) {
-            int idx1 = (*(pic_t**)a)->LongTermFrameIdx;
-            int idx2 = (*(pic_t**)b)->LongTermFrameIdx;
-            return (idx1 < idx2) ? -1 : (idx1 > idx2) ? 1 : 0;
-        });
-
-        gen_pic_list_from_frame_list(shr.bottom_field_flag, fs_listlt, listltidx, currSlice->RefPicList[0], &currSlice->RefPicSize[0], 1);
-        gen_pic_list_from_frame_list(shr.bottom_field_flag, fs_listlt, listltidx, currSlice->RefPicList[1], &currSlice->RefPicSize[1], 1);
-
-        delete []fs_list0;
-        delete []fs_list1;
-        delete []fs_listlt;
-    }
-
-    if ((currSlice->RefPicSize[0] == currSlice->RefPicSize[1]) && (currSlice->RefPicSize[0] > 1)) {
-        // check if lists are identical, if yes swap first two elements of currSlice->RefPicList[1]
-        int diff = 0;
-        for (int j = 0; j < currSlice->RefPicSize[0]; j++) {
-            if (currSlice->RefPicList[0][j] != currSlice->RefPicList[1][j]) {
-                diff = 1;
-                break;
-            }
-        }
-        if (!diff) {
-            storable_picture *tmp_s = currSlice->RefPicList[1][0];
-            currSlice->RefPicList[1][0] = currSlice->RefPicList[1][1];
-            currSlice->RefPicList[1][1] = tmp_s;
-        }
-    }
-
-    // set max size
-    currSlice->RefPicSize[0] = min<int>(currSlice->RefPicSize[0], shr.num_ref_idx_l0_active_minus1 + 1);
-    currSlice->RefPicSize[1] = min<int>(currSlice->RefPicSize[1], shr.num_ref_idx_l1_active_minus1 + 1);
-
-    // set the unused list entries to NULL
-    for (int i = currSlice->RefPicSize[0]; i < MAX_LIST_SIZE; i++)
-        currSlice->RefPicList[0][i] = p_Vid->no_reference_picture;
-    for (int i = currSlice->RefPicSize[1]; i < MAX_LIST_SIZE; i++)
-        currSlice->RefPicList[1][i] = p_Vid->no_reference_picture;
-}
-
 
 #if (MVC_EXTENSION_ENABLE)
 
@@ -423,270 +158,178 @@ static void gen_pic_list_from_frame_interview_list(bool bottom_field_flag, pic_t
     }
 }
 
-static void init_lists_i_slice_mvc(slice_t *currSlice)
+#endif
+
+
+// Short-term reference frames by descending FrameNumWrap (8.2.4.1) for the
+// current frame_num. fs_ref is kept by descending FrameNum, so the frames
+// that wrap around only move from its front to its back.
+static int short_term_by_frame_num_wrap(dpb_t *p_Dpb, unsigned frame_num, pic_t **fs_list)
+{
+    int size  = p_Dpb->ref_frames_in_buffer;
+    int first = 0;
+    while (first < size && p_Dpb->fs_ref[first]->FrameNum > frame_num)
+        ++first;
+
+    for (int i = 0; i < size; i++)
+        fs_list[i] = p_Dpb->fs_ref[(first + i) % size];
+    return size;
+}
+
+// Short-term reference frames in the orders of 8.2.4.2.3 and 8.2.4.2.4: for
+// list 0 those not after poc by descending POC, then those after it by
+// ascending POC, and the other way round for list 1. fs_ref_poc is kept by
+// ascending POC, so both lists are read off either side of poc.
+static int short_term_by_poc(dpb_t *p_Dpb, int poc, pic_t **fs_list0, pic_t **fs_list1)
+{
+    int size   = p_Dpb->ref_frames_in_buffer;
+    int before = 0;
+    while (before < size && p_Dpb->fs_ref_poc[before]->poc <= poc)
+        ++before;
+
+    for (int i = 0; i < before; i++)
+        fs_list0[i] = fs_list1[size - before + i] = p_Dpb->fs_ref_poc[before - 1 - i];
+    for (int i = before; i < size; i++)
+        fs_list0[i] = fs_list1[i - before] = p_Dpb->fs_ref_poc[i];
+    return size;
+}
+
+static void init_lists_i_slice(slice_t *currSlice)
 {
+#if (MVC_EXTENSION_ENABLE)
     currSlice->listinterviewidx0 = 0;
     currSlice->listinterviewidx1 = 0;
-
+#endif
     currSlice->RefPicSize[0] = 0;
     currSlice->RefPicSize[1] = 0;
 }
 
-static void init_lists_p_slice_mvc(slice_t *currSlice)
+static void init_lists_p_slice(slice_t *currSlice)
 {
     VideoParameters *p_Vid = currSlice->p_Vid;
     dpb_t *p_Dpb = currSlice->p_Dpb;
     shr_t& shr = currSlice->header;
 
-    unsigned int i;
-
-    int list0idx = 0;
-    int listltidx = 0;
-
-    int currPOC = shr.PicOrderCnt;
-    int anchor_pic_flag = currSlice->anchor_pic_flag;
-
+#if (MVC_EXTENSION_ENABLE)
     currSlice->listinterviewidx0 = 0;
     currSlice->listinterviewidx1 = 0;
+#endif
+
+    pic_t* fs_list0[MAX_LIST_SIZE];
+    int list0idx = short_term_by_frame_num_wrap(p_Dpb, shr.frame_num, fs_list0);
 
     if (!shr.field_pic_flag) {
-        for (i=0; i<p_Dpb->ref_frames_in_buffer; i++) {
-            if (p_Dpb->fs_ref[i]->is_used == 3) {
-                if ((p_Dpb->fs_ref[i]->frame->used_for_reference)&&(!p_Dpb->fs_ref[i]->frame->is_long_term))
-                    currSlice->RefPicList[0][list0idx++] = p_Dpb->fs_ref[i]->frame;
-            }
+        int size = 0;
+        for (int i = 0; i < list0idx; i++) {
+            pic_t* fs = fs_list0[i];
+            if (fs->is_used == 3 && fs->frame->used_for_reference && !fs->frame->is_long_term)
+                currSlice->RefPicList[0][size++] = fs->frame;
         }
-        // order list 0 by PicNum
-        std::qsort(currSlice->RefPicList[0], list0idx, sizeof(storable_picture*), [](const void *arg1, const void *arg2) {
-            int pic_num1 = (*(storable_picture**)arg1)->PicNum;
-            int pic_num2 = (*(storable_picture**)arg2)->PicNum;
-            return (pic_num1 < pic_num2) ? 1 : (pic_num1 > pic_num2) ? -1 : 0;
-        });
-
-        currSlice->RefPicSize[0] = (char) list0idx;
 
-        // long term handling
-        for (i = 0; i < p_Dpb->ltref_frames_in_buffer; i++) {
-            if (p_Dpb->fs_ltref[i]->is_used == 3) {
-                if (p_Dpb->fs_ltref[i]->frame->is_long_term)
-                    currSlice->RefPicList[0][list0idx++]=p_Dpb->fs_ltref[i]->frame;
-            }
+        // long term handling, LongTermPicNum is LongTermFrameIdx for frames
+        for (int i = 0; i < p_Dpb->ltref_frames_in_buffer; i++) {
+            pic_t* fs = p_Dpb->fs_ltref[i];
+            if (fs->is_used == 3 && fs->frame->is_long_term)
+                currSlice->RefPicList[0][size++] = fs->frame;
         }
-        std::qsort(&currSlice->RefPicList[0][(short) currSlice->RefPicSize[0]], list0idx - currSlice->RefPicSize[0],
-                   sizeof(storable_picture*), [](const void *arg1, const void *arg2) {
-            int long_term_pic_num1 = (*(storable_picture**)arg1)->LongTermPicNum;
-            int long_term_pic_num2 = (*(storable_picture**)arg2)->LongTermPicNum;
-            return (long_term_pic_num1 < long_term_pic_num2) ? -1 : (long_term_pic_num1 > long_term_pic_num2) ? 1 : 0;
-        });
-
-        currSlice->RefPicSize[0] = (char) list0idx;
+        currSlice->RefPicSize[0] = (char) size;
     } else {
-        pic_t** fs_list0  = new pic_t*[p_Dpb->size];
-        pic_t** fs_listlt = new pic_t*[p_Dpb->size];
-
-        for (i = 0; i < p_Dpb->ref_frames_in_buffer; i++) {
-            if (p_Dpb->fs_ref[i]->is_reference)
-                fs_list0[list0idx++] = p_Dpb->fs_ref[i];
+        int size = 0;
+        for (int i = 0; i < list0idx; i++) {
+            if (fs_list0[i]->is_reference)
+                fs_list0[size++] = fs_list0[i];
         }
 
-        std::qsort(fs_list0, list0idx, sizeof(pic_t*), [](const void *arg1, const void *arg2) {
-            int frame_num_wrap1 = (*(pic_t**)arg1)->FrameNumWrap;
-            int frame_num_wrap2 = (*(pic_t**)arg2)->FrameNumWrap;
-            return (frame_num_wrap1 < frame_num_wrap2) ? 1 : (frame_num_wrap1 > frame_num_wrap2) ? -1 : 0;
-        });
-
         currSlice->RefPicSize[0] = 0;
-        gen_pic_list_from_frame_list(shr.bottom_field_flag, fs_list0, list0idx, currSlice->RefPicList[0], &currSlice->RefPicSize[0], 0);
+        gen_pic_list_from_frame_list(shr.bottom_field_flag, fs_list0, size, currSlice->RefPicList[0], &currSlice->RefPicSize[0], 0);
 
         // long term handling
-        for (i = 0; i < p_Dpb->ltref_frames_in_buffer; i++)
-            fs_listlt[listltidx++]=p_Dpb->fs_ltref[i];
-
-        std::qsort(fs_listlt, listltidx, sizeof(pic_t*), [](const void *arg1, const void *arg2) {
-            int long_term_frame_idx1 = (*(pic_t**)arg1)->LongTermFrameIdx;
-            int long_term_frame_idx2 = (*(pic_t**)arg2)->LongTermFrameIdx;
-            return (long_term_frame_idx1 < long_term_frame_idx2) ? -1 : (long_term_frame_idx1 > long_term_frame_idx2) ? 1 : 0;
-        });
-
-        gen_pic_list_from_frame_list(shr.bottom_field_flag, fs_listlt, listltidx, currSlice->RefPicList[0], &currSlice->RefPicSize[0], 1);
-
-        delete []fs_list0;
-        delete []fs_listlt;
+        gen_pic_list_from_frame_list(shr.bottom_field_flag, p_Dpb->fs_ltref, p_Dpb->ltref_frames_in_buffer,
+                                     currSlice->RefPicList[0], &currSlice->RefPicSize[0], 1);
     }
 
-    currSlice->RefPicSize[1] = 0;    
+    currSlice->RefPicSize[1] = 0;
 
-    if (currSlice->mvc_extension_flag) {
+#if (MVC_EXTENSION_ENABLE)
+    if (currSlice->view_id && currSlice->mvc_extension_flag) {
         int curr_view_id = currSlice->layer_id;
-        currSlice->fs_listinterview0 = new pic_t*[p_Dpb->size];
-        list0idx = currSlice->RefPicSize[0];
+        int list0idx = currSlice->RefPicSize[0];
         if (!shr.field_pic_flag) {
-            append_interview_list(p_Vid->p_Dpb_layer[1], false, false, 0, currSlice->fs_listinterview0, &currSlice->listinterviewidx0, currPOC, curr_view_id, anchor_pic_flag);
-            for (i = 0; i < (unsigned int)currSlice->listinterviewidx0; i++)
-                currSlice->RefPicList[0][list0idx++]=currSlice->fs_listinterview0[i]->frame;
+            append_interview_list(p_Vid->p_Dpb_layer[1], false, false, 0, currSlice->fs_listinterview0, &currSlice->listinterviewidx0,
+                                  shr.PicOrderCnt, curr_view_id, currSlice->anchor_pic_flag);
+            for (int i = 0; i < currSlice->listinterviewidx0; i++)
+                currSlice->RefPicList[0][list0idx++] = currSlice->fs_listinterview0[i]->frame;
             currSlice->RefPicSize[0] = (char) list0idx;
         } else {
-            append_interview_list(p_Vid->p_Dpb_layer[1], shr.field_pic_flag, shr.bottom_field_flag, 0, currSlice->fs_listinterview0, &currSlice->listinterviewidx0, currPOC, curr_view_id, anchor_pic_flag);
-            gen_pic_list_from_frame_interview_list(shr.bottom_field_flag, currSlice->fs_listinterview0, currSlice->listinterviewidx0, currSlice->RefPicList[0], &currSlice->RefPicSize[0]);
+            append_interview_list(p_Vid->p_Dpb_layer[1], shr.field_pic_flag, shr.bottom_field_flag, 0, currSlice->fs_listinterview0, &currSlice->listinterviewidx0,
+                                  shr.PicOrderCnt, curr_view_id, currSlice->anchor_pic_flag);
+            gen_pic_list_from_frame_interview_list(shr.bottom_field_flag, currSlice->fs_listinterview0, currSlice->listinterviewidx0,
+                                                   currSlice->RefPicList[0], &currSlice->RefPicSize[0]);
         }
     }
+#endif
 
     // set max size
     currSlice->RefPicSize[0] = (char) min<int>(currSlice->RefPicSize[0], shr.num_ref_idx_l0_active_minus1 + 1);
-    currSlice->RefPicSize[1] = (char) min<int>(currSlice->RefPicSize[1], shr.num_ref_idx_l1_active_minus1 + 1);
 
     // set the unused list entries to NULL
-    for (i = currSlice->RefPicSize[0]; i < MAX_LIST_SIZE; i++)
+    for (int i = currSlice->RefPicSize[0]; i < MAX_LIST_SIZE; i++)
         currSlice->RefPicList[0][i] = p_Vid->no_reference_picture;
-    for (i = currSlice->RefPicSize[1]; i < MAX_LIST_SIZE; i++)
+    for (int i = currSlice->RefPicSize[1]; i < MAX_LIST_SIZE; i++)
         currSlice->RefPicList[1][i] = p_Vid->no_reference_picture;
 }
 
-static void init_lists_b_slice_mvc(slice_t *currSlice)
+static void init_lists_b_slice(slice_t *currSlice)
 {
     VideoParameters *p_Vid = currSlice->p_Vid;
     dpb_t *p_Dpb = currSlice->p_Dpb;
     shr_t& shr = currSlice->header;
 
-    unsigned int i;
-    int j;
-
-    int list0idx = 0;
-    int list0idx_1 = 0;
-    int listltidx = 0;
-
-    int currPOC = shr.PicOrderCnt;
-    int anchor_pic_flag = currSlice->anchor_pic_flag;
-
+#if (MVC_EXTENSION_ENABLE)
     currSlice->listinterviewidx0 = 0;
     currSlice->listinterviewidx1 = 0;
+#endif
+
+    pic_t* fs_list0[MAX_LIST_SIZE];
+    pic_t* fs_list1[MAX_LIST_SIZE];
+    int list0idx = short_term_by_poc(p_Dpb, shr.PicOrderCnt, fs_list0, fs_list1);
 
     // B-slice_t
     if (!shr.field_pic_flag) {
-        for (i = 0; i < p_Dpb->ref_frames_in_buffer; i++) {
-            if (p_Dpb->fs_ref[i]->is_used == 3) {
-                if (p_Dpb->fs_ref[i]->frame->used_for_reference && !p_Dpb->fs_ref[i]->frame->is_long_term) {
-                    if (shr.PicOrderCnt >= p_Dpb->fs_ref[i]->frame->poc) //!KS use >= for error concealment
-                        currSlice->RefPicList[0][list0idx++] = p_Dpb->fs_ref[i]->frame;
-                }
+        for (int list = 0; list < 2; list++) {
+            pic_t** fs_list = list ? fs_list1 : fs_list0;
+            int size = 0;
+            for (int i = 0; i < list0idx; i++) {
+                pic_t* fs = fs_list[i];
+                if (fs->is_used == 3 && fs->frame->used_for_reference && !fs->frame->is_long_term)
+                    currSlice->RefPicList[list][size++] = fs->frame;
             }
-        }
-        std::qsort(currSlice->RefPicList[0], list0idx, sizeof(storable_picture*), [](const void *arg1, const void *arg2) {
-            int poc1 = (*(storable_picture**)arg1)->poc;
-            int poc2 = (*(storable_picture**)arg2)->poc;
-            return (poc1 < poc2) ? 1 : (poc1 > poc2) ? -1 : 0;
-        });
-
-        list0idx_1 = list0idx;
-        for (i = 0; i < p_Dpb->ref_frames_in_buffer; i++) {
-            if (p_Dpb->fs_ref[i]->is_used == 3) {
-                if (p_Dpb->fs_ref[i]->frame->used_for_reference && !p_Dpb->fs_ref[i]->frame->is_long_term) {
-                    if (shr.PicOrderCnt < p_Dpb->fs_ref[i]->frame->poc)
-                        currSlice->RefPicList[0][list0idx++] = p_Dpb->fs_ref[i]->frame;
-                }
-            }
-        }
-        std::qsort(&currSlice->RefPicList[0][list0idx_1], list0idx-list0idx_1,
-                   sizeof(storable_picture*), [](const void *arg1, const void *arg2) {
-            int poc1 = (*(storable_picture**)arg1)->poc;
-            int poc2 = (*(storable_picture**)arg2)->poc;
-            return (poc1 < poc2) ? -1 : (poc1 > poc2) ? 1 : 0;
-        });
 
-        for (j = 0; j < list0idx_1; j++)
-            currSlice->RefPicList[1][list0idx - list0idx_1 + j] = currSlice->RefPicList[0][j];
-        for (j = list0idx_1; j < list0idx; j++)
-            currSlice->RefPicList[1][j - list0idx_1] = currSlice->RefPicList[0][j];
-
-        currSlice->RefPicSize[0] = currSlice->RefPicSize[1] = (char) list0idx;
-
-        // long term handling
-        for (i = 0; i < p_Dpb->ltref_frames_in_buffer; i++) {
-            if (p_Dpb->fs_ltref[i]->is_used == 3) {
-                if (p_Dpb->fs_ltref[i]->frame->is_long_term) {
-                    currSlice->RefPicList[0][list0idx]   = p_Dpb->fs_ltref[i]->frame;
-                    currSlice->RefPicList[1][list0idx++] = p_Dpb->fs_ltref[i]->frame;
-                }
+            // long term handling, LongTermPicNum is LongTermFrameIdx for frames
+            for (int i = 0; i < p_Dpb->ltref_frames_in_buffer; i++) {
+                pic_t* fs = p_Dpb->fs_ltref[i];
+                if (fs->is_used == 3 && fs->frame->is_long_term)
+                    currSlice->RefPicList[list][size++] = fs->frame;
             }
+            currSlice->RefPicSize[list] = (char) size;
         }
-        std::qsort(&currSlice->RefPicList[0][(short) currSlice->RefPicSize[0]], list0idx - currSlice->RefPicSize[0],
-                   sizeof(storable_picture*), [](const void *arg1, const void *arg2) {
-            int long_term_pic_num1 = (*(storable_picture**)arg1)->LongTermPicNum;
-            int long_term_pic_num2 = (*(storable_picture**)arg2)->LongTermPicNum;
-            return (long_term_pic_num1 < long_term_pic_num2) ? -1 : (long_term_pic_num1 > long_term_pic_num2) ? 1 : 0;
-        });
-        std::qsort(&currSlice->RefPicList[1][(short) currSlice->RefPicSize[0]], list0idx - currSlice->RefPicSize[0],
-                   sizeof(storable_picture*), [](const void *arg1, const void *arg2) {
-            int long_term_pic_num1 = (*(storable_picture**)arg1)->LongTermPicNum;
-            int long_term_pic_num2 = (*(storable_picture**)arg2)->LongTermPicNum;
-            return (long_term_pic_num1 < long_term_pic_num2) ? -1 : (long_term_pic_num1 > long_term_pic_num2) ? 1 : 0;
-        });
-        currSlice->RefPicSize[0] = currSlice->RefPicSize[1] = (char) list0idx;
     } else {
-        pic_t **fs_list0  = new pic_t*[p_Dpb->size];
-        pic_t **fs_list1  = new pic_t*[p_Dpb->size];
-        pic_t **fs_listlt = new pic_t*[p_Dpb->size];
-
-        currSlice->RefPicSize[0] = 0;
-        currSlice->RefPicSize[1] = 1;
-
-        for (i = 0; i < p_Dpb->ref_frames_in_buffer; i++) {
-            if (p_Dpb->fs_ref[i]->is_used) {
-                if (shr.PicOrderCnt >= p_Dpb->fs_ref[i]->poc)
-                    fs_list0[list0idx++] = p_Dpb->fs_ref[i];
-            }
-        }
-        std::qsort(fs_list0, list0idx, sizeof(pic_t*), [](const void *arg1, const void *arg2) {
-            int poc1 = (*(pic_t**)arg1)->poc;
-            int poc2 = (*(pic_t**)arg2)->poc;
-            return (poc1 < poc2) ? 1 : (poc1 > poc2) ? -1 : 0;
-        });
-
-        list0idx_1 = list0idx;
-        for (i = 0; i < p_Dpb->ref_frames_in_buffer; i++) {
-            if (p_Dpb->fs_ref[i]->is_used) {
-                if (shr.PicOrderCnt < p_Dpb->fs_ref[i]->poc)
-                    fs_list0[list0idx++] = p_Dpb->fs_ref[i];
-            }
-        }
-        std::qsort(&fs_list0[list0idx_1], list0idx-list0idx_1, sizeof(pic_t*), [](const void *arg1, const void *arg2) {
-            int poc1 = (*(pic_t**)arg1)->poc;
-            int poc2 = (*(pic_t**)arg2)->poc;
-            return (poc1 < poc2) ? -1 : (poc1 > poc2) ? 1 : 0;
-        });
-
-        for (j = 0; j < list0idx_1; j++)
-            fs_list1[list0idx - list0idx_1 + j] = fs_list0[j];
-        for (j = list0idx_1; j < list0idx; j++)
-            fs_list1[j - list0idx_1] = fs_list0[j];
-
         currSlice->RefPicSize[0] = 0;
         currSlice->RefPicSize[1] = 0;
         gen_pic_list_from_frame_list(shr.bottom_field_flag, fs_list0, list0idx, currSlice->RefPicList[0], &currSlice->RefPicSize[0], 0);
         gen_pic_list_from_frame_list(shr.bottom_field_flag, fs_list1, list0idx, currSlice->RefPicList[1], &currSlice->RefPicSize[1], 0);
 
         // long term handling
-        for (i = 0; i < p_Dpb->ltref_frames_in_buffer; i++)
-            fs_listlt[listltidx++] = p_Dpb->fs_ltref[i];
-
-        std::qsort(fs_listlt, listltidx, sizeof(pic_t*), [](const void *arg1, const void *arg2) {
-            int long_term_frame_idx1 = (*(pic_t**)arg1)->LongTermFrameIdx;
-            int long_term_frame_idx2 = (*(pic_t**)arg2)->LongTermFrameIdx;
-            return (long_term_frame_idx1 < long_term_frame_idx2) ? -1 : (long_term_frame_idx1 > long_term_frame_idx2) ? 1 : 0;
-        });
-
-        gen_pic_list_from_frame_list(shr.bottom_field_flag, fs_listlt, listltidx, currSlice->RefPicList[0], &currSlice->RefPicSize[0], 1);
-        gen_pic_list_from_frame_list(shr.bottom_field_flag, fs_listlt, listltidx, currSlice->RefPicList[1], &currSlice->RefPicSize[1], 1);
-
-        delete []fs_list0;
-        delete []fs_list1;
-        delete []fs_listlt;
+        gen_pic_list_from_frame_list(shr.bottom_field_flag, p_Dpb->fs_ltref, p_Dpb->ltref_frames_in_buffer,
+                                     currSlice->RefPicList[0], &currSlice->RefPicSize[0], 1);
+        gen_pic_list_from_frame_list(shr.bottom_field_flag, p_Dpb->fs_ltref, p_Dpb->ltref_frames_in_buffer,
+                                     currSlice->RefPicList[1], &currSlice->RefPicSize[1], 1);
     }
 
-    if (currSlice->RefPicSize[0] == currSlice->RefPicSize[1] && currSlice->RefPicSize[0] > 1) {
+    if ((currSlice->RefPicSize[0] == currSlice->RefPicSize[1]) && (currSlice->RefPicSize[0] > 1)) {
         // check if lists are identical, if yes swap first two elements of currSlice->RefPicList[1]
         int diff = 0;
-        for (j = 0; j < currSlice->RefPicSize[0]; j++) {
+        for (int j = 0; j < currSlice->RefPicSize[0]; j++) {
             if (currSlice->RefPicList[0][j] != currSlice->RefPicList[1][j]) {
                 diff = 1;
                 break;
@@ -694,107 +337,59 @@ static void init_lists_b_slice_mvc(slice_t *currSlice)
         }
         if (!diff) {
             storable_picture *tmp_s = currSlice->RefPicList[1][0];
-            currSlice->RefPicList[1][0]=currSlice->RefPicList[1][1];
-            currSlice->RefPicList[1][1]=tmp_s;
+            currSlice->RefPicList[1][0] = currSlice->RefPicList[1][1];
+            currSlice->RefPicList[1][1] = tmp_s;
         }
     }
 
-    if (currSlice->mvc_extension_flag) {
+#if (MVC_EXTENSION_ENABLE)
+    if (currSlice->view_id && currSlice->mvc_extension_flag) {
         int curr_view_id = currSlice->view_id;
-        // B-slice_t
-        currSlice->fs_listinterview0 = new pic_t*[p_Dpb->size];
-        currSlice->fs_listinterview1 = new pic_t*[p_Dpb->size];
-        list0idx = currSlice->RefPicSize[0];
-
-        if (!shr.field_pic_flag) {
-            append_interview_list(
-                p_Vid->p_Dpb_layer[1], false, false, 0,
-                currSlice->fs_listinterview0, &currSlice->listinterviewidx0,
-                currPOC, curr_view_id, anchor_pic_flag);
-            append_interview_list(
-                p_Vid->p_Dpb_layer[1], false, false, 1,
-                currSlice->fs_listinterview1, &currSlice->listinterviewidx1,
-                currPOC, curr_view_id, anchor_pic_flag);
-            for (i = 0; i < (unsigned int)currSlice->listinterviewidx0; i++)
-                currSlice->RefPicList[0][list0idx++]=currSlice->fs_listinterview0[i]->frame;
-            currSlice->RefPicSize[0] = (char) list0idx;
-            list0idx = currSlice->RefPicSize[1];
-            for (i = 0; i < (unsigned int)currSlice->listinterviewidx1; i++)
-                currSlice->RefPicList[1][list0idx++] = currSlice->fs_listinterview1[i]->frame;
-            currSlice->RefPicSize[1] = (char) list0idx;
-        } else {
-            append_interview_list(
-                p_Vid->p_Dpb_layer[1],
-                shr.field_pic_flag, shr.bottom_field_flag, 0,
-                currSlice->fs_listinterview0, &currSlice->listinterviewidx0,
-                currPOC, curr_view_id, anchor_pic_flag);
-            gen_pic_list_from_frame_interview_list(
-                shr.bottom_field_flag, currSlice->fs_listinterview0, currSlice->listinterviewidx0,
-                currSlice->RefPicList[0], &currSlice->RefPicSize[0]);
-            append_interview_list(
-                p_Vid->p_Dpb_layer[1],
-                shr.field_pic_flag, shr.bottom_field_flag, 1,
-                currSlice->fs_listinterview1, &currSlice->listinterviewidx1,
-                currPOC, curr_view_id, anchor_pic_flag);
-            gen_pic_list_from_frame_interview_list(
-                shr.bottom_field_flag, currSlice->fs_listinterview1, currSlice->listinterviewidx1,
-                currSlice->RefPicList[1], &currSlice->RefPicSize[1]);
-        }    
+        for (int list = 0; list < 2; list++) {
+            pic_t** fs_listinterview = list ? currSlice->fs_listinterview1 : currSlice->fs_listinterview0;
+            int* listinterviewidx = list ? &currSlice->listinterviewidx1 : &currSlice->listinterviewidx0;
+            append_interview_list(p_Vid->p_Dpb_layer[1], shr.field_pic_flag, shr.bottom_field_flag, list, fs_listinterview, listinterviewidx,
+                                  shr.PicOrderCnt, curr_view_id, currSlice->anchor_pic_flag);
+            if (!shr.field_pic_flag) {
+                int size = currSlice->RefPicSize[list];
+                for (int i = 0; i < *listinterviewidx; i++)
+                    currSlice->RefPicList[list][size++] = fs_listinterview[i]->frame;
+                currSlice->RefPicSize[list] = (char) size;
+            } else
+                gen_pic_list_from_frame_interview_list(shr.bottom_field_flag, fs_listinterview, *listinterviewidx,
+                                                       currSlice->RefPicList[list], &currSlice->RefPicSize[list]);
+        }
     }
+#endif
 
     // set max size
-    currSlice->RefPicSize[0] = (char) min<int>(currSlice->RefPicSize[0], shr.num_ref_idx_l0_active_minus1 + 1);
-    currSlice->RefPicSize[1] = (char) min<int>(currSlice->RefPicSize[1], shr.num_ref_idx_l1_active_minus1 + 1);
+    currSlice->RefPicSize[0] = min<int>(currSlice->RefPicSize[0], shr.num_ref_idx_l0_active_minus1 + 1);
+    currSlice->RefPicSize[1] = min<int>(currSlice->RefPicSize[1], shr.num_ref_idx_l1_active_minus1 + 1);
 
     // set the unused list entries to NULL
-    for (i = currSlice->RefPicSize[0]; i < MAX_LIST_SIZE; i++)
+    for (int i = currSlice->RefPicSize[0]; i < MAX_LIST_SIZE; i++)
         currSlice->RefPicList[0][i] = p_Vid->no_reference_picture;
-    for (i = currSlice->RefPicSize[1]; i < MAX_LIST_SIZE; i++)
+    for (int i = currSlice->RefPicSize[1]; i < MAX_LIST_SIZE; i++)
         currSlice->RefPicList[1][i] = p_Vid->no_reference_picture;
 }
 
-#endif
-
-
 void slice_t::init_lists()
 {
-#if (MVC_EXTENSION_ENABLE)
-    if (this->view_id) {
-        switch (this->header.slice_type) {
-        case P_slice: 
-        case SP_slice:
-            init_lists_p_slice_mvc(this);
-            return;
-        case B_slice:
-            init_lists_b_slice_mvc(this);
-            return;
-        case I_slice: 
-        case SI_slice: 
-            init_lists_i_slice_mvc(this);
-            return;
-        default:
-            printf("Unsupported slice type\n");
-            break;
-        }
-    } else
-#endif
-    {
-        switch (this->header.slice_type) {
-        case P_slice:
-        case SP_slice:
-            init_lists_p_slice(this);
-            return;
-        case B_slice:
-            init_lists_b_slice(this);
-            return;
-        case I_slice:
-        case SI_slice:
-            init_lists_i_slice(this);
-            return;
-        default:
-            printf("Unsupported slice type\n");
-            break;
-        }
+    switch (this->header.slice_type) {
+    case P_slice:
+    case SP_slice:
+        init_lists_p_slice(this);
+        return;
+    case B_slice:
+        init_lists_b_slice(this);
+        return;
+    case I_slice:
+    case SI_slice:
+        init_lists_i_slice(this);
+        return;
+    default:
+        printf("Unsupported slice type\n");
+        break;
     }
 }
 
@@ -1166,7 +761,6 @@ static void reorder_lists_mvc(slice_t* currSlice, int currPOC)
 
 void slice_t::init_ref_lists()
 {
-    VideoParameters* p_Vid = this->p_Vid;
     shr_t& shr = this->header;
 
     this->init_lists();
@@ -1176,21 +770,92 @@ void slice_t::init_ref_lists()
         reorder_lists_mvc(this, shr.PicOrderCnt);
     else
         reorder_lists(this);
-
-    if (this->fs_listinterview0) {
-        delete []this->fs_listinterview0;
-        this->fs_listinterview0 = nullptr;
-    }
-    if (this->fs_listinterview1) {
-        delete []this->fs_listinterview1;
-        this->fs_listinterview1 = nullptr;
-    }
 #endif
+}
+
+// Reference of list entry ref_idx as get_ref_pic picks it, for frame
+// macroblocks (k = 0) and the field macroblocks of the top (k = 1) and the
+// bottom (k = 2) macroblock of a pair.
+static storable_picture* list_ref(slice_t* currSlice, int list, int k, int ref_idx)
+{
+    storable_picture* ref = currSlice->RefPicList[list][k == 0 ? ref_idx : ref_idx / 2];
+    if (k == 0 || !ref)
+        return ref;
+    return (k == 1) == (ref_idx % 2 == 0) ? ref->top_field : ref->bottom_field;
+}
+
+// 8.4.1.2.3 and 8.4.2.3.1: the temporal direct scale factors, the implicit
+// bi-prediction weights and the field holding the colocated motion depend on
+// the lists only, so they are derived once here rather than per block.
+void slice_t::init_list_factors()
+{
+    shr_t& shr = this->header;
+    storable_picture* dec_picture = this->dec_picture;
+
+    this->colocated_field = nullptr;
+    if (shr.slice_type != B_slice)
+        return;
+
+    storable_picture* ref = this->RefPicList[LIST_1][0];
+    if (shr.field_pic_flag) {
+        if (ref && ref->frame)
+            this->colocated_field = shr.bottom_field_flag ? ref->frame->bottom_field : ref->frame->top_field;
+    } else if (ref && ref->top_field && ref->bottom_field) {
+        this->colocated_field = abs(dec_picture->poc - ref->bottom_field->poc) >
+                                abs(dec_picture->poc - ref->top_field->poc) ?
+                                ref->top_field : ref->bottom_field;
+    }
+
+    bool implicit = this->active_pps->weighted_bipred_idc == 2;
+
+    for (int k = 0; k < (shr.MbaffFrameFlag ? 3 : 1); ++k) {
+        int num_l0 = min<int>((shr.num_ref_idx_l0_active_minus1 + 1) * (k ? 2 : 1), 32);
+        int num_l1 = min<int>((shr.num_ref_idx_l1_active_minus1 + 1) * (k ? 2 : 1), 32);
+        int cur_poc = k == 0 ? dec_picture->poc : k == 1 ? dec_picture->top_poc : dec_picture->bottom_poc;
+        int poc     = k == 0 ? shr.PicOrderCnt : k == 1 ? shr.TopFieldOrderCnt : shr.BottomFieldOrderCnt;
+
+        storable_picture* ref_pic1 = list_ref(this, LIST_1, k, 0);
+        for (int i = 0; i < num_l0; ++i) {
+            storable_picture* ref_pic0 = list_ref(this, LIST_0, k, i);
+            this->DistScaleFactor[k][i] = 9999;
+            if (!ref_pic0 || !ref_pic1 || ref_pic0->is_long_term)
+                continue;
+            int tb = clip3(-128, 127, cur_poc - ref_pic0->poc);
+            int td = clip3(-128, 127, ref_pic1->poc - ref_pic0->poc);
+            if (td != 0) {
+                int tx = (16384 + abs(td / 2)) / td;
+                this->DistScaleFactor[k][i] = clip3(-1024, 1023, (tb * tx + 32) >> 6);
+            }
+        }
 
-    // update reference flags and set current p_Vid->ref_flag
-    if (!(shr.redundant_pic_cnt != 0 && p_Vid->previous_frame_num == shr.frame_num)) {
-        for (int i = 16; i > 0; i--)
-            this->ref_flag[i] = this->ref_flag[i-1];
+        if (!implicit)
+            continue;
+        for (int i = 0; i < num_l0; ++i) {
+            storable_picture* ref_pic0 = list_ref(this, LIST_0, k, i);
+            for (int j = 0; j < num_l1; ++j) {
+                storable_picture* ref_pic1 = list_ref(this, LIST_1, k, j);
+                this->implicit_weight[k][i][j] = 32;
+                if (!ref_pic0 || !ref_pic1)
+                    continue;
+                int td = clip3(-128, 127, ref_pic1->poc - ref_pic0->poc);
+                if (td == 0 || ref_pic1->is_long_term || ref_pic0->is_long_term)
+                    continue;
+                int tb = clip3(-128, 127, poc - ref_pic0->poc);
+                int tx = (16384 + abs(td / 2)) / td;
+                int DistScaleFactor = clip3(-1024, 1023, (tx * tb + 32) >> 6);
+                if ((DistScaleFactor >> 2) >= -64 && (DistScaleFactor >> 2) <= 128)
+                    this->implicit_weight[k][i][j] = DistScaleFactor >> 2;
+            }
+        }
     }
-    this->ref_flag[0] = shr.redundant_pic_cnt == 0 ? p_Vid->Is_primary_correct : p_Vid->Is_redundant_correct;
+}
+
+void slice_t::copy_ref_lists(const slice_t& slice)
+{
+    memcpy(this->RefPicSize, slice.RefPicSize, sizeof(this->RefPicSize));
+    memcpy(this->RefPicList, slice.RefPicList, sizeof(this->RefPicList));
+    memcpy(this->RefPicId, slice.RefPicId, sizeof(this->RefPicId));
+    memcpy(this->implicit_weight, slice.implicit_weight, sizeof(this->implicit_weight));
+    memcpy(this->DistScaleFactor, slice.DistScaleFactor, sizeof(this->DistScaleFactor));
+    this->colocated_field = slice.colocated_field;
 }
@@ -0,0 +1,90 @@
+#include "thread_pool.h"
+
+
+namespace vio  {
+namespace h264 {
+
+
+thread_pool_t::thread_pool_t(int num_threads) :
+    job        { nullptr },
+    count      { 0 },
+    next       { 0 },
+    pending    { 0 },
+    generation { 0 },
+    stop       { false }
+{
+    if (num_threads <= 0)
+        num_threads = std::thread::hardware_concurrency();
+
+    for (int i = 1; i < num_threads; ++i)
+        this->workers.emplace_back(&thread_pool_t::work, this);
+}
+
+thread_pool_t::~thread_pool_t()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stop = true;
+    }
+    this->wake.notify_all();
+
+    for (std::thread& worker : this->workers)
+        worker.join();
+}
+
+void thread_pool_t::run(int count, const std::function<void(int)>& job)
+{
+    if (this->workers.empty() || count <= 1) {
+        for (int i = 0; i < count; ++i)
+            job(i);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    this->job     = &job;
+    this->count   = count;
+    this->next    = 0;
+    this->pending = count;
+    ++this->generation;
+    this->wake.notify_all();
+
+    this->drain(lock);
+    this->done.wait(lock, [this] { return this->pending == 0; });
+}
+
+void thread_pool_t::work()
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+    unsigned generation = this->generation;
+
+    while (true) {
+        this->wake.wait(lock, [&] { return this->stop || this->generation != generation; });
+        if (this->stop)
+            break;
+
+        generation = this->generation;
+        this->drain(lock);
+    }
+}
+
+// Takes indices until none is left, called and returning with the lock held
+
+void thread_pool_t::drain(std::unique_lock<std::mutex>& lock)
+{
+    while (this->next < this->count) {
+        const std::function<void(int)>& job = *this->job;
+        int i = this->next++;
+
+        lock.unlock();
+        job(i);
+        lock.lock();
+
+        if (--this->pending == 0)
+            this->done.notify_all();
+    }
+}
+
+
+}
+}
@@ -0,0 +1,52 @@
+#ifndef _THREAD_POOL_H_
+#define _THREAD_POOL_H_
+
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace vio  {
+namespace h264 {
+
+
+// Fixed set of worker threads running index-parallel jobs. The calling thread
+// takes part in the job and run() returns once every index has completed.
+// run() is not reentrant, a job must not call run() on the same pool.
+
+class thread_pool_t {
+public:
+    thread_pool_t(int num_threads);
+    ~thread_pool_t();
+
+    int         size() const { return this->workers.size() + 1; }
+
+    void        run(int count, const std::function<void(int)>& job);
+
+private:
+    void        work ();
+    void        drain(std::unique_lock<std::mutex>& lock);
+
+    std::vector<std::thread> workers;
+
+    std::mutex              mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    const std::function<void(int)>* job;
+    int         count;
+    int         next;
+    int         pending;
+    unsigned    generation;
+    bool        stop;
+};
+
+
+}
+}
+
+
+#endif /* _THREAD_POOL_H_ */
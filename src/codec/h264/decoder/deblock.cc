@@ -21,11 +21,18 @@
  * =============================================================================
  */
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "global.h"
 #include "slice.h"
 #include "macroblock.h"
 #include "neighbour.h"
 #include "decoder.h"
+#include "deblock_filter.h"
+#include "thread_pool.h"
 
 
 namespace vio  {
@@ -41,10 +48,10 @@ inline int Deblock::bs_compare_mvs(const pic_motion_params* mv_info_p, const pic
 {
     int StrValue;
 
-    storable_picture* ref_p0 = mv_info_p->ref_pic[LIST_0];
-    storable_picture* ref_q0 = mv_info_q->ref_pic[LIST_0];
-    storable_picture* ref_p1 = mv_info_p->ref_pic[LIST_1];
-    storable_picture* ref_q1 = mv_info_q->ref_pic[LIST_1];
+    int ref_p0 = mv_info_p->ref_pic_id[LIST_0];
+    int ref_q0 = mv_info_q->ref_pic_id[LIST_0];
+    int ref_p1 = mv_info_p->ref_pic_id[LIST_1];
+    int ref_q1 = mv_info_q->ref_pic_id[LIST_1];
 
     if ((ref_p0 == ref_q0 && ref_p1 == ref_q1) || (ref_p0 == ref_q1 && ref_p1 == ref_q0)) {
         // L0 and L1 reference pictures of p0 are different; q0 as well
@@ -75,18 +82,18 @@ inline int Deblock::bs_compare_mvs(const pic_motion_params* mv_info_p, const pic
 }
 
 
-void Deblock::strength_vertical(mb_t* MbQ, int edge)
+void Deblock::strength_vertical(mb_t* MbQ, deblock_params_t& dp, int edge)
 {
-    uint8_t* Strength = MbQ->strength_ver[edge];
+    uint8_t* Strength = dp.strength_ver[edge];
     int StrValue;
 
     slice_t& slice = *MbQ->p_Slice;
     shr_t& shr = slice.header;
 
-    int mvlimit = (shr.field_pic_flag || MbQ->fieldMbInFrameFlag) ? 2 : 4;
-    auto mv_info = slice.p_Vid->dec_picture->mv_info;
+    int mvlimit = (shr.field_pic_flag || dp.fieldMbInFrameFlag) ? 2 : 4;
+    auto mv_info = slice.dec_picture->mv_info;
 
-    int dy = (1 + MbQ->fieldMbInFrameFlag);
+    int dy = (1 + dp.fieldMbInFrameFlag);
 
     loc_t locQ = slice.neighbour.get_location(&slice, false, MbQ->mbAddrX, {edge * 4, 0});
     loc_t locP = locQ - loc_t{1, 0};
@@ -146,26 +153,30 @@ void Deblock::strength_vertical(mb_t* MbQ, int edge)
             StrValue = this->bs_compare_mvs(mv_info_p, mv_info_q, mvlimit);
         }
 
+        // only the left pair of an MBAFF edge changes from line to line
         locP.y += dy;
-        nbP = slice.neighbour.get_neighbour(&slice, false, locP);
-        MbP = nbP.mb;
+        if (shr.MbaffFrameFlag) {
+            nbP = slice.neighbour.get_neighbour(&slice, false, locP);
+            MbP = nbP.mb;
+        } else
+            nbP.y += dy;
 
         Strength[y] = StrValue;
     }
 }
 
-void Deblock::strength_horizontal(mb_t* MbQ, int edge)
+void Deblock::strength_horizontal(mb_t* MbQ, deblock_params_t& dp, int edge)
 {
-    uint8_t* Strength = MbQ->strength_hor[edge];
+    uint8_t* Strength = dp.strength_hor[edge];
     int StrValue;
 
     slice_t& slice = *MbQ->p_Slice;
     shr_t& shr = slice.header;
-    int mvlimit = (shr.field_pic_flag || MbQ->fieldMbInFrameFlag) ? 2 : 4;
-    pic_motion_params** mv_info = slice.p_Vid->dec_picture->mv_info;
+    int mvlimit = (shr.field_pic_flag || dp.fieldMbInFrameFlag) ? 2 : 4;
+    auto mv_info = slice.dec_picture->mv_info;
 
-    bool fieldModeInFrameFilteringFlag = MbQ->fieldMbInFrameFlag ||
-                                         ((edge == 0 || edge == 4) && MbQ->filterHorEdgeFlag[0][4]);
+    bool fieldModeInFrameFilteringFlag = dp.fieldMbInFrameFlag ||
+                                         ((edge == 0 || edge == 4) && dp.filterHorEdgeFlag[0][4]);
     int dy = (1 + fieldModeInFrameFilteringFlag);
 
     loc_t locQ = slice.neighbour.get_location(&slice, false, MbQ->mbAddrX) +
@@ -227,16 +238,16 @@ void Deblock::strength_horizontal(mb_t* MbQ, int edge)
     }
 }
 
-void Deblock::strength(mb_t* MbQ)
+void Deblock::strength(mb_t* MbQ, deblock_params_t& dp)
 {
     slice_t& slice = *MbQ->p_Slice;
     sps_t& sps = *slice.active_sps;
     shr_t& shr = slice.header;
 
     if (shr.disable_deblocking_filter_idc != 1) {
-        MbQ->fieldMbInFrameFlag = shr.MbaffFrameFlag && MbQ->mb_field_decoding_flag;
+        dp.fieldMbInFrameFlag = shr.MbaffFrameFlag && MbQ->mb_field_decoding_flag;
 
-        int dy = (1 + MbQ->fieldMbInFrameFlag);
+        int dy = (1 + dp.fieldMbInFrameFlag);
         loc_t locQ = slice.neighbour.get_location(&slice, false, MbQ->mbAddrX);
         mb_t* MbL  = slice.neighbour.get_mb(&slice, false, locQ - loc_t{1, 0});
         mb_t* MbU  = slice.neighbour.get_mb(&slice, false, locQ - loc_t{0, dy});
@@ -253,37 +264,38 @@ void Deblock::strength(mb_t* MbQ)
         }
 
         for (int chroma = 0; chroma < 2; ++chroma) {
-            MbQ->filterVerEdgeFlag[chroma][0] = filterLeftMbEdgeFlag;
-            MbQ->filterHorEdgeFlag[chroma][0] = filterTopMbEdgeFlag;
+            dp.filterVerEdgeFlag[chroma][0] = filterLeftMbEdgeFlag;
+            dp.filterHorEdgeFlag[chroma][0] = filterTopMbEdgeFlag;
             for (int edge = 1; edge < 4; ++edge) {
-                MbQ->filterVerEdgeFlag[chroma][edge] = filterInternalEdgesFlag;
-                MbQ->filterHorEdgeFlag[chroma][edge] = filterInternalEdgesFlag;
+                dp.filterVerEdgeFlag[chroma][edge] = filterInternalEdgesFlag;
+                dp.filterHorEdgeFlag[chroma][edge] = filterInternalEdgesFlag;
             }
-            MbQ->filterHorEdgeFlag[chroma][4] = filterTopMbEdgeFlag &&
+            dp.filterHorEdgeFlag[chroma][4] = filterTopMbEdgeFlag &&
                 !MbQ->mb_field_decoding_flag && MbU->mb_field_decoding_flag;
         }
 
         if (MbQ->transform_size_8x8_flag) {
-            MbQ->filterVerEdgeFlag[0][1] = MbQ->filterVerEdgeFlag[0][3] = 0;
-            MbQ->filterHorEdgeFlag[0][1] = MbQ->filterHorEdgeFlag[0][3] = 0;
+            dp.filterVerEdgeFlag[0][1] = dp.filterVerEdgeFlag[0][3] = 0;
+            dp.filterHorEdgeFlag[0][1] = dp.filterHorEdgeFlag[0][3] = 0;
         }
         if (sps.ChromaArrayType == 1) {
-            MbQ->filterVerEdgeFlag[1][2] = MbQ->filterVerEdgeFlag[1][3] = 0;
-            MbQ->filterHorEdgeFlag[1][2] = MbQ->filterHorEdgeFlag[1][3] = 0;
+            dp.filterVerEdgeFlag[1][2] = dp.filterVerEdgeFlag[1][3] = 0;
+            dp.filterHorEdgeFlag[1][2] = dp.filterHorEdgeFlag[1][3] = 0;
         } else if (sps.ChromaArrayType == 2) {
-            MbQ->filterVerEdgeFlag[1][2] = MbQ->filterVerEdgeFlag[1][3] = 0;
+            dp.filterVerEdgeFlag[1][2] = dp.filterVerEdgeFlag[1][3] = 0;
         } else if (sps.ChromaArrayType == 3 && MbQ->transform_size_8x8_flag) {
-            MbQ->filterVerEdgeFlag[1][1] = MbQ->filterVerEdgeFlag[1][3] = 0;
-            MbQ->filterHorEdgeFlag[1][1] = MbQ->filterHorEdgeFlag[1][3] = 0;
+            dp.filterVerEdgeFlag[1][1] = dp.filterVerEdgeFlag[1][3] = 0;
+            dp.filterHorEdgeFlag[1][1] = dp.filterHorEdgeFlag[1][3] = 0;
         }
 
+        // 4:2:2 chroma keeps the odd horizontal edges that an 8x8 transform drops for luma
         for (int edge = 0; edge < 4; ++edge) {
-            if (MbQ->filterVerEdgeFlag[0][edge])
-                this->strength_vertical(MbQ, edge);
-            if (MbQ->filterHorEdgeFlag[0][edge])
-                this->strength_horizontal(MbQ, edge);
-            if (edge == 0 && MbQ->filterHorEdgeFlag[0][4])
-                this->strength_horizontal(MbQ, 4);
+            if (dp.filterVerEdgeFlag[0][edge])
+                this->strength_vertical(MbQ, dp, edge);
+            if (dp.filterHorEdgeFlag[0][edge] || (sps.ChromaArrayType == 2 && dp.filterHorEdgeFlag[1][edge]))
+                this->strength_horizontal(MbQ, dp, edge);
+            if (edge == 0 && dp.filterHorEdgeFlag[0][4])
+                this->strength_horizontal(MbQ, dp, 4);
         }
     }
 }
@@ -324,114 +336,24 @@ static const uint8_t TABLE_TC0[52][3] = {
 };
 
 
-void Deblock::filter_strong(px_t *pixQ, int width, int alpha, int beta, int bS, bool chromaStyleFilteringFlag)
-{
-#define p(i) (pixQ[- (i + 1) * width])
-#define q(i) (pixQ[  (i    ) * width])
-    bool filterSamplesFlag = bS != 0 && abs(p(0) - q(0)) < alpha
-                                     && abs(p(1) - p(0)) < beta
-                                     && abs(q(1) - q(0)) < beta;
-
-    if (filterSamplesFlag && bS == 4) {
-        int ap = abs(p(2) - p(0));
-        int aq = abs(q(2) - q(0));
-        int p0, p1, p2;
-        int q0, q1, q2;
-
-        if (chromaStyleFilteringFlag == 0 && ap < beta && abs(p(0) - q(0)) < (alpha >> 2) + 2) {
-            p0 = (p(2) + 2 * p(1) + 2 * p(0) + 2 * q(0) + q(1) + 4) >> 3;
-            p1 = (p(2) + p(1) + p(0) + q(0) + 2) >> 2;
-            p2 = (2 * p(3) + 3 * p(2) + p(1) + p(0) + q(0) + 4) >> 3;
-        } else {
-            p0 = (2 * p(1) + p(0) + q(1) + 2) >> 2;
-            p1 = p(1);
-            p2 = p(2);
-        }
-
-        if (chromaStyleFilteringFlag == 0 && aq < beta && abs(p(0) - q(0)) < (alpha >> 2) + 2) {
-            q0 = (p(1) + 2 * p(0) + 2 * q(0) + 2 * q(1) + q(2) + 4) >> 3;
-            q1 = (p(0) + q(0) + q(1) + q(2) + 2) >> 2;
-            q2 = (2 * q(3) + 3 * q(2) + q(1) + q(0) + p(0) + 4) >> 3;
-        } else {
-            q0 = (2 * q(1) + q(0) + p(1) + 2) >> 2;
-            q1 = q(1);
-            q2 = q(2);
-        }
-
-        p(0) = p0;
-        p(1) = p1;
-        p(2) = p2;
-        q(0) = q0;
-        q(1) = q1;
-        q(2) = q2;
-    }
-#undef p
-#undef q
-}
-
-void Deblock::filter_normal(px_t *pixQ, int width, int alpha, int beta, int bS, bool chromaStyleFilteringFlag, int tc0, int BitDepth)
-{
-#define p(i) (pixQ[- (i + 1) * width])
-#define q(i) (pixQ[  (i    ) * width])
-    bool filterSamplesFlag = bS != 0 && abs(p(0) - q(0)) < alpha
-                                     && abs(p(1) - p(0)) < beta
-                                     && abs(q(1) - q(0)) < beta;
-
-    if (filterSamplesFlag && bS < 4) {
-        int tc, delta;
-        int ap, aq;
-        int p0, p1;
-        int q0, q1;
-
-        ap = abs(p(2) - p(0));
-        aq = abs(q(2) - q(0));
-        if (chromaStyleFilteringFlag == 0)
-            tc = tc0 + (ap < beta ? 1 : 0) + (aq < beta ? 1 : 0);
-        else
-            tc = tc0 + 1;
-        delta = clip3(-tc, tc, ((((q(0) - p(0)) << 2) + (p(1) - q(1)) + 4) >> 3));
-
-#define Clip1(x) (clip3(0, (1 << BitDepth) - 1, x))
-        p0 = Clip1(p(0) + delta);
-        q0 = Clip1(q(0) - delta);
-#undef Clip1
-
-        if (chromaStyleFilteringFlag == 0 && ap < beta)
-            p1 = p(1) + clip3(-tc0, tc0, (p(2) + ((p(0) + q(0) + 1) >> 1) - (p(1) << 1)) >> 1);
-        else
-            p1 = p(1);
-        if (chromaStyleFilteringFlag == 0 && aq < beta)
-            q1 = q(1) + clip3(-tc0, tc0, (q(2) + ((p(0) + q(0) + 1) >> 1) - (q(1) << 1)) >> 1);
-        else
-            q1 = q(1);
-
-        p(0) = p0;
-        p(1) = p1;
-        q(0) = q0;
-        q(1) = q1;
-    }
-#undef p
-#undef q
-}
-
-
-void Deblock::filter_edge(mb_t* MbQ, bool chromaEdgeFlag, ColorPlane pl, bool verticalEdgeFlag, bool fieldModeInFrameFilteringFlag, int edge)
+template <typename px_t>
+void Deblock::filter_edge(mb_t* MbQ, const deblock_params_t& dp, bool chromaEdgeFlag, ColorPlane pl, bool verticalEdgeFlag, bool fieldModeInFrameFilteringFlag, int edge)
 {
     slice_t& slice = *MbQ->p_Slice;
     sps_t& sps = *slice.active_sps;
     bool chromaStyleFilteringFlag = chromaEdgeFlag && (sps.ChromaArrayType != 3);
 
-    px_t** Img = pl ? slice.dec_picture->imgUV[pl - 1] : slice.dec_picture->imgY;
+    px_t** Img = slice.dec_picture->img<px_t>(pl);
     int width    = chromaEdgeFlag == 0 ? slice.dec_picture->iLumaStride : slice.dec_picture->iChromaStride;
     int nE       = chromaEdgeFlag == 0 ? 16 : (verticalEdgeFlag == 1 ? sps.MbHeightC : sps.MbWidthC);
     int BitDepth = chromaEdgeFlag == 0 ? sps.BitDepthY : sps.BitDepthC;
 
-    uint8_t* Strength;
+    const uint8_t* Strength;
     if (verticalEdgeFlag)
-        Strength = MbQ->strength_ver[edge == 1 ? 4 : edge * 4 / (chromaEdgeFlag == 0 ? 16 : sps.MbWidthC)];
+        Strength = dp.strength_ver[edge == 1 ? 4 : edge * 4 / (chromaEdgeFlag == 0 ? 16 : sps.MbWidthC)];
     else
-        Strength = MbQ->strength_hor[edge == 1 ? 4 : edge * 4 / (chromaEdgeFlag == 0 ? 16 : sps.MbHeightC)];
-    uint64_t* bS64 = (uint64_t*)Strength;
+        Strength = dp.strength_hor[edge == 1 ? 4 : edge * 4 / (chromaEdgeFlag == 0 ? 16 : sps.MbHeightC)];
+    const uint64_t* bS64 = (const uint64_t*)Strength;
     if (bS64[0] == 0 && bS64[1] == 0)
         return;
 
@@ -456,12 +378,36 @@ void Deblock::filter_edge(mb_t* MbQ, bool chromaEdgeFlag, ColorPlane pl, bool ve
 
     bool mixed = verticalEdgeFlag && (!MbQ->mb_field_decoding_flag && MbP->mb_field_decoding_flag);
 
+#if defined(__SSE2__)
+    // Unless the left pair of an MBAFF vertical edge is looked up per line,
+    // one MbP and so one set of thresholds covers the whole edge
+    if (!(verticalEdgeFlag && slice.header.MbaffFrameFlag) && BitDepth <= 12) {
+        int qPp    = pl ? MbP->QpC[pl - 1] : MbP->QpY;
+        int qPq    = pl ? MbQ->QpC[pl - 1] : MbQ->QpY;
+        int qPav   = (qPp + qPq + 1) >> 1;
+        int indexA = clip3(0, 51, qPav + MbQ->p_Slice->header.FilterOffsetA);
+        int indexB = clip3(0, 51, qPav + MbQ->p_Slice->header.FilterOffsetB);
+        int alpha  = TABLE_ALPHA[indexA] * (1 << (BitDepth - 8));
+        int beta   = TABLE_BETA [indexB] * (1 << (BitDepth - 8));
+
+        int16_t bS[16], tc0[16];
+        for (int pel = 0; pel < nE; ++pel) {
+            bS [pel] = Strength[nE == 8 ? pel << 1 : pel];
+            tc0[pel] = bS[pel] > 0 && bS[pel] < 4 ? TABLE_TC0[indexA][bS[pel] - 1] * (1 << (BitDepth - 8)) : 0;
+        }
+        for (int pel = 0; pel < nE; pel += 8)
+            filter_lines(SrcPtrQ + pel * nxtQ, incQ, nxtQ, verticalEdgeFlag,
+                         bS + pel, tc0 + pel, alpha, beta, chromaStyleFilteringFlag, BitDepth);
+        return;
+    }
+#endif
+
     for (int pel = 0; pel < nE; ++pel) {
         int StrengthIdx = (nE == 8) ? (pel << 1) + (mixed && (pel & 1)) : pel;
         int bS = Strength[StrengthIdx];
 
         if (bS > 0) {
-            if (verticalEdgeFlag) {
+            if (verticalEdgeFlag && slice.header.MbaffFrameFlag) {
                 yJ = yI + dy * pel * (chromaEdgeFlag == 0 ? 1 : sps.SubHeightC);
                 MbP = slice.neighbour.get_mb(&slice, false, {xJ, yJ + (chromaEdgeFlag && mixed && (pel & 1))});
             }
@@ -475,17 +421,18 @@ void Deblock::filter_edge(mb_t* MbQ, bool chromaEdgeFlag, ColorPlane pl, bool ve
             int beta   = TABLE_BETA [indexB] * (1 << (BitDepth - 8));
 
             if (bS == 4)
-                this->filter_strong(SrcPtrQ, incQ, alpha, beta, bS, chromaStyleFilteringFlag);
+                filter_strong(SrcPtrQ, incQ, alpha, beta, bS, chromaStyleFilteringFlag);
             else if (bS > 0) {
                 int tc0 = TABLE_TC0[indexA][bS - 1] * (1 << (BitDepth - 8));
-                this->filter_normal(SrcPtrQ, incQ, alpha, beta, bS, chromaStyleFilteringFlag, tc0, BitDepth);
+                filter_normal(SrcPtrQ, incQ, alpha, beta, bS, chromaStyleFilteringFlag, tc0, BitDepth);
             }
         }
         SrcPtrQ += nxtQ;
     }
 }
 
-void Deblock::filter_vertical(mb_t* MbQ)
+template <typename px_t>
+void Deblock::filter_vertical(mb_t* MbQ, const deblock_params_t& dp)
 {
     slice_t& slice = *MbQ->p_Slice;
     sps_t& sps = *slice.active_sps;
@@ -493,17 +440,18 @@ void Deblock::filter_vertical(mb_t* MbQ)
 
     if (shr.disable_deblocking_filter_idc != 1) {
         for (int edge = 0; edge < 4; ++edge) {
-            if (MbQ->filterVerEdgeFlag[0][edge])
-                this->filter_edge(MbQ, false, PLANE_Y, true, MbQ->fieldMbInFrameFlag, edge * 4);
-            if (sps.ChromaArrayType != 0 && MbQ->filterVerEdgeFlag[1][edge]) {
-                this->filter_edge(MbQ, true, PLANE_U, true, MbQ->fieldMbInFrameFlag, edge * 4);
-                this->filter_edge(MbQ, true, PLANE_V, true, MbQ->fieldMbInFrameFlag, edge * 4);
+            if (dp.filterVerEdgeFlag[0][edge])
+                this->filter_edge<px_t>(MbQ, dp, false, PLANE_Y, true, dp.fieldMbInFrameFlag, edge * 4);
+            if (sps.ChromaArrayType != 0 && dp.filterVerEdgeFlag[1][edge]) {
+                this->filter_edge<px_t>(MbQ, dp, true, PLANE_U, true, dp.fieldMbInFrameFlag, edge * 4);
+                this->filter_edge<px_t>(MbQ, dp, true, PLANE_V, true, dp.fieldMbInFrameFlag, edge * 4);
             }
         }
     }
 }
 
-void Deblock::filter_horizontal(mb_t* MbQ)
+template <typename px_t>
+void Deblock::filter_horizontal(mb_t* MbQ, const deblock_params_t& dp)
 {
     slice_t& slice = *MbQ->p_Slice;
     sps_t& sps = *slice.active_sps;
@@ -511,47 +459,100 @@ void Deblock::filter_horizontal(mb_t* MbQ)
 
     if (shr.disable_deblocking_filter_idc != 1) {
         for (int edge = 0; edge < 4; ++edge) {
-            if (MbQ->filterHorEdgeFlag[0][edge]) {
-                if (!((edge == 0) && MbQ->filterHorEdgeFlag[0][4]))
-                    this->filter_edge(MbQ, false, PLANE_Y, false, MbQ->fieldMbInFrameFlag, edge * 4);
+            if (dp.filterHorEdgeFlag[0][edge]) {
+                if (!((edge == 0) && dp.filterHorEdgeFlag[0][4]))
+                    this->filter_edge<px_t>(MbQ, dp, false, PLANE_Y, false, dp.fieldMbInFrameFlag, edge * 4);
                 else {
-                    this->filter_edge(MbQ, false, PLANE_Y, false, true, 0);
-                    this->filter_edge(MbQ, false, PLANE_Y, false, true, 1);
+                    this->filter_edge<px_t>(MbQ, dp, false, PLANE_Y, false, true, 0);
+                    this->filter_edge<px_t>(MbQ, dp, false, PLANE_Y, false, true, 1);
                 }
             }
-            if (sps.ChromaArrayType != 0 && MbQ->filterHorEdgeFlag[1][edge]) {
-                if (!((edge == 0) && MbQ->filterHorEdgeFlag[1][4])) {
-                    this->filter_edge(MbQ, true, PLANE_U, false, MbQ->fieldMbInFrameFlag, edge * 4);
-                    this->filter_edge(MbQ, true, PLANE_V, false, MbQ->fieldMbInFrameFlag, edge * 4);
+            if (sps.ChromaArrayType != 0 && dp.filterHorEdgeFlag[1][edge]) {
+                if (!((edge == 0) && dp.filterHorEdgeFlag[1][4])) {
+                    this->filter_edge<px_t>(MbQ, dp, true, PLANE_U, false, dp.fieldMbInFrameFlag, edge * 4);
+                    this->filter_edge<px_t>(MbQ, dp, true, PLANE_V, false, dp.fieldMbInFrameFlag, edge * 4);
                 } else {
-                    this->filter_edge(MbQ, true, PLANE_U, false, true, 0);
-                    this->filter_edge(MbQ, true, PLANE_U, false, true, 1);
-                    this->filter_edge(MbQ, true, PLANE_V, false, true, 0);
-                    this->filter_edge(MbQ, true, PLANE_V, false, true, 1);
+                    this->filter_edge<px_t>(MbQ, dp, true, PLANE_U, false, true, 0);
+                    this->filter_edge<px_t>(MbQ, dp, true, PLANE_U, false, true, 1);
+                    this->filter_edge<px_t>(MbQ, dp, true, PLANE_V, false, true, 0);
+                    this->filter_edge<px_t>(MbQ, dp, true, PLANE_V, false, true, 1);
                 }
             }
         }
     }
 }
 
-void Deblock::deblock_pic(VideoParameters* p_Vid)
+// Strengths only read macroblock data, which filtering leaves alone, so they
+// are derived for each macroblock right before it is filtered. Filtering of a
+// macroblock modifies the bottom of the one above and the right of the one to
+// its left, so rows are filtered as a wavefront with each row kept two
+// macroblocks (pairs for MBAFF) behind the row above it. Once a row is done
+// the one above it is final, and is padded while it is still in cache.
+// Pictures decoded on the pipeline publish their final rows in order to
+// the pictures predicting from them.
+
+template <typename px_t>
+void Deblock::deblock_pic(VideoParameters* p_Vid, storable_picture* pic, bool pad)
 {
-    slice_t* slice = p_Vid->dec_picture->slice_headers[0];
+    slice_t* slice = pic->slice_headers[0];
+    sps_t& sps = *slice->active_sps;
     shr_t& shr = slice->header;
     mb_t* mb_data = slice->neighbour.mb_data;
 
-    for (int mbAddr = 0; mbAddr < shr.PicSizeInMbs; ++mbAddr) {
-        mb_t* mb = &mb_data[mbAddr];
-        this->strength(mb);
-    }
-    for (int mbAddr = 0; mbAddr < shr.PicSizeInMbs; ++mbAddr) {
-        mb_t* mb = &mb_data[mbAddr];
-        this->filter_vertical(mb);
-        this->filter_horizontal(mb);
-    }
+    int width  = sps.PicWidthInMbs;
+    int pairs  = 1 + shr.MbaffFrameFlag;
+    int height = shr.PicSizeInMbs / (width * pairs);
+
+    std::vector<std::atomic<int>> progress(height);
+    for (auto& done : progress)
+        done.store(0, std::memory_order_relaxed);
+
+    std::mutex final_mutex;
+    std::vector<bool> final(height);
+    int  frontier = 0;
+    auto finish   = [&](int row) {
+        if (!pic->progress)
+            return;
+        std::lock_guard<std::mutex> lock(final_mutex);
+        final[row] = true;
+        while (frontier < height && final[frontier])
+            ++frontier;
+        pic->publish_rows(frontier * 16 * pairs);
+    };
+
+    p_Vid->threads->run(height, [&](int row) {
+        mb_t* mb = &mb_data[row * width * pairs];
+        deblock_params_t dp;
+        for (int x = 0; x < width; ++x) {
+            if (row > 0) {
+                int needed = min(x + 2, width);
+                while (progress[row - 1].load(std::memory_order_acquire) < needed)
+                    std::this_thread::yield();
+            }
+            for (int i = 0; i < pairs; ++i) {
+                this->strength(mb, dp);
+                this->filter_vertical<px_t>(mb, dp);
+                this->filter_horizontal<px_t>(mb, dp);
+                ++mb;
+            }
+            progress[row].store(x + 1, std::memory_order_release);
+        }
+        int lines = 16 * pairs;
+        if (row > 0) {
+            if (pad)
+                pic->pad_rows((row - 1) * lines, row * lines);
+            finish(row - 1);
+        }
+        if (row == height - 1) {
+            if (pad)
+                pic->pad_rows(row * lines, (row + 1) * lines);
+            finish(row);
+        }
+    });
 }
 
 
+template <typename px_t>
 void Deblock::make_frame_picture_JV(VideoParameters *p_Vid)
 {
     sps_t* sps = p_Vid->active_sps;
@@ -563,13 +564,24 @@ void Deblock::make_frame_picture_JV(VideoParameters *p_Vid)
         memcpy(&p_Vid->dec_picture->JVmv_info[PLANE_Y][0][0], &p_Vid->dec_picture_JV[PLANE_Y]->mv_info[0][0], nsize);
         memcpy(&p_Vid->dec_picture->JVmv_info[PLANE_U][0][0], &p_Vid->dec_picture_JV[PLANE_U]->mv_info[0][0], nsize);
         memcpy(&p_Vid->dec_picture->JVmv_info[PLANE_V][0][0], &p_Vid->dec_picture_JV[PLANE_V]->mv_info[0][0], nsize);
+
+        // the chroma planes' reference ids index their own pictures' tables
+        for (int pl = PLANE_U; pl <= PLANE_V; ++pl) {
+            pic_motion_params* mv_info = &p_Vid->dec_picture->JVmv_info[pl][0][0];
+            for (int i = 0; i < nsize / (int)sizeof(pic_motion_params); ++i) {
+                for (int list = 0; list < 2; ++list) {
+                    uint8_t& id = mv_info[i].ref_pic_id[list];
+                    id = p_Vid->dec_picture->ref_pic_id(p_Vid->dec_picture_JV[pl]->ref_pics[id]);
+                }
+            }
+        }
     }
 
     // This could be done with pointers and seems not necessary
     for (int uv = 0; uv < 2; uv++) {
         for (int line = 0; line < sps->FrameHeightInMbs * 16; line++) {
             int nsize = sizeof(px_t) * sps->PicWidthInMbs * 16;
-            memcpy(p_Vid->dec_picture->imgUV[uv][line], p_Vid->dec_picture_JV[uv+1]->imgY[line], nsize);
+            memcpy(p_Vid->dec_picture->img<px_t>(1 + uv)[line], p_Vid->dec_picture_JV[uv+1]->img<px_t>(0)[line], nsize);
         }
         if (p_Vid->dec_picture_JV[uv + 1]) {
             delete p_Vid->dec_picture_JV[uv + 1];
@@ -578,6 +590,7 @@ void Deblock::make_frame_picture_JV(VideoParameters *p_Vid)
     }
 }
 
+template <typename px_t>
 static void update_mbaff_macroblock_data(px_t **cur_img, px_t (*temp)[16], int x0, int width, int height)
 {
     px_t (*temp_evn)[16] = temp;
@@ -593,18 +606,22 @@ static void update_mbaff_macroblock_data(px_t **cur_img, px_t (*temp)[16], int x
     }
 }
 
+// Field macroblock pairs are decoded as a field each, interleave their rows.
+// The flags are read from the macroblocks, those of the picture being taken
+// away once it is no longer used for reference.
+template <typename px_t>
 static void MbAffPostProc(storable_picture& pic)
 {
     sps_t& sps = *pic.sps;
     slice_t& first_slice = *pic.slice_headers[0];
 
-    px_t**  imgY  = pic.imgY;
-    px_t*** imgUV = pic.imgUV;
+    px_t**  imgY  = pic.img<px_t>(0);
+    px_t**  imgUV[2] = {pic.img<px_t>(1), pic.img<px_t>(2)};
 
     px_t temp_buffer[32][16];
 
     for (int mbAddr = 0; mbAddr < sps.PicWidthInMbs * sps.FrameHeightInMbs; mbAddr += 2) {
-        if (pic.motion.mb_field_decoding_flag[mbAddr]) {
+        if (first_slice.neighbour.mb_data[mbAddr].mb_field_decoding_flag) {
             loc_t loc = first_slice.neighbour.get_location(&first_slice, false, mbAddr);
             update_mbaff_macroblock_data(imgY + loc.y, temp_buffer, loc.x, 16, 16);
 
@@ -619,14 +636,24 @@ static void MbAffPostProc(storable_picture& pic)
     }
 }
 
-void Deblock::deblock(VideoParameters *p_Vid)
+// Returns whether the picture was filtered, and padded as pad says.
+bool Deblock::deblock(VideoParameters *p_Vid, storable_picture* pic, bool pad)
+{
+    if (pic->px_size == 1)
+        return this->deblock<uint8_t >(p_Vid, pic, pad);
+    else
+        return this->deblock<uint16_t>(p_Vid, pic, pad);
+}
+
+template <typename px_t>
+bool Deblock::deblock(VideoParameters *p_Vid, storable_picture* p, bool pad)
 {
-    storable_picture& pic = *p_Vid->dec_picture;
+    storable_picture& pic = *p;
     sps_t& sps = *pic.sps;
     slice_t& first_slice = *pic.slice_headers[0];
 
     if (first_slice.header.MbaffFrameFlag)
-        MbAffPostProc(pic);
+        MbAffPostProc<px_t>(pic);
 
     int iDeblockMode = 1;
     for (auto slice : pic.slice_headers) {
@@ -637,22 +664,26 @@ void Deblock::deblock(VideoParameters *p_Vid)
 #endif
     }
 
-    if (!iDeblockMode && (0x03 & (1 << pic.used_for_reference))) {
+    bool filtered = false;
+    if (!iDeblockMode) {
         if (sps.separate_colour_plane_flag) {
             int colour_plane_id = first_slice.header.colour_plane_id;
             for (int nplane = 0; nplane < 3; ++nplane) {
                 first_slice.header.colour_plane_id = nplane;
                 p_Vid->mb_data     = p_Vid->mb_data_JV    [nplane];
                 p_Vid->dec_picture = p_Vid->dec_picture_JV[nplane];
-                this->deblock_pic(p_Vid);
+                this->deblock_pic<px_t>(p_Vid, p_Vid->dec_picture, false);
             }
             first_slice.header.colour_plane_id = colour_plane_id;
-        } else
-            this->deblock_pic(p_Vid);
+        } else {
+            this->deblock_pic<px_t>(p_Vid, &pic, pad);
+            filtered = true;
+        }
     }
 
     if (sps.separate_colour_plane_flag)
-        this->make_frame_picture_JV(p_Vid);
+        this->make_frame_picture_JV<px_t>(p_Vid);
+    return filtered;
 }
 
 
@@ -0,0 +1,311 @@
+/*
+ * =============================================================================
+ *
+ *   This confidential and proprietary software may be used only
+ *  as authorized by a licensing agreement from Thumb o'Cat Inc.
+ *  In the event of publication, the following notice is applicable:
+ * 
+ *       Copyright (C) 2013 - 2013 Thumb o'Cat
+ *                     All right reserved.
+ * 
+ *   The entire notice above must be reproduced on all authorized copies.
+ *
+ * =============================================================================
+ *
+ *  File      : deblock_filter.h
+ *  Author(s) : Luuvish
+ *  Version   : 1.0
+ *  Revision  :
+ *      1.0 June 16, 2013    first release
+ *
+ * =============================================================================
+ */
+
+#ifndef _VIO_H264_DEBLOCK_FILTER_H_
+#define _VIO_H264_DEBLOCK_FILTER_H_
+
+
+#include <cstdint>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "defines.h"
+
+
+namespace vio  {
+namespace h264 {
+
+
+// Sample filters of 8.7.2.3 and 8.7.2.4 across one edge, free of any decoder
+// state so that test/h264/deblock_check.cc can compare them with each other.
+
+template <typename px_t>
+void filter_strong(px_t *pixQ, int width, int alpha, int beta, int bS, bool chromaStyleFilteringFlag)
+{
+#define p(i) (pixQ[- (i + 1) * width])
+#define q(i) (pixQ[  (i    ) * width])
+    bool filterSamplesFlag = bS != 0 && abs(p(0) - q(0)) < alpha
+                                     && abs(p(1) - p(0)) < beta
+                                     && abs(q(1) - q(0)) < beta;
+
+    if (filterSamplesFlag && bS == 4) {
+        int ap = abs(p(2) - p(0));
+        int aq = abs(q(2) - q(0));
+        int p0, p1, p2;
+        int q0, q1, q2;
+
+        if (chromaStyleFilteringFlag == 0 && ap < beta && abs(p(0) - q(0)) < (alpha >> 2) + 2) {
+            p0 = (p(2) + 2 * p(1) + 2 * p(0) + 2 * q(0) + q(1) + 4) >> 3;
+            p1 = (p(2) + p(1) + p(0) + q(0) + 2) >> 2;
+            p2 = (2 * p(3) + 3 * p(2) + p(1) + p(0) + q(0) + 4) >> 3;
+        } else {
+            p0 = (2 * p(1) + p(0) + q(1) + 2) >> 2;
+            p1 = p(1);
+            p2 = p(2);
+        }
+
+        if (chromaStyleFilteringFlag == 0 && aq < beta && abs(p(0) - q(0)) < (alpha >> 2) + 2) {
+            q0 = (p(1) + 2 * p(0) + 2 * q(0) + 2 * q(1) + q(2) + 4) >> 3;
+            q1 = (p(0) + q(0) + q(1) + q(2) + 2) >> 2;
+            q2 = (2 * q(3) + 3 * q(2) + q(1) + q(0) + p(0) + 4) >> 3;
+        } else {
+            q0 = (2 * q(1) + q(0) + p(1) + 2) >> 2;
+            q1 = q(1);
+            q2 = q(2);
+        }
+
+        p(0) = p0;
+        p(1) = p1;
+        p(2) = p2;
+        q(0) = q0;
+        q(1) = q1;
+        q(2) = q2;
+    }
+#undef p
+#undef q
+}
+
+template <typename px_t>
+void filter_normal(px_t *pixQ, int width, int alpha, int beta, int bS, bool chromaStyleFilteringFlag, int tc0, int BitDepth)
+{
+#define p(i) (pixQ[- (i + 1) * width])
+#define q(i) (pixQ[  (i    ) * width])
+    bool filterSamplesFlag = bS != 0 && abs(p(0) - q(0)) < alpha
+                                     && abs(p(1) - p(0)) < beta
+                                     && abs(q(1) - q(0)) < beta;
+
+    if (filterSamplesFlag && bS < 4) {
+        int tc, delta;
+        int ap, aq;
+        int p0, p1;
+        int q0, q1;
+
+        ap = abs(p(2) - p(0));
+        aq = abs(q(2) - q(0));
+        if (chromaStyleFilteringFlag == 0)
+            tc = tc0 + (ap < beta ? 1 : 0) + (aq < beta ? 1 : 0);
+        else
+            tc = tc0 + 1;
+        delta = clip3(-tc, tc, ((((q(0) - p(0)) << 2) + (p(1) - q(1)) + 4) >> 3));
+
+#define Clip1(x) (clip3(0, (1 << BitDepth) - 1, x))
+        p0 = Clip1(p(0) + delta);
+        q0 = Clip1(q(0) - delta);
+#undef Clip1
+
+        if (chromaStyleFilteringFlag == 0 && ap < beta)
+            p1 = p(1) + clip3(-tc0, tc0, (p(2) + ((p(0) + q(0) + 1) >> 1) - (p(1) << 1)) >> 1);
+        else
+            p1 = p(1);
+        if (chromaStyleFilteringFlag == 0 && aq < beta)
+            q1 = q(1) + clip3(-tc0, tc0, (q(2) + ((p(0) + q(0) + 1) >> 1) - (q(1) << 1)) >> 1);
+        else
+            q1 = q(1);
+
+        p(0) = p0;
+        p(1) = p1;
+        q(0) = q0;
+        q(1) = q1;
+    }
+#undef p
+#undef q
+}
+
+
+#if defined(__SSE2__)
+
+// Filters 8 lines across one edge at once, one line per 16-bit lane. Lines
+// run along nxtQ and the samples of a line are incQ apart, as in filter_edge.
+// The intermediate sums fit in 16 bits up to a bit depth of 12.
+
+static inline void transpose_8x8(__m128i v[8])
+{
+    __m128i t0 = _mm_unpacklo_epi16(v[0], v[1]);
+    __m128i t1 = _mm_unpackhi_epi16(v[0], v[1]);
+    __m128i t2 = _mm_unpacklo_epi16(v[2], v[3]);
+    __m128i t3 = _mm_unpackhi_epi16(v[2], v[3]);
+    __m128i t4 = _mm_unpacklo_epi16(v[4], v[5]);
+    __m128i t5 = _mm_unpackhi_epi16(v[4], v[5]);
+    __m128i t6 = _mm_unpacklo_epi16(v[6], v[7]);
+    __m128i t7 = _mm_unpackhi_epi16(v[6], v[7]);
+
+    __m128i u0 = _mm_unpacklo_epi32(t0, t2);
+    __m128i u1 = _mm_unpackhi_epi32(t0, t2);
+    __m128i u2 = _mm_unpacklo_epi32(t1, t3);
+    __m128i u3 = _mm_unpackhi_epi32(t1, t3);
+    __m128i u4 = _mm_unpacklo_epi32(t4, t6);
+    __m128i u5 = _mm_unpackhi_epi32(t4, t6);
+    __m128i u6 = _mm_unpacklo_epi32(t5, t7);
+    __m128i u7 = _mm_unpackhi_epi32(t5, t7);
+
+    v[0] = _mm_unpacklo_epi64(u0, u4);
+    v[1] = _mm_unpackhi_epi64(u0, u4);
+    v[2] = _mm_unpacklo_epi64(u1, u5);
+    v[3] = _mm_unpackhi_epi64(u1, u5);
+    v[4] = _mm_unpacklo_epi64(u2, u6);
+    v[5] = _mm_unpackhi_epi64(u2, u6);
+    v[6] = _mm_unpacklo_epi64(u3, u7);
+    v[7] = _mm_unpackhi_epi64(u3, u7);
+}
+
+// 8 samples widened to, or narrowed from, 16-bit lanes
+template <typename px_t>
+static inline __m128i load_px(const px_t* p)
+{
+    if (sizeof(px_t) == 1)
+        return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p), _mm_setzero_si128());
+    return _mm_loadu_si128((const __m128i*)p);
+}
+
+template <typename px_t>
+static inline void store_px(px_t* p, __m128i v)
+{
+    if (sizeof(px_t) == 1)
+        _mm_storel_epi64((__m128i*)p, _mm_packus_epi16(v, v));
+    else
+        _mm_storeu_si128((__m128i*)p, v);
+}
+
+static inline __m128i absdiff(__m128i a, __m128i b)
+{
+    return _mm_max_epi16(_mm_sub_epi16(a, b), _mm_sub_epi16(b, a));
+}
+
+static inline __m128i select(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+template <typename px_t>
+static void filter_lines(px_t* pixQ, int incQ, int nxtQ, bool verticalEdgeFlag,
+                         const int16_t* bS, const int16_t* tc0, int alpha, int beta,
+                         bool chromaStyleFilteringFlag, int BitDepth)
+{
+    __m128i v[8];
+
+    if (verticalEdgeFlag) {
+        for (int i = 0; i < 8; ++i)
+            v[i] = load_px(pixQ + i * nxtQ - 4);
+        transpose_8x8(v);
+    } else {
+        for (int i = 0; i < 8; ++i)
+            v[i] = (chromaStyleFilteringFlag && (i < 2 || i > 5)) ? _mm_setzero_si128() :
+                   load_px(pixQ + (i - 4) * incQ);
+    }
+
+    __m128i p3 = v[0], p2 = v[1], p1 = v[2], p0 = v[3];
+    __m128i q0 = v[4], q1 = v[5], q2 = v[6], q3 = v[7];
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one  = _mm_set1_epi16(1);
+    const __m128i two  = _mm_set1_epi16(2);
+    const __m128i four = _mm_set1_epi16(4);
+    __m128i vbeta = _mm_set1_epi16(beta);
+    __m128i vbS   = _mm_loadu_si128((const __m128i*)bS);
+    __m128i vtc0  = _mm_loadu_si128((const __m128i*)tc0);
+
+    __m128i filterSamplesFlag = _mm_and_si128(
+        _mm_cmplt_epi16(absdiff(p0, q0), _mm_set1_epi16(alpha)),
+        _mm_and_si128(_mm_cmplt_epi16(absdiff(p1, p0), vbeta),
+                      _mm_cmplt_epi16(absdiff(q1, q0), vbeta)));
+    filterSamplesFlag = _mm_andnot_si128(_mm_cmpeq_epi16(vbS, zero), filterSamplesFlag);
+    if (_mm_movemask_epi8(filterSamplesFlag) == 0)
+        return;
+
+    __m128i strong = _mm_and_si128(filterSamplesFlag, _mm_cmpeq_epi16(vbS, four));
+    __m128i normal = _mm_andnot_si128(strong, filterSamplesFlag);
+
+    __m128i ap = chromaStyleFilteringFlag ? zero : _mm_cmplt_epi16(absdiff(p2, p0), vbeta);
+    __m128i aq = chromaStyleFilteringFlag ? zero : _mm_cmplt_epi16(absdiff(q2, q0), vbeta);
+
+    // bS < 4
+    __m128i tc = chromaStyleFilteringFlag ? _mm_add_epi16(vtc0, one) :
+                 _mm_sub_epi16(_mm_sub_epi16(vtc0, ap), aq);
+    __m128i delta = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(
+        _mm_slli_epi16(_mm_sub_epi16(q0, p0), 2), _mm_sub_epi16(p1, q1)), four), 3);
+    delta = _mm_min_epi16(_mm_max_epi16(delta, _mm_sub_epi16(zero, tc)), tc);
+
+    __m128i maxval = _mm_set1_epi16((1 << BitDepth) - 1);
+    __m128i np0 = _mm_min_epi16(_mm_max_epi16(_mm_add_epi16(p0, delta), zero), maxval);
+    __m128i nq0 = _mm_min_epi16(_mm_max_epi16(_mm_sub_epi16(q0, delta), zero), maxval);
+
+    __m128i avg = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(p0, q0), one), 1);
+    __m128i ntc0 = _mm_sub_epi16(zero, vtc0);
+    __m128i np1 = _mm_add_epi16(p1, _mm_min_epi16(_mm_max_epi16(_mm_srai_epi16(
+        _mm_sub_epi16(_mm_add_epi16(p2, avg), _mm_slli_epi16(p1, 1)), 1), ntc0), vtc0));
+    __m128i nq1 = _mm_add_epi16(q1, _mm_min_epi16(_mm_max_epi16(_mm_srai_epi16(
+        _mm_sub_epi16(_mm_add_epi16(q2, avg), _mm_slli_epi16(q1, 1)), 1), ntc0), vtc0));
+    np1 = select(ap, np1, p1);
+    nq1 = select(aq, nq1, q1);
+
+    // bS == 4
+    __m128i small = _mm_cmplt_epi16(absdiff(p0, q0), _mm_set1_epi16((alpha >> 2) + 2));
+    __m128i sp = _mm_and_si128(ap, small);
+    __m128i sq = _mm_and_si128(aq, small);
+    __m128i p0q0 = _mm_add_epi16(p0, q0);
+
+    __m128i sp0 = select(sp,
+        _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(_mm_add_epi16(p2, q1), four),
+                       _mm_slli_epi16(_mm_add_epi16(p1, p0q0), 1)), 3),
+        _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(p1, 1), _mm_add_epi16(p0, q1)), two), 2));
+    __m128i sp1 = select(sp,
+        _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(p2, p1), _mm_add_epi16(p0q0, two)), 2), p1);
+    __m128i sp2 = select(sp,
+        _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(p3, 1), _mm_add_epi16(p2, _mm_slli_epi16(p2, 1))),
+                       _mm_add_epi16(_mm_add_epi16(p1, p0q0), four)), 3), p2);
+    __m128i sq0 = select(sq,
+        _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(_mm_add_epi16(q2, p1), four),
+                       _mm_slli_epi16(_mm_add_epi16(q1, p0q0), 1)), 3),
+        _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(q1, 1), _mm_add_epi16(q0, p1)), two), 2));
+    __m128i sq1 = select(sq,
+        _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(q2, q1), _mm_add_epi16(p0q0, two)), 2), q1);
+    __m128i sq2 = select(sq,
+        _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(q3, 1), _mm_add_epi16(q2, _mm_slli_epi16(q2, 1))),
+                       _mm_add_epi16(_mm_add_epi16(q1, p0q0), four)), 3), q2);
+
+    v[1] = select(strong, sp2, p2);
+    v[2] = select(strong, sp1, select(normal, np1, p1));
+    v[3] = select(strong, sp0, select(normal, np0, p0));
+    v[4] = select(strong, sq0, select(normal, nq0, q0));
+    v[5] = select(strong, sq1, select(normal, nq1, q1));
+    v[6] = select(strong, sq2, q2);
+
+    if (verticalEdgeFlag) {
+        transpose_8x8(v);
+        for (int i = 0; i < 8; ++i)
+            store_px(pixQ + i * nxtQ - 4, v[i]);
+    } else {
+        int first = chromaStyleFilteringFlag ? 3 : 1;
+        for (int i = first; i < 8 - first; ++i)
+            store_px(pixQ + (i - 4) * incQ, v[i]);
+    }
+}
+
+#endif
+
+
+}
+}
+
+#endif // _VIO_H264_DEBLOCK_FILTER_H_
@@ -62,16 +62,17 @@ void Decoder::assign_quant_params(slice_t& slice)
 }
 
 
+template <typename px_t>
 void Decoder::decode(mb_t& mb)
 {
     slice_t& slice = *mb.p_Slice;
     const sps_t& sps = *slice.active_sps;
 
-    this->decode_one_component(mb, PLANE_Y);
+    this->decode_one_component<px_t>(mb, PLANE_Y);
 
     if (sps.ChromaArrayType == 3) {
-        this->decode_one_component(mb, PLANE_U);
-        this->decode_one_component(mb, PLANE_V);
+        this->decode_one_component<px_t>(mb, PLANE_U);
+        this->decode_one_component<px_t>(mb, PLANE_V);
 
         slice.parser.is_reset_coeff    = false;
         slice.parser.is_reset_coeff_cr = false;
@@ -95,6 +96,23 @@ void Decoder::coeff_chroma_ac(mb_t* mb, ColorPlane pl, int x0, int y0, int runar
     this->transform->coeff_chroma_ac(mb, pl, x0, y0, runarr, levarr);
 }
 
+void Decoder::coeff_luma_dc(mb_t* mb, ColorPlane pl, int x0, int y0, int numCoeff, const uint8_t* runarr, const int* levarr)
+{
+    this->transform->coeff_luma_dc(mb, pl, x0, y0, numCoeff, runarr, levarr);
+}
+void Decoder::coeff_luma_ac(mb_t* mb, ColorPlane pl, int x0, int y0, int numCoeff, const uint8_t* runarr, const int* levarr)
+{
+    this->transform->coeff_luma_ac(mb, pl, x0, y0, numCoeff, runarr, levarr);
+}
+void Decoder::coeff_chroma_dc(mb_t* mb, ColorPlane pl, int x0, int y0, int numCoeff, const uint8_t* runarr, const int* levarr)
+{
+    this->transform->coeff_chroma_dc(mb, pl, x0, y0, numCoeff, runarr, levarr);
+}
+void Decoder::coeff_chroma_ac(mb_t* mb, ColorPlane pl, int x0, int y0, int numCoeff, const uint8_t* runarr, const int* levarr)
+{
+    this->transform->coeff_chroma_ac(mb, pl, x0, y0, numCoeff, runarr, levarr);
+}
+
 void Decoder::transform_luma_dc(mb_t* mb, ColorPlane pl)
 {
     this->transform->transform_luma_dc(mb, pl);
@@ -104,48 +122,30 @@ void Decoder::transform_chroma_dc(mb_t* mb, ColorPlane pl)
     this->transform->transform_chroma_dc(mb, pl);
 }
 
-void Decoder::deblock_filter(slice_t& slice)
+bool Decoder::deblock_filter(slice_t& slice, storable_picture* pic, bool pad)
 {
-    this->deblock->deblock(slice.p_Vid);
+    return this->deblock->deblock(slice.p_Vid, pic, pad);
 }
 
+template <typename px_t>
 void Decoder::get_block_luma(storable_picture *curr_ref, int x_pos, int y_pos, int block_size_x, int block_size_y,
                              px_t block[16][16], int pl, mb_t& mb)
 {
     this->inter_prediction->get_block_luma(curr_ref, x_pos, y_pos, block_size_x, block_size_y, block, pl, mb);
 }
 
+template <typename px_t>
 void Decoder::decode_one_component(mb_t& mb, ColorPlane curr_plane)
 {
-    const slice_t& slice = *mb.p_Slice;
-    const sps_t& sps = *slice.active_sps;
-    const shr_t& shr = slice.header;
-
-    VideoParameters* p_Vid = slice.p_Vid;
-
-    if (sps.ChromaArrayType == 3) {
-        if (!mb.is_intra_block) {
-            storable_picture *vidref = p_Vid->no_reference_picture;
-            int noref = shr.PicOrderCnt < p_Vid->recovery_poc;
-            for (int j = 0; j < 2; ++j) {
-                for (int i = 0; i < slice.RefPicSize[j]; ++i) {
-                    storable_picture *curr_ref = slice.RefPicList[j][i];
-                    if (curr_ref) {
-                        curr_ref->no_ref = noref && (curr_ref == vidref);
-                    }
-                }
-            }
-        }
-    }
-
     if (mb.mb_type == I_PCM)
-        this->mb_pred_ipcm(mb, curr_plane);
+        this->mb_pred_ipcm<px_t>(mb, curr_plane);
     else if (mb.mb_type == I_16x16 || mb.mb_type == I_4x4 || mb.mb_type == I_8x8)
-        this->mb_pred_intra(mb, curr_plane);
+        this->mb_pred_intra<px_t>(mb, curr_plane);
     else
-        this->mb_pred_inter(mb, curr_plane);
+        this->mb_pred_inter<px_t>(mb, curr_plane);
 }
 
+template <typename px_t>
 void Decoder::mb_pred_ipcm(mb_t& mb, ColorPlane curr_plane)
 {
     slice_t& slice = *mb.p_Slice;
@@ -154,19 +154,20 @@ void Decoder::mb_pred_ipcm(mb_t& mb, ColorPlane curr_plane)
 
     for (int i = 0; i < 16; ++i) {
         for (int j = 0; j < 16 ; ++j)
-            dec_picture->imgY[mb.mb.y * 16 + i][mb.mb.x * 16 + j] = (px_t) this->transform->cof[0][i][j];
+            dec_picture->img<px_t>(0)[mb.mb.y * 16 + i][mb.mb.x * 16 + j] = (px_t) this->transform->cof[0][i][j];
     }
 
     if (sps.ChromaArrayType != 0) {
         for (int k = 0; k < 2; ++k) {
             for (int i = 0; i < sps.MbHeightC; ++i) {
                 for (int j = 0;j < sps.MbWidthC; ++j)
-                    dec_picture->imgUV[k][mb.mb.y * sps.MbHeightC + i][mb.mb.x * sps.MbWidthC + j] = (px_t) this->transform->cof[k + 1][i][j];
+                    dec_picture->img<px_t>(k + 1)[mb.mb.y * sps.MbHeightC + i][mb.mb.x * sps.MbWidthC + j] = (px_t) this->transform->cof[k + 1][i][j];
             }
         }
     }
 }
 
+template <typename px_t>
 void Decoder::mb_pred_intra(mb_t& mb, ColorPlane curr_plane)
 {
     slice_t& slice = *mb.p_Slice;
@@ -179,29 +180,29 @@ void Decoder::mb_pred_intra(mb_t& mb, ColorPlane curr_plane)
         int joff = ((block4x4 / 4) / 2) * 8 + ((block4x4 % 4) / 2) * 4;
 
         if (mb.mb_type == I_4x4)
-            this->intra_prediction->intra_pred_4x4(mb, curr_plane, ioff, joff);
+            this->intra_prediction->intra_pred_4x4<px_t>(mb, curr_plane, ioff, joff);
         else if (mb.mb_type == I_8x8)
-            this->intra_prediction->intra_pred_8x8(mb, curr_plane, ioff, joff);
+            this->intra_prediction->intra_pred_8x8<px_t>(mb, curr_plane, ioff, joff);
         else if (mb.mb_type == I_16x16)
-            this->intra_prediction->intra_pred_16x16(mb, curr_plane);
+            this->intra_prediction->intra_pred_16x16<px_t>(mb, curr_plane);
 
         if (mb.mb_type == I_4x4)
-            this->transform->inverse_transform_4x4(&mb, curr_plane, ioff, joff);
+            this->transform->inverse_transform_4x4<px_t>(&mb, curr_plane, ioff, joff);
         else if (mb.mb_type == I_8x8)
-            this->transform->inverse_transform_8x8(&mb, curr_plane, ioff, joff);
+            this->transform->inverse_transform_8x8<px_t>(&mb, curr_plane, ioff, joff);
         else if (mb.mb_type == I_16x16)
-            this->transform->inverse_transform_16x16(&mb, curr_plane, ioff, joff);
+            this->transform->inverse_transform_16x16<px_t>(&mb, curr_plane, ioff, joff);
     }
 
     if (mb.mb_type == I_16x16 || mb.CodedBlockPatternLuma != 0 || mb.CodedBlockPatternChroma != 0)
         slice.parser.is_reset_coeff = false;
 
     if (sps.chroma_format_idc != CHROMA_FORMAT_400 && sps.chroma_format_idc != CHROMA_FORMAT_444) {
-        this->intra_prediction->intra_pred_chroma(mb, PLANE_U);
-        this->intra_prediction->intra_pred_chroma(mb, PLANE_V);
+        this->intra_prediction->intra_pred_chroma<px_t>(mb, PLANE_U);
+        this->intra_prediction->intra_pred_chroma<px_t>(mb, PLANE_V);
 
         for (int uv = 0; uv < 2; uv++)
-            this->transform->inverse_transform_chroma(&mb, (ColorPlane)(uv + 1));
+            this->transform->inverse_transform_chroma<px_t>(&mb, (ColorPlane)(uv + 1));
         if (mb.CodedBlockPatternChroma)
             slice.parser.is_reset_coeff_cr = false;
     }
@@ -214,6 +215,7 @@ static const int BLOCK_STEP[8][2] = {
     {2, 2}, {2, 1}, {1, 2}, {1, 1}
 };
 
+template <typename px_t>
 void Decoder::mb_pred_inter(mb_t& mb, ColorPlane curr_plane)
 {
     slice_t& slice = *mb.p_Slice;
@@ -248,19 +250,26 @@ void Decoder::mb_pred_inter(mb_t& mb, ColorPlane curr_plane)
 
             for (int j = j0; j < j0 + step_v0; j += step_v4) {
                 for (int i = i0; i < i0 + step_h0; i += step_h4)
-                    this->inter_prediction->inter_pred(mb, curr_plane, pred_dir, i, j, step_h4 * 4, step_v4 * 4);
+                    this->inter_prediction->inter_pred<px_t>(mb, curr_plane, pred_dir, i, j, step_h4 * 4, step_v4 * 4);
             }
         }
     }
 
     if (shr.slice_type == SP_slice)
-        this->transform->inverse_transform_sp(&mb, curr_plane);
+        this->transform->inverse_transform_sp<px_t>(&mb, curr_plane);
     else
-        this->transform->inverse_transform_inter(&mb, curr_plane);
+        this->transform->inverse_transform_inter<px_t>(&mb, curr_plane);
     if (mb.CodedBlockPatternLuma != 0 || mb.CodedBlockPatternChroma != 0)
         slice.parser.is_reset_coeff = false;
 }
 
+template void Decoder::decode<uint8_t >(mb_t& mb);
+template void Decoder::decode<uint16_t>(mb_t& mb);
+template void Decoder::get_block_luma<uint8_t >(storable_picture* curr_ref, int x_pos, int y_pos,
+    int block_size_x, int block_size_y, uint8_t  block[16][16], int pl, mb_t& mb);
+template void Decoder::get_block_luma<uint16_t>(storable_picture* curr_ref, int x_pos, int y_pos,
+    int block_size_x, int block_size_y, uint16_t block[16][16], int pl, mb_t& mb);
+
 
 }
 }
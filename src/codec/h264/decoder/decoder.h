@@ -65,9 +65,13 @@ public:
 
     void init(slice_t& slice);
 
+    template <typename px_t>
     void intra_pred_4x4   (mb_t& mb, int comp, int xO, int yO);
+    template <typename px_t>
     void intra_pred_8x8   (mb_t& mb, int comp, int xO, int yO);
+    template <typename px_t>
     void intra_pred_16x16 (mb_t& mb, int comp);
+    template <typename px_t>
     void intra_pred_chroma(mb_t& mb, int comp);
 
 protected:
@@ -78,6 +82,7 @@ protected:
         slice_t*          slice;
     };
 
+    template <typename px_t>
     class Intra4x4 {
     public:
         Intra4x4(const sets_t& sets, mb_t& mb, int comp, int xO, int yO);
@@ -92,17 +97,14 @@ protected:
         void vertical_left      (px_t* pred);
         void horizontal_up      (px_t* pred);
 
-    protected:
-        inline px_t& pred4x4L(int x, int y, px_t* pred);
-        inline px_t& p       (int x, int y);
-
     private:
         bool available[4];
-        px_t samples[9 * 9];
+        px_t edge[40];
 
         const sets_t& sets;
     };
 
+    template <typename px_t>
     class Intra8x8 {
     public:
         Intra8x8(const sets_t& sets, mb_t& mb, int comp, int xO, int yO);
@@ -118,19 +120,17 @@ protected:
         void horizontal_up      (px_t* pred);
 
     protected:
-        inline px_t& pred8x8L(int x, int y, px_t* pred);
-        inline px_t& po      (int x, int y);
-        inline px_t& p       (int x, int y);
         void filtering();
 
     private:
         bool available[4];
-        px_t samples_lf[17 * 17];
-        px_t samples[17 * 17];
+        px_t edge_lf[40];
+        px_t edge[40];
 
         const sets_t& sets;
     };
 
+    template <typename px_t>
     class Intra16x16 {
     public:
         Intra16x16(const sets_t& sets, mb_t& mb, int comp, int xO, int yO);
@@ -141,16 +141,16 @@ protected:
         void plane              (px_t* pred);
 
     protected:
-        inline px_t& predL(int x, int y, px_t* pred);
         inline px_t& p    (int x, int y);
 
     private:
         bool available[4];
-        px_t samples[17 * 17];
+        px_t edge[40];
 
         const sets_t& sets;
     };
 
+    template <typename px_t>
     class Chroma {
     public:
         Chroma(const sets_t& sets, mb_t& mb, int comp, int xO, int yO);
@@ -167,7 +167,7 @@ protected:
 
     private:
         bool available[4];
-        px_t samples[17 * 17];
+        px_t edge[40];
 
         const sets_t& sets;
     };
@@ -180,9 +180,11 @@ class InterPrediction {
 public:
     void        init(slice_t& slice);
 
+    template <typename px_t>
     void        get_block_luma(storable_picture* curr_ref, int x_pos, int y_pos, int block_size_x, int block_size_y,
                     px_t block[16][16], int pl, mb_t& mb);
 
+    template <typename px_t>
     void        inter_pred(mb_t& mb, int comp, int pred_dir, int i, int j, int block_size_x, int block_size_y);
 
 protected:
@@ -193,12 +195,15 @@ protected:
         slice_t*          slice;
     };
 
+    template <typename px_t>
     void        get_block_chroma(storable_picture* curr_ref, int mvLX[2],
                     int partWidthC, int partHeightC, px_t predPartLXC[16][16], int comp, mb_t& mb);
 
+    template <typename px_t>
     void        mc_prediction(px_t* mb_pred,
                     px_t block[16][16], int block_size_y, int block_size_x,
                     mb_t& mb, int pl, short l0_refframe, int pred_dir);
+    template <typename px_t>
     void        bi_prediction(px_t* mb_pred, 
                     px_t block_l0[16][16], px_t block_l1[16][16], int block_size_y, int block_size_x,
                     mb_t& mb, int pl, short l0_refframe, short l1_refframe);
@@ -208,6 +213,7 @@ protected:
 
 private:
     sets_t sets;
+    bool   weighted_pred_flag;
 };
 
 class Transform {
@@ -224,17 +230,28 @@ public:
     void        coeff_chroma_dc(mb_t* mb, ColorPlane pl, int x0, int y0, int runarr, int levarr);
     void        coeff_chroma_ac(mb_t* mb, ColorPlane pl, int x0, int y0, int runarr, int levarr);
 
+    void        coeff_luma_dc  (mb_t* mb, ColorPlane pl, int x0, int y0, int numCoeff, const uint8_t* runarr, const int* levarr);
+    void        coeff_luma_ac  (mb_t* mb, ColorPlane pl, int x0, int y0, int numCoeff, const uint8_t* runarr, const int* levarr);
+    void        coeff_chroma_dc(mb_t* mb, ColorPlane pl, int x0, int y0, int numCoeff, const uint8_t* runarr, const int* levarr);
+    void        coeff_chroma_ac(mb_t* mb, ColorPlane pl, int x0, int y0, int numCoeff, const uint8_t* runarr, const int* levarr);
+
     int         inverse_quantize(mb_t* mb, bool uv, ColorPlane pl, int i0, int j0, int levarr);
 
     void        transform_luma_dc       (mb_t* mb, ColorPlane pl);
     void        transform_chroma_dc     (mb_t* mb, ColorPlane pl);
 
+    template <typename px_t>
     void        inverse_transform_4x4   (mb_t* mb, ColorPlane pl, int ioff, int joff);
+    template <typename px_t>
     void        inverse_transform_8x8   (mb_t* mb, ColorPlane pl, int ioff, int joff);
+    template <typename px_t>
     void        inverse_transform_16x16 (mb_t* mb, ColorPlane pl, int ioff, int joff);
+    template <typename px_t>
     void        inverse_transform_chroma(mb_t* mb, ColorPlane pl);
 
+    template <typename px_t>
     void        inverse_transform_inter (mb_t* mb, ColorPlane pl);
+    template <typename px_t>
     void        inverse_transform_sp    (mb_t* mb, ColorPlane pl);
 
     int         cof[3][16][16];
@@ -254,12 +271,21 @@ private:
     void        bypass_16x16 (int r[16][16], int f[16][16], int ioff, int joff, uint8_t pred_mode);
     void        bypass_chroma(int r[16][16], int f[16][16], int nW, int nH, uint8_t pred_mode);
 
+    template <typename px_t>
     void        itrans_sp   (mb_t* mb, ColorPlane pl, int ioff, int joff);
+    template <typename px_t>
     void        itrans_sp_cr(mb_t* mb, ColorPlane pl);
 
-    void        construction       (mb_t* mb, ColorPlane pl, int ioff, int joff, int nW, int nH);
-    void        construction_16x16 (mb_t* mb, ColorPlane pl, int ioff, int joff);
-    void        construction_chroma(mb_t* mb, ColorPlane pl, int ioff, int joff);
+    template <typename px_t>
+    void        inverse_4x4_add(mb_t* mb, ColorPlane pl, int ioff, int joff);
+    template <typename px_t>
+    void        inverse_8x8_add(mb_t* mb, ColorPlane pl, int ioff, int joff);
+    template <typename px_t>
+    void        inverse_dc_add (mb_t* mb, ColorPlane pl, int ioff, int joff);
+    template <typename px_t>
+    void        copy_prediction(mb_t* mb, ColorPlane pl, int ioff, int joff, int nW, int nH);
+    template <typename px_t>
+    void        construction   (mb_t* mb, ColorPlane pl, int ioff, int joff, int nW, int nH);
 
     int         InvLevelScale4x4_Intra[3][6][4][4];
     int         InvLevelScale4x4_Inter[3][6][4][4];
@@ -269,32 +295,45 @@ private:
     const int*  qmatrix[12];
 
     int         mb_rres[3][16][16];
-    px_t        mb_rec [3][16][16];
+};
+
+// Edge flags and boundary strengths of the macroblock being filtered
+struct deblock_params_t {
+    uint8_t     strength_ver[4][16]; // bS
+    uint8_t     strength_hor[5][16]; // bS
+    bool        fieldMbInFrameFlag;
+    bool        filterVerEdgeFlag[2][4];
+    bool        filterHorEdgeFlag[2][5];
 };
 
 class Deblock {
 public:
     void init();
-    void deblock(VideoParameters* p_Vid);
+    bool deblock(VideoParameters* p_Vid, storable_picture* pic, bool pad);
 
 private:
     int  compare_mvs(const mv_t* mv0, const mv_t* mv1, int mvlimit);
     int  bs_compare_mvs(const pic_motion_params* mv_info_p, const pic_motion_params* mv_info_q, int mvlimit);
 
-    void strength_vertical  (mb_t* MbQ, int edge);
-    void strength_horizontal(mb_t* MbQ, int edge);
-    void strength           (mb_t* mb);
+    void strength_vertical  (mb_t* MbQ, deblock_params_t& dp, int edge);
+    void strength_horizontal(mb_t* MbQ, deblock_params_t& dp, int edge);
+    void strength           (mb_t* MbQ, deblock_params_t& dp);
 
-    void filter_strong(px_t *pixQ, int width, int alpha, int beta, int bS, bool chromaStyleFilteringFlag);
-    void filter_normal(px_t *pixQ, int width, int alpha, int beta, int bS, bool chromaStyleFilteringFlag, int tc0, int BitDepth);
-    void filter_edge  (mb_t* MbQ, bool chromaEdgeFlag, ColorPlane pl, bool verticalEdgeFlag, bool fieldModeInFrameFilteringFlag, int edge);
+    template <typename px_t>
+    void filter_edge  (mb_t* MbQ, const deblock_params_t& dp, bool chromaEdgeFlag, ColorPlane pl, bool verticalEdgeFlag, bool fieldModeInFrameFilteringFlag, int edge);
 
-    void filter_vertical  (mb_t* MbQ);
-    void filter_horizontal(mb_t* MbQ);
+    template <typename px_t>
+    void filter_vertical  (mb_t* MbQ, const deblock_params_t& dp);
+    template <typename px_t>
+    void filter_horizontal(mb_t* MbQ, const deblock_params_t& dp);
 
     void init_neighbors       (VideoParameters *p_Vid);
+    template <typename px_t>
     void make_frame_picture_JV(VideoParameters *p_Vid);
-    void deblock_pic          (VideoParameters *p_Vid);
+    template <typename px_t>
+    void deblock_pic          (VideoParameters *p_Vid, storable_picture* pic, bool pad);
+    template <typename px_t>
+    bool deblock              (VideoParameters *p_Vid, storable_picture* pic, bool pad);
 };
 
 
@@ -307,6 +346,7 @@ public:
 
     void        assign_quant_params(slice_t& slice);
 
+    template <typename px_t>
     void        decode(mb_t& mb);
 
     void        coeff_luma_dc  (mb_t* mb, ColorPlane pl, int x0, int y0, int runarr, int levarr);
@@ -314,20 +354,30 @@ public:
     void        coeff_chroma_dc(mb_t* mb, ColorPlane pl, int x0, int y0, int runarr, int levarr);
     void        coeff_chroma_ac(mb_t* mb, ColorPlane pl, int x0, int y0, int runarr, int levarr);
 
+    void        coeff_luma_dc  (mb_t* mb, ColorPlane pl, int x0, int y0, int numCoeff, const uint8_t* runarr, const int* levarr);
+    void        coeff_luma_ac  (mb_t* mb, ColorPlane pl, int x0, int y0, int numCoeff, const uint8_t* runarr, const int* levarr);
+    void        coeff_chroma_dc(mb_t* mb, ColorPlane pl, int x0, int y0, int numCoeff, const uint8_t* runarr, const int* levarr);
+    void        coeff_chroma_ac(mb_t* mb, ColorPlane pl, int x0, int y0, int numCoeff, const uint8_t* runarr, const int* levarr);
+
     void        transform_luma_dc  (mb_t* mb, ColorPlane pl);
     void        transform_chroma_dc(mb_t* mb, ColorPlane pl);
 
-    void        deblock_filter(slice_t& slice);
+    bool        deblock_filter(slice_t& slice, storable_picture* pic, bool pad);
 
     // called in erc_do_p.cpp
+    template <typename px_t>
     void        get_block_luma(storable_picture *curr_ref, int x_pos, int y_pos,
                                int block_size_x, int block_size_y, px_t block[16][16],
                                int pl, mb_t& mb);
 
 protected:
+    template <typename px_t>
     void        decode_one_component(mb_t& mb, ColorPlane curr_plane);
+    template <typename px_t>
     void        mb_pred_ipcm        (mb_t& mb, ColorPlane curr_plane);
+    template <typename px_t>
     void        mb_pred_intra       (mb_t& mb, ColorPlane curr_plane);
+    template <typename px_t>
     void        mb_pred_inter       (mb_t& mb, ColorPlane curr_plane);
 
 public:
@@ -338,12 +338,19 @@ void ercVariables_t::erc_picture(storable_picture* pic)
         this->ercMarkCurrSegmentOK(pic->size_x);
 
     //! call the right error concealment function depending on the frame type.
-    this->erc_mvperMB /= shr.PicSizeInMbs;
-
-    if (shr.slice_type == I_slice || shr.slice_type == SI_slice) // I-frame
-        this->ercConcealIntraFrame(pic);
-    else
-        this->ercConcealInterFrame(pic);
+    this->erc_mvperMB = this->erc_mvperMB / shr.PicSizeInMbs;
+
+    if (shr.slice_type == I_slice || shr.slice_type == SI_slice) { // I-frame
+        if (pic->px_size == 1)
+            this->ercConcealIntraFrame<uint8_t >(pic);
+        else
+            this->ercConcealIntraFrame<uint16_t>(pic);
+    } else {
+        if (pic->px_size == 1)
+            this->ercConcealInterFrame<uint8_t >(pic);
+        else
+            this->ercConcealInterFrame<uint16_t>(pic);
+    }
 }
 
 
@@ -405,15 +412,16 @@ void ercVariables_t::ercMarkCurrSegmentOK(int picSizeX)
 }
 
 
+template <typename px_t>
 int ercVariables_t::ercConcealIntraFrame(storable_picture* pic)
 {
     // if concealment is on
     if (this->concealment) {
         // if there are segments to be concealed
         if (this->nOfCorruptedSegments) {
-            this->concealBlocks(pic, 0);
-            this->concealBlocks(pic, 1);
-            this->concealBlocks(pic, 2);
+            this->concealBlocks<px_t>(pic, 0);
+            this->concealBlocks<px_t>(pic, 1);
+            this->concealBlocks<px_t>(pic, 2);
         }
         return 1;
     }
@@ -421,6 +429,7 @@ int ercVariables_t::ercConcealIntraFrame(storable_picture* pic)
     return 0;
 }
 
+template <typename px_t>
 int ercVariables_t::ercConcealInterFrame(storable_picture* pic)
 {
     sps_t* sps = pic->sps;
@@ -473,7 +482,7 @@ int ercVariables_t::ercConcealInterFrame(storable_picture* pic)
                                 if (this->erc_mvperMB >= MVPERMB_THR)
                                     this->concealByTrial(pic, predMB, currRow * lastColumn + column, predBlocks);
                                 else
-                                    this->concealByCopy(pic, ref_pic, currRow * lastColumn + column);
+                                    this->concealByCopy<px_t>(pic, ref_pic, currRow * lastColumn + column);
 
                                 this->ercMarkCurrMBConcealed(currRow * lastColumn + column, -1, picSizeX);
                             }
@@ -488,7 +497,7 @@ int ercVariables_t::ercConcealInterFrame(storable_picture* pic)
                                 if (this->erc_mvperMB >= MVPERMB_THR)
                                     this->concealByTrial(pic, predMB, currRow * lastColumn + column, predBlocks);
                                 else
-                                    this->concealByCopy(pic, ref_pic, currRow * lastColumn + column);
+                                    this->concealByCopy<px_t>(pic, ref_pic, currRow * lastColumn + column);
 
                                 this->ercMarkCurrMBConcealed(currRow * lastColumn + column, -1, picSizeX);
                             }
@@ -513,7 +522,7 @@ int ercVariables_t::ercConcealInterFrame(storable_picture* pic)
                                 if (this->erc_mvperMB >= MVPERMB_THR)
                                     this->concealByTrial(pic, predMB, currRow * lastColumn + column, predBlocks);
                                 else
-                                    this->concealByCopy(pic, ref_pic, currRow * lastColumn + column);
+                                    this->concealByCopy<px_t>(pic, ref_pic, currRow * lastColumn + column);
 
                                 this->ercMarkCurrMBConcealed(currRow * lastColumn + column, -1, picSizeX);
                             }
@@ -639,6 +648,7 @@ int ercVariables_t::ercCollectColumnBlocks(int predBlocks[], int currRow, int cu
     return srcCounter;
 }
 
+template <typename px_t>
 void ercVariables_t::pixMeanInterpolateBlock(px_t* src[], px_t* block, int blockSize, int frameWidth, int BitDepth)
 {
     int bmax = blockSize - 1;
@@ -682,10 +692,11 @@ void ercVariables_t::pixMeanInterpolateBlock(px_t* src[], px_t* block, int block
     }
 }
 
+template <typename px_t>
 void ercVariables_t::ercPixConcealIMB(storable_picture* pic, int comp, int row, int column, int predBlocks[])
 {
     sps_t* sps = pic->sps;
-    px_t* currFrame     = comp == 0 ? &pic->imgY[0][0] : comp == 1 ? &pic->imgUV[0][0][0] : &pic->imgUV[1][0][0];
+    px_t* currFrame     = &pic->img<px_t>(comp)[0][0];
     int frameWidth      = comp == 0 ? pic->size_x : pic->size_x >> 1;
     int mbWidthInBlocks = comp == 0 ? 2 : 1;
     int BitDepth        = comp == 0 ? sps->BitDepthY : sps->BitDepthC;
@@ -715,6 +726,7 @@ void ercVariables_t::ercPixConcealIMB(storable_picture* pic, int comp, int row,
     this->pixMeanInterpolateBlock(src, currBlock, mbWidthInBlocks * 8, frameWidth, BitDepth);
 }
 
+template <typename px_t>
 void ercVariables_t::concealBlocks(storable_picture* pic, int comp)
 {
     int lastColumn  = comp == 0 ? pic->size_x >> 3 : pic->size_x >> 4;
@@ -749,7 +761,7 @@ void ercVariables_t::concealBlocks(storable_picture* pic, int comp)
 
                     for (int currRow = firstCorruptedRow; currRow < lastRow; currRow += step) {
                         this->ercCollect8PredBlocks(predBlocks, currRow, column, condition, lastRow, lastColumn, step, 1);
-                        this->ercPixConcealIMB(pic, comp, currRow, column, predBlocks);
+                        this->ercPixConcealIMB<px_t>(pic, comp, currRow, column, predBlocks);
 
                         if (comp == 0) {
                             condition[currRow * lastColumn + column                 ] = ERC_BLOCK_CONCEALED;
@@ -765,7 +777,7 @@ void ercVariables_t::concealBlocks(storable_picture* pic, int comp)
 
                     for (int currRow = lastCorruptedRow; currRow >= 0; currRow -= step) {
                         this->ercCollect8PredBlocks(predBlocks, currRow, column, condition, lastRow, lastColumn, step, 1);
-                        this->ercPixConcealIMB(pic, comp, currRow, column, predBlocks);
+                        this->ercPixConcealIMB<px_t>(pic, comp, currRow, column, predBlocks);
 
                         condition[currRow * lastColumn + column] = ERC_BLOCK_CONCEALED;
                         if (comp == 0) {
@@ -793,7 +805,7 @@ void ercVariables_t::concealBlocks(storable_picture* pic, int comp)
                             this->ercCollectColumnBlocks(predBlocks, currRow, column, condition, lastRow, lastColumn, step);
                         else
                             this->ercCollect8PredBlocks(predBlocks, currRow, column, condition, lastRow, lastColumn, step, 1);
-                        this->ercPixConcealIMB(pic, comp, currRow, column, predBlocks);
+                        this->ercPixConcealIMB<px_t>(pic, comp, currRow, column, predBlocks);
 
                         condition[currRow * lastColumn + column] = ERC_BLOCK_CONCEALED;
                         if (comp == 0) {
@@ -809,6 +821,7 @@ void ercVariables_t::concealBlocks(storable_picture* pic, int comp)
 }
 
 
+template <typename px_t>
 void ercVariables_t::buildPredRegionYUV(storable_picture* pic, int* mv, int x, int y, px_t* predMB)
 {
     sps_t* sps = pic->sps;
@@ -828,6 +841,7 @@ void ercVariables_t::buildPredRegionYUV(storable_picture* pic, int* mv, int x, i
     auto ref_pic = slice.RefPicList[0][ref_frame];
   
     int mv_mul = 4;
+    px_t (*mb_pred[3])[16] = {slice.mb_pred<px_t>(0), slice.mb_pred<px_t>(1), slice.mb_pred<px_t>(2)};
 
     int num_uv_blocks;
     if (sps->chroma_format_idc != CHROMA_FORMAT_400)
@@ -850,7 +864,7 @@ void ercVariables_t::buildPredRegionYUV(storable_picture* pic, int* mv, int x, i
 
             for (int ii = 0; ii < 4; ++ii) {
                 for (int jj = 0; jj < 16/4; ++jj)
-                    slice.mb_pred[PLANE_Y][jj + joff][ii + ioff] = tmp_block[jj][ii];
+                    mb_pred[PLANE_Y][jj + joff][ii + ioff] = tmp_block[jj][ii];
             }
         }
     }
@@ -858,7 +872,7 @@ void ercVariables_t::buildPredRegionYUV(storable_picture* pic, int* mv, int x, i
     px_t* pMB = predMB;
     for (int j = 0; j < 16; ++j) {
         for (int i = 0; i < 16; ++i)
-            pMB[j * 16 + i] = slice.mb_pred[PLANE_Y][j][i];
+            pMB[j * 16 + i] = mb_pred[PLANE_Y][j][i];
     }
     pMB += 256;
 
@@ -874,6 +888,7 @@ void ercVariables_t::buildPredRegionYUV(storable_picture* pic, int* mv, int x, i
         int f4 = f3 >> 1;
 
         for (int uv = 0; uv < 2; ++uv) {
+            px_t** imgUV = ref_pic->img<px_t>(1 + uv);
             for (int b8 = 0; b8 < num_uv_blocks; ++b8) {
                 for (int b4 = 0; b4 < 4; ++b4) {
                     int joff = subblk_offset_y[yuv][b8][b4];
@@ -896,11 +911,11 @@ void ercVariables_t::buildPredRegionYUV(storable_picture* pic, int* mv, int x, i
                             int if0 = (f1_x - if1);
                             int jf0 = (f1_y - jf1);
 
-                            slice.mb_pred[uv + 1][jj + joff][ii + ioff] = (px_t) 
-                                ((if0 * jf0 * ref_pic->imgUV[uv][jj0][ii0] +
-                                  if1 * jf0 * ref_pic->imgUV[uv][jj0][ii1] +
-                                  if0 * jf1 * ref_pic->imgUV[uv][jj1][ii0] +
-                                  if1 * jf1 * ref_pic->imgUV[uv][jj1][ii1] + f4) / f3);
+                            mb_pred[uv + 1][jj + joff][ii + ioff] = (px_t) 
+                                ((if0 * jf0 * imgUV[jj0][ii0] +
+                                  if1 * jf0 * imgUV[jj0][ii1] +
+                                  if0 * jf1 * imgUV[jj1][ii0] +
+                                  if1 * jf1 * imgUV[jj1][ii1] + f4) / f3);
                         }
                     }
                 }
@@ -908,16 +923,17 @@ void ercVariables_t::buildPredRegionYUV(storable_picture* pic, int* mv, int x, i
 
             for (int j = 0; j < 8; ++j) {
                 for (int i = 0; i < 8; ++i)
-                    pMB[j * 8 + i] = slice.mb_pred[uv + 1][j][i];
+                    pMB[j * 8 + i] = mb_pred[uv + 1][j][i];
             }
             pMB += 64;
         }
     }
 }
 
+template <typename px_t>
 int ercVariables_t::edgeDistortion(storable_picture* pic, int predBlocks[], int currYBlockNum, px_t* predMB, int regionSize)
 {
-    px_t* recY = &pic->imgY[0][0];
+    px_t* recY = &pic->img<px_t>(0)[0][0];
     int picSizeX = pic->size_x;
 
     int threshold = ERC_BLOCK_OK;
@@ -974,6 +990,7 @@ int ercVariables_t::edgeDistortion(storable_picture* pic, int predBlocks[], int
     return (distortion / numOfPredBlocks);
 }
 
+template <typename px_t>
 void ercVariables_t::copyPredMB(storable_picture* pic, int currYBlockNum, px_t* predMB, int regionSize)
 {
     int picSizeX = pic->size_x;
@@ -990,7 +1007,7 @@ void ercVariables_t::copyPredMB(storable_picture* pic, int currYBlockNum, px_t*
     for (int j = ymin; j <= ymax; ++j) {
         for (int k = xmin; k <= xmax; ++k) {
             int locationTmp = (j - ymin) * 16 + (k - xmin);
-            pic->imgY[j][k] = predMB[locationTmp];
+            pic->img<px_t>(0)[j][k] = predMB[locationTmp];
         }
     }
 
@@ -998,16 +1015,17 @@ void ercVariables_t::copyPredMB(storable_picture* pic, int currYBlockNum, px_t*
         for (int j = (ymin >> uv_y); j <= (ymax >> uv_y); ++j) {
             for (int k = (xmin >> uv_x); k <= (xmax >> uv_x); ++k) {
                 int locationTmp = (j - (ymin >> uv_y)) * sps->MbWidthC + (k - (xmin >> 1)) + 256;
-                pic->imgUV[0][j][k] = predMB[locationTmp];
+                pic->img<px_t>(1)[j][k] = predMB[locationTmp];
 
                 locationTmp += 64;
 
-                pic->imgUV[1][j][k] = predMB[locationTmp];
+                pic->img<px_t>(2)[j][k] = predMB[locationTmp];
             }
         }
     }
 }
 
+template <typename px_t>
 int ercVariables_t::concealByTrial(storable_picture* pic, px_t* predMB, int currMBNum, int predBlocks[])
 {
     int picSizeX = pic->size_x;
@@ -1160,13 +1178,14 @@ int ercVariables_t::concealByTrial(storable_picture* pic, px_t* predMB, int curr
     return 0;
 }
 
+template <typename px_t>
 void ercVariables_t::copyBetweenFrames(storable_picture* dec_pic, storable_picture* ref_pic, int currYBlockNum, int regionSize)
 {
     int picSizeX = dec_pic->size_x;
     sps_t* sps = dec_pic->sps;
-    px_t* yptr = &dec_pic->imgY[0][0];
-    px_t* uptr = &dec_pic->imgUV[0][0][0];
-    px_t* vptr = &dec_pic->imgUV[1][0][0];
+    px_t* yptr = &dec_pic->img<px_t>(0)[0][0];
+    px_t* uptr = &dec_pic->img<px_t>(1)[0][0];
+    px_t* vptr = &dec_pic->img<px_t>(2)[0][0];
 
     /* set the position of the region to be copied */
     int xmin = (xPosYBlock(currYBlockNum, picSizeX) << 3);
@@ -1175,7 +1194,7 @@ void ercVariables_t::copyBetweenFrames(storable_picture* dec_pic, storable_pictu
     for (int j = ymin; j < ymin + regionSize; ++j) {
         for (int k = xmin; k < xmin + regionSize; ++k) {
             int location   = j * picSizeX + k;
-            yptr[location] = ref_pic->imgY[j][k];
+            yptr[location] = ref_pic->img<px_t>(0)[j][k];
         }
     }
 
@@ -1184,12 +1203,13 @@ void ercVariables_t::copyBetweenFrames(storable_picture* dec_pic, storable_pictu
         for (int k = xmin >> uv_div[0][sps->chroma_format_idc];
              k < (xmin + regionSize) >> uv_div[0][sps->chroma_format_idc]; ++k) {
             int location   = ((j * picSizeX) >> uv_div[0][sps->chroma_format_idc]) + k;
-            uptr[location] = ref_pic->imgUV[0][j][k];
-            vptr[location] = ref_pic->imgUV[1][j][k];
+            uptr[location] = ref_pic->img<px_t>(1)[j][k];
+            vptr[location] = ref_pic->img<px_t>(2)[j][k];
         }
     }
 }
 
+template <typename px_t>
 int ercVariables_t::concealByCopy(storable_picture* dec_pic, storable_picture* ref_pic, int currMBNum)
 {
     int picSizeX = dec_pic->size_x;
@@ -1199,7 +1219,7 @@ int ercVariables_t::concealByCopy(storable_picture* dec_pic, storable_picture* r
     currRegion->xMin       = (xPosMB(currMBNum, picSizeX) << 4);
     currRegion->yMin       = (yPosMB(currMBNum, picSizeX) << 4);
 
-    this->copyBetweenFrames(dec_pic, ref_pic, MBNum2YBlock(currMBNum, 0, picSizeX), 16);
+    this->copyBetweenFrames<px_t>(dec_pic, ref_pic, MBNum2YBlock(currMBNum, 0, picSizeX), 16);
 
     return 0;
 }
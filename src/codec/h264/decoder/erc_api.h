@@ -2,6 +2,8 @@
 #define _ERC_API_H_
 
 
+#include <atomic>
+
 struct VideoParameters;
 namespace vio { namespace h264 {
 struct macroblock_t;
@@ -28,7 +30,7 @@ struct ercVariables_t {
 
     objectBuffer_t* erc_object_list;
 
-    int         erc_mvperMB;
+    std::atomic<int> erc_mvperMB;
 
     ercVariables_t(int pic_sizex, int pic_sizey, bool flag);
     ~ercVariables_t();
@@ -43,22 +45,33 @@ private:
     void ercMarkCurrSegmentLost(int picSizeX);
     void ercMarkCurrSegmentOK  (int picSizeX);
 
+    template <typename px_t>
     int  ercConcealIntraFrame(storable_picture* pic);
+    template <typename px_t>
     int  ercConcealInterFrame(storable_picture* pic);
 
     int  ercCollect8PredBlocks(int predBlocks[], int currRow, int currColumn, char* condition,
                                int maxRow, int maxColumn, int step, uint8_t fNoCornerNeigh);
 
     int  ercCollectColumnBlocks (int predBlocks[], int currRow, int currColumn, char* condition, int maxRow, int maxColumn, int step);
+    template <typename px_t>
     void pixMeanInterpolateBlock(px_t* src[], px_t* block, int blockSize, int frameWidth, int BitDepth);
+    template <typename px_t>
     void ercPixConcealIMB       (storable_picture* pic, int comp, int row, int column, int predBlocks[]);
+    template <typename px_t>
     void concealBlocks          (storable_picture* pic, int comp);
 
+    template <typename px_t>
     void buildPredRegionYUV    (storable_picture* pic, int* mv, int x, int y, px_t* predMB);
+    template <typename px_t>
     int  edgeDistortion        (storable_picture* pic, int predBlocks[], int currYBlockNum, px_t* predMB, int regionSize);
+    template <typename px_t>
     void copyPredMB            (storable_picture* pic, int currYBlockNum, px_t* predMB, int regionSize);
+    template <typename px_t>
     int  concealByTrial        (storable_picture* pic, px_t* predMB, int currMBNum, int predBlocks[]);
+    template <typename px_t>
     void copyBetweenFrames     (storable_picture* dec_pic, storable_picture* ref_pic, int currYBlockNum, int regionSize);
+    template <typename px_t>
     int  concealByCopy         (storable_picture* dec_pic, storable_picture* ref_pic, int currMBNum);
     void ercMarkCurrMBConcealed(int currMBNum, int comp, int picSizeX);
 };
@@ -21,6 +21,10 @@
  * =============================================================================
  */
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "global.h"
 #include "slice.h"
 #include "macroblock.h"
@@ -32,13 +36,137 @@ namespace vio  {
 namespace h264 {
 
 
-static inline int RSHIFT_RND(int x, int a)
+#if defined(__SSE2__)
+
+// W samples, at most 8, widened to or narrowed from 16-bit lanes
+
+template <int W, typename px_t>
+static inline __m128i load(const px_t* p)
+{
+    const int n = (W < 8 ? W : 8) * sizeof(px_t);
+    __m128i v;
+    if (n <= 4) {
+        int t = 0;
+        memcpy(&t, p, n);
+        v = _mm_cvtsi32_si128(t);
+    } else if (n == 8)
+        v = _mm_loadl_epi64((const __m128i*)p);
+    else
+        v = _mm_loadu_si128((const __m128i*)p);
+    return sizeof(px_t) == 1 ? _mm_unpacklo_epi8(v, _mm_setzero_si128()) : v;
+}
+
+template <int W, typename px_t>
+static inline void store(px_t* p, __m128i v)
 {
-    return (a > 0) ? ((x + (1 << (a-1) )) >> a) : (x << (-a));
+    const int n = (W < 8 ? W : 8) * sizeof(px_t);
+    if (sizeof(px_t) == 1)
+        v = _mm_packus_epi16(v, v);
+    if (n <= 4) {
+        int t = _mm_cvtsi128_si32(v);
+        memcpy(p, &t, n);
+    } else if (n == 8)
+        _mm_storel_epi64((__m128i*)p, v);
+    else
+        _mm_storeu_si128((__m128i*)p, v);
 }
-static inline int RSHIFT_RND_SF(int x, int a)
+
+static inline __m128i clip_pel(__m128i lo, __m128i hi, __m128i maxval)
 {
-    return ((x + (1 << (a-1) )) >> a);
+    __m128i v = _mm_packs_epi32(lo, hi);
+    return _mm_min_epi16(_mm_max_epi16(v, _mm_setzero_si128()), maxval);
+}
+
+#endif
+
+// 8.4.2.3 Weighted sample prediction of a W wide partition from the 16 wide
+// prediction blocks into mb_pred. Weights and offsets stay within 16 bits,
+// so the products are formed by madd on interleaved sample/weight pairs.
+
+template <int W, typename px_t>
+static void weighted_sample(px_t* mb_pred, px_t block[16][16], int height,
+                            int weight, int offset, int denom, int color_clip)
+{
+    int round = denom > 0 ? 1 << (denom - 1) : 0;
+#if defined(__SSE2__)
+    const int N = W < 8 ? 8 : W;
+    __m128i wr     = _mm_set1_epi32((round << 16) | (weight & 0xffff));
+    __m128i one    = _mm_set1_epi16(1);
+    __m128i off    = _mm_set1_epi32(offset);
+    __m128i shift  = _mm_cvtsi32_si128(denom);
+    __m128i maxval = _mm_set1_epi16(color_clip);
+
+    for (int j = 0; j < height; ++j) {
+        for (int i = 0; i < N; i += 8) {
+            __m128i b  = load<W>(&block[j][i]);
+            __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(b, one), wr);
+            __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(b, one), wr);
+            lo = _mm_add_epi32(_mm_sra_epi32(lo, shift), off);
+            hi = _mm_add_epi32(_mm_sra_epi32(hi, shift), off);
+            store<W>(mb_pred + i, clip_pel(lo, hi, maxval));
+        }
+        mb_pred += 16;
+    }
+#else
+    for (int j = 0; j < height; ++j) {
+        for (int i = 0; i < W; ++i)
+            mb_pred[i] = (px_t) clip1(color_clip, ((weight * block[j][i] + round) >> denom) + offset);
+        mb_pred += 16;
+    }
+#endif
+}
+
+template <int W, typename px_t>
+static void weighted_bi_sample(px_t* mb_pred, px_t block_l0[16][16], px_t block_l1[16][16], int height,
+                               int weight0, int weight1, int offset, int denom, int color_clip)
+{
+    int round = 1 << (denom - 1);
+#if defined(__SSE2__)
+    const int N = W < 8 ? 8 : W;
+    __m128i w01    = _mm_set1_epi32((int) (((uint32_t) weight1 << 16) | (weight0 & 0xffff)));
+    __m128i rnd    = _mm_set1_epi32(round);
+    __m128i off    = _mm_set1_epi32(offset);
+    __m128i shift  = _mm_cvtsi32_si128(denom);
+    __m128i maxval = _mm_set1_epi16(color_clip);
+
+    for (int j = 0; j < height; ++j) {
+        for (int i = 0; i < N; i += 8) {
+            __m128i b0 = load<W>(&block_l0[j][i]);
+            __m128i b1 = load<W>(&block_l1[j][i]);
+            __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(b0, b1), w01), rnd);
+            __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(b0, b1), w01), rnd);
+            lo = _mm_add_epi32(_mm_sra_epi32(lo, shift), off);
+            hi = _mm_add_epi32(_mm_sra_epi32(hi, shift), off);
+            store<W>(mb_pred + i, clip_pel(lo, hi, maxval));
+        }
+        mb_pred += 16;
+    }
+#else
+    for (int j = 0; j < height; ++j) {
+        for (int i = 0; i < W; ++i)
+            mb_pred[i] = (px_t) clip1(color_clip, ((weight0 * block_l0[j][i] + weight1 * block_l1[j][i] + round) >> denom) + offset);
+        mb_pred += 16;
+    }
+#endif
+}
+
+template <int W, typename px_t>
+static void average_sample(px_t* mb_pred, px_t block_l0[16][16], px_t block_l1[16][16], int height)
+{
+#if defined(__SSE2__)
+    const int N = W < 8 ? 8 : W;
+    for (int j = 0; j < height; ++j) {
+        for (int i = 0; i < N; i += 8)
+            store<W>(mb_pred + i, _mm_avg_epu16(load<W>(&block_l0[j][i]), load<W>(&block_l1[j][i])));
+        mb_pred += 16;
+    }
+#else
+    for (int j = 0; j < height; ++j) {
+        for (int i = 0; i < W; ++i)
+            mb_pred[i] = (px_t) ((block_l0[j][i] + block_l1[j][i] + 1) >> 1);
+        mb_pred += 16;
+    }
+#endif
 }
 
 
@@ -48,43 +176,54 @@ void InterPrediction::init(slice_t& slice)
     this->sets.sps   = slice.active_sps;
     this->sets.pps   = slice.active_pps;
     this->sets.slice = &slice;
+
+    shr_t& shr = slice.header;
+    this->weighted_pred_flag =
+        (slice.active_pps->weighted_pred_flag && (shr.slice_type == P_slice || shr.slice_type == SP_slice)) ||
+        (slice.active_pps->weighted_bipred_idc == 1 && shr.slice_type == B_slice);
 }
 
+template <typename px_t>
 void InterPrediction::mc_prediction(
     px_t* mb_pred, px_t block[16][16], int block_size_y, int block_size_x,
     mb_t& mb, int pl, short l0_refframe, int pred_dir)
 {
     slice_t& slice = *mb.p_Slice;
     sps_t& sps = *slice.active_sps;
-    pps_t& pps = *slice.active_pps;
     shr_t& shr = slice.header;
 
-    bool weighted_pred_flag = (pps.weighted_pred_flag && (shr.slice_type == P_slice || shr.slice_type == SP_slice)) ||
-                              (pps.weighted_bipred_idc == 1 && (shr.slice_type == B_slice));
-    int weight, offset, denom, color_clip;
-    if (weighted_pred_flag) {
-        int ref_idx = shr.MbaffFrameFlag && mb.mb_field_decoding_flag ? l0_refframe >> 1 : l0_refframe;
-
-        weight = shr.pred_weight_l[pred_dir][pl][ref_idx].weight;
-        offset = shr.pred_weight_l[pred_dir][pl][ref_idx].offset;
-        offset <<= pl == 0 ? sps.bit_depth_luma_minus8 : sps.bit_depth_chroma_minus8;
-
-        denom  = pl > 0 ? shr.chroma_log2_weight_denom : shr.luma_log2_weight_denom;
-        color_clip = (1 << (pl > 0 ? sps.BitDepthC : sps.BitDepthY)) - 1;
+    if (!this->weighted_pred_flag) {
+        for (int j = 0; j < block_size_y; ++j)
+            memcpy(&mb_pred[j * 16], block[j], block_size_x * sizeof(px_t));
+        return;
     }
 
-    for (int j = 0; j < block_size_y; ++j) {
-        for (int i = 0; i < block_size_x; ++i) {
-            if (weighted_pred_flag) {
-                int result = RSHIFT_RND((weight * block[j][i]), denom);
-                mb_pred[i] = (px_t) clip1(color_clip, result + offset);
-            } else
-                mb_pred[i] = block[j][i];
-        }
-        mb_pred += 16;
+    int ref_idx = shr.MbaffFrameFlag && mb.mb_field_decoding_flag ? l0_refframe >> 1 : l0_refframe;
+
+    int weight = shr.pred_weight_l[pred_dir][pl][ref_idx].weight;
+    int offset = shr.pred_weight_l[pred_dir][pl][ref_idx].offset;
+    offset <<= pl == 0 ? sps.bit_depth_luma_minus8 : sps.bit_depth_chroma_minus8;
+
+    int denom  = pl > 0 ? shr.chroma_log2_weight_denom : shr.luma_log2_weight_denom;
+    int color_clip = (1 << (pl > 0 ? sps.BitDepthC : sps.BitDepthY)) - 1;
+
+    switch (block_size_x) {
+    case 2:
+        weighted_sample< 2>(mb_pred, block, block_size_y, weight, offset, denom, color_clip);
+        break;
+    case 4:
+        weighted_sample< 4>(mb_pred, block, block_size_y, weight, offset, denom, color_clip);
+        break;
+    case 8:
+        weighted_sample< 8>(mb_pred, block, block_size_y, weight, offset, denom, color_clip);
+        break;
+    default:
+        weighted_sample<16>(mb_pred, block, block_size_y, weight, offset, denom, color_clip);
+        break;
     }
 }
 
+template <typename px_t>
 void InterPrediction::bi_prediction(
     px_t* mb_pred, px_t block_l0[16][16], px_t block_l1[16][16],
     int block_size_y, int block_size_x, mb_t& mb, int pl, short l0_refframe, short l1_refframe)
@@ -94,67 +233,292 @@ void InterPrediction::bi_prediction(
     pps_t& pps = *slice.active_pps;
     shr_t& shr = slice.header;
 
-    int weight0, weight1, offset0, offset1;
-    int offset, denom, color_clip;
-    if (pps.weighted_bipred_idc) {
-        int ref_idx0 = shr.MbaffFrameFlag && mb.mb_field_decoding_flag ? l0_refframe >> 1 : l0_refframe;
-        int ref_idx1 = shr.MbaffFrameFlag && mb.mb_field_decoding_flag ? l1_refframe >> 1 : l1_refframe;
-
-        if (pps.weighted_bipred_idc == 1) {
-            weight0 = shr.pred_weight_l[0][pl][ref_idx0].weight;
-            weight1 = shr.pred_weight_l[1][pl][ref_idx1].weight;
-            offset0 = shr.pred_weight_l[0][pl][ref_idx0].offset;
-            offset1 = shr.pred_weight_l[1][pl][ref_idx1].offset;
-            offset0 <<= pl == 0 ? sps.bit_depth_luma_minus8 : sps.bit_depth_chroma_minus8;
-            offset1 <<= pl == 0 ? sps.bit_depth_luma_minus8 : sps.bit_depth_chroma_minus8;
+    if (!pps.weighted_bipred_idc) {
+        switch (block_size_x) {
+        case 2:
+            average_sample< 2>(mb_pred, block_l0, block_l1, block_size_y);
+            break;
+        case 4:
+            average_sample< 4>(mb_pred, block_l0, block_l1, block_size_y);
+            break;
+        case 8:
+            average_sample< 8>(mb_pred, block_l0, block_l1, block_size_y);
+            break;
+        default:
+            average_sample<16>(mb_pred, block_l0, block_l1, block_size_y);
+            break;
         }
+        return;
+    }
+
+    int weight0, weight1, offset0, offset1;
+    int ref_idx0 = shr.MbaffFrameFlag && mb.mb_field_decoding_flag ? l0_refframe >> 1 : l0_refframe;
+    int ref_idx1 = shr.MbaffFrameFlag && mb.mb_field_decoding_flag ? l1_refframe >> 1 : l1_refframe;
+
+    if (pps.weighted_bipred_idc == 1) {
+        weight0 = shr.pred_weight_l[0][pl][ref_idx0].weight;
+        weight1 = shr.pred_weight_l[1][pl][ref_idx1].weight;
+        offset0 = shr.pred_weight_l[0][pl][ref_idx0].offset;
+        offset1 = shr.pred_weight_l[1][pl][ref_idx1].offset;
+        offset0 <<= pl == 0 ? sps.bit_depth_luma_minus8 : sps.bit_depth_chroma_minus8;
+        offset1 <<= pl == 0 ? sps.bit_depth_luma_minus8 : sps.bit_depth_chroma_minus8;
+    } else {
+        int k = shr.MbaffFrameFlag && mb.mb_field_decoding_flag ? 1 + mb.mbAddrX % 2 : 0;
+        weight1 = slice.implicit_weight[k][l0_refframe][l1_refframe];
+        weight0 = 64 - weight1;
+        offset0 = offset1 = 0;
+    }
+
+    int offset = (offset0 + offset1 + 1) >> 1;
+    int denom  = pl > 0 ? shr.chroma_log2_weight_denom + 1 : shr.luma_log2_weight_denom + 1;
+    int color_clip = (1 << (pl > 0 ? sps.BitDepthC : sps.BitDepthY)) - 1;
+
+    switch (block_size_x) {
+    case 2:
+        weighted_bi_sample< 2>(mb_pred, block_l0, block_l1, block_size_y, weight0, weight1, offset, denom, color_clip);
+        break;
+    case 4:
+        weighted_bi_sample< 4>(mb_pred, block_l0, block_l1, block_size_y, weight0, weight1, offset, denom, color_clip);
+        break;
+    case 8:
+        weighted_bi_sample< 8>(mb_pred, block_l0, block_l1, block_size_y, weight0, weight1, offset, denom, color_clip);
+        break;
+    default:
+        weighted_bi_sample<16>(mb_pred, block_l0, block_l1, block_size_y, weight0, weight1, offset, denom, color_clip);
+        break;
+    }
+}
+
+// 8.4.2.2.1 Luma sample interpolation on the padded reference. The clamping
+// of xAL and yAL, together with CheckVertMV splitting tall blocks near the
+// top and bottom, keeps every block plus its six-tap support inside the
+// MCBUF_LUMA_PAD_X/Y border, where the padding already repeats the edge
+// samples that coordinate clipping would select. Rows are addressed through
+// the row pointers of the reference, so field references work as frames do.
+
+static inline int tap6(int A, int C, int G, int M, int R, int T)
+{
+    return A - 5 * C + 20 * G + 20 * M - 5 * R + T;
+}
+
+#if defined(__SSE2__)
+
+// Up to 9-bit samples the six-tap sums of one pass fit in 16-bit lanes.
 
-        if (pps.weighted_bipred_idc == 2) {
-            storable_picture* ref_pic0 = slice.RefPicList[LIST_0][ref_idx0];
-            storable_picture* ref_pic1 = slice.RefPicList[LIST_1][ref_idx1];
-            if (shr.MbaffFrameFlag && mb.mb_field_decoding_flag) {
-                ref_pic0 = (mb.mbAddrX % 2 == l0_refframe % 2) ? ref_pic0->top_field : ref_pic0->bottom_field;
-                ref_pic1 = (mb.mbAddrX % 2 == l1_refframe % 2) ? ref_pic1->top_field : ref_pic1->bottom_field;
+static inline __m128i tap6(__m128i A, __m128i C, __m128i G, __m128i M, __m128i R, __m128i T)
+{
+    __m128i AT = _mm_add_epi16(A, T);
+    __m128i CR = _mm_add_epi16(C, R);
+    __m128i GM = _mm_add_epi16(G, M);
+    return _mm_add_epi16(_mm_sub_epi16(AT, _mm_add_epi16(_mm_slli_epi16(CR, 2), CR)),
+                         _mm_add_epi16(_mm_slli_epi16(GM, 4), _mm_slli_epi16(GM, 2)));
+}
+
+template <int W, typename px_t>
+static inline __m128i tap6_h(const px_t* p)
+{
+    return tap6(load<W>(p - 2), load<W>(p - 1), load<W>(p), load<W>(p + 1), load<W>(p + 2), load<W>(p + 3));
+}
+
+template <int W, typename px_t>
+static inline __m128i tap6_v(px_t** rows, int x)
+{
+    return tap6(load<W>(rows[-2] + x), load<W>(rows[-1] + x), load<W>(rows[0] + x),
+                load<W>(rows[ 1] + x), load<W>(rows[ 2] + x), load<W>(rows[3] + x));
+}
+
+static inline __m128i round5(__m128i v, __m128i maxval)
+{
+    v = _mm_srai_epi16(_mm_add_epi16(v, _mm_set1_epi16(16)), 5);
+    return _mm_min_epi16(_mm_max_epi16(v, _mm_setzero_si128()), maxval);
+}
+
+// second pass over 16-bit first pass sums, widened to 32 bits
+static inline __m128i round10(const int16_t* p, int stride, __m128i maxval)
+{
+    const __m128i k0 = _mm_set_epi16(-5, 1, -5, 1, -5, 1, -5, 1);
+    const __m128i k1 = _mm_set1_epi16(20);
+    const __m128i k2 = _mm_set_epi16(1, -5, 1, -5, 1, -5, 1, -5);
+    const __m128i rnd = _mm_set1_epi32(512);
+
+    __m128i A = _mm_loadu_si128((const __m128i*)(p - 2 * stride));
+    __m128i C = _mm_loadu_si128((const __m128i*)(p - 1 * stride));
+    __m128i G = _mm_loadu_si128((const __m128i*)(p));
+    __m128i M = _mm_loadu_si128((const __m128i*)(p + 1 * stride));
+    __m128i R = _mm_loadu_si128((const __m128i*)(p + 2 * stride));
+    __m128i T = _mm_loadu_si128((const __m128i*)(p + 3 * stride));
+
+    __m128i lo = _mm_add_epi32(_mm_add_epi32(
+        _mm_madd_epi16(_mm_unpacklo_epi16(A, C), k0),
+        _mm_madd_epi16(_mm_unpacklo_epi16(G, M), k1)),
+        _mm_madd_epi16(_mm_unpacklo_epi16(R, T), k2));
+    __m128i hi = _mm_add_epi32(_mm_add_epi32(
+        _mm_madd_epi16(_mm_unpackhi_epi16(A, C), k0),
+        _mm_madd_epi16(_mm_unpackhi_epi16(G, M), k1)),
+        _mm_madd_epi16(_mm_unpackhi_epi16(R, T), k2));
+    lo = _mm_srai_epi32(_mm_add_epi32(lo, rnd), 10);
+    hi = _mm_srai_epi32(_mm_add_epi32(hi, rnd), 10);
+
+    __m128i v = _mm_packs_epi32(lo, hi);
+    return _mm_min_epi16(_mm_max_epi16(v, _mm_setzero_si128()), maxval);
+}
+
+template <int W, typename px_t>
+static void luma_block_sse2(px_t** ref, int xAL, int yAL, int partHeightL, int xFracL, int yFracL,
+                            int max_imgpel_value, px_t partPredLXL[16][16])
+{
+    const int N = W < 8 ? 8 : W;
+    __m128i maxval = _mm_set1_epi16(max_imgpel_value);
+
+    if (yFracL == 0) {
+        for (int yL = 0; yL < partHeightL; ++yL) {
+            const px_t* src = ref[yAL + yL] + xAL;
+            for (int xL = 0; xL < N; xL += 8) {
+                __m128i b = round5(tap6_h<W>(src + xL), maxval);
+                if (xFracL & 1)
+                    b = _mm_avg_epu16(b, load<W>(src + xL + xFracL / 2));
+                store<W>(&partPredLXL[yL][xL], b);
+            }
+        }
+    } else if (xFracL == 0) {
+        for (int yL = 0; yL < partHeightL; ++yL) {
+            px_t** rows = ref + yAL + yL;
+            for (int xL = 0; xL < N; xL += 8) {
+                __m128i h = round5(tap6_v<W>(rows, xAL + xL), maxval);
+                if (yFracL & 1)
+                    h = _mm_avg_epu16(h, load<W>(rows[yFracL / 2] + xAL + xL));
+                store<W>(&partPredLXL[yL][xL], h);
             }
+        }
+    } else if (xFracL != 2 && yFracL != 2) {
+        for (int yL = 0; yL < partHeightL; ++yL) {
+            px_t** rows = ref + yAL + yL;
+            for (int xL = 0; xL < N; xL += 8) {
+                __m128i b = round5(tap6_h<W>(rows[yFracL / 2] + xAL + xL), maxval);
+                __m128i h = round5(tap6_v<W>(rows, xAL + xL + xFracL / 2), maxval);
+                store<W>(&partPredLXL[yL][xL], _mm_avg_epu16(b, h));
+            }
+        }
+    } else {
+        int16_t tmp_res[16 + 5][16];
 
-            int td = clip3(-128, 127, ref_pic1->poc - ref_pic0->poc);
-            if (td == 0 || ref_pic1->is_long_term || ref_pic0->is_long_term) {
-                weight0 = 32;
-                weight1 = 32;
-            } else {
-                int poc = !shr.MbaffFrameFlag || !mb.mb_field_decoding_flag ? shr.PicOrderCnt :
-                          mb.mbAddrX % 2 == 0 ? shr.TopFieldOrderCnt : shr.BottomFieldOrderCnt;
-                int tb = clip3(-128, 127, poc - ref_pic0->poc);
-                int tx = (16384 + abs(td / 2)) / td;
-                int DistScaleFactor = clip3(-1024, 1023, (tx * tb + 32) >> 6);
-
-                weight1 = DistScaleFactor >> 2;
-                weight0 = 64 - weight1;
-                if (weight1 < -64 || weight1 > 128) {
-                    weight0 = 32;
-                    weight1 = 32;
-                }
+        for (int yL = 0; yL < partHeightL + 5; ++yL) {
+            const px_t* src = ref[yAL + yL - 2] + xAL;
+            for (int xL = 0; xL < N; xL += 8)
+                _mm_storeu_si128((__m128i*)&tmp_res[yL][xL], tap6_h<W>(src + xL));
+        }
+
+        for (int yL = 0; yL < partHeightL; ++yL) {
+            px_t** rows = ref + yAL + yL;
+            for (int xL = 0; xL < N; xL += 8) {
+                __m128i j = round10(&tmp_res[yL + 2][xL], 16, maxval);
+                if (xFracL == 2 && (yFracL & 1))
+                    j = _mm_avg_epu16(j, round5(_mm_loadu_si128((const __m128i*)&tmp_res[yL + 2 + yFracL / 2][xL]), maxval));
+                if (yFracL == 2 && (xFracL & 1))
+                    j = _mm_avg_epu16(j, round5(tap6_v<W>(rows, xAL + xL + xFracL / 2), maxval));
+                store<W>(&partPredLXL[yL][xL], j);
             }
-            offset0 = offset1 = 0;
         }
+    }
+}
 
-        offset = (offset0 + offset1 + 1) >> 1;
-        denom  = pl > 0 ? shr.chroma_log2_weight_denom + 1 : shr.luma_log2_weight_denom + 1;
-        color_clip = (1 << (pl > 0 ? sps.BitDepthC : sps.BitDepthY)) - 1;
+#endif
+
+template <int W, typename px_t>
+static void luma_block(px_t** ref, int xAL, int yAL, int partHeightL, int xFracL, int yFracL,
+                       int max_imgpel_value, px_t partPredLXL[16][16])
+{
+#if defined(__SSE2__)
+    if (max_imgpel_value < 512) {
+        luma_block_sse2<W>(ref, xAL, yAL, partHeightL, xFracL, yFracL, max_imgpel_value, partPredLXL);
+        return;
     }
+#endif
+
+    if (yFracL == 0) {
+        for (int yL = 0; yL < partHeightL; ++yL) {
+            const px_t* src = ref[yAL + yL] + xAL;
+            for (int xL = 0; xL < W; ++xL) {
+                const px_t* p = src + xL;
+                int b = clip1(max_imgpel_value, (tap6(p[-2], p[-1], p[0], p[1], p[2], p[3]) + 16) >> 5);
+                if (xFracL & 1)
+                    b = (b + p[xFracL / 2] + 1) >> 1;
+                partPredLXL[yL][xL] = (px_t) b;
+            }
+        }
+    } else if (xFracL == 0) {
+        for (int yL = 0; yL < partHeightL; ++yL) {
+            px_t** rows = ref + yAL + yL;
+            for (int xL = 0; xL < W; ++xL) {
+                int x = xAL + xL;
+                int h = clip1(max_imgpel_value, (tap6(rows[-2][x], rows[-1][x], rows[0][x],
+                                                      rows[ 1][x], rows[ 2][x], rows[3][x]) + 16) >> 5);
+                if (yFracL & 1)
+                    h = (h + rows[yFracL / 2][x] + 1) >> 1;
+                partPredLXL[yL][xL] = (px_t) h;
+            }
+        }
+    } else if (xFracL != 2 && yFracL != 2) {
+        for (int yL = 0; yL < partHeightL; ++yL) {
+            px_t** rows = ref + yAL + yL;
+            for (int xL = 0; xL < W; ++xL) {
+                const px_t* p = rows[yFracL / 2] + xAL + xL;
+                int x = xAL + xL + xFracL / 2;
+                int b = clip1(max_imgpel_value, (tap6(p[-2], p[-1], p[0], p[1], p[2], p[3]) + 16) >> 5);
+                int h = clip1(max_imgpel_value, (tap6(rows[-2][x], rows[-1][x], rows[0][x],
+                                                      rows[ 1][x], rows[ 2][x], rows[3][x]) + 16) >> 5);
+                partPredLXL[yL][xL] = (px_t) ((b + h + 1) >> 1);
+            }
+        }
+    } else {
+        int tmp_res[16 + 5][16];
+
+        for (int yL = 0; yL < partHeightL + 5; ++yL) {
+            const px_t* src = ref[yAL + yL - 2] + xAL;
+            for (int xL = 0; xL < W; ++xL) {
+                const px_t* p = src + xL;
+                tmp_res[yL][xL] = tap6(p[-2], p[-1], p[0], p[1], p[2], p[3]);
+            }
+        }
 
-    for (int j = 0; j < block_size_y; ++j) {
-        for (int i = 0; i < block_size_x; ++i) {
-            if (pps.weighted_bipred_idc) {
-                int result = RSHIFT_RND((weight0 * block_l0[j][i] + weight1 * block_l1[j][i]), denom);
-                mb_pred[i] = (px_t) clip1(color_clip, result + offset);
-            } else
-                mb_pred[i] = (px_t) (((block_l0[j][i] + block_l1[j][i]) + 1) >> 1);
+        for (int yL = 0; yL < partHeightL; ++yL) {
+            px_t** rows = ref + yAL + yL;
+            for (int xL = 0; xL < W; ++xL) {
+                int j = clip1(max_imgpel_value, (tap6(tmp_res[yL    ][xL], tmp_res[yL + 1][xL], tmp_res[yL + 2][xL],
+                                                      tmp_res[yL + 3][xL], tmp_res[yL + 4][xL], tmp_res[yL + 5][xL]) + 512) >> 10);
+                if (xFracL == 2 && (yFracL & 1)) {
+                    int b = clip1(max_imgpel_value, (tmp_res[yL + 2 + yFracL / 2][xL] + 16) >> 5);
+                    j = (j + b + 1) >> 1;
+                }
+                if (yFracL == 2 && (xFracL & 1)) {
+                    int x = xAL + xL + xFracL / 2;
+                    int h = clip1(max_imgpel_value, (tap6(rows[-2][x], rows[-1][x], rows[0][x],
+                                                          rows[ 1][x], rows[ 2][x], rows[3][x]) + 16) >> 5);
+                    j = (j + h + 1) >> 1;
+                }
+                partPredLXL[yL][xL] = (px_t) j;
+            }
         }
-        mb_pred += 16;
     }
 }
 
+// Copies the width x height samples at x0, y0 of an unpadded reference to
+// edge, clamping columns to the picture as its padding would have. Rows
+// outside it repeat the edge rows through the row pointers already.
+template <typename px_t>
+static px_t** emulate_edge(px_t** ref, int x0, int y0, int width, int height, int max_x,
+                           px_t edge[16 + 5][32], px_t* rows[16 + 5])
+{
+    for (int y = 0; y < height; ++y) {
+        const px_t* src = ref[y0 + y];
+        for (int x = 0; x < width; ++x)
+            edge[y][x] = src[clip3(0, max_x, x0 + x)];
+        rows[y] = edge[y];
+    }
+    return rows;
+}
+
+template <typename px_t>
 void InterPrediction::get_block_luma(
     storable_picture* curr_ref, int x_pos, int y_pos, int partWidthL, int partHeightL,
     px_t partPredLXL[16][16], int comp, mb_t& mb)
@@ -162,7 +526,10 @@ void InterPrediction::get_block_luma(
     int max_imgpel_value = (1 << (comp > 0 ? this->sets.sps->BitDepthC : this->sets.sps->BitDepthY)) - 1;
 
     if (curr_ref->no_ref) {
-        memset(partPredLXL[0], max_imgpel_value, partHeightL * partWidthL * sizeof(px_t));
+        for (int yL = 0; yL < partHeightL; ++yL) {
+            for (int xL = 0; xL < partWidthL; ++xL)
+                partPredLXL[yL][xL] = (px_t) max_imgpel_value;
+        }
         return;
     }
 
@@ -172,173 +539,83 @@ void InterPrediction::get_block_luma(
     int maxold_y = (mb.mb_field_decoding_flag) ? (this->sets.pic->size_y >> 1) - 1 : this->sets.pic->size_y - 1;
 
     shr_t& shr = this->sets.slice->header;
-    px_t** cur_imgY = (this->sets.sps->separate_colour_plane_flag && shr.colour_plane_id > PLANE_Y) ?
-                        curr_ref->imgUV[shr.colour_plane_id-1] : 
-                        comp ? curr_ref->imgUV[comp - 1] : curr_ref->imgY;
-
-    uint32_t PicWidthInSamplesL  = this->sets.sps->PicWidthInSamplesL;
-    uint32_t PicHeightInSamplesL = this->sets.slice->header.PicHeightInSamplesL;
-    uint32_t refPicHeightEffectiveL =
-        !this->sets.slice->header.MbaffFrameFlag || !mb.mb_field_decoding_flag ?
-        PicHeightInSamplesL : PicHeightInSamplesL / 2;
+    px_t** cur_imgY = curr_ref->img<px_t>(
+        this->sets.sps->separate_colour_plane_flag && shr.colour_plane_id > PLANE_Y ? shr.colour_plane_id : comp);
 
     int xAL    = clip3(-18, maxold_x + 2, mvLX[0] >> 2);
     int yAL    = clip3(-10, maxold_y + 2, mvLX[1] >> 2);
     int xFracL = (mvLX[0] & 3);
     int yFracL = (mvLX[1] & 3);
 
-    int tmp_res[16+5][16+5];
+    // only blocks whose six-tap support crosses the left or right border of
+    // an unpadded reference are interpolated from an edge-clamped copy
+    px_t  edge[16 + 5][32];
+    px_t* rows[16 + 5];
+    if (!curr_ref->padded && (xAL < 2 || xAL + partWidthL + 3 > maxold_x + 1)) {
+        cur_imgY = emulate_edge(cur_imgY, xAL - 2, yAL - 2, partWidthL + 5, partHeightL + 5, maxold_x, edge, rows);
+        xAL = 2;
+        yAL = 2;
+    }
 
     if (xFracL == 0 && yFracL == 0) {
         for (int yL = 0; yL < partHeightL; yL++)
-            memcpy(&partPredLXL[yL][0], &cur_imgY[yAL + yL][xAL], 16 * sizeof(px_t));
-    } else if (xFracL == 0 || yFracL == 0) {
-        for (int yL = 0; yL < partHeightL; yL++) {
-            for (int xL = 0; xL < partWidthL; xL++) {
-                int xIntL = xAL + xL;
-                int yIntL = yAL + yL;
-
-                if (yFracL == 0) {
-                    int xEL = clip3<int>(0, PicWidthInSamplesL - 1, xIntL - 2);
-                    int xFL = clip3<int>(0, PicWidthInSamplesL - 1, xIntL - 1);
-                    int xGL = clip3<int>(0, PicWidthInSamplesL - 1, xIntL + 0);
-                    int xHL = clip3<int>(0, PicWidthInSamplesL - 1, xIntL + 1);
-                    int xIL = clip3<int>(0, PicWidthInSamplesL - 1, xIntL + 2);
-                    int xJL = clip3<int>(0, PicWidthInSamplesL - 1, xIntL + 3);
-                    int yZL = clip3<int>(0, refPicHeightEffectiveL - 1, yIntL + 0);
-                    px_t E = cur_imgY[yZL][xEL];
-                    px_t F = cur_imgY[yZL][xFL];
-                    px_t G = cur_imgY[yZL][xGL];
-                    px_t H = cur_imgY[yZL][xHL];
-                    px_t I = cur_imgY[yZL][xIL];
-                    px_t J = cur_imgY[yZL][xJL];
-                    int b1 = (E - 5 * F + 20 * G + 20 * H - 5 * I + J);
-                    int b  = clip1(max_imgpel_value, (b1 + 16) >> 5);
-
-                    if (xFracL % 2 == 0)
-                        partPredLXL[yL][xL] = (px_t) b;
-                    else {
-                        int G = cur_imgY[yZL][xFracL == 1 ? xGL : xHL];
-                        int a = (G + b + 1) >> 1;
-                        partPredLXL[yL][xL] = (px_t) a;
-                    }
-                }
-
-                if (xFracL == 0) {
-                    int xZL = clip3<int>(0, PicWidthInSamplesL - 1, xIntL + 0);
-                    int yAL = clip3<int>(0, refPicHeightEffectiveL - 1, yIntL - 2);
-                    int yCL = clip3<int>(0, refPicHeightEffectiveL - 1, yIntL - 1);
-                    int yGL = clip3<int>(0, refPicHeightEffectiveL - 1, yIntL + 0);
-                    int yML = clip3<int>(0, refPicHeightEffectiveL - 1, yIntL + 1);
-                    int yRL = clip3<int>(0, refPicHeightEffectiveL - 1, yIntL + 2);
-                    int yTL = clip3<int>(0, refPicHeightEffectiveL - 1, yIntL + 3);
-                    px_t A = cur_imgY[yAL][xZL];
-                    px_t C = cur_imgY[yCL][xZL];
-                    px_t G = cur_imgY[yGL][xZL];
-                    px_t M = cur_imgY[yML][xZL];
-                    px_t R = cur_imgY[yRL][xZL];
-                    px_t T = cur_imgY[yTL][xZL];
-                    int h1 = (A - 5 * C + 20 * G + 20 * M - 5 * R + T);
-                    int h  = clip1(max_imgpel_value, (h1 + 16) >> 5);
-
-                    if (yFracL % 2 == 0)
-                        partPredLXL[yL][xL] = (px_t) h;
-                    else {
-                        int G = cur_imgY[yFracL == 1 ? yGL : yML][xZL];
-                        int d = (G + h + 1) >> 1;
-                        partPredLXL[yL][xL] = (px_t) d;
-                    }
-                }
-            }
-        }
-    } else if (xFracL % 2 == 1 && yFracL % 2 == 1) {
-        for (int yL = 0; yL < partHeightL; yL++) {
-            for (int xL = 0; xL < partWidthL; xL++) {
-                int xIntL = xAL + xL;
-                int yIntL = yAL + yL;
-
-                int xEL = clip3<int>(0, PicWidthInSamplesL - 1, xIntL - 2);
-                int xFL = clip3<int>(0, PicWidthInSamplesL - 1, xIntL - 1);
-                int xGL = clip3<int>(0, PicWidthInSamplesL - 1, xIntL + 0);
-                int xHL = clip3<int>(0, PicWidthInSamplesL - 1, xIntL + 1);
-                int xIL = clip3<int>(0, PicWidthInSamplesL - 1, xIntL + 2);
-                int xJL = clip3<int>(0, PicWidthInSamplesL - 1, xIntL + 3);
-                int yZL = clip3<int>(0, refPicHeightEffectiveL - 1, yIntL + (yFracL == 3 ? 1 : 0));
-                px_t E = cur_imgY[yZL][xEL];
-                px_t F = cur_imgY[yZL][xFL];
-                px_t G = cur_imgY[yZL][xGL];
-                px_t H = cur_imgY[yZL][xHL];
-                px_t I = cur_imgY[yZL][xIL];
-                px_t J = cur_imgY[yZL][xJL];
-                int b1 = (E - 5 * F + 20 * G + 20 * H - 5 * I + J);
-                int b  = clip1(max_imgpel_value, (b1 + 16) >> 5);
-
-                int xZL = clip3<int>(0, PicWidthInSamplesL - 1, xIntL + (xFracL == 3 ? 1 : 0));
-                int yAL = clip3<int>(0, refPicHeightEffectiveL - 1, yIntL - 2);
-                int yCL = clip3<int>(0, refPicHeightEffectiveL - 1, yIntL - 1);
-                int yGL = clip3<int>(0, refPicHeightEffectiveL - 1, yIntL + 0);
-                int yML = clip3<int>(0, refPicHeightEffectiveL - 1, yIntL + 1);
-                int yRL = clip3<int>(0, refPicHeightEffectiveL - 1, yIntL + 2);
-                int yTL = clip3<int>(0, refPicHeightEffectiveL - 1, yIntL + 3);
-                px_t A = cur_imgY[yAL][xZL];
-                px_t C = cur_imgY[yCL][xZL];
-                     G = cur_imgY[yGL][xZL];
-                px_t M = cur_imgY[yML][xZL];
-                px_t R = cur_imgY[yRL][xZL];
-                px_t T = cur_imgY[yTL][xZL];
-                int h1 = (A - 5 * C + 20 * G + 20 * M - 5 * R + T);
-                int h  = clip1(max_imgpel_value, (h1 + 16) >> 5);
-
-                int e  = (b + h + 1) >> 1;
-                partPredLXL[yL][xL] = (px_t) e;
-            }
-        }
-    } else {
-        int shift_x = xFracL == 2 ? 1 : this->sets.pic->iLumaStride;
-        int step_x  = xFracL != 2 && yFracL == 2 ? 1 : 0;
-        int step_y  = xFracL == 2 || yFracL != 2 ? 1 : 0;
-
-        int img_pos_x = xAL - 2;
-        int img_pos_y = yAL - 2;
-        int blk_pos_x = yFracL == 2 ? (xFracL == 3 ? 3 : 2) : 0;
-        int blk_pos_y = xFracL == 2 ? (yFracL == 3 ? 3 : 2) : 0;
-
-        for (int yL = 0; yL < partHeightL + (xFracL == 2 ? 5 : 0); yL++) {
-            for (int xL = 0; xL < partWidthL + (yFracL == 2 ? 5 : 0); xL++) {
-                int xIntL = img_pos_x + xL;
-                int yIntL = img_pos_y + yL;
-                px_t A = cur_imgY[yIntL][xIntL + shift_x * 0];
-                px_t C = cur_imgY[yIntL][xIntL + shift_x * 1];
-                px_t G = cur_imgY[yIntL][xIntL + shift_x * 2];
-                px_t M = cur_imgY[yIntL][xIntL + shift_x * 3];
-                px_t R = cur_imgY[yIntL][xIntL + shift_x * 4];
-                px_t T = cur_imgY[yIntL][xIntL + shift_x * 5];
-                int h1 = (A - 5 * C + 20 * G + 20 * M - 5 * R + T);
-                tmp_res[yL][xL] = h1;
-            }
-        }
+            memcpy(&partPredLXL[yL][0], &cur_imgY[yAL + yL][xAL], partWidthL * sizeof(px_t));
+    } else if (partWidthL == 4)
+        luma_block< 4>(cur_imgY, xAL, yAL, partHeightL, xFracL, yFracL, max_imgpel_value, partPredLXL);
+    else if (partWidthL == 8)
+        luma_block< 8>(cur_imgY, xAL, yAL, partHeightL, xFracL, yFracL, max_imgpel_value, partPredLXL);
+    else
+        luma_block<16>(cur_imgY, xAL, yAL, partHeightL, xFracL, yFracL, max_imgpel_value, partPredLXL);
+}
 
-        for (int yL = 0; yL < partHeightL; yL++) {
-            for (int xL = 0; xL < partWidthL; xL++) {
-                int aa = tmp_res[yL + step_y * 0][xL + step_x * 0];
-                int bb = tmp_res[yL + step_y * 1][xL + step_x * 1];
-                int b1 = tmp_res[yL + step_y * 2][xL + step_x * 2];
-                int s1 = tmp_res[yL + step_y * 3][xL + step_x * 3];
-                int gg = tmp_res[yL + step_y * 4][xL + step_x * 4];
-                int hh = tmp_res[yL + step_y * 5][xL + step_x * 5];
-                int j1 = (aa - 5 * bb + 20 * b1 + 20 * s1 - 5 * gg + hh);
-                int j  = clip1(max_imgpel_value, (j1 + 512) >> 10);
-                partPredLXL[yL][xL] = (px_t) j;
+// 8.4.2.2.2 Chroma sample interpolation. Blocks whose bilinear support lies
+// inside the iChromaPadX/Y border are read through the row pointers without
+// clipping; up to 9-bit samples every weighted sum fits in 16-bit lanes.
 
-                if (xFracL == 1 || xFracL == 3 || yFracL == 1 || yFracL == 3) {
-                    px_t q0 = clip1(max_imgpel_value, (tmp_res[blk_pos_y + yL][blk_pos_x + xL] + 16) >> 5);
-                    partPredLXL[yL][xL] = (px_t) ((partPredLXL[yL][xL] + q0 + 1) >> 1);
-                }
+template <int W, typename px_t>
+static void chroma_block(px_t** ref, int xAL, int yAL, int partHeightC, int xFracC, int yFracC,
+                         int max_imgpel_value, px_t predPartLXC[16][16])
+{
+    int wA = (8 - xFracC) * (8 - yFracC);
+    int wB = xFracC * (8 - yFracC);
+    int wC = (8 - xFracC) * yFracC;
+    int wD = xFracC * yFracC;
+
+#if defined(__SSE2__)
+    if (max_imgpel_value < 512) {
+        const int N = W < 8 ? 8 : W;
+        __m128i kA  = _mm_set1_epi16(wA);
+        __m128i kB  = _mm_set1_epi16(wB);
+        __m128i kC  = _mm_set1_epi16(wC);
+        __m128i kD  = _mm_set1_epi16(wD);
+        __m128i rnd = _mm_set1_epi16(32);
+
+        for (int yC = 0; yC < partHeightC; ++yC) {
+            const px_t* r0 = ref[yAL + yC    ] + xAL;
+            const px_t* r1 = ref[yAL + yC + 1] + xAL;
+            for (int xC = 0; xC < N; xC += 8) {
+                __m128i ab = _mm_add_epi16(_mm_mullo_epi16(load<W>(r0 + xC), kA),
+                                           _mm_mullo_epi16(load<W>(r0 + xC + 1), kB));
+                __m128i cd = _mm_add_epi16(_mm_mullo_epi16(load<W>(r1 + xC), kC),
+                                           _mm_mullo_epi16(load<W>(r1 + xC + 1), kD));
+                __m128i v  = _mm_add_epi16(_mm_add_epi16(ab, cd), rnd);
+                store<W>(&predPartLXC[yC][xC], _mm_srli_epi16(v, 6));
             }
         }
+        return;
+    }
+#endif
+
+    for (int yC = 0; yC < partHeightC; ++yC) {
+        const px_t* r0 = ref[yAL + yC    ] + xAL;
+        const px_t* r1 = ref[yAL + yC + 1] + xAL;
+        for (int xC = 0; xC < W; ++xC)
+            predPartLXC[yC][xC] = (px_t) ((wA * r0[xC] + wB * r0[xC + 1] +
+                                           wC * r1[xC] + wD * r1[xC + 1] + 32) >> 6);
     }
 }
 
+template <typename px_t>
 void InterPrediction::get_block_chroma(storable_picture* pic,
     int mvLXX[2], int partWidthC, int partHeightC,
     px_t predPartLXC[16][16], int comp, mb_t& mb)
@@ -365,15 +642,18 @@ void InterPrediction::get_block_chroma(storable_picture* pic,
 
     if (pic->no_ref) {
         px_t no_ref_value = (px_t)(1 << (this->sets.sps->BitDepthC - 1));
-        memset(predPartLXC, no_ref_value, partHeightC * partWidthC * sizeof(px_t));
+        for (int yC = 0; yC < partHeightC; ++yC) {
+            for (int xC = 0; xC < partWidthC; ++xC)
+                predPartLXC[yC][xC] = no_ref_value;
+        }
         return;
     }
 
-    px_t** imgUV = pic->imgUV[comp - 1];
+    px_t** imgUV = pic->img<px_t>(comp);
 
-    uint32_t PicWidthInSamplesC  = this->sets.sps->PicWidthInSamplesC;
-    uint32_t PicHeightInSamplesC = this->sets.slice->header.PicHeightInSamplesC;
-    uint32_t refPicHeightEffectiveC =
+    int PicWidthInSamplesC  = this->sets.sps->PicWidthInSamplesC;
+    int PicHeightInSamplesC = this->sets.slice->header.PicHeightInSamplesC;
+    int refPicHeightEffectiveC =
         !this->sets.slice->header.MbaffFrameFlag || !mb.mb_field_decoding_flag ?
         PicHeightInSamplesC : PicHeightInSamplesC / 2;
 
@@ -382,6 +662,19 @@ void InterPrediction::get_block_chroma(storable_picture* pic,
     int xFracC = (mvCX[0] & 7);
     int yFracC = (this->sets.sps->ChromaArrayType == 1) ? (mvCX[1] & 7) : (mvCX[1] & 3) << 1;
 
+    int padX = pic->padded ? pic->iChromaPadX : 0;
+    if (xAL >= -padX && xAL + partWidthC <= PicWidthInSamplesC - 1 + padX &&
+        yAL >= -pic->iChromaPadY && yAL + partHeightC <= refPicHeightEffectiveC - 1 + pic->iChromaPadY) {
+        int max_imgpel_value = (1 << this->sets.sps->BitDepthC) - 1;
+        if (partWidthC == 2)
+            chroma_block<2>(imgUV, xAL, yAL, partHeightC, xFracC, yFracC, max_imgpel_value, predPartLXC);
+        else if (partWidthC == 4)
+            chroma_block<4>(imgUV, xAL, yAL, partHeightC, xFracC, yFracC, max_imgpel_value, predPartLXC);
+        else
+            chroma_block<8>(imgUV, xAL, yAL, partHeightC, xFracC, yFracC, max_imgpel_value, predPartLXC);
+        return;
+    }
+
     for (int yC = 0; yC < partHeightC; yC++) {
         for (int xC = 0; xC < partWidthC; xC++) {
             int xIntC = xAL + xC;
@@ -445,6 +738,7 @@ int InterPrediction::CheckVertMV(mb_t *currMB, int vec_y, int block_size_y)
         return 0;
 }
 
+template <typename px_t>
 void InterPrediction::inter_pred(mb_t& mb, int comp, int pred_dir, int i, int j, int partWidthL, int partHeightL)
 {
     shr_t& shr = this->sets.slice->header;
@@ -483,15 +777,26 @@ void InterPrediction::inter_pred(mb_t& mb, int comp, int pred_dir, int i, int j,
         vec2_y = (block_y_aff + j) * 16 + mv_l1->mv_y;
     }
 
-    // vars for get_block_luma
+    // references still being decoded on the pipeline threads are read once
+    // the rows down to the bottom of the six-tap support are final, blocks
+    // above the picture being clamped into its top rows
+    refPic0->wait_rows(max(vec1_y >> 2, 0) + partHeightL + 6);
+    if (pred_dir == 2)
+        refPic1->wait_rows(max(vec2_y >> 2, 0) + partHeightL + 6);
+
+    // Single list partitions without explicit weights are interpolated
+    // straight into mb_pred, the others through the prediction blocks.
+    bool direct = pred_dir != 2 && !this->weighted_pred_flag;
+
     px_t partPredL0L[16][16];
     px_t partPredL1L[16][16];
+    px_t (*predL0L)[16] = direct ? (px_t (*)[16]) &this->sets.slice->mb_pred<px_t>(comp)[j * 4][i * 4] : partPredL0L;
 
     if (CheckVertMV(&mb, vec1_y, partHeightL)) {
-        get_block_luma(refPic0, vec1_x, vec1_y   , partWidthL, 8            , partPredL0L  , comp, mb);
-        get_block_luma(refPic0, vec1_x, vec1_y+32, partWidthL, partHeightL-8, partPredL0L+8, comp, mb);
+        get_block_luma(refPic0, vec1_x, vec1_y   , partWidthL, 8            , predL0L  , comp, mb);
+        get_block_luma(refPic0, vec1_x, vec1_y+32, partWidthL, partHeightL-8, predL0L+8, comp, mb);
     } else
-        get_block_luma(refPic0, vec1_x, vec1_y   , partWidthL, partHeightL  , partPredL0L  , comp, mb);
+        get_block_luma(refPic0, vec1_x, vec1_y   , partWidthL, partHeightL  , predL0L  , comp, mb);
     if (pred_dir == 2) {
         if (CheckVertMV(&mb, vec2_y, partHeightL)) {
             get_block_luma(refPic1, vec2_x, vec2_y   , partWidthL, 8            , partPredL1L  , comp, mb);
@@ -500,22 +805,31 @@ void InterPrediction::inter_pred(mb_t& mb, int comp, int pred_dir, int i, int j,
             get_block_luma(refPic1, vec2_x, vec2_y   , partWidthL, partHeightL  , partPredL1L  , comp, mb);
     }
 
-    if (pred_dir != 2)
-        mc_prediction(&this->sets.slice->mb_pred[comp][j * 4][i * 4], partPredL0L, partHeightL, partWidthL, mb, comp, ref_idx_l0, pred_dir);
-    else
-        bi_prediction(&this->sets.slice->mb_pred[comp][j * 4][i * 4], partPredL0L, partPredL1L, partHeightL, partWidthL, mb, comp, ref_idx_l0, ref_idx_l1);
+    if (pred_dir == 2)
+        bi_prediction(&this->sets.slice->mb_pred<px_t>(comp)[j * 4][i * 4], partPredL0L, partPredL1L, partHeightL, partWidthL, mb, comp, ref_idx_l0, ref_idx_l1);
+    else if (!direct)
+        mc_prediction(&this->sets.slice->mb_pred<px_t>(comp)[j * 4][i * 4], partPredL0L, partHeightL, partWidthL, mb, comp, ref_idx_l0, pred_dir);
 
     if (this->sets.sps->ChromaArrayType == 1 || this->sets.sps->ChromaArrayType == 2) {
-        px_t partPredL0Cb[16][16];
-        px_t partPredL1Cb[16][16];
-        px_t partPredL0Cr[16][16];
-        px_t partPredL1Cr[16][16];
-
         int mvL0[2] = {vec1_x, vec1_y};
         int mvL1[2] = {vec2_x, vec2_y};
 
         int partWidthC  = partWidthL  / this->sets.sps->SubWidthC;
         int partHeightC = partHeightL / this->sets.sps->SubHeightC;
+        int xO = i * 4 / this->sets.sps->SubWidthC;
+        int yO = j * 4 / this->sets.sps->SubHeightC;
+
+        if (direct) {
+            get_block_chroma(refPic0, mvL0, partWidthC, partHeightC, (px_t (*)[16]) &this->sets.slice->mb_pred<px_t>(1)[yO][xO], PLANE_U, mb);
+            get_block_chroma(refPic0, mvL0, partWidthC, partHeightC, (px_t (*)[16]) &this->sets.slice->mb_pred<px_t>(2)[yO][xO], PLANE_V, mb);
+            return;
+        }
+
+        px_t partPredL0Cb[16][16];
+        px_t partPredL1Cb[16][16];
+        px_t partPredL0Cr[16][16];
+        px_t partPredL1Cr[16][16];
+
         get_block_chroma(refPic0, mvL0, partWidthC, partHeightC, partPredL0Cb, PLANE_U, mb);
         get_block_chroma(refPic0, mvL0, partWidthC, partHeightC, partPredL0Cr, PLANE_V, mb);
         if (pred_dir == 2) {
@@ -523,18 +837,23 @@ void InterPrediction::inter_pred(mb_t& mb, int comp, int pred_dir, int i, int j,
             get_block_chroma(refPic1, mvL1, partWidthC, partHeightC, partPredL1Cr, PLANE_V, mb);
         }
 
-        int xO = i * 4 / this->sets.sps->SubWidthC;
-        int yO = j * 4 / this->sets.sps->SubHeightC;
         if (pred_dir != 2) {
-            mc_prediction(&this->sets.slice->mb_pred[1][yO][xO], partPredL0Cb, partHeightC, partWidthC, mb, PLANE_U, ref_idx_l0, pred_dir);
-            mc_prediction(&this->sets.slice->mb_pred[2][yO][xO], partPredL0Cr, partHeightC, partWidthC, mb, PLANE_V, ref_idx_l0, pred_dir);
+            mc_prediction(&this->sets.slice->mb_pred<px_t>(1)[yO][xO], partPredL0Cb, partHeightC, partWidthC, mb, PLANE_U, ref_idx_l0, pred_dir);
+            mc_prediction(&this->sets.slice->mb_pred<px_t>(2)[yO][xO], partPredL0Cr, partHeightC, partWidthC, mb, PLANE_V, ref_idx_l0, pred_dir);
         } else {
-            bi_prediction(&this->sets.slice->mb_pred[1][yO][xO], partPredL0Cb, partPredL1Cb, partHeightC, partWidthC, mb, PLANE_U, ref_idx_l0, ref_idx_l1);
-            bi_prediction(&this->sets.slice->mb_pred[2][yO][xO], partPredL0Cr, partPredL1Cr, partHeightC, partWidthC, mb, PLANE_V, ref_idx_l0, ref_idx_l1);
+            bi_prediction(&this->sets.slice->mb_pred<px_t>(1)[yO][xO], partPredL0Cb, partPredL1Cb, partHeightC, partWidthC, mb, PLANE_U, ref_idx_l0, ref_idx_l1);
+            bi_prediction(&this->sets.slice->mb_pred<px_t>(2)[yO][xO], partPredL0Cr, partPredL1Cr, partHeightC, partWidthC, mb, PLANE_V, ref_idx_l0, ref_idx_l1);
         }
     }
 }
 
+template void InterPrediction::inter_pred<uint8_t >(mb_t& mb, int comp, int pred_dir, int i, int j, int partWidthL, int partHeightL);
+template void InterPrediction::inter_pred<uint16_t>(mb_t& mb, int comp, int pred_dir, int i, int j, int partWidthL, int partHeightL);
+template void InterPrediction::get_block_luma<uint8_t >(storable_picture* curr_ref, int x_pos, int y_pos,
+    int partWidthL, int partHeightL, uint8_t  partPredLXL[16][16], int comp, mb_t& mb);
+template void InterPrediction::get_block_luma<uint16_t>(storable_picture* curr_ref, int x_pos, int y_pos,
+    int partWidthL, int partHeightL, uint16_t partPredLXL[16][16], int comp, mb_t& mb);
+
 
 }
 }
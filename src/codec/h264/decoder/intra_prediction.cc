@@ -21,6 +21,10 @@
  * =============================================================================
  */
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "global.h"
 #include "slice.h"
 #include "macroblock.h"
@@ -39,11 +43,12 @@ void IntraPrediction::init(slice_t& slice)
     this->sets.slice = &slice;
 }
 
+template <typename px_t>
 void IntraPrediction::intra_pred_4x4(mb_t& mb, int comp, int xO, int yO)
 {
-    Intra4x4 samples {this->sets, mb, comp, xO, yO};
+    Intra4x4<px_t> samples {this->sets, mb, comp, xO, yO};
 
-    px_t* pred = &this->sets.slice->mb_pred[comp][yO][xO];
+    px_t* pred = &this->sets.slice->mb_pred<px_t>(comp)[yO][xO];
 
     int i4x4 = ((yO / 4) / 2) * 8 + ((yO / 4) % 2) * 2 + ((xO / 4) / 2) * 4 + ((xO / 4) % 2);
     switch (mb.Intra4x4PredMode[i4x4]) {
@@ -68,11 +73,12 @@ void IntraPrediction::intra_pred_4x4(mb_t& mb, int comp, int xO, int yO)
     }
 }
 
+template <typename px_t>
 void IntraPrediction::intra_pred_8x8(mb_t& mb, int comp, int xO, int yO)
 {
-    Intra8x8 samples {this->sets, mb, comp, xO, yO};
+    Intra8x8<px_t> samples {this->sets, mb, comp, xO, yO};
 
-    px_t* pred = &this->sets.slice->mb_pred[comp][yO][xO];
+    px_t* pred = &this->sets.slice->mb_pred<px_t>(comp)[yO][xO];
 
     int i8x8 = (yO / 8) * 2 + (xO / 8);
     switch (mb.Intra8x8PredMode[i8x8]) {
@@ -97,11 +103,12 @@ void IntraPrediction::intra_pred_8x8(mb_t& mb, int comp, int xO, int yO)
     }
 }
 
+template <typename px_t>
 void IntraPrediction::intra_pred_16x16(mb_t& mb, int comp)
 {
-    Intra16x16 samples {this->sets, mb, comp, 0, 0};
+    Intra16x16<px_t> samples {this->sets, mb, comp, 0, 0};
 
-    px_t* pred = &this->sets.slice->mb_pred[comp][0][0];
+    px_t* pred = &this->sets.slice->mb_pred<px_t>(comp)[0][0];
 
     switch (mb.Intra16x16PredMode) {
     case Intra_16x16_Vertical:
@@ -115,11 +122,12 @@ void IntraPrediction::intra_pred_16x16(mb_t& mb, int comp)
     }
 }
 
+template <typename px_t>
 void IntraPrediction::intra_pred_chroma(mb_t& mb, int comp)
 {
-    Chroma samples {this->sets, mb, comp, 0, 0};
+    Chroma<px_t> samples {this->sets, mb, comp, 0, 0};
 
-    px_t* pred = &this->sets.slice->mb_pred[comp][0][0];
+    px_t* pred = &this->sets.slice->mb_pred<px_t>(comp)[0][0];
 
     switch (mb.intra_chroma_pred_mode) {
     case Intra_Chroma_DC:
@@ -134,585 +142,575 @@ void IntraPrediction::intra_pred_chroma(mb_t& mb, int comp)
 }
 
 
-IntraPrediction::Intra4x4::Intra4x4(const sets_t& _sets, mb_t& mb, int comp, int xO, int yO) :
-    sets {_sets}
+#if defined(__SSE2__)
+
+// W samples, at most 8, narrowed from 16-bit lanes
+
+template <int W, typename px_t>
+static inline void store(px_t* p, __m128i v)
 {
-    px_t** img = comp ? this->sets.pic->imgUV[comp - 1] : this->sets.pic->imgY;
+    const int n = (W < 8 ? W : 8) * sizeof(px_t);
+    if (sizeof(px_t) == 1)
+        v = _mm_packus_epi16(v, v);
+    if (n <= 4) {
+        int t = _mm_cvtsi128_si32(v);
+        memcpy(p, &t, n);
+    } else if (n == 8)
+        _mm_storel_epi64((__m128i*)p, v);
+    else
+        _mm_storeu_si128((__m128i*)p, v);
+}
 
-    nb_t nbA[4];
-    for (int i = 0; i < 4; i++) {
-        nbA[i] = this->sets.slice->neighbour.get_neighbour(this->sets.slice, false, mb.mbAddrX, {xO - 1, yO + i});
-        nbA[i].mb = nbA[i].mb && nbA[i].mb->slice_nr == mb.slice_nr ? nbA[i].mb : nullptr;
+template <typename px_t>
+static inline __m128i load8(const px_t* p)
+{
+    if (sizeof(px_t) == 1)
+        return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p), _mm_setzero_si128());
+    return _mm_loadu_si128((const __m128i*)p);
+}
+
+#endif
+
+// The neighbouring samples of an NxN block are kept in one line E, the left
+// column bottom up, then the corner and the top row with its extension to
+// the right, so that p(x, y) = E[N + x - y]. E[-1] and E[3N + 1] repeat the
+// end samples. Every directional mode then predicts a row as a window of the
+// 2-tap or 3-tap filtered line.
+
+// dst[i] = (src[i - 1] + 2 * src[i] + src[i + 1] + 2) >> 2 for i < n, eight
+// at a time, so src is read from -1 up to n rounded up to a multiple of 8
+
+template <typename px_t>
+static inline void filter_3tap(px_t* dst, const px_t* src, int n)
+{
+#if defined(__SSE2__)
+    const __m128i two = _mm_set1_epi16(2);
+    for (int i = 0; i < n; i += 8) {
+        __m128i a = load8(src + i - 1);
+        __m128i b = load8(src + i);
+        __m128i c = load8(src + i + 1);
+        __m128i s = _mm_add_epi16(_mm_add_epi16(a, c), _mm_add_epi16(_mm_add_epi16(b, b), two));
+        store<8>(dst + i, _mm_srli_epi16(s, 2));
     }
-    nb_t nbB = this->sets.slice->neighbour.get_neighbour(this->sets.slice, false, mb.mbAddrX, {xO    , yO - 1});
-    nb_t nbC = this->sets.slice->neighbour.get_neighbour(this->sets.slice, false, mb.mbAddrX, {xO + 4, yO - 1});
-    nb_t nbD = this->sets.slice->neighbour.get_neighbour(this->sets.slice, false, mb.mbAddrX, {xO - 1, yO - 1});
-    nbB.mb = nbB.mb && nbB.mb->slice_nr == mb.slice_nr ? nbB.mb : nullptr;
-    nbC.mb = nbC.mb && nbC.mb->slice_nr == mb.slice_nr ? nbC.mb : nullptr;
-    nbD.mb = nbD.mb && nbD.mb->slice_nr == mb.slice_nr ? nbD.mb : nullptr;
-
-    nbC.mb = nbC.mb && !(xO == 4 && (yO == 4 || yO == 12)) ? nbC.mb : nullptr;
-
-    if (this->sets.pps->constrained_intra_pred_flag) {
-        available[0] = 1;
-        for (int i = 0; i < 4; i++)
-            available[0] &= nbA[i].mb && nbA[i].mb->is_intra_block ? 1 : 0;
-        available[1] = nbB.mb && nbB.mb->is_intra_block ? 1 : 0;
-        available[2] = nbC.mb && nbC.mb->is_intra_block ? 1 : 0;
-        available[3] = nbD.mb && nbD.mb->is_intra_block ? 1 : 0;
-    } else {
-        available[0] = nbA[0].mb ? 1 : 0;
-        available[1] = nbB.mb    ? 1 : 0;
-        available[2] = nbC.mb    ? 1 : 0;
-        available[3] = nbD.mb    ? 1 : 0;
+#else
+    for (int i = 0; i < n; ++i)
+        dst[i] = (src[i - 1] + 2 * src[i] + src[i + 1] + 2) >> 2;
+#endif
+}
+
+// dst[i] = (src[i] + src[i + 1] + 1) >> 1 for i < n
+
+template <typename px_t>
+static inline void filter_2tap(px_t* dst, const px_t* src, int n)
+{
+#if defined(__SSE2__)
+    for (int i = 0; i < n; i += 8)
+        store<8>(dst + i, _mm_avg_epu16(load8(src + i), load8(src + i + 1)));
+#else
+    for (int i = 0; i < n; ++i)
+        dst[i] = (src[i] + src[i + 1] + 1) >> 1;
+#endif
+}
+
+template <typename px_t>
+static inline int sum(const px_t* p, int n)
+{
+    int s = 0;
+#if defined(__SSE2__)
+    if (n >= 8) {
+        const __m128i one = _mm_set1_epi16(1);
+        __m128i v = _mm_setzero_si128();
+        for (; n >= 8; n -= 8, p += 8)
+            v = _mm_add_epi32(v, _mm_madd_epi16(load8(p), one));
+        v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+        v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+        s = _mm_cvtsi128_si32(v);
     }
+#endif
+    for (int i = 0; i < n; ++i)
+        s += p[i];
+    return s;
+}
 
-    if (available[3]) {
-        px_t *pix = &img[nbD.y][nbD.x];
-        p(-1, -1) = pix[0];
+template <typename px_t>
+static inline void fill(px_t* pred, int width, int height, int value)
+{
+#if defined(__SSE2__)
+    __m128i v = _mm_set1_epi16(value);
+    for (int y = 0; y < height; ++y, pred += 16) {
+        if (width == 4)
+            store<4>(pred, v);
+        else {
+            for (int x = 0; x < width; x += 8)
+                store<8>(pred + x, v);
+        }
     }
-    if (available[0]) {
-        for (int y = 0; y < 4; y++)
-            p(-1, y) = img[nbA[y].y][nbA[y].x];
+#else
+    for (int y = 0; y < height; ++y, pred += 16) {
+        for (int x = 0; x < width; ++x)
+            pred[x] = value;
+    }
+#endif
+}
+
+// 8.3.3.4 and 8.3.4.4 (a + b * (x - xc) + c * (y - yc) + 16) >> 5, the
+// width being a multiple of 8
+
+template <typename px_t>
+static void plane(px_t* pred, int width, int height, int a, int b, int c, int xc, int yc, int max_pel_value)
+{
+#if defined(__SSE2__)
+    __m128i bx = _mm_set_epi32(3 * b, 2 * b, b, 0);
+    __m128i b4 = _mm_set1_epi32(4 * b);
+    __m128i maxval = _mm_set1_epi16(max_pel_value);
+    for (int y = 0; y < height; ++y, pred += 16) {
+        __m128i v = _mm_add_epi32(_mm_set1_epi32(a + c * (y - yc) - b * xc + 16), bx);
+        for (int x = 0; x < width; x += 8) {
+            __m128i lo = _mm_srai_epi32(v, 5);
+            v = _mm_add_epi32(v, b4);
+            __m128i hi = _mm_srai_epi32(v, 5);
+            v = _mm_add_epi32(v, b4);
+            __m128i s = _mm_packs_epi32(lo, hi);
+            store<8>(pred + x, _mm_min_epi16(_mm_max_epi16(s, _mm_setzero_si128()), maxval));
+        }
     }
-    if (available[1]) {
-        px_t *pix = &img[nbB.y][nbB.x];
-        for (int x = 0; x < 4; x++)
-            p(x, -1) = pix[x];
-        pix = &img[nbC.y][nbC.x - 4];
-        for (int x = 4; x < 8; x++)
-            p(x, -1) = available[2] ? pix[x] : p(3, -1);
-        available[2] = available[1];
+#else
+    for (int y = 0; y < height; ++y, pred += 16) {
+        for (int x = 0; x < width; ++x)
+            pred[x] = clip3(0, max_pel_value, (a + b * (x - xc) + c * (y - yc) + 16) >> 5);
     }
+#endif
 }
 
-void IntraPrediction::Intra4x4::vertical(px_t* pred)
+
+template <int N, typename px_t>
+static void pred_vertical(px_t* pred, const px_t* E)
 {
-    assert(this->available[1]);
+    for (int y = 0; y < N; ++y)
+        memcpy(pred + y * 16, E + N + 1, N * sizeof(px_t));
+}
 
-    for (int y = 0; y < 4; y++) {
-        for (int x = 0; x < 4; x++)
-            pred4x4L(x, y, pred) = p(x, -1);
-    }
+template <int N, typename px_t>
+static void pred_horizontal(px_t* pred, const px_t* E)
+{
+    for (int y = 0; y < N; ++y)
+        fill(pred + y * 16, N, 1, E[N - 1 - y]);
 }
 
-void IntraPrediction::Intra4x4::horizontal(px_t* pred)
+template <int N, typename px_t>
+static void pred_dc(px_t* pred, const px_t* E, bool availA, bool availB, int bit_depth)
 {
-    assert(this->available[0]);
+    int dc;
+    if (availA || availB) {
+        int shift = (N == 4 ? 1 : N == 8 ? 2 : 3) + (availA ? 1 : 0) + (availB ? 1 : 0);
+        int s = (availA ? sum(E, N) : 0) + (availB ? sum(E + N + 1, N) : 0);
+        dc = (s + (1 << (shift - 1))) >> shift;
+    } else
+        dc = 1 << (bit_depth - 1);
 
-    for (int y = 0; y < 4; y++) {
-        for (int x = 0; x < 4; x++)
-            pred4x4L(x, y, pred) = p(-1, y);
-    }
+    fill(pred, N, N, dc);
 }
 
-void IntraPrediction::Intra4x4::dc(px_t* pred)
+template <int N, typename px_t>
+static void pred_diagonal_down_left(px_t* pred, const px_t* E)
 {
-    bool availA = this->available[0];
-    bool availB = this->available[1];
+    px_t f3[3 * N + 8];
+    filter_3tap(f3, E, 3 * N + 1);
 
-    int sum = 0;
-    if (availA || availB) {
-        int round = 0 + (availA ? 2 : 0) + (availB ? 2 : 0);
-        int shift = 1 + (availA ? 1 : 0) + (availB ? 1 : 0);
-        if (availA) {
-            for (int y = 0; y < 4; y++)
-                sum += p(-1, y);
-        }
-        if (availB) {
-            for (int x = 0; x < 4; x++)
-                sum += p(x, -1);
-        }
-        sum = (sum + round) >> shift;
-    } else
-        sum = 1 << (this->sets.sps->BitDepthY - 1);
+    for (int y = 0; y < N; ++y)
+        memcpy(pred + y * 16, f3 + N + 2 + y, N * sizeof(px_t));
+}
+
+template <int N, typename px_t>
+static void pred_diagonal_down_right(px_t* pred, const px_t* E)
+{
+    px_t f3[3 * N + 8];
+    filter_3tap(f3, E, 2 * N);
 
-    for (int y = 0; y < 4; y++) {
-        for (int x = 0; x < 4; x++)
-            pred4x4L(x, y, pred) = sum;
+    for (int y = 0; y < N; ++y)
+        memcpy(pred + y * 16, f3 + N - y, N * sizeof(px_t));
+}
+
+template <int N, typename px_t>
+static void pred_vertical_right(px_t* pred, const px_t* E)
+{
+    px_t f2[3 * N + 8];
+    px_t f3[3 * N + 8];
+    filter_2tap(f2, E, 2 * N);
+    filter_3tap(f3, E, 2 * N);
+
+    // each row is the one two above moved right by a sample
+    memcpy(pred     , f2 + N, N * sizeof(px_t));
+    memcpy(pred + 16, f3 + N, N * sizeof(px_t));
+    for (int y = 2; y < N; ++y) {
+        pred[y * 16] = f3[N + 1 - y];
+        memcpy(pred + y * 16 + 1, pred + (y - 2) * 16, (N - 1) * sizeof(px_t));
     }
 }
 
-void IntraPrediction::Intra4x4::diagonal_down_left(px_t* pred)
+template <int N, typename px_t>
+static void pred_horizontal_down(px_t* pred, const px_t* E)
 {
-    assert(this->available[1]);
+    px_t f2[3 * N + 8];
+    px_t f3[3 * N + 8];
+    filter_2tap(f2, E, 2 * N);
+    filter_3tap(f3, E, 2 * N);
 
-    for (int y = 0; y < 4; y++) {
-        for (int x = 0; x < 4; x++) {
-            if (x == 3 && y == 3)
-                pred4x4L(x, y, pred) = (p(x + y, -1) + 3 * p(x + y + 1, -1) + 2) >> 2;
-            else
-                pred4x4L(x, y, pred) =
-                    (p(x + y, -1) + 2 * p(x + y + 1, -1) + p(x + y + 2, -1) + 2) >> 2;
-        }
+    // left samples interleaved with their 3-tap values, then the top row
+    px_t h[3 * N];
+    for (int j = 0; j < N; ++j) {
+        h[2 * j    ] = f2[j];
+        h[2 * j + 1] = f3[j + 1];
     }
+    for (int m = 0; m < N - 2; ++m)
+        h[2 * N + m] = f3[N + 1 + m];
+
+    for (int y = 0; y < N; ++y)
+        memcpy(pred + y * 16, h + 2 * (N - 1 - y), N * sizeof(px_t));
 }
 
-void IntraPrediction::Intra4x4::diagonal_down_right(px_t* pred)
+template <int N, typename px_t>
+static void pred_vertical_left(px_t* pred, const px_t* E)
 {
-    assert(this->available[3]);
+    px_t f2[3 * N + 8];
+    px_t f3[3 * N + 8];
+    filter_2tap(f2, E, 3 * N);
+    filter_3tap(f3, E, 3 * N);
 
-    for (int y = 0; y < 4; y++) {
-        for (int x = 0; x < 4; x++) {
-            if (x > y)
-                pred4x4L(x, y, pred) =
-                    (p(x - y - 2, -1) + 2 * p(x - y - 1, -1) + p(x - y, -1) + 2) >> 2;
-            else if (x < y)
-                pred4x4L(x, y, pred) =
-                    (p(-1, y - x - 2) + 2 * p(-1, y - x - 1) + p(-1, y - x) + 2) >> 2;
-            else
-                pred4x4L(x, y, pred) = (p(0, -1) + 2 * p(-1, -1) + p(-1, 0) + 2) >> 2;
-        }
+    for (int y = 0; y < N; ++y)
+        memcpy(pred + y * 16, (y % 2 == 0 ? f2 + N + 1 : f3 + N + 2) + y / 2, N * sizeof(px_t));
+}
+
+template <int N, typename px_t>
+static void pred_horizontal_up(px_t* pred, const px_t* E)
+{
+    px_t f2[3 * N + 8];
+    px_t f3[3 * N + 8];
+    filter_2tap(f2, E, N);
+    filter_3tap(f3, E, N);
+
+    // left samples top down interleaved with their 3-tap values, then p(-1, N - 1)
+    px_t u[3 * N];
+    for (int a = 0; a < N - 1; ++a) {
+        u[2 * a    ] = f2[N - 2 - a];
+        u[2 * a + 1] = f3[N - 2 - a];
     }
+    for (int k = 2 * N - 2; k < 3 * N; ++k)
+        u[k] = E[0];
+
+    for (int y = 0; y < N; ++y)
+        memcpy(pred + y * 16, u + 2 * y, N * sizeof(px_t));
+}
+
+
+// A neighbour is usable unless constrained intra prediction excludes it
+
+static inline bool usable(slice_t* slice, mb_t* mb)
+{
+    return mb && (!slice->active_pps->constrained_intra_pred_flag || mb->is_intra_block);
 }
 
-void IntraPrediction::Intra4x4::vertical_right(px_t* pred)
+// n samples left of (xO, yO) going down, stored at p[0], p[-1], ... Only an
+// MBAFF frame can interleave the rows of two macroblocks in this column.
+
+template <typename px_t>
+static bool left_column(slice_t* slice, mb_t& mb, bool chroma, int xO, int yO, int n, px_t** img, px_t* p)
 {
-    assert(this->available[3]);
+    Neighbour& neighbour = slice->neighbour;
 
-    for (int y = 0; y < 4; y++) {
-        for (int x = 0; x < 4; x++) {
-            int zVR = 2 * x - y;
-            if (zVR >= 0 && (zVR % 2) == 0)
-                pred4x4L(x, y, pred) = (p(x - (y >> 1) - 1, -1) + p(x - (y >> 1), -1) + 1) >> 1;
-            else if (zVR >= 0 && (zVR % 2) == 1)
-                pred4x4L(x, y, pred) = (p(x - (y >> 1) - 2, -1) +
-                    2 * p(x - (y >> 1) - 1, -1) + p(x - (y >> 1), -1) + 2) >> 2;
-            else if (zVR == -1)
-                pred4x4L(x, y, pred) = (p(-1, 0) + 2 * p(-1, -1) + p(0, -1) + 2) >> 2;
-            else // zVR < -1
-                pred4x4L(x, y, pred) = (p(-1, y - 2 * x - 1) +
-                    2 * p(-1, y - 2 * x - 2) + p(-1, y - 2 * x - 3) + 2) >> 2;
-        }
+    if (!slice->header.MbaffFrameFlag) {
+        nb_t nbA = neighbour.get_neighbour(slice, chroma, mb.mbAddrX, {xO - 1, yO});
+        if (!usable(slice, nbA.mb))
+            return false;
+        for (int y = 0; y < n; ++y)
+            p[-y] = img[nbA.y + y][nbA.x];
+        return true;
     }
+
+    nb_t nbA[16];
+    for (int y = 0; y < n; ++y) {
+        nbA[y] = neighbour.get_neighbour(slice, chroma, mb.mbAddrX, {xO - 1, yO + y});
+        if (!usable(slice, nbA[y].mb))
+            return false;
+    }
+    for (int y = 0; y < n; ++y)
+        p[-y] = img[nbA[y].y][nbA[y].x];
+    return true;
 }
 
-void IntraPrediction::Intra4x4::horizontal_down(px_t* pred)
+// n samples of the row above (xO, yO)
+
+template <typename px_t>
+static bool top_row(slice_t* slice, mb_t& mb, bool chroma, int xO, int yO, int n, px_t** img, px_t* p)
 {
-    assert(this->available[3]);
+    nb_t nb = slice->neighbour.get_neighbour(slice, chroma, mb.mbAddrX, {xO, yO - 1});
+    if (!usable(slice, nb.mb))
+        return false;
+    memcpy(p, &img[nb.y][nb.x], n * sizeof(px_t));
+    return true;
+}
 
-    for (int y = 0; y < 4; y++) {
-        for (int x = 0; x < 4; x++) {
-            int zHD = 2 * y - x;
-            if (zHD >= 0 && (zHD % 2) == 0)
-                pred4x4L(x, y, pred) = (p(-1, y - (x >> 1) - 1) + p(-1, y - (x >> 1)) + 1) >> 1;
-            else if (zHD >= 0 && (zHD % 2) == 1)
-                pred4x4L(x, y, pred) = (p(-1, y - (x >> 1) - 2) +
-                    2 * p(-1, y - (x >> 1) - 1) + p(-1, y - (x >> 1)) + 2) >> 2;
-            else if (zHD == -1)
-                pred4x4L(x, y, pred) = (p(-1, 0) + 2 * p(-1, -1) + p(0, -1) + 2) >> 2;
-            else // zHD < -1
-                pred4x4L(x, y, pred) = (p(x - 2 * y - 1, -1) +
-                    2 * p(x - 2 * y - 2, -1) + p(x - 2 * y - 3, -1) + 2) >> 2;
-        }
+
+template <typename px_t>
+IntraPrediction::Intra4x4<px_t>::Intra4x4(const sets_t& _sets, mb_t& mb, int comp, int xO, int yO) :
+    sets {_sets}
+{
+    slice_t* slice = this->sets.slice;
+    px_t** img = this->sets.pic->img<px_t>(comp);
+    px_t* E = this->edge + 1;
+
+    memset(this->edge, 0, sizeof(this->edge));
+
+    available[0] = left_column(slice, mb, false, xO, yO, 4, img, E + 3);
+    available[1] = top_row(slice, mb, false, xO, yO, 4, img, E + 5);
+    available[2] = !(xO == 4 && (yO == 4 || yO == 12)) &&
+                   top_row(slice, mb, false, xO + 4, yO, 4, img, E + 9);
+    available[3] = top_row(slice, mb, false, xO - 1, yO, 1, img, E + 4);
+
+    if (!available[2]) {
+        for (int x = 4; x < 8; ++x)
+            E[5 + x] = E[8];
     }
+    E[-1] = E[0];
+    E[13] = E[12];
 }
 
-void IntraPrediction::Intra4x4::vertical_left(px_t* pred)
+template <typename px_t>
+void IntraPrediction::Intra4x4<px_t>::vertical(px_t* pred)
 {
     assert(this->available[1]);
 
-    for (int y = 0; y < 4; y++) {
-        for (int x = 0; x < 4; x++) {
-            if ((y % 2) == 0)
-                pred4x4L(x, y, pred) = (p(x + (y >> 1), -1) + p(x + (y >> 1) + 1, -1) + 1) >> 1;
-            else // (y % 2) == 1
-                pred4x4L(x, y, pred) = (p(x + (y >> 1), -1) +
-                    2 * p(x + (y >> 1) + 1, -1) + p(x + (y >> 1) + 2, -1) + 2) >> 2;
-        }
-    }
+    pred_vertical<4>(pred, this->edge + 1);
 }
 
-void IntraPrediction::Intra4x4::horizontal_up(px_t* pred)
+template <typename px_t>
+void IntraPrediction::Intra4x4<px_t>::horizontal(px_t* pred)
 {
     assert(this->available[0]);
 
-    int max = 4;
-    int mHU = (max - 1) * 2 - 1;
-    for (int y = 0; y < 4; y++) {
-        for (int x = 0; x < 4; x++) {
-            int zHU = x + 2 * y;
-            if (zHU < mHU && (zHU % 2) == 0)
-                pred4x4L(x, y, pred) = (p(-1, y + (x >> 1)) + p(-1, y + (x >> 1) + 1) + 1) >> 1;
-            else if (zHU < mHU && (zHU % 2) == 1)
-                pred4x4L(x, y, pred) = (p(-1, y + (x >> 1)) +
-                    2 * p(-1, y + (x >> 1) + 1) + p(-1, y + (x >> 1) + 2) + 2) >> 2;
-            else if (zHU == mHU)
-                pred4x4L(x, y, pred) = (p(-1, max - 2) + 3 * p(-1, max - 1) + 2) >> 2;
-            else // zHU > mHU
-                pred4x4L(x, y, pred) = p(-1, max - 1);
-        }
-    }
+    pred_horizontal<4>(pred, this->edge + 1);
 }
 
-inline px_t& IntraPrediction::Intra4x4::pred4x4L(int x, int y, px_t* pred)
+template <typename px_t>
+void IntraPrediction::Intra4x4<px_t>::dc(px_t* pred)
 {
-    return pred[y * 16 + x];
+    pred_dc<4>(pred, this->edge + 1, this->available[0], this->available[1], this->sets.sps->BitDepthY);
 }
 
-inline px_t& IntraPrediction::Intra4x4::p(int x, int y)
+template <typename px_t>
+void IntraPrediction::Intra4x4<px_t>::diagonal_down_left(px_t* pred)
 {
-    return this->samples[(y + 1) * 9 + (x + 1)];
+    assert(this->available[1]);
+
+    pred_diagonal_down_left<4>(pred, this->edge + 1);
 }
 
+template <typename px_t>
+void IntraPrediction::Intra4x4<px_t>::diagonal_down_right(px_t* pred)
+{
+    assert(this->available[3]);
+
+    pred_diagonal_down_right<4>(pred, this->edge + 1);
+}
+
+template <typename px_t>
+void IntraPrediction::Intra4x4<px_t>::vertical_right(px_t* pred)
+{
+    assert(this->available[3]);
+
+    pred_vertical_right<4>(pred, this->edge + 1);
+}
+
+template <typename px_t>
+void IntraPrediction::Intra4x4<px_t>::horizontal_down(px_t* pred)
+{
+    assert(this->available[3]);
 
-IntraPrediction::Intra8x8::Intra8x8(const sets_t& _sets, mb_t& mb, int comp, int xO, int yO) :
+    pred_horizontal_down<4>(pred, this->edge + 1);
+}
+
+template <typename px_t>
+void IntraPrediction::Intra4x4<px_t>::vertical_left(px_t* pred)
+{
+    assert(this->available[1]);
+
+    pred_vertical_left<4>(pred, this->edge + 1);
+}
+
+template <typename px_t>
+void IntraPrediction::Intra4x4<px_t>::horizontal_up(px_t* pred)
+{
+    assert(this->available[0]);
+
+    pred_horizontal_up<4>(pred, this->edge + 1);
+}
+
+
+template <typename px_t>
+IntraPrediction::Intra8x8<px_t>::Intra8x8(const sets_t& _sets, mb_t& mb, int comp, int xO, int yO) :
     sets {_sets}
 {
-    px_t** img = comp ? this->sets.pic->imgUV[comp - 1] : this->sets.pic->imgY;
+    slice_t* slice = this->sets.slice;
+    px_t** img = this->sets.pic->img<px_t>(comp);
+    px_t* E = this->edge_lf + 1;
 
-    nb_t nbA[8];
-    for (int i = 0; i < 8; i++) {
-        nbA[i] = this->sets.slice->neighbour.get_neighbour(this->sets.slice, false, mb.mbAddrX, {xO - 1, yO + i});
-        nbA[i].mb = nbA[i].mb && nbA[i].mb->slice_nr == mb.slice_nr ? nbA[i].mb : nullptr;
-    }
-    nb_t nbB = this->sets.slice->neighbour.get_neighbour(this->sets.slice, false, mb.mbAddrX, {xO    , yO - 1});
-    nb_t nbC = this->sets.slice->neighbour.get_neighbour(this->sets.slice, false, mb.mbAddrX, {xO + 8, yO - 1});
-    nb_t nbD = this->sets.slice->neighbour.get_neighbour(this->sets.slice, false, mb.mbAddrX, {xO - 1, yO - 1});
-    nbB.mb = nbB.mb && nbB.mb->slice_nr == mb.slice_nr ? nbB.mb : nullptr;
-    nbC.mb = nbC.mb && nbC.mb->slice_nr == mb.slice_nr ? nbC.mb : nullptr;
-    nbD.mb = nbD.mb && nbD.mb->slice_nr == mb.slice_nr ? nbD.mb : nullptr;
-
-    nbC.mb = nbC.mb && !(xO == 8 && yO == 8) ? nbC.mb : nullptr;
-
-    if (this->sets.pps->constrained_intra_pred_flag) {
-        available[0] = 1;
-        for (int i = 0; i < 8; i++)
-            available[0] &= nbA[i].mb && nbA[i].mb->is_intra_block ? 1 : 0;
-        available[1] = nbB.mb && nbB.mb->is_intra_block ? 1 : 0;
-        available[2] = nbC.mb && nbC.mb->is_intra_block ? 1 : 0;
-        available[3] = nbD.mb && nbD.mb->is_intra_block ? 1 : 0;
-    } else {
-        available[0] = nbA[0].mb ? 1 : 0;
-        available[1] = nbB.mb    ? 1 : 0;
-        available[2] = nbC.mb    ? 1 : 0;
-        available[3] = nbD.mb    ? 1 : 0;
-    }
+    memset(this->edge_lf, 0, sizeof(this->edge_lf));
 
-    if (available[3]) {
-        px_t *pix = &img[nbD.y][nbD.x];
-        po(-1, -1) = pix[0];
-    }
-    if (available[0]) {
-        for (int y = 0; y < 8; y++)
-            po(-1, y) = img[nbA[y].y][nbA[y].x];
-    }
-    if (available[1]) {
-        px_t *pix = &img[nbB.y][nbB.x];
-        for (int x = 0; x < 8; x++)
-            po(x, -1) = pix[x];
-        pix = &img[nbC.y][nbC.x - 8];
-        for (int x = 8; x < 16; x++)
-            po(x, -1) = available[2] ? pix[x] : po(7, -1);
-        available[2] = available[1];
+    available[0] = left_column(slice, mb, false, xO, yO, 8, img, E + 7);
+    available[1] = top_row(slice, mb, false, xO, yO, 8, img, E + 9);
+    available[2] = !(xO == 8 && yO == 8) &&
+                   top_row(slice, mb, false, xO + 8, yO, 8, img, E + 17);
+    available[3] = top_row(slice, mb, false, xO - 1, yO, 1, img, E + 8);
+
+    if (!available[2]) {
+        for (int x = 8; x < 16; ++x)
+            E[9 + x] = E[16];
     }
+    E[-1] = E[0];
+    E[25] = E[24];
 
     this->filtering();
 }
 
-void IntraPrediction::Intra8x8::filtering()
+// 8.3.2.2.1 Reference sample filtering, the ends without both neighbours
+// are patched up afterwards
+
+template <typename px_t>
+void IntraPrediction::Intra8x8<px_t>::filtering()
 {
     bool availA = this->available[0];
     bool availB = this->available[1];
     bool availD = this->available[3];
 
-    if (availB) {
-        if (availD)
-            p(0, -1) = (po(-1, -1) + 2 * po(0, -1) + po(1, -1) + 2) >> 2;
-        else
-            p(0, -1) = (3 * po(0, -1) + po(1, -1) + 2) >> 2;
-        for (int x = 1; x < 15; x++)
-            p(x, -1) = (po(x - 1, -1) + 2 * po(x, -1) + po(x + 1, -1) + 2) >> 2;
-        p(15, -1) = (po(14, -1) + 3 * po(15, -1) + 2) >> 2;
-    }
-    if (availD) {
-        if (availA && availB)
-            p(-1, -1) = (po(0, -1) + 2 * po(-1, -1) + po(-1, 0) + 2) >> 2;
-        else if (availB)
-            p(-1, -1) = (3 * po(-1, -1) + po(0, -1) + 2) >> 2;
+    const px_t* po = this->edge_lf + 1;
+    px_t* p = this->edge + 1;
+
+    filter_3tap(p, po, 25);
+
+    if (!availD) {
+        p[9] = (3 * po[9] + po[10] + 2) >> 2;
+        p[7] = (3 * po[7] + po[6] + 2) >> 2;
+    } else if (!availA || !availB) {
+        if (availB)
+            p[8] = (3 * po[8] + po[9] + 2) >> 2;
         else if (availA)
-            p(-1, -1) = (3 * po(-1, -1) + po(-1, 0) + 2) >> 2;
+            p[8] = (3 * po[8] + po[7] + 2) >> 2;
         else
-            p(-1, -1) = po(-1, -1);
-    }
-    if (availA) {
-        if (availD)
-            p(-1, 0) = (po(-1, -1) + 2 * po(-1, 0) + po(-1, 1) + 2) >> 2;
-        else
-            p(-1, 0) = (3 * po(-1, 0) + po(-1, 1) + 2) >> 2;
-        for (int y = 1; y < 7; y++)
-            p(-1, y) = (po(-1, y - 1) + 2 * po(-1, y) + po(-1, y + 1) + 2) >> 2;
-        p(-1, 7) = (po(-1, 6) + 3 * po(-1, 7) + 2) >> 2;
+            p[8] = po[8];
     }
+    p[-1] = p[0];
+    p[25] = p[24];
 }
 
-void IntraPrediction::Intra8x8::vertical(px_t* pred)
+template <typename px_t>
+void IntraPrediction::Intra8x8<px_t>::vertical(px_t* pred)
 {
     assert(this->available[1]);
 
-    for (int y = 0; y < 8; y++) {
-        for (int x = 0; x < 8; x++)
-            pred8x8L(x, y, pred) = p(x, -1);
-    }
+    pred_vertical<8>(pred, this->edge + 1);
 }
 
-void IntraPrediction::Intra8x8::horizontal(px_t* pred)
+template <typename px_t>
+void IntraPrediction::Intra8x8<px_t>::horizontal(px_t* pred)
 {
     assert(this->available[0]);
 
-    for (int y = 0; y < 8; y++) {
-        for (int x = 0; x < 8; x++)
-            pred8x8L(x, y, pred) = p(-1, y);
-    }
+    pred_horizontal<8>(pred, this->edge + 1);
 }
 
-void IntraPrediction::Intra8x8::dc(px_t* pred)
+template <typename px_t>
+void IntraPrediction::Intra8x8<px_t>::dc(px_t* pred)
 {
-    bool availA = this->available[0];
-    bool availB = this->available[1];
-
-    int sum = 0;
-    if (availA || availB) {
-        int round = 0 + (availA ? 4 : 0) + (availB ? 4 : 0);
-        int shift = 2 + (availA ? 1 : 0) + (availB ? 1 : 0);
-        if (availA) {
-            for (int y = 0; y < 8; y++)
-                sum += p(-1, y);
-        }
-        if (availB) {
-            for (int x = 0; x < 8; x++)
-                sum += p(x, -1);
-        }
-        sum = (sum + round) >> shift;
-    } else
-        sum = 1 << (this->sets.sps->BitDepthY - 1);
-
-    for (int y = 0; y < 8; y++) {
-        for (int x = 0; x < 8; x++)
-            pred8x8L(x, y, pred) = sum;
-    }
+    pred_dc<8>(pred, this->edge + 1, this->available[0], this->available[1], this->sets.sps->BitDepthY);
 }
 
-void IntraPrediction::Intra8x8::diagonal_down_left(px_t* pred)
+template <typename px_t>
+void IntraPrediction::Intra8x8<px_t>::diagonal_down_left(px_t* pred)
 {
     assert(this->available[1]);
 
-    for (int y = 0; y < 8; y++) {
-        for (int x = 0; x < 8; x++) {
-            if (x == 7 && y == 7)
-                pred8x8L(x, y, pred) = (p(x + y, -1) + 3 * p(x + y + 1, -1) + 2) >> 2;
-            else
-                pred8x8L(x, y, pred) =
-                    (p(x + y, -1) + 2 * p(x + y + 1, -1) + p(x + y + 2, -1) + 2) >> 2;
-        }
-    }
+    pred_diagonal_down_left<8>(pred, this->edge + 1);
 }
 
-void IntraPrediction::Intra8x8::diagonal_down_right(px_t* pred)
+template <typename px_t>
+void IntraPrediction::Intra8x8<px_t>::diagonal_down_right(px_t* pred)
 {
     assert(this->available[3]);
 
-    for (int y = 0; y < 8; y++) {
-        for (int x = 0; x < 8; x++) {
-            if (x > y)
-                pred8x8L(x, y, pred) =
-                    (p(x - y - 2, -1) + 2 * p(x - y - 1, -1) + p(x - y, -1) + 2) >> 2;
-            else if (x < y)
-                pred8x8L(x, y, pred) =
-                    (p(-1, y - x - 2) + 2 * p(-1, y - x - 1) + p(-1, y - x) + 2) >> 2;
-            else
-                pred8x8L(x, y, pred) = (p(0, -1) + 2 * p(-1, -1) + p(-1, 0) + 2) >> 2;
-        }
-    }
+    pred_diagonal_down_right<8>(pred, this->edge + 1);
 }
 
-void IntraPrediction::Intra8x8::vertical_right(px_t* pred)
+template <typename px_t>
+void IntraPrediction::Intra8x8<px_t>::vertical_right(px_t* pred)
 {
     assert(this->available[3]);
 
-    for (int y = 0; y < 8; y++) {
-        for (int x = 0; x < 8; x++) {
-            int zVR = 2 * x - y;
-            if (zVR >= 0 && (zVR % 2) == 0)
-                pred8x8L(x, y, pred) = (p(x - (y >> 1) - 1, -1) + p(x - (y >> 1), -1) + 1) >> 1;
-            else if (zVR >= 0 && (zVR % 2) == 1)
-                pred8x8L(x, y, pred) = (p(x - (y >> 1) - 2, -1) +
-                    2 * p(x - (y >> 1) - 1, -1) + p(x - (y >> 1), -1) + 2) >> 2;
-            else if (zVR == -1)
-                pred8x8L(x, y, pred) = (p(-1, 0) + 2 * p(-1, -1) + p(0, -1) + 2) >> 2;
-            else // zVR < -1
-                pred8x8L(x, y, pred) = (p(-1, y - 2 * x - 1) +
-                    2 * p(-1, y - 2 * x - 2) + p(-1, y - 2 * x - 3) + 2) >> 2;
-        }
-    }
+    pred_vertical_right<8>(pred, this->edge + 1);
 }
 
-void IntraPrediction::Intra8x8::horizontal_down(px_t* pred)
+template <typename px_t>
+void IntraPrediction::Intra8x8<px_t>::horizontal_down(px_t* pred)
 {
     assert(this->available[3]);
 
-    for (int y = 0; y < 8; y++) {
-        for (int x = 0; x < 8; x++) {
-            int zHD = 2 * y - x;
-            if (zHD >= 0 && (zHD % 2) == 0)
-                pred8x8L(x, y, pred) = (p(-1, y - (x >> 1) - 1) + p(-1, y - (x >> 1)) + 1) >> 1;
-            else if (zHD >= 0 && (zHD % 2) == 1)
-                pred8x8L(x, y, pred) = (p(-1, y - (x >> 1) - 2) +
-                    2 * p(-1, y - (x >> 1) - 1) + p(-1, y - (x >> 1)) + 2) >> 2;
-            else if (zHD == -1)
-                pred8x8L(x, y, pred) = (p(-1, 0) + 2 * p(-1, -1) + p(0, -1) + 2) >> 2;
-            else // zHD < -1
-                pred8x8L(x, y, pred) = (p(x - 2 * y - 1, -1) +
-                    2 * p(x - 2 * y - 2, -1) + p(x - 2 * y - 3, -1) + 2) >> 2;
-        }
-    }
+    pred_horizontal_down<8>(pred, this->edge + 1);
 }
 
-void IntraPrediction::Intra8x8::vertical_left(px_t* pred)
+template <typename px_t>
+void IntraPrediction::Intra8x8<px_t>::vertical_left(px_t* pred)
 {
     assert(this->available[1]);
 
-    for (int y = 0; y < 8; y++) {
-        for (int x = 0; x < 8; x++) {
-            if ((y % 2) == 0)
-                pred8x8L(x, y, pred) = (p(x + (y >> 1), -1) + p(x + (y >> 1) + 1, -1) + 1) >> 1;
-            else // (y % 2) == 1
-                pred8x8L(x, y, pred) = (p(x + (y >> 1), -1) +
-                    2 * p(x + (y >> 1) + 1, -1) + p(x + (y >> 1) + 2, -1) + 2) >> 2;
-        }
-    }
+    pred_vertical_left<8>(pred, this->edge + 1);
 }
 
-void IntraPrediction::Intra8x8::horizontal_up(px_t* pred)
+template <typename px_t>
+void IntraPrediction::Intra8x8<px_t>::horizontal_up(px_t* pred)
 {
     assert(this->available[0]);
 
-    int max = 8;
-    int mHU = (max - 1) * 2 - 1;
-    for (int y = 0; y < 8; y++) {
-        for (int x = 0; x < 8; x++) {
-            int zHU = x + 2 * y;
-            if (zHU < mHU && (zHU % 2) == 0)
-                pred8x8L(x, y, pred) = (p(-1, y + (x >> 1)) + p(-1, y + (x >> 1) + 1) + 1) >> 1;
-            else if (zHU < mHU && (zHU % 2) == 1)
-                pred8x8L(x, y, pred) = (p(-1, y + (x >> 1)) +
-                    2 * p(-1, y + (x >> 1) + 1) + p(-1, y + (x >> 1) + 2) + 2) >> 2;
-            else if (zHU == mHU)
-                pred8x8L(x, y, pred) = (p(-1, max - 2) + 3 * p(-1, max - 1) + 2) >> 2;
-            else // zHU > mHU
-                pred8x8L(x, y, pred) = p(-1, max - 1);
-        }
-    }
-}
-
-inline px_t& IntraPrediction::Intra8x8::pred8x8L(int x, int y, px_t* pred)
-{
-    return pred[y * 16 + x];
+    pred_horizontal_up<8>(pred, this->edge + 1);
 }
 
-inline px_t& IntraPrediction::Intra8x8::po(int x, int y)
-{
-    return this->samples_lf[(y + 1) * 17 + (x + 1)];
-}
 
-inline px_t& IntraPrediction::Intra8x8::p(int x, int y)
-{
-    return this->samples[(y + 1) * 17 + (x + 1)];
-}
-
-
-IntraPrediction::Intra16x16::Intra16x16(const sets_t& _sets, mb_t& mb, int comp, int xO, int yO) :
+template <typename px_t>
+IntraPrediction::Intra16x16<px_t>::Intra16x16(const sets_t& _sets, mb_t& mb, int comp, int xO, int yO) :
     sets {_sets}
 {
-    px_t** img = comp ? this->sets.pic->imgUV[comp - 1] : this->sets.pic->imgY;
-
-    nb_t nbA[16];
-    for (int i = 0; i < 16; i++) {
-        nbA[i] = this->sets.slice->neighbour.get_neighbour(this->sets.slice, false, mb.mbAddrX, {xO - 1, yO + i});
-        nbA[i].mb = nbA[i].mb && nbA[i].mb->slice_nr == mb.slice_nr ? nbA[i].mb : nullptr;
-    }
-    nb_t nbB = this->sets.slice->neighbour.get_neighbour(this->sets.slice, false, mb.mbAddrX, {xO    , yO - 1});
-    nb_t nbD = this->sets.slice->neighbour.get_neighbour(this->sets.slice, false, mb.mbAddrX, {xO - 1, yO - 1});
-    nbB.mb = nbB.mb && nbB.mb->slice_nr == mb.slice_nr ? nbB.mb : nullptr;
-    nbD.mb = nbD.mb && nbD.mb->slice_nr == mb.slice_nr ? nbD.mb : nullptr;
-
-    if (this->sets.pps->constrained_intra_pred_flag) {
-        available[0] = 1;
-        for (int i = 0; i < 16; i++)
-            available[0] &= nbA[i].mb && nbA[i].mb->is_intra_block ? 1 : 0;
-        available[1] = nbB.mb && nbB.mb->is_intra_block ? 1 : 0;
-        available[2] = 0;
-        available[3] = nbD.mb && nbD.mb->is_intra_block ? 1 : 0;
-    } else {
-        available[0] = nbA[0].mb ? 1 : 0;
-        available[1] = nbB.mb    ? 1 : 0;
-        available[2] = 0;
-        available[3] = nbD.mb    ? 1 : 0;
-    }
+    slice_t* slice = this->sets.slice;
+    px_t** img = this->sets.pic->img<px_t>(comp);
+    px_t* E = this->edge + 1;
 
-    if (available[3]) {
-        px_t *pix = &img[nbD.y][nbD.x];
-        p(-1, -1) = pix[0];
-    }
-    if (available[0]) {
-        for (int y = 0; y < 16; y++)
-            p(-1, y) = img[nbA[y].y][nbA[y].x];
-    }
-    if (available[1]) {
-        px_t *pix = &img[nbB.y][nbB.x];
-        for (int x = 0; x < 16; x++)
-            p(x, -1) = pix[x];
-    }
+    available[0] = left_column(slice, mb, false, xO, yO, 16, img, E + 15);
+    available[1] = top_row(slice, mb, false, xO, yO, 16, img, E + 17);
+    available[2] = 0;
+    available[3] = top_row(slice, mb, false, xO - 1, yO, 1, img, E + 16);
 }
 
-void IntraPrediction::Intra16x16::vertical(px_t* pred)
+template <typename px_t>
+void IntraPrediction::Intra16x16<px_t>::vertical(px_t* pred)
 {
     assert(this->available[1]);
 
-    for (int y = 0; y < 16; y++) {
-        for (int x = 0; x < 16; x++)
-            predL(x, y, pred) = p(x, -1);
-    }
+    pred_vertical<16>(pred, this->edge + 1);
 }
 
-void IntraPrediction::Intra16x16::horizontal(px_t* pred)
+template <typename px_t>
+void IntraPrediction::Intra16x16<px_t>::horizontal(px_t* pred)
 {
     assert(this->available[0]);
 
-    for (int y = 0; y < 16; y++) {
-        for (int x = 0; x < 16; x++)
-            predL(x, y, pred) = p(-1, y);
-    }
+    pred_horizontal<16>(pred, this->edge + 1);
 }
 
-void IntraPrediction::Intra16x16::dc(px_t* pred)
+template <typename px_t>
+void IntraPrediction::Intra16x16<px_t>::dc(px_t* pred)
 {
-    bool availA = this->available[0];
-    bool availB = this->available[1];
-
-    int sum = 0;
-    if (availA || availB) {
-        int round = 0 + (availA ? 8 : 0) + (availB ? 8 : 0);
-        int shift = 3 + (availA ? 1 : 0) + (availB ? 1 : 0);
-        if (availA) {
-            for (int y = 0; y < 16; y++)
-                sum += p(-1, y);
-        }
-        if (availB) {
-            for (int x = 0; x < 16; x++)
-                sum += p(x, -1);
-        }
-        sum = (sum + round) >> shift;
-    } else
-        sum = 1 << (this->sets.sps->BitDepthY - 1);
-
-    for (int y = 0; y < 16; y++) {
-        for (int x = 0; x < 16; x++)
-            predL(x, y, pred) = sum;
-    }
+    pred_dc<16>(pred, this->edge + 1, this->available[0], this->available[1], this->sets.sps->BitDepthY);
 }
 
-void IntraPrediction::Intra16x16::plane(px_t* pred)
+template <typename px_t>
+void IntraPrediction::Intra16x16<px_t>::plane(px_t* pred)
 {
     assert(this->available[3]);
 
@@ -727,75 +725,33 @@ void IntraPrediction::Intra16x16::plane(px_t* pred)
     int b = (5 * H + 32) >> 6;
     int c = (5 * V + 32) >> 6;
 
-    for (int y = 0; y < 16; y++) {
-        for (int x = 0; x < 16; x++)
-            predL(x, y, pred) = clip3(0, (1 << this->sets.sps->BitDepthY) - 1,
-                (a + b * (x - 7) + c * (y - 7) + 16) >> 5);
-    }
-}
-
-inline px_t& IntraPrediction::Intra16x16::predL(int x, int y, px_t* pred)
-{
-    return pred[y * 16 + x];
+    ::vio::h264::plane(pred, 16, 16, a, b, c, 7, 7, (1 << this->sets.sps->BitDepthY) - 1);
 }
 
-inline px_t& IntraPrediction::Intra16x16::p(int x, int y)
+template <typename px_t>
+inline px_t& IntraPrediction::Intra16x16<px_t>::p(int x, int y)
 {
-    return this->samples[(y + 1) * 17 + (x + 1)];
+    return this->edge[1 + 16 + x - y];
 }
 
 
-IntraPrediction::Chroma::Chroma(const sets_t& _sets, mb_t& mb, int comp, int xO, int yO) :
+template <typename px_t>
+IntraPrediction::Chroma<px_t>::Chroma(const sets_t& _sets, mb_t& mb, int comp, int xO, int yO) :
     sets {_sets}
 {
-    px_t** img = this->sets.pic->imgUV[comp - 1];
+    slice_t* slice = this->sets.slice;
+    px_t** img = this->sets.pic->img<px_t>(comp);
+    px_t* E = this->edge + 1;
+    int half = this->sets.sps->MbHeightC / 2;
 
-    nb_t nbA[16];
-    for (int i = 0; i < this->sets.sps->MbHeightC; ++i) {
-        nbA[i] = this->sets.slice->neighbour.get_neighbour(this->sets.slice, true, mb.mbAddrX, {xO - 1, yO + i});
-        nbA[i].mb = nbA[i].mb && nbA[i].mb->slice_nr == mb.slice_nr ? nbA[i].mb : nullptr;
-    }
-    nb_t nbB = this->sets.slice->neighbour.get_neighbour(this->sets.slice, true, mb.mbAddrX, {xO    , yO - 1});
-    nb_t nbD = this->sets.slice->neighbour.get_neighbour(this->sets.slice, true, mb.mbAddrX, {xO - 1, yO - 1});
-    nbB.mb = nbB.mb && nbB.mb->slice_nr == mb.slice_nr ? nbB.mb : nullptr;
-    nbD.mb = nbD.mb && nbD.mb->slice_nr == mb.slice_nr ? nbD.mb : nullptr;
-
-    if (this->sets.pps->constrained_intra_pred_flag) {
-        available[0] = 1;
-        for (int i = 0; i < this->sets.sps->MbHeightC / 2; ++i)
-            available[0] &= nbA[i].mb && nbA[i].mb->is_intra_block ? 1 : 0;
-        available[1] = nbB.mb && nbB.mb->is_intra_block ? 1 : 0;
-        available[2] = 1;
-        for (int i = this->sets.sps->MbHeightC / 2; i < this->sets.sps->MbHeightC; ++i)
-            available[2] &= nbA[i].mb && nbA[i].mb->is_intra_block ? 1 : 0;
-        available[3] = nbD.mb && nbD.mb->is_intra_block ? 1 : 0;
-    } else {
-        available[0] = nbA[0].mb ? 1 : 0;
-        available[1] = nbB.mb    ? 1 : 0;
-        available[2] = nbA[0].mb ? 1 : 0;
-        available[3] = nbD.mb    ? 1 : 0;
-    }
-
-    if (available[3]) {
-        px_t *pix = &img[nbD.y][nbD.x];
-        p(-1, -1) = pix[0];
-    }
-    if (available[0]) {
-        for (int y = 0; y < this->sets.sps->MbHeightC / 2; y++)
-            p(-1, y) = img[nbA[y].y][nbA[y].x];
-    }
-    if (available[2]) {
-        for (int y = this->sets.sps->MbHeightC / 2; y < this->sets.sps->MbHeightC; y++)
-            p(-1, y) = img[nbA[y].y][nbA[y].x];
-    }
-    if (available[1]) {
-        px_t *pix = &img[nbB.y][nbB.x];
-        for (int x = 0; x < this->sets.sps->MbWidthC; x++)
-            p(x, -1) = pix[x];
-    }
+    available[0] = left_column(slice, mb, true, xO, yO, half, img, E + 15);
+    available[1] = top_row(slice, mb, true, xO, yO, this->sets.sps->MbWidthC, img, E + 17);
+    available[2] = left_column(slice, mb, true, xO, yO + half, half, img, E + 15 - half);
+    available[3] = top_row(slice, mb, true, xO - 1, yO, 1, img, E + 16);
 }
 
-void IntraPrediction::Chroma::dc4x4(px_t* pred, bool* available, int xO, int yO)
+template <typename px_t>
+void IntraPrediction::Chroma<px_t>::dc4x4(px_t* pred, bool* available, int xO, int yO)
 {
     bool availA = available[0];
     bool availB = available[1];
@@ -816,13 +772,11 @@ void IntraPrediction::Chroma::dc4x4(px_t* pred, bool* available, int xO, int yO)
     } else
         sum = 1 << (this->sets.sps->BitDepthC - 1);
 
-    for (int y = 0; y < 4; y++) {
-        for (int x = 0; x < 4; x++)
-            predC(x + xO, y + yO, pred) = sum;
-    }
+    fill(&predC(xO, yO, pred), 4, 4, sum);
 }
 
-void IntraPrediction::Chroma::dc(px_t* pred)
+template <typename px_t>
+void IntraPrediction::Chroma<px_t>::dc(px_t* pred)
 {
     for (int chroma4x4BlkIdx = 0;
          chroma4x4BlkIdx < (1 << (this->sets.sps->ChromaArrayType + 1));
@@ -848,27 +802,26 @@ void IntraPrediction::Chroma::dc(px_t* pred)
     }
 }
 
-void IntraPrediction::Chroma::horizontal(px_t* pred)
+template <typename px_t>
+void IntraPrediction::Chroma<px_t>::horizontal(px_t* pred)
 {
     assert(this->available[0]);
 
-    for (int y = 0; y < this->sets.sps->MbHeightC; y++) {
-        for (int x = 0; x < this->sets.sps->MbWidthC; x++)
-            predC(x, y, pred) = p(-1, y);
-    }
+    for (int y = 0; y < this->sets.sps->MbHeightC; y++)
+        fill(&predC(0, y, pred), this->sets.sps->MbWidthC, 1, p(-1, y));
 }
 
-void IntraPrediction::Chroma::vertical(px_t* pred)
+template <typename px_t>
+void IntraPrediction::Chroma<px_t>::vertical(px_t* pred)
 {
     assert(this->available[1]);
 
-    for (int y = 0; y < this->sets.sps->MbHeightC; y++) {
-        for (int x = 0; x < this->sets.sps->MbWidthC; x++)
-            predC(x, y, pred) = p(x, -1);
-    }
+    for (int y = 0; y < this->sets.sps->MbHeightC; y++)
+        memcpy(&predC(0, y, pred), &p(0, -1), this->sets.sps->MbWidthC * sizeof(px_t));
 }
 
-void IntraPrediction::Chroma::plane(px_t* pred)
+template <typename px_t>
+void IntraPrediction::Chroma<px_t>::plane(px_t* pred)
 {
     assert(this->available[3]);
 
@@ -886,23 +839,31 @@ void IntraPrediction::Chroma::plane(px_t* pred)
     int b = ((34 - 29 * (this->sets.sps->ChromaArrayType == 3 ? 1 : 0)) * H + 32) >> 6;
     int c = ((34 - 29 * (this->sets.sps->ChromaArrayType != 1 ? 1 : 0)) * V + 32) >> 6;
 
-    for (int y = 0; y < this->sets.sps->MbHeightC; y++) {
-        for (int x = 0; x < this->sets.sps->MbWidthC; x++)
-            predC(x, y, pred) = clip3(0, (1 << this->sets.sps->BitDepthC) - 1,
-                (a + b * (x - 3 - xCF) + c * (y - 3 - yCF) + 16) >> 5);
-    }
+    ::vio::h264::plane(pred, this->sets.sps->MbWidthC, this->sets.sps->MbHeightC, a, b, c,
+                       3 + xCF, 3 + yCF, (1 << this->sets.sps->BitDepthC) - 1);
 }
 
-inline px_t& IntraPrediction::Chroma::predC(int x, int y, px_t* pred)
+template <typename px_t>
+inline px_t& IntraPrediction::Chroma<px_t>::predC(int x, int y, px_t* pred)
 {
     return pred[y * 16 + x];
 }
 
-inline px_t& IntraPrediction::Chroma::p(int x, int y)
+template <typename px_t>
+inline px_t& IntraPrediction::Chroma<px_t>::p(int x, int y)
 {
-    return this->samples[(y + 1) * 17 + (x + 1)];
+    return this->edge[1 + 16 + x - y];
 }
 
+template void IntraPrediction::intra_pred_4x4   <uint8_t >(mb_t& mb, int comp, int xO, int yO);
+template void IntraPrediction::intra_pred_4x4   <uint16_t>(mb_t& mb, int comp, int xO, int yO);
+template void IntraPrediction::intra_pred_8x8   <uint8_t >(mb_t& mb, int comp, int xO, int yO);
+template void IntraPrediction::intra_pred_8x8   <uint16_t>(mb_t& mb, int comp, int xO, int yO);
+template void IntraPrediction::intra_pred_16x16 <uint8_t >(mb_t& mb, int comp);
+template void IntraPrediction::intra_pred_16x16 <uint16_t>(mb_t& mb, int comp);
+template void IntraPrediction::intra_pred_chroma<uint8_t >(mb_t& mb, int comp);
+template void IntraPrediction::intra_pred_chroma<uint16_t>(mb_t& mb, int comp);
+
 
 }
 }
@@ -21,6 +21,10 @@
  * =============================================================================
  */
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "global.h"
 #include "slice.h"
 #include "macroblock.h"
@@ -449,12 +453,112 @@ void Transform::coeff_chroma_dc(mb_t* mb, ColorPlane pl, int x0, int y0, int run
 
 void Transform::coeff_chroma_ac(mb_t* mb, ColorPlane pl, int x0, int y0, int runarr, int levarr)
 {
+    mb->cbp_blks[pl] |= ((uint64_t)0x01 << (y0 * 4 + x0));
+
     const pos_t& pos = inverse_scan_chroma_ac(mb, runarr);
     if (!mb->TransformBypassModeFlag)
         levarr = this->inverse_quantize(mb, true, pl, pos.x, pos.y, levarr);
     this->cof[pl][y0 * 4 + pos.y][x0 * 4 + pos.x] = levarr;
 }
 
+// Whole-block variants: scan and dequantisation tables are resolved once per block
+
+void Transform::coeff_luma_dc(mb_t* mb, ColorPlane pl, int x0, int y0, int numCoeff, const uint8_t* runarr, const int* levarr)
+{
+    slice_t& slice = *mb->p_Slice;
+    shr_t& shr = slice.header;
+
+    bool field = shr.field_pic_flag || mb->mb_field_decoding_flag;
+    const uint8_t (*zigzag_scan_4x4)[2] = ZIGZAG_SCAN_4x4[field];
+
+    for (int k = 0; k < numCoeff; ++k) {
+        const uint8_t* pos = zigzag_scan_4x4[runarr[k]];
+        this->cof[pl][pos[1] * 4][pos[0] * 4] = levarr[k];
+    }
+}
+
+void Transform::coeff_luma_ac(mb_t* mb, ColorPlane pl, int x0, int y0, int numCoeff, const uint8_t* runarr, const int* levarr)
+{
+    slice_t& slice = *mb->p_Slice;
+    sps_t& sps = *slice.active_sps;
+    shr_t& shr = slice.header;
+
+    bool field = shr.field_pic_flag || mb->mb_field_decoding_flag;
+    int qp_per = mb->qp_scaled[pl] / 6;
+    int qp_rem = mb->qp_scaled[pl] % 6;
+    int transform_pl = sps.separate_colour_plane_flag ? shr.colour_plane_id : pl;
+    int (*cof)[16] = &this->cof[pl][y0 * 4];
+
+    if (!mb->transform_size_8x8_flag) {
+        mb->cbp_blks[pl] |= ((uint64_t)0x01 << (y0 * 4 + x0));
+
+        const uint8_t (*zigzag_scan_4x4)[2] = ZIGZAG_SCAN_4x4[field];
+        int (*InvLevelScale4x4)[4] = mb->is_intra_block ?
+            this->InvLevelScale4x4_Intra[transform_pl][qp_rem] :
+            this->InvLevelScale4x4_Inter[transform_pl][qp_rem];
+
+        for (int k = 0; k < numCoeff; ++k) {
+            int i0 = zigzag_scan_4x4[runarr[k]][0];
+            int j0 = zigzag_scan_4x4[runarr[k]][1];
+            int level = levarr[k];
+            if (!mb->TransformBypassModeFlag)
+                level = rshift_rnd_sf((level * InvLevelScale4x4[j0][i0]) << qp_per, 4);
+            cof[j0][x0 * 4 + i0] = level;
+        }
+    } else {
+        mb->cbp_blks[pl] |= ((uint64_t)0x33 << (y0 * 4 + x0));
+
+        const uint8_t (*zigzag_scan_8x8)[2] = ZIGZAG_SCAN_8x8[field];
+        int (*InvLevelScale8x8)[8] = mb->is_intra_block ?
+            this->InvLevelScale8x8_Intra[transform_pl][qp_rem] :
+            this->InvLevelScale8x8_Inter[transform_pl][qp_rem];
+
+        for (int k = 0; k < numCoeff; ++k) {
+            int i0 = zigzag_scan_8x8[runarr[k]][0];
+            int j0 = zigzag_scan_8x8[runarr[k]][1];
+            int level = levarr[k];
+            if (!mb->TransformBypassModeFlag)
+                level = rshift_rnd_sf((level * InvLevelScale8x8[j0][i0]) << qp_per, 6);
+            cof[j0][x0 * 4 + i0] = level;
+        }
+    }
+}
+
+void Transform::coeff_chroma_dc(mb_t* mb, ColorPlane pl, int x0, int y0, int numCoeff, const uint8_t* runarr, const int* levarr)
+{
+    for (int k = 0; k < numCoeff; ++k) {
+        const pos_t& pos = inverse_scan_chroma_dc(mb, runarr[k]);
+        this->cof[pl][pos.y * 4][pos.x * 4] = levarr[k];
+    }
+}
+
+void Transform::coeff_chroma_ac(mb_t* mb, ColorPlane pl, int x0, int y0, int numCoeff, const uint8_t* runarr, const int* levarr)
+{
+    slice_t& slice = *mb->p_Slice;
+    shr_t& shr = slice.header;
+
+    bool field = shr.field_pic_flag || mb->mb_field_decoding_flag;
+    int qp_per = mb->qp_scaled[pl] / 6;
+    int qp_rem = mb->qp_scaled[pl] % 6;
+    int (*cof)[16] = &this->cof[pl][y0 * 4];
+
+    mb->cbp_blks[pl] |= ((uint64_t)0x01 << (y0 * 4 + x0));
+
+    const uint8_t (*zigzag_scan_4x4)[2] = ZIGZAG_SCAN_4x4[field];
+    int (*InvLevelScale4x4)[4] = mb->is_intra_block ?
+        this->InvLevelScale4x4_Intra[pl][qp_rem] :
+        this->InvLevelScale4x4_Inter[pl][qp_rem];
+
+    for (int k = 0; k < numCoeff; ++k) {
+        int i0 = zigzag_scan_4x4[runarr[k]][0];
+        int j0 = zigzag_scan_4x4[runarr[k]][1];
+        int level = levarr[k];
+        if (!mb->TransformBypassModeFlag)
+            level = rshift_rnd_sf((level * InvLevelScale4x4[j0][i0]) << qp_per, 4);
+        cof[j0][x0 * 4 + i0] = level;
+    }
+}
+
 
 
 void Transform::ihadamard_2x2(int c[2][2], int f[2][2])
@@ -910,167 +1014,366 @@ void Transform::transform_chroma_dc(mb_t* mb, ColorPlane pl)
 }
 
 
-void Transform::construction(mb_t* mb, ColorPlane pl, int ioff, int joff, int nW, int nH)
+#if defined(__SSE2__)
+
+// W samples, at most 8, widened to or narrowed from 16-bit lanes
+
+template <int W, typename px_t>
+static inline __m128i load(const px_t* p)
 {
-    slice_t* slice = mb->p_Slice;
-    sps_t* sps = slice->active_sps;
-    storable_picture* dec_picture = slice->dec_picture;
-    px_t** curr_img = pl ? dec_picture->imgUV[pl - 1] : dec_picture->imgY;
-    int max_pel_value_comp = (1 << (pl > 0 ? sps->BitDepthC : sps->BitDepthY)) - 1;
-    int block8x8 = (joff / 8) * 2 + (ioff / 8);
+    const int n = W * sizeof(px_t);
+    __m128i v;
+    if (n <= 4) {
+        int t = 0;
+        memcpy(&t, p, n);
+        v = _mm_cvtsi32_si128(t);
+    } else if (n == 8)
+        v = _mm_loadl_epi64((const __m128i*)p);
+    else
+        v = _mm_loadu_si128((const __m128i*)p);
+    return sizeof(px_t) == 1 ? _mm_unpacklo_epi8(v, _mm_setzero_si128()) : v;
+}
 
-    int (*mb_rres)[16] = this->mb_rres[pl];
-    px_t** mb_pred = slice->mb_pred[pl];
-    px_t (*mb_rec)[16] = this->mb_rec[pl];
+template <int W, typename px_t>
+static inline void store(px_t* p, __m128i v)
+{
+    const int n = W * sizeof(px_t);
+    if (sizeof(px_t) == 1)
+        v = _mm_packus_epi16(v, v);
+    if (n <= 4) {
+        int t = _mm_cvtsi128_si32(v);
+        memcpy(p, &t, n);
+    } else if (n == 8)
+        _mm_storel_epi64((__m128i*)p, v);
+    else
+        _mm_storeu_si128((__m128i*)p, v);
+}
 
-    if (mb->CodedBlockPatternLuma & (1 << block8x8)) {
-        for (int j = 0; j < nH; ++j) {
-            for (int i = 0; i < nW; ++i)
-                mb_rec[joff + j][ioff + i] = (px_t) clip1(max_pel_value_comp, mb_rres[joff + j][ioff + i] + mb_pred[joff + j][ioff + i]);
-        }
-    } else {
-        for (int j = 0; j < nH; ++j)
-            memcpy(&mb_rec[joff + j][ioff], &mb_pred[joff + j][ioff], nW * sizeof(px_t));
-    }
+static inline void transpose_4x4(__m128i v[4])
+{
+    __m128i t0 = _mm_unpacklo_epi32(v[0], v[1]);
+    __m128i t1 = _mm_unpacklo_epi32(v[2], v[3]);
+    __m128i t2 = _mm_unpackhi_epi32(v[0], v[1]);
+    __m128i t3 = _mm_unpackhi_epi32(v[2], v[3]);
+    v[0] = _mm_unpacklo_epi64(t0, t1);
+    v[1] = _mm_unpackhi_epi64(t0, t1);
+    v[2] = _mm_unpacklo_epi64(t2, t3);
+    v[3] = _mm_unpackhi_epi64(t2, t3);
+}
 
-    for (int j = 0; j < nH; ++j)
-        memcpy(&curr_img[mb->mb.y * 16 + joff + j][mb->mb.x * 16 + ioff], &mb_rec[joff + j][ioff], nW * sizeof (px_t));
+// One pass of the 4x4 and 8x8 inverse transforms over four lanes, the same
+// arithmetic as inverse_4x4 and inverse_8x8 so the results stay bit exact
+
+static inline void idct4(__m128i v[4])
+{
+    __m128i e0 = _mm_add_epi32(v[0], v[2]);
+    __m128i e1 = _mm_sub_epi32(v[0], v[2]);
+    __m128i e2 = _mm_sub_epi32(_mm_srai_epi32(v[1], 1), v[3]);
+    __m128i e3 = _mm_add_epi32(v[1], _mm_srai_epi32(v[3], 1));
+
+    v[0] = _mm_add_epi32(e0, e3);
+    v[1] = _mm_add_epi32(e1, e2);
+    v[2] = _mm_sub_epi32(e1, e2);
+    v[3] = _mm_sub_epi32(e0, e3);
+}
+
+static inline void idct8(__m128i v[8])
+{
+    __m128i e0 = _mm_add_epi32(v[0], v[4]);
+    __m128i e1 = _mm_sub_epi32(_mm_sub_epi32(v[5], v[3]), _mm_add_epi32(v[7], _mm_srai_epi32(v[7], 1)));
+    __m128i e2 = _mm_sub_epi32(v[0], v[4]);
+    __m128i e3 = _mm_sub_epi32(_mm_add_epi32(v[1], v[7]), _mm_add_epi32(v[3], _mm_srai_epi32(v[3], 1)));
+    __m128i e4 = _mm_sub_epi32(_mm_srai_epi32(v[2], 1), v[6]);
+    __m128i e5 = _mm_sub_epi32(_mm_add_epi32(v[7], _mm_add_epi32(v[5], _mm_srai_epi32(v[5], 1))), v[1]);
+    __m128i e6 = _mm_add_epi32(v[2], _mm_srai_epi32(v[6], 1));
+    __m128i e7 = _mm_add_epi32(_mm_add_epi32(v[3], v[5]), _mm_add_epi32(v[1], _mm_srai_epi32(v[1], 1)));
+
+    __m128i f0 = _mm_add_epi32(e0, e6);
+    __m128i f1 = _mm_add_epi32(e1, _mm_srai_epi32(e7, 2));
+    __m128i f2 = _mm_add_epi32(e2, e4);
+    __m128i f3 = _mm_add_epi32(e3, _mm_srai_epi32(e5, 2));
+    __m128i f4 = _mm_sub_epi32(e2, e4);
+    __m128i f5 = _mm_sub_epi32(_mm_srai_epi32(e3, 2), e5);
+    __m128i f6 = _mm_sub_epi32(e0, e6);
+    __m128i f7 = _mm_sub_epi32(e7, _mm_srai_epi32(e1, 2));
+
+    v[0] = _mm_add_epi32(f0, f7);
+    v[1] = _mm_add_epi32(f2, f5);
+    v[2] = _mm_add_epi32(f4, f3);
+    v[3] = _mm_add_epi32(f6, f1);
+    v[4] = _mm_sub_epi32(f6, f1);
+    v[5] = _mm_sub_epi32(f4, f3);
+    v[6] = _mm_sub_epi32(f2, f5);
+    v[7] = _mm_sub_epi32(f0, f7);
+}
+
+// Rounds W residual lanes, adds them to the prediction and stores the
+// clipped samples. Saturating to 16 bits before the add keeps the clip exact
+// as the prediction never exceeds 14 bits.
+
+template <int W, typename px_t>
+static inline void add_pred(px_t* img, const px_t* pred, __m128i lo, __m128i hi, __m128i maxval)
+{
+    const __m128i rnd = _mm_set1_epi32(1 << 5);
+    lo = _mm_srai_epi32(_mm_add_epi32(lo, rnd), 6);
+    hi = _mm_srai_epi32(_mm_add_epi32(hi, rnd), 6);
+    __m128i v = _mm_adds_epi16(_mm_packs_epi32(lo, hi), load<W>(pred));
+    store<W>(img, _mm_min_epi16(_mm_max_epi16(v, _mm_setzero_si128()), maxval));
 }
 
-void Transform::construction_16x16(mb_t* mb, ColorPlane pl, int ioff, int joff)
+#endif
+
+// Picture rows of the current macroblock in plane pl, x0 is its left column
+
+template <typename px_t>
+static inline px_t** mb_rows(mb_t* mb, ColorPlane pl, int& x0)
 {
     slice_t* slice = mb->p_Slice;
     sps_t* sps = slice->active_sps;
     storable_picture* dec_picture = slice->dec_picture;
-    px_t** curr_img = pl ? dec_picture->imgUV[pl - 1] : dec_picture->imgY;
-    int max_pel_value_comp = (1 << (pl > 0 ? sps->BitDepthC : sps->BitDepthY)) - 1;
+    px_t** curr_img = dec_picture->img<px_t>(pl);
 
-    int (*mb_rres)[16] = this->mb_rres[pl];
-    px_t **mb_pred = slice->mb_pred[pl];
-    px_t (*mb_rec)[16] = this->mb_rec [pl];
+    x0 = mb->mb.x * (pl ? sps->MbWidthC : 16);
+    return &curr_img[mb->mb.y * (pl ? sps->MbHeightC : 16)];
+}
 
-    for (int j = 0; j < 16; j++) {
-        for (int i = 0; i < 16; i++)
-            mb_rec[j][i] = (px_t) clip1(max_pel_value_comp, mb_rres[j][i] + mb_pred[j][i]);
-    }
+static inline int max_pel_value(mb_t* mb, ColorPlane pl)
+{
+    sps_t* sps = mb->p_Slice->active_sps;
+    return (1 << (pl > 0 ? sps->BitDepthC : sps->BitDepthY)) - 1;
+}
 
-    for (int j = 0; j < 16; ++j)
-        memcpy(&curr_img[mb->mb.y * 16 + joff + j][mb->mb.x * 16 + ioff], &mb_rec[joff + j][ioff], 16 * sizeof (px_t));
+// Reconstruction writes straight into the picture: the inverse transform is
+// added to the prediction and clipped in one pass, blocks without residual
+// copy their prediction and DC only blocks skip the transform altogether.
+
+template <typename px_t>
+void Transform::inverse_4x4_add(mb_t* mb, ColorPlane pl, int ioff, int joff)
+{
+    int x0;
+    px_t** img = mb_rows<px_t>(mb, pl, x0) + joff;
+    px_t (*mb_pred)[16] = mb->p_Slice->mb_pred<px_t>(pl) + joff;
+    int max_pel_value_comp = max_pel_value(mb, pl);
+
+#if defined(__SSE2__)
+    int (*cof)[16] = &this->cof[pl][joff];
+    __m128i v[4];
+    for (int i = 0; i < 4; ++i)
+        v[i] = _mm_loadu_si128((const __m128i*)&cof[i][ioff]);
+
+    transpose_4x4(v);
+    idct4(v);
+    transpose_4x4(v);
+    idct4(v);
+
+    __m128i maxval = _mm_set1_epi16(max_pel_value_comp);
+    for (int j = 0; j < 4; ++j)
+        add_pred<4>(&img[j][x0 + ioff], &mb_pred[j][ioff], v[j], v[j], maxval);
+#else
+    int (*mb_rres)[16] = &this->mb_rres[pl][joff];
+    this->inverse_4x4(this->cof[pl], this->mb_rres[pl], joff, ioff);
+
+    for (int j = 0; j < 4; ++j) {
+        for (int i = 0; i < 4; ++i)
+            img[j][x0 + ioff + i] = (px_t) clip1(max_pel_value_comp, mb_rres[j][ioff + i] + mb_pred[j][ioff + i]);
+    }
+#endif
 }
 
-void Transform::construction_chroma(mb_t* mb, ColorPlane pl, int ioff, int joff)
+template <typename px_t>
+void Transform::inverse_8x8_add(mb_t* mb, ColorPlane pl, int ioff, int joff)
 {
-    slice_t* slice = mb->p_Slice;
-    sps_t* sps = slice->active_sps;
-    storable_picture* dec_picture = slice->dec_picture;
-    px_t** curr_img = pl ? dec_picture->imgUV[pl - 1] : dec_picture->imgY;
-    int max_pel_value_comp = (1 << (pl > 0 ? sps->BitDepthC : sps->BitDepthY)) - 1;
+    int x0;
+    px_t** img = mb_rows<px_t>(mb, pl, x0) + joff;
+    px_t (*mb_pred)[16] = mb->p_Slice->mb_pred<px_t>(pl) + joff;
+    int max_pel_value_comp = max_pel_value(mb, pl);
+
+#if defined(__SSE2__)
+    int (*cof)[16] = &this->cof[pl][joff];
+    // four 4x4 quadrants, columns 0-3 and 4-7 of rows 0-3 then of rows 4-7
+    __m128i v[16];
+    for (int i = 0; i < 4; ++i) {
+        v[i     ] = _mm_loadu_si128((const __m128i*)&cof[i    ][ioff    ]);
+        v[i +  4] = _mm_loadu_si128((const __m128i*)&cof[i    ][ioff + 4]);
+        v[i +  8] = _mm_loadu_si128((const __m128i*)&cof[i + 4][ioff    ]);
+        v[i + 12] = _mm_loadu_si128((const __m128i*)&cof[i + 4][ioff + 4]);
+    }
 
-    int (*mb_rres)[16] = this->mb_rres[pl];
-    px_t **mb_pred = slice->mb_pred[pl];
-    px_t (*mb_rec)[16] = this->mb_rec [pl];
+    for (int i = 0; i < 16; i += 4)
+        transpose_4x4(v + i);
+    idct8(v);
+    idct8(v + 8);
+    for (int i = 0; i < 16; i += 4)
+        transpose_4x4(v + i);
+
+    __m128i lo[8] = { v[0], v[1], v[2], v[3], v[ 8], v[ 9], v[10], v[11] };
+    __m128i hi[8] = { v[4], v[5], v[6], v[7], v[12], v[13], v[14], v[15] };
+    idct8(lo);
+    idct8(hi);
+
+    __m128i maxval = _mm_set1_epi16(max_pel_value_comp);
+    for (int j = 0; j < 8; ++j)
+        add_pred<8>(&img[j][x0 + ioff], &mb_pred[j][ioff], lo[j], hi[j], maxval);
+#else
+    int (*mb_rres)[16] = &this->mb_rres[pl][joff];
+    this->inverse_8x8(this->cof[pl], this->mb_rres[pl], joff, ioff);
 
-    for (int j = 0; j < sps->MbHeightC; j++) {
-        for (int i = 0; i < sps->MbWidthC; i++)
-            mb_rec[j][i] = (px_t) clip1(max_pel_value_comp, mb_rres[j][i] + mb_pred[j][i]);
+    for (int j = 0; j < 8; ++j) {
+        for (int i = 0; i < 8; ++i)
+            img[j][x0 + ioff + i] = (px_t) clip1(max_pel_value_comp, mb_rres[j][ioff + i] + mb_pred[j][ioff + i]);
     }
+#endif
+}
 
-    for (int joff = 0; joff < sps->MbHeightC; joff += 4) {
-        for (int ioff = 0; ioff < sps->MbWidthC; ioff += 4)
-            for (int j = 0; j < 4; ++j)
-                memcpy(&curr_img[mb->mb.y * sps->MbHeightC + joff + j][mb->mb.x * sps->MbWidthC + ioff],
-                       &mb_rec[joff + j][ioff], 4 * sizeof (px_t));
+template <typename px_t>
+void Transform::inverse_dc_add(mb_t* mb, ColorPlane pl, int ioff, int joff)
+{
+    int dc = this->cof[pl][joff][ioff];
+    if (dc == 0) {
+        this->copy_prediction<px_t>(mb, pl, ioff, joff, 4, 4);
+        return;
+    }
+
+    int x0;
+    px_t** img = mb_rows<px_t>(mb, pl, x0) + joff;
+    px_t (*mb_pred)[16] = mb->p_Slice->mb_pred<px_t>(pl) + joff;
+    int max_pel_value_comp = max_pel_value(mb, pl);
+
+#if defined(__SSE2__)
+    __m128i r = _mm_set1_epi32(dc);
+    __m128i maxval = _mm_set1_epi16(max_pel_value_comp);
+    for (int j = 0; j < 4; ++j)
+        add_pred<4>(&img[j][x0 + ioff], &mb_pred[j][ioff], r, r, maxval);
+#else
+    int r = (dc + (1 << 5)) >> 6;
+    for (int j = 0; j < 4; ++j) {
+        for (int i = 0; i < 4; ++i)
+            img[j][x0 + ioff + i] = (px_t) clip1(max_pel_value_comp, r + mb_pred[j][ioff + i]);
     }
+#endif
 }
 
-void Transform::inverse_transform_4x4(mb_t* mb, ColorPlane pl, int ioff, int joff)
+template <typename px_t>
+void Transform::copy_prediction(mb_t* mb, ColorPlane pl, int ioff, int joff, int nW, int nH)
+{
+    int x0;
+    px_t** img = mb_rows<px_t>(mb, pl, x0) + joff;
+    px_t (*mb_pred)[16] = mb->p_Slice->mb_pred<px_t>(pl) + joff;
+
+    for (int j = 0; j < nH; ++j)
+        memcpy(&img[j][x0 + ioff], &mb_pred[j][ioff], nW * sizeof(px_t));
+}
+
+// Lossless and SP macroblocks leave their residual in mb_rres
+
+template <typename px_t>
+void Transform::construction(mb_t* mb, ColorPlane pl, int ioff, int joff, int nW, int nH)
 {
-    int block8x8 = (joff / 8) * 2 + (ioff / 8);
+    int x0;
+    px_t** img = mb_rows<px_t>(mb, pl, x0) + joff;
+    px_t (*mb_pred)[16] = mb->p_Slice->mb_pred<px_t>(pl) + joff;
+    int (*mb_rres)[16] = &this->mb_rres[pl][joff];
+    int max_pel_value_comp = max_pel_value(mb, pl);
+
+    for (int j = 0; j < nH; ++j) {
+        for (int i = 0; i < nW; ++i)
+            img[j][x0 + ioff + i] = (px_t) clip1(max_pel_value_comp, mb_rres[j][ioff + i] + mb_pred[j][ioff + i]);
+    }
+}
 
-    if (mb->CodedBlockPatternLuma & (1 << block8x8)) {
+template <typename px_t>
+void Transform::inverse_transform_4x4(mb_t* mb, ColorPlane pl, int ioff, int joff)
+{
+    if (!(mb->cbp_blks[pl] & ((uint64_t)0x01 << ((joff / 4) * 4 + ioff / 4))))
+        this->copy_prediction<px_t>(mb, pl, ioff, joff, 4, 4);
+    else if (mb->TransformBypassModeFlag) {
         int i4x4 = ((joff / 4) / 2) * 8 + ((joff / 4) % 2) * 2 +
                    ((ioff / 4) / 2) * 4 + ((ioff / 4) % 2);
         uint8_t pred_mode = mb->Intra4x4PredMode[i4x4];
-        if (mb->TransformBypassModeFlag)
-            this->bypass_4x4(this->cof[pl], this->mb_rres[pl], ioff, joff, pred_mode);
-        else
-            this->inverse_4x4(this->cof[pl], this->mb_rres[pl], joff, ioff);
-    }
-
-    this->construction(mb, pl, ioff, joff, 4, 4);
+        this->bypass_4x4(this->cof[pl], this->mb_rres[pl], ioff, joff, pred_mode);
+        this->construction<px_t>(mb, pl, ioff, joff, 4, 4);
+    } else
+        this->inverse_4x4_add<px_t>(mb, pl, ioff, joff);
 }
 
+template <typename px_t>
 void Transform::inverse_transform_8x8(mb_t* mb, ColorPlane pl, int ioff, int joff)
 {
-    int block8x8 = (joff / 8) * 2 + (ioff / 8);
-
-    if (mb->CodedBlockPatternLuma & (1 << block8x8)) {
+    if (!(mb->cbp_blks[pl] & ((uint64_t)0x33 << ((joff / 4) * 4 + ioff / 4))))
+        this->copy_prediction<px_t>(mb, pl, ioff, joff, 8, 8);
+    else if (mb->TransformBypassModeFlag) {
+        int block8x8 = (joff / 8) * 2 + (ioff / 8);
         uint8_t pred_mode = mb->Intra8x8PredMode[block8x8];
-        if (mb->TransformBypassModeFlag)
-            this->bypass_8x8(this->cof[pl], this->mb_rres[pl], ioff, joff, pred_mode);
-        else
-            this->inverse_8x8(this->cof[pl], this->mb_rres[pl], joff, ioff);
-    }
-
-    this->construction(mb, pl, ioff, joff, 8, 8);
+        this->bypass_8x8(this->cof[pl], this->mb_rres[pl], ioff, joff, pred_mode);
+        this->construction<px_t>(mb, pl, ioff, joff, 8, 8);
+    } else
+        this->inverse_8x8_add<px_t>(mb, pl, ioff, joff);
 }
 
+template <typename px_t>
 void Transform::inverse_transform_16x16(mb_t* mb, ColorPlane pl, int ioff, int joff)
 {
     uint8_t pred_mode = mb->Intra16x16PredMode;
-    if (mb->TransformBypassModeFlag)
+    if (mb->TransformBypassModeFlag) {
         this->bypass_16x16(this->cof[pl], this->mb_rres[pl], ioff, joff, pred_mode);
-    else {
-        for (int j = 0; j < 16; j += 4) {
-            for (int i = 0; i < 16; i += 4)
-                this->inverse_4x4(this->cof[pl], this->mb_rres[pl], j, i);
-        }
+        this->construction<px_t>(mb, pl, ioff, joff, 16, 16);
+        return;
     }
 
-    this->construction_16x16(mb, pl, ioff, joff);
+    // the DC levels come from the Hadamard stage and are not in cbp_blks
+    for (int j = 0; j < 16; j += 4) {
+        for (int i = 0; i < 16; i += 4) {
+            if (mb->cbp_blks[pl] & ((uint64_t)0x01 << (j + i / 4)))
+                this->inverse_4x4_add<px_t>(mb, pl, ioff + i, joff + j);
+            else
+                this->inverse_dc_add<px_t>(mb, pl, ioff + i, joff + j);
+        }
+    }
 }
 
+template <typename px_t>
 void Transform::inverse_transform_chroma(mb_t* mb, ColorPlane pl)
 {
     slice_t* slice = mb->p_Slice;
     sps_t* sps = slice->active_sps;
 
     uint8_t pred_mode = mb->intra_chroma_pred_mode;
-    if (mb->TransformBypassModeFlag)
+    if (mb->TransformBypassModeFlag) {
         this->bypass_chroma(this->cof[pl], this->mb_rres[pl], sps->MbWidthC, sps->MbHeightC, pred_mode);
-    else {
-        for (int joff = 0; joff < sps->MbHeightC; joff += 4) {
-            for (int ioff = 0; ioff < sps->MbWidthC; ioff += 4)
-                this->inverse_4x4(this->cof[pl], this->mb_rres[pl], joff, ioff);
-        }
+        this->construction<px_t>(mb, pl, 0, 0, sps->MbWidthC, sps->MbHeightC);
+        return;
     }
 
-    this->construction_chroma(mb, pl, 0, 0);
+    for (int joff = 0; joff < sps->MbHeightC; joff += 4) {
+        for (int ioff = 0; ioff < sps->MbWidthC; ioff += 4) {
+            if (mb->cbp_blks[pl] & ((uint64_t)0x01 << (joff + ioff / 4)))
+                this->inverse_4x4_add<px_t>(mb, pl, ioff, joff);
+            else
+                this->inverse_dc_add<px_t>(mb, pl, ioff, joff);
+        }
+    }
 }
 
+template <typename px_t>
 void Transform::inverse_transform_inter(mb_t* mb, ColorPlane pl)
 {
     slice_t* slice = mb->p_Slice;
     sps_t* sps = slice->active_sps;
-    storable_picture* dec_picture = slice->dec_picture;
-    px_t** curr_img = pl ? dec_picture->imgUV[pl - 1] : dec_picture->imgY;
 
     if (mb->CodedBlockPatternLuma) {
         if (!mb->transform_size_8x8_flag) {
             for (int y = 0; y < 16; y += 4) {
                 for (int x = 0; x < 16; x += 4)
-                    this->inverse_transform_4x4(mb, pl, x, y);
+                    this->inverse_transform_4x4<px_t>(mb, pl, x, y);
             }
         } else {
             for (int y = 0; y < 16; y += 8) {
                 for (int x = 0; x < 16; x += 8)
-                    this->inverse_transform_8x8(mb, pl, x, y);
+                    this->inverse_transform_8x8<px_t>(mb, pl, x, y);
             }
         }
-    } else {
-        for (int j = 0; j < 16; ++j)
-            memcpy(&curr_img[mb->mb.y * 16 + j][mb->mb.x * 16], &slice->mb_pred[pl][j][0], 16 * sizeof (px_t));
-    }
+    } else
+        this->copy_prediction<px_t>(mb, pl, 0, 0, 16, 16);
 
     if (mb->CodedBlockPatternLuma)
         slice->parser.is_reset_coeff = false;
@@ -1079,15 +1382,10 @@ void Transform::inverse_transform_inter(mb_t* mb, ColorPlane pl)
         return;
 
     for (int uv = 0; uv < 2; ++uv) {
-        px_t **curUV = &dec_picture->imgUV[uv][mb->mb.y * sps->MbHeightC]; 
-        px_t **mb_pred = slice->mb_pred[uv + 1];
-
         if (mb->CodedBlockPatternChroma)
-            this->inverse_transform_chroma(mb, (ColorPlane)(uv + 1));
-        else {
-            for (int j = 0; j < sps->MbHeightC; ++j)
-                memcpy(&curUV[j][mb->mb.x * sps->MbWidthC], &mb_pred[j][0], sps->MbWidthC * sizeof (px_t));
-        }
+            this->inverse_transform_chroma<px_t>(mb, (ColorPlane)(uv + 1));
+        else
+            this->copy_prediction<px_t>(mb, (ColorPlane)(uv + 1), 0, 0, sps->MbWidthC, sps->MbHeightC);
     }
 
     if (mb->CodedBlockPatternChroma)
@@ -1129,19 +1427,16 @@ static const uint16_t LevelScale2[6][4][4] = {
      {  4559,  2893,  4559,  2893 }}
 };
 
+template <typename px_t>
 void Transform::itrans_sp(mb_t* mb, ColorPlane pl, int ioff, int joff)
 {
     slice_t& slice = *mb->p_Slice;
-    sps_t& sps = *slice.active_sps;
     shr_t& shr = slice.header;
 
     int QpY = (shr.slice_type == SI_slice) ? shr.QsY : slice.parser.QpY;
     int QsY = shr.QsY;
 
     int    (*cof    )[16] = this->cof    [pl];
-    int    (*mb_rres)[16] = this->mb_rres[pl];
-    px_t (*mb_rec )[16] = this->mb_rec [pl];
-    int max_pel_value_comp = (1 << (pl > 0 ? sps.BitDepthC : sps.BitDepthY)) - 1;
 
     const int (*InvLevelScale4x4)  [4] = dequant_coef[QpY % 6];
     const int (*InvLevelScale4x4SP)[4] = dequant_coef[QsY % 6];  
@@ -1150,7 +1445,7 @@ void Transform::itrans_sp(mb_t* mb, ColorPlane pl, int ioff, int joff)
     int c[16][16];
     for (int i = 0; i < 4; ++i) {
         for (int j = 0; j < 4; ++j)
-            p[joff + i][ioff + j] = slice.mb_pred[pl][joff + i][ioff + j];
+            p[joff + i][ioff + j] = slice.mb_pred<px_t>(pl)[joff + i][ioff + j];
     }
 
     this->forward_4x4(p, c, joff, ioff);
@@ -1178,21 +1473,27 @@ void Transform::itrans_sp(mb_t* mb, ColorPlane pl, int ioff, int joff)
         }
     }
 
+    int (*mb_rres)[16] = this->mb_rres[pl];
     this->inverse_4x4(cof, mb_rres, joff, ioff);
 
+    // the prediction is already part of the requantised levels
+    int x0;
+    px_t** img = mb_rows<px_t>(mb, pl, x0);
+    int max_pel_value_comp = max_pel_value(mb, pl);
     for (int j = 0; j < 4; ++j) {
         for (int i = 0; i < 4; ++i)
-            mb_rec[joff + j][ioff + i] = (px_t)clip1(max_pel_value_comp, mb_rres[joff + j][ioff + i]);
+            img[joff + j][x0 + ioff + i] = (px_t)clip1(max_pel_value_comp, mb_rres[joff + j][ioff + i]);
     }
 }
 
 
+template <typename px_t>
 void Transform::itrans_sp_cr(mb_t* mb, ColorPlane pl)
 {
     slice_t& slice = *mb->p_Slice;
     sps_t& sps = *slice.active_sps;
     shr_t& shr = slice.header;
-    px_t** mb_pred = slice.mb_pred[pl];
+    px_t (*mb_pred)[16] = slice.mb_pred<px_t>(pl);
     int (*cof)[16] = this->cof[pl];
 
     int QpC = mb->QpC[pl - 1];
@@ -1262,43 +1563,56 @@ void Transform::itrans_sp_cr(mb_t* mb, ColorPlane pl)
     cof[0][4] = (mp1[0][0] + mp1[0][1] - mp1[1][0] - mp1[1][1]) >> 1;
     cof[4][0] = (mp1[0][0] - mp1[0][1] + mp1[1][0] - mp1[1][1]) >> 1;
     cof[4][4] = (mp1[0][0] - mp1[0][1] - mp1[1][0] + mp1[1][1]) >> 1;
+
+    // every block now carries requantised levels
+    mb->cbp_blks[pl] = 0xFFFF;
 }
 
+template <typename px_t>
 void Transform::inverse_transform_sp(mb_t* mb, ColorPlane pl)
 {
     slice_t* slice = mb->p_Slice;
     sps_t* sps = slice->active_sps;
-    storable_picture* dec_picture = slice->dec_picture;
-    px_t** curr_img = pl ? dec_picture->imgUV[pl - 1] : dec_picture->imgY;
 
     if (!mb->transform_size_8x8_flag) {
         for (int y = 0; y < 16; y += 4) {
             for (int x = 0; x < 16; x += 4)
-                this->itrans_sp(mb, pl, x, y);
+                this->itrans_sp<px_t>(mb, pl, x, y);
         }
     } else {
         for (int y = 0; y < 16; y += 8) {
             for (int x = 0; x < 16; x += 8)
-                this->inverse_transform_8x8(mb, pl, x, y);
+                this->inverse_transform_8x8<px_t>(mb, pl, x, y);
         }
     }
 
-    for (int j = 0; j < 16; ++j)
-        memcpy(&curr_img[mb->mb.y * 16 + j][mb->mb.x * 16], &this->mb_rec[pl][j][0], 16 * sizeof (px_t));
-
     slice->parser.is_reset_coeff = false;
 
     if (sps->chroma_format_idc == CHROMA_FORMAT_400 || sps->chroma_format_idc == CHROMA_FORMAT_444)
         return;
 
     for (int uv = 0; uv < 2; ++uv) {
-        this->itrans_sp_cr(mb, (ColorPlane)(uv + 1));
-        this->inverse_transform_chroma(mb, (ColorPlane)(uv + 1));
+        this->itrans_sp_cr<px_t>(mb, (ColorPlane)(uv + 1));
+        this->inverse_transform_chroma<px_t>(mb, (ColorPlane)(uv + 1));
     }
 
     slice->parser.is_reset_coeff_cr = false;
 }
 
 
+template void Transform::inverse_transform_4x4   <uint8_t >(mb_t* mb, ColorPlane pl, int ioff, int joff);
+template void Transform::inverse_transform_4x4   <uint16_t>(mb_t* mb, ColorPlane pl, int ioff, int joff);
+template void Transform::inverse_transform_8x8   <uint8_t >(mb_t* mb, ColorPlane pl, int ioff, int joff);
+template void Transform::inverse_transform_8x8   <uint16_t>(mb_t* mb, ColorPlane pl, int ioff, int joff);
+template void Transform::inverse_transform_16x16 <uint8_t >(mb_t* mb, ColorPlane pl, int ioff, int joff);
+template void Transform::inverse_transform_16x16 <uint16_t>(mb_t* mb, ColorPlane pl, int ioff, int joff);
+template void Transform::inverse_transform_chroma<uint8_t >(mb_t* mb, ColorPlane pl);
+template void Transform::inverse_transform_chroma<uint16_t>(mb_t* mb, ColorPlane pl);
+template void Transform::inverse_transform_inter <uint8_t >(mb_t* mb, ColorPlane pl);
+template void Transform::inverse_transform_inter <uint16_t>(mb_t* mb, ColorPlane pl);
+template void Transform::inverse_transform_sp    <uint8_t >(mb_t* mb, ColorPlane pl);
+template void Transform::inverse_transform_sp    <uint16_t>(mb_t* mb, ColorPlane pl);
+
+
 }
 }
@@ -7,6 +7,7 @@
 #include "dpb.h"
 #include "memalloc.h"
 #include "output.h"
+#include "pipeline.h"
 
 using vio::h264::mb_t;
 
@@ -157,16 +158,18 @@ void decoded_picture_buffer_t::init(VideoParameters* p_Vid, int type)
     this->ltref_frames_in_buffer = 0;
 
     this->fs       = new pic_t*[this->size];
-    this->fs_ref   = new pic_t*[this->size];
-    this->fs_ltref = new pic_t*[this->size];
+    this->fs_ref     = new pic_t*[this->size];
+    this->fs_ref_poc = new pic_t*[this->size];
+    this->fs_ltref   = new pic_t*[this->size];
 #if (MVC_EXTENSION_ENABLE)
     this->fs_ilref = new pic_t*[1];
 #endif
 
     for (int i = 0; i < this->size; i++) {
         this->fs[i]       = new pic_t {};
-        this->fs_ref[i]   = nullptr;
-        this->fs_ltref[i] = nullptr;
+        this->fs_ref[i]     = nullptr;
+        this->fs_ref_poc[i] = nullptr;
+        this->fs_ltref[i]   = nullptr;
         this->fs[i]->layer_id = -1;
 #if (MVC_EXTENSION_ENABLE)
         this->fs[i]->view_id = -1;
@@ -221,6 +224,8 @@ void decoded_picture_buffer_t::free()
 
     if (this->fs_ref)
         delete []this->fs_ref;
+    if (this->fs_ref_poc)
+        delete []this->fs_ref_poc;
     if (this->fs_ltref)
         delete []this->fs_ltref;
 
@@ -245,12 +250,17 @@ void decoded_picture_buffer_t::free()
         delete p_Vid->no_reference_picture;
         p_Vid->no_reference_picture = nullptr;
     }
+
+    // buffers kept for the old sequence are unlikely to fit the next one
+    p_Vid->pic_pool->clear();
 }
 
 void decoded_picture_buffer_t::idr_memory_management(storable_picture* p)
 {
     if (p->slice_headers[0]->header.no_output_of_prior_pics_flag) {
         // free all stored pictures
+        if (this->p_Vid->pipeline)
+            this->p_Vid->pipeline->drain();
         for (int i = 0; i < this->used_size; i++) {
             // reset all reference settings
             delete this->fs[i];
@@ -317,19 +327,19 @@ void decoded_picture_buffer_t::remove_frame(int pos)
 
     switch (fs->is_used) {
     case 3:
-        delete fs->frame;
-        delete fs->top_field;
-        delete fs->bottom_field;
+        release_picture(this->p_Vid, fs->frame);
+        release_picture(this->p_Vid, fs->top_field);
+        release_picture(this->p_Vid, fs->bottom_field);
         fs->frame        = nullptr;
         fs->top_field    = nullptr;
         fs->bottom_field = nullptr;
         break;
     case 2:
-        delete fs->bottom_field;
+        release_picture(this->p_Vid, fs->bottom_field);
         fs->bottom_field = nullptr;
         break;
     case 1:
-        delete fs->top_field;
+        release_picture(this->p_Vid, fs->top_field);
         fs->top_field = nullptr;
         break;
     case 0:
@@ -479,32 +489,54 @@ void decoded_picture_buffer_t::init_picture_number(slice_t& slice)
 }
 
 
+// The reference indices are kept sorted in the orders reference lists are
+// initialised in (8.2.4.2), so slices only copy them out. They are rebuilt
+// whenever marking changes and at the start of every picture, and hold at
+// most max_num_ref_frames entries, which insertion sorts in place.
+
 void decoded_picture_buffer_t::update_ref_list()
 {
-    int i, j;
-    for (i = 0, j = 0; i < this->used_size; i++) {
-        if (this->fs[i]->is_short_term_reference())
-            this->fs_ref[j++] = this->fs[i];
+    int j = 0;
+    for (int i = 0; i < this->used_size; i++) {
+        pic_t* fs = this->fs[i];
+        if (!fs->is_short_term_reference())
+            continue;
+
+        int k;
+        for (k = j; k > 0 && this->fs_ref[k - 1]->FrameNum < fs->FrameNum; k--)
+            this->fs_ref[k] = this->fs_ref[k - 1];
+        this->fs_ref[k] = fs;
+        for (k = j; k > 0 && this->fs_ref_poc[k - 1]->poc > fs->poc; k--)
+            this->fs_ref_poc[k] = this->fs_ref_poc[k - 1];
+        this->fs_ref_poc[k] = fs;
+        j++;
     }
 
     this->ref_frames_in_buffer = j;
 
-    while (j < this->size)
-        this->fs_ref[j++] = nullptr;
+    for (; j < this->size; j++)
+        this->fs_ref[j] = this->fs_ref_poc[j] = nullptr;
 }
 
 void decoded_picture_buffer_t::update_ltref_list()
 {
-    int i, j;
-    for (i = 0, j = 0; i < this->used_size; i++) {
-        if (this->fs[i]->is_long_term_reference())
-            this->fs_ltref[j++] = this->fs[i];
+    int j = 0;
+    for (int i = 0; i < this->used_size; i++) {
+        pic_t* fs = this->fs[i];
+        if (!fs->is_long_term_reference())
+            continue;
+
+        int k;
+        for (k = j; k > 0 && this->fs_ltref[k - 1]->LongTermFrameIdx > fs->LongTermFrameIdx; k--)
+            this->fs_ltref[k] = this->fs_ltref[k - 1];
+        this->fs_ltref[k] = fs;
+        j++;
     }
 
     this->ltref_frames_in_buffer = j;
 
-    while (j < this->size)
-        this->fs_ltref[j++] = nullptr;
+    for (; j < this->size; j++)
+        this->fs_ltref[j] = nullptr;
 }
 
 void decoded_picture_buffer_t::check_num_ref()
@@ -1053,3 +1085,14 @@ storable_picture* get_ref_pic(mb_t& mb, storable_picture** RefPicListX, int ref_
             mb.mbAddrX % 2 == ref_idx % 2 ? 
             RefPicListX[ref_idx / 2]->top_field : RefPicListX[ref_idx / 2]->bottom_field;
 }
+
+int get_ref_pic_id(mb_t& mb, int list, int ref_idx)
+{
+    slice_t& slice = *mb.p_Slice;
+    shr_t& shr = slice.header;
+
+    return (ref_idx < 0) ? 0 :
+            !shr.MbaffFrameFlag || !mb.mb_field_decoding_flag ? slice.RefPicId[list][0][ref_idx] :
+            mb.mbAddrX % 2 == ref_idx % 2 ?
+            slice.RefPicId[list][1][ref_idx / 2] : slice.RefPicId[list][2][ref_idx / 2];
+}
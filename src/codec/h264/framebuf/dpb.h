@@ -27,8 +27,9 @@ struct decoded_picture_buffer_t {
     VideoParameters* p_Vid;
     InputParameters* p_Inp;
     pic_t**     fs;
-    pic_t**     fs_ref;
-    pic_t**     fs_ltref;
+    pic_t**     fs_ref;     //!< short-term references by descending FrameNum
+    pic_t**     fs_ref_poc; //!< short-term references by ascending POC
+    pic_t**     fs_ltref;   //!< long-term references by ascending LongTermFrameIdx
     pic_t**     fs_ilref; // inter-layer reference (for multi-layered codecs)
     unsigned    size;
     unsigned    used_size;
@@ -105,10 +106,10 @@ using dpb_t = decoded_picture_buffer_t;
 
 
 extern void fill_frame_num_gap(VideoParameters *p_Vid, slice_t *pSlice);
-extern void pad_buf(px_t *pImgBuf, int iWidth, int iHeight, int iStride, int iPadX, int iPadY);
 
 
 storable_picture* get_ref_pic(mb_t& mb, storable_picture** RefPicListX, int ref_idx);
+int get_ref_pic_id(mb_t& mb, int list, int ref_idx);
 
 
 #endif // _DPB_H_
@@ -76,6 +76,7 @@ static const uint8_t subblk_offset_y[3][8][4] = {
 };
 
 
+template <typename px_t>
 static void buildPredblockRegionYUV(VideoParameters* p_Vid, int* mv,
                                     int x, int y, px_t* predMB, int list, int current_mb_nr)
 {
@@ -96,6 +97,7 @@ static void buildPredblockRegionYUV(VideoParameters* p_Vid, int* mv,
     mb.mb.y = (short)(y / 4);
 
     int mv_mul = 4;
+    px_t (*mb_pred[3])[16] = {slice.mb_pred<px_t>(0), slice.mb_pred<px_t>(1), slice.mb_pred<px_t>(2)};
 
     // luma *******************************************************
     px_t tmp_block[16][16];
@@ -105,13 +107,13 @@ static void buildPredblockRegionYUV(VideoParameters* p_Vid, int* mv,
 
     for (int jj = 0; jj < 16/4; ++jj) {
         for (int ii = 0; ii < 4; ++ii)
-            slice.mb_pred[PLANE_Y][jj][ii] = tmp_block[jj][ii];
+            mb_pred[PLANE_Y][jj][ii] = tmp_block[jj][ii];
     }
 
     px_t* pMB = predMB;
     for (int j = 0; j < 4; ++j) {
         for (int i = 0; i < 4; ++i)
-            pMB[j * 4 + i] = slice.mb_pred[PLANE_Y][j][i];
+            pMB[j * 4 + i] = mb_pred[PLANE_Y][j][i];
     }
     pMB += 16;
 
@@ -127,6 +129,7 @@ static void buildPredblockRegionYUV(VideoParameters* p_Vid, int* mv,
         int f4 = f3 >> 1;
 
         for (int uv = 0; uv < 2; ++uv) {
+            px_t** imgUV = ref_pic->img<px_t>(1 + uv);
             int joff = subblk_offset_y[yuv][0][0];
             int j4   = mb.mb.y * sps.MbHeightC / 4 + joff;
             int ioff = subblk_offset_x[yuv][0][0];
@@ -147,17 +150,17 @@ static void buildPredblockRegionYUV(VideoParameters* p_Vid, int* mv,
                     int if0 = (f1_x - if1);
                     int jf0 = (f1_y - jf1);
 
-                    slice.mb_pred[uv + 1][jj][ii] = (px_t)
-                        ((if0 * jf0 * ref_pic->imgUV[uv][jj0][ii0] +
-                          if1 * jf0 * ref_pic->imgUV[uv][jj0][ii1] +
-                          if0 * jf1 * ref_pic->imgUV[uv][jj1][ii0] +
-                          if1 * jf1 * ref_pic->imgUV[uv][jj1][ii1] + f4) / f3);
+                    mb_pred[uv + 1][jj][ii] = (px_t)
+                        ((if0 * jf0 * imgUV[jj0][ii0] +
+                          if1 * jf0 * imgUV[jj0][ii1] +
+                          if0 * jf1 * imgUV[jj1][ii0] +
+                          if1 * jf1 * imgUV[jj1][ii1] + f4) / f3);
                 }
             }
 
             for (int j = 0; j < 2; ++j) {
                 for (int i = 0; i < 2; ++i)
-                    pMB[j * 2 + i] = slice.mb_pred[uv + 1][j][i];
+                    pMB[j * 2 + i] = mb_pred[uv + 1][j][i];
             }
             pMB += 4;
         }
@@ -165,22 +168,28 @@ static void buildPredblockRegionYUV(VideoParameters* p_Vid, int* mv,
 }
 
 
-static void CopyImgData(px_t** inputY, px_t*** inputUV, px_t** outputY, px_t*** outputUV, 
+template <typename px_t>
+static void CopyImgData(storable_picture* input, storable_picture* output,
                         int img_width, int img_height, int img_width_cr, int img_height_cr)
 {
+    px_t** inputY  = input ->img<px_t>(0);
+    px_t** outputY = output->img<px_t>(0);
     for (int y = 0; y < img_height; ++y) {
         for (int x = 0; x < img_width; ++x)
             outputY[y][x] = inputY[y][x];
     }
 
-    for (int y = 0; y < img_height_cr; ++y) {
-        for (int x = 0; x < img_width_cr; ++x) {
-            outputUV[0][y][x] = inputUV[0][y][x];
-            outputUV[1][y][x] = inputUV[1][y][x];
+    for (int uv = 1; uv < 3 && output->pixels[uv]; ++uv) {
+        px_t** inputUV  = input ->img<px_t>(uv);
+        px_t** outputUV = output->img<px_t>(uv);
+        for (int y = 0; y < img_height_cr; ++y) {
+            for (int x = 0; x < img_width_cr; ++x)
+                outputUV[y][x] = inputUV[y][x];
         }
     }
 }
 
+template <typename px_t>
 static void copy_to_conceal(storable_picture *src, storable_picture *dst, VideoParameters *p_Vid)
 {
     sps_t* sps = p_Vid->active_sps;
@@ -199,7 +208,7 @@ static void copy_to_conceal(storable_picture *src, storable_picture *dst, VideoP
         // We need these initializations for using deblocking filter for frame copy
         // concealment as well.
 
-        CopyImgData(src->imgY, src->imgUV, dst->imgY, dst->imgUV,
+        CopyImgData<px_t>(src, dst,
                     sps->PicWidthInMbs * 16, sps->FrameHeightInMbs * 16,
                     sps->PicWidthInMbs * sps->MbWidthC, sps->FrameHeightInMbs * sps->MbHeightC);
     }
@@ -253,7 +262,7 @@ static void copy_to_conceal(storable_picture *src, storable_picture *dst, VideoP
 
                 for (int ii = 0; ii < multiplier; ++ii) {
                     for (int jj = 0; jj < multiplier; ++jj)
-                        dst->imgY[i * multiplier + ii][j * multiplier + jj] = predMB[ii * multiplier + jj];
+                        dst->img<px_t>(0)[i * multiplier + ii][j * multiplier + jj] = predMB[ii * multiplier + jj];
                 }
 
                 predMB += (multiplier * multiplier);
@@ -262,7 +271,7 @@ static void copy_to_conceal(storable_picture *src, storable_picture *dst, VideoP
                     for (int uv = 0; uv < 2; ++uv) {
                         for (int ii = 0; ii < multiplier / 2; ++ii) {
                             for (int jj = 0; jj < multiplier / 2; ++jj)
-                                dst->imgUV[uv][i * multiplier / 2 + ii][j * multiplier / 2 + jj] =
+                                dst->img<px_t>(1 + uv)[i * multiplier / 2 + ii][j * multiplier / 2 + jj] =
                                     predMB[ii * (multiplier / 2) + jj];
                         }
                         predMB += (multiplier * multiplier / 4);
@@ -274,6 +283,14 @@ static void copy_to_conceal(storable_picture *src, storable_picture *dst, VideoP
     }
 }
 
+static void copy_to_conceal(storable_picture *src, storable_picture *dst, VideoParameters *p_Vid)
+{
+    if (dst->px_size == 1)
+        copy_to_conceal<uint8_t >(src, dst, p_Vid);
+    else
+        copy_to_conceal<uint16_t>(src, dst, p_Vid);
+}
+
 
 storable_picture* decoded_picture_buffer_t::get_last_ref_pic_from_dpb()
 {
@@ -6,172 +6,33 @@
 using namespace vio::h264;
 
 
-static int init_top_bot_planes(px_t **imgFrame, int dim0, px_t ***imgTopField, px_t ***imgBotField)
-{
-    *imgTopField = new px_t*[dim0 >> 1];
-    *imgBotField = new px_t*[dim0 >> 1];
-
-    for (int i = 0; i < (dim0 >> 1); i++) {
-        (*imgTopField)[i] = imgFrame[2 * i    ];
-        (*imgBotField)[i] = imgFrame[2 * i + 1];
-    }
-
-    return dim0 * sizeof(px_t*);
-}
-
-static void free_top_bot_planes(px_t **imgTopField, px_t **imgBotField)
-{
-    delete []imgTopField;
-    delete []imgBotField;
-}
-
-
-static void init_img_data(VideoParameters *p_Vid, ImageData *p_ImgData, sps_t *sps)
-{
-    // allocate memory for reference frame buffers: p_ImgData->frm_data
-    p_ImgData->yuv_format    = sps->chroma_format_idc;
-    p_ImgData->frm_stride[0] = sps->PicWidthInMbs * 16;
-    p_ImgData->frm_stride[1] =
-    p_ImgData->frm_stride[2] = sps->PicWidthInMbs * sps->MbWidthC;
-    p_ImgData->top_stride[0] =
-    p_ImgData->bot_stride[0] = p_ImgData->frm_stride[0] << 1;
-    p_ImgData->top_stride[1] =
-    p_ImgData->top_stride[2] =
-    p_ImgData->bot_stride[1] =
-    p_ImgData->bot_stride[2] = p_ImgData->frm_stride[1] << 1;
-
-    if (sps->separate_colour_plane_flag) {
-        for (int nplane = 0; nplane < 3; nplane++)
-            get_mem2Dpel(&(p_ImgData->frm_data[nplane]), sps->FrameHeightInMbs * 16, sps->PicWidthInMbs * 16);
-    } else {
-        get_mem2Dpel(&(p_ImgData->frm_data[0]), sps->FrameHeightInMbs * 16, sps->PicWidthInMbs * 16);
-
-        if (sps->chroma_format_idc != CHROMA_FORMAT_400) {
-            get_mem2Dpel(&(p_ImgData->frm_data[1]), sps->FrameHeightInMbs * sps->MbHeightC, sps->PicWidthInMbs * sps->MbWidthC);
-            get_mem2Dpel(&(p_ImgData->frm_data[2]), sps->FrameHeightInMbs * sps->MbHeightC, sps->PicWidthInMbs * sps->MbWidthC);
-
-            if (sizeof(px_t) == sizeof(unsigned char)) {
-                for (int k = 1; k < 3; k++)
-                    memset(p_ImgData->frm_data[k][0], 128, sps->FrameHeightInMbs * sps->MbHeightC * sps->PicWidthInMbs * sps->MbWidthC * sizeof(px_t));
-            } else {
-                px_t mean_val = (px_t)sps->BitDepthC;
-                for (int k = 1; k < 3; k++) {
-                    for (int j = 0; j < sps->FrameHeightInMbs * sps->MbHeightC; j++) {
-                        for (int i = 0; i < sps->PicWidthInMbs * sps->MbWidthC; i++)
-                            p_ImgData->frm_data[k][j][i] = mean_val;
-                    }
-                }
-            }
-        }
-    }
-
-    if (!sps->frame_mbs_only_flag) {
-        // allocate memory for field reference frame buffers
-        init_top_bot_planes(p_ImgData->frm_data[0], sps->FrameHeightInMbs * 16, &(p_ImgData->top_data[0]), &(p_ImgData->bot_data[0]));
-
-        if (sps->chroma_format_idc != CHROMA_FORMAT_400) {
-            init_top_bot_planes(p_ImgData->frm_data[1], sps->FrameHeightInMbs * sps->MbHeightC, &(p_ImgData->top_data[1]), &(p_ImgData->bot_data[1]));
-            init_top_bot_planes(p_ImgData->frm_data[2], sps->FrameHeightInMbs * sps->MbHeightC, &(p_ImgData->top_data[2]), &(p_ImgData->bot_data[2]));
-        }
-    }
-}
-
-void free_img_data(VideoParameters *p_Vid, ImageData *p_ImgData)
-{
-    if (p_Vid->active_sps->separate_colour_plane_flag) {
-        for (int nplane = 0; nplane < 3; nplane++) {
-            if (p_ImgData->frm_data[nplane]) {
-                free_mem2Dpel(p_ImgData->frm_data[nplane]);      // free ref frame buffers
-                p_ImgData->frm_data[nplane] = NULL;
-            }
-        }
-    } else {
-        if (p_ImgData->frm_data[0]) {
-            free_mem2Dpel(p_ImgData->frm_data[0]);      // free ref frame buffers
-            p_ImgData->frm_data[0] = NULL;
-        }
-    
-        if (p_ImgData->yuv_format != CHROMA_FORMAT_400) {
-            if (p_ImgData->frm_data[1]) {
-                free_mem2Dpel(p_ImgData->frm_data[1]);
-                p_ImgData->frm_data[1] = NULL;
-            }
-            if (p_ImgData->frm_data[2]) {
-                free_mem2Dpel(p_ImgData->frm_data[2]);
-                p_ImgData->frm_data[2] = NULL;
-            }
-        }
-    }
-  
-    if (!p_Vid->active_sps->frame_mbs_only_flag) {
-        free_top_bot_planes(p_ImgData->top_data[0], p_ImgData->bot_data[0]);
-
-        if (p_ImgData->yuv_format != CHROMA_FORMAT_400) {
-            free_top_bot_planes(p_ImgData->top_data[1], p_ImgData->bot_data[1]);
-            free_top_bot_planes(p_ImgData->top_data[2], p_ImgData->bot_data[2]);
-        }
-    }
-}
-
-static void copy_img_data(px_t *out_img, px_t *in_img, int ostride, int istride, unsigned int size_y, unsigned int size_x)
-{
-    for (int i = 0; i < size_y; i++) {
-        memcpy(out_img, in_img, size_x);
-        out_img += ostride;
-        in_img += istride;
-    }
-}
-
-static void process_picture_in_dpb_s(VideoParameters* p_Vid, storable_picture* p_pic)
+#if (MVC_EXTENSION_ENABLE)
+// Copies the samples of src into the planes of dst, which has the same
+// layout, and pads them.
+template <typename px_t>
+static void copy_planes(storable_picture* dst, storable_picture* src)
 {
-    ImageData* p_img_out = &p_Vid->tempData3;
-
-    if (!p_Vid->tempData3.frm_data[0])
-        init_img_data(p_Vid, &p_Vid->tempData3, p_Vid->active_sps);
-
-    px_t*** d_img;
-    if (p_pic->slice.structure == FRAME)
-        d_img = p_img_out->frm_data;
-    else { //If reference picture is a field, then frm_data will actually contain field data and therefore top/bottom stride is set accordingly.
-        if (p_pic->slice.structure == TOP_FIELD)
-            d_img = p_img_out->top_data;
-        else
-            d_img = p_img_out->bot_data;
-    }
-
-    for (int i = 0; i < p_pic->size_y; i++)
-        memcpy(d_img[0][i], p_pic->imgY[i], p_pic->size_x*sizeof(px_t));
-    if (p_Vid->active_sps->chroma_format_idc != CHROMA_FORMAT_400) {
-        for (int i = 0; i < p_pic->size_y_cr; i++)
-            memcpy(d_img[1][i], p_pic->imgUV[0][i], p_pic->size_x_cr * sizeof(px_t));
-        for (int i = 0; i < p_pic->size_y_cr; i++)
-            memcpy(d_img[2][i], p_pic->imgUV[1][i], p_pic->size_x_cr * sizeof(px_t));
+    for (int pl = 0; pl < 3 && src->pixels[pl]; pl++) {
+        int size_x = pl ? src->size_x_cr : src->size_x;
+        int size_y = pl ? src->size_y_cr : src->size_y;
+        px_t** out = dst->img<px_t>(pl);
+        px_t** in  = src->img<px_t>(pl);
+        for (int i = 0; i < size_y; i++)
+            memcpy(out[i], in[i], size_x * sizeof(px_t));
     }
+    dst->pad_rows(0, dst->size_y);
 }
 
-#if (MVC_EXTENSION_ENABLE)
 static storable_picture* clone_storable_picture(VideoParameters* p_Vid, storable_picture* p_pic)
 {
     int i, j;
     int nplane;
-    int *istride = NULL;
-    int ostride[2];
-    px_t ***img_in = NULL;
 
     sps_t *sps = p_Vid->active_sps;
     storable_picture *p_stored_pic = new storable_picture(p_Vid, (PictureStructure)p_Vid->structure,
         sps->PicWidthInMbs * 16, sps->FrameHeightInMbs * 16,
         sps->PicWidthInMbs * sps->MbWidthC, sps->FrameHeightInMbs * sps->MbHeightC, 0);
 
-    int iChromaPadX = MCBUF_CHROMA_PAD_X;
-    int iChromaPadY = MCBUF_CHROMA_PAD_Y;
-    if (sps->chroma_format_idc == CHROMA_FORMAT_422)
-        iChromaPadY = MCBUF_CHROMA_PAD_Y * 2;
-    else if (sps->chroma_format_idc == CHROMA_FORMAT_444) {
-        iChromaPadX = MCBUF_LUMA_PAD_X;
-        iChromaPadY = MCBUF_LUMA_PAD_Y;
-    }
-
     p_stored_pic->sps = p_pic->sps;
     p_stored_pic->pps = p_pic->pps;
     p_stored_pic->slice_headers = p_pic->slice_headers;
@@ -202,35 +63,16 @@ static storable_picture* clone_storable_picture(VideoParameters* p_Vid, storable
 
     // store BL reconstruction
 
-    ostride[0] = p_stored_pic->iLumaStride;
-    ostride[1] = p_stored_pic->iChromaStride;
-    if (p_stored_pic->slice.structure == FRAME) {
-        istride = p_Vid->tempData3.frm_stride;
-        img_in  = p_Vid->tempData3.frm_data;
-    } else if (p_stored_pic->slice.structure == TOP_FIELD) {
-        istride = p_Vid->tempData3.top_stride;
-        img_in  = p_Vid->tempData3.top_data;
-    } else {
-        istride = p_Vid->tempData3.bot_stride;
-        img_in  = p_Vid->tempData3.bot_data;
-    }
-
-    copy_img_data(&p_stored_pic->imgY[0][0], &img_in[0][0][0], ostride[0], istride[0], p_pic->size_y, p_pic->size_x * sizeof(px_t)); 
-
-    pad_buf(*p_stored_pic->imgY, p_stored_pic->size_x, p_stored_pic->size_y, p_stored_pic->iLumaStride, MCBUF_LUMA_PAD_X, MCBUF_LUMA_PAD_Y);
-
-    if (p_Vid->active_sps->chroma_format_idc != CHROMA_FORMAT_400) {    
-        copy_img_data(&p_stored_pic->imgUV[0][0][0], &img_in[1][0][0], ostride[1], istride[1], p_pic->size_y_cr, p_pic->size_x_cr*sizeof(px_t));
-        pad_buf(*p_stored_pic->imgUV[0], p_stored_pic->size_x_cr, p_stored_pic->size_y_cr, p_stored_pic->iChromaStride, iChromaPadX, iChromaPadY);
-        copy_img_data(&p_stored_pic->imgUV[1][0][0], &img_in[2][0][0], ostride[1], istride[2], p_pic->size_y_cr, p_pic->size_x_cr*sizeof(px_t));
-        pad_buf(*p_stored_pic->imgUV[1], p_stored_pic->size_x_cr, p_stored_pic->size_y_cr, p_stored_pic->iChromaStride, iChromaPadX, iChromaPadY);
-    }
+    if (p_stored_pic->px_size == 1)
+        copy_planes<uint8_t >(p_stored_pic, p_pic);
+    else
+        copy_planes<uint16_t>(p_stored_pic, p_pic);
+    p_stored_pic->padded = true;
 
     for (j = 0; j < (p_pic->size_y / 4); j++) {
-        char *ref_idx = p_stored_pic->mv_info[j][0].ref_idx;
-        for (i = 0; i < (p_pic->size_x / 4); i++) {          
-            *((short *) ref_idx) = -1;
-            ref_idx += sizeof(pic_motion_params);
+        for (i = 0; i < (p_pic->size_x / 4); i++) {
+            p_stored_pic->mv_info[j][i].ref_idx[LIST_0] = -1;
+            p_stored_pic->mv_info[j][i].ref_idx[LIST_1] = -1;
         }
     }
 
@@ -258,6 +100,5 @@ static storable_picture* clone_storable_picture(VideoParameters* p_Vid, storable
 
 void picture_in_dpb(slice_t* currSlice, VideoParameters *p_Vid, storable_picture *p_pic)
 {
-    process_picture_in_dpb_s(p_Vid, p_pic);
     currSlice->p_Dpb->store_proc_picture(clone_storable_picture(p_Vid, p_pic));
 }
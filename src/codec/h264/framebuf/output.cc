@@ -1,3 +1,7 @@
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "global.h"
 #include "input_parameters.h"
 #include "h264decoder.h"
@@ -7,11 +11,18 @@
 #include "memalloc.h"
 #include "sei.h"
 #include "output.h"
+#include "thread_pool.h"
 
 #include <fcntl.h>
+#include <errno.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 using namespace vio::h264;
 
@@ -27,85 +38,302 @@ static int testEndian(void)
     return (*p == 0);
 }
 
-static void img2buf_byte(px_t** imgX, unsigned char* buf, int size_x, int size_y, int symbol_size_in_bytes, int crop_left, int crop_right, int crop_top, int crop_bottom, int iOutStride)
+// Row kernels, converting n samples into packed little endian samples of the
+// output symbol size.
+
+template <typename px_t>
+static void row_copy(const px_t* src, uint8_t* dst, int n)
+{
+    memcpy(dst, src, n * sizeof(px_t));
+}
+
+template <typename px_t>
+static void row_narrow(const px_t* src, uint8_t* dst, int n)
 {
-    int twidth  = size_x - crop_left - crop_right;
-    int theight = size_y - crop_top - crop_bottom;
-    px_t** img = &imgX[crop_top];
-    for (int i = 0; i < theight; i++) {
-        memcpy(buf, *img++ + crop_left, twidth);
-        buf += iOutStride;
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i mask = _mm_set1_epi16(0xFF);
+    for (; sizeof(px_t) == 2 && i + 16 <= n; i += 16) {
+        __m128i lo = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src + i    )), mask);
+        __m128i hi = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src + i + 8)), mask);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
     }
+#endif
+    for (; i < n; ++i)
+        dst[i] = (uint8_t)src[i];
 }
 
-// little endian
-static void img2buf_le(px_t** imgX, unsigned char* buf, int size_x, int size_y, int symbol_size_in_bytes, int crop_left, int crop_right, int crop_top, int crop_bottom, int iOutStride)
+template <typename px_t>
+static void row_le16(const px_t* src, uint8_t* dst, int n)
 {
-    if (sizeof (px_t) < symbol_size_in_bytes) {
-        int twidth  = size_x - crop_left - crop_right;
-        int theight = size_y - crop_top - crop_bottom;
-        for (int j = 0; j < theight; j++)
-            memset(buf + j * iOutStride, 0, twidth * symbol_size_in_bytes);
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; sizeof(px_t) == 1 && i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + 2 * i     ), _mm_unpacklo_epi8(v, zero));
+        _mm_storeu_si128((__m128i*)(dst + 2 * i + 16), _mm_unpackhi_epi8(v, zero));
+    }
+#endif
+    for (; i < n; ++i) {
+        dst[2 * i    ] = (uint8_t)(src[i]     );
+        dst[2 * i + 1] = (uint8_t)(src[i] >> 8);
     }
+}
+
+static void fill_le(uint8_t* dst, int value, int size, int symbol_size_in_bytes)
+{
+    if (symbol_size_in_bytes == 1) {
+        memset(dst, value, size);
+        return;
+    }
+
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i v = _mm_set1_epi16((int16_t)value);
+    for (; i + 16 <= size; i += 16)
+        _mm_storeu_si128((__m128i*)(dst + i), v);
+#endif
+    for (; i + 2 <= size; i += 2) {
+        dst[i    ] = (uint8_t)(value     );
+        dst[i + 1] = (uint8_t)(value >> 8);
+    }
+}
+
+template <typename px_t>
+static void img2buf(decltype(row_copy<px_t>)* row, px_t** imgX, uint8_t* buf,
+                    int x0, int y0, int width, int height, int stride)
+{
+    for (int j = 0; j < height; ++j)
+        row(imgX[y0 + j] + x0, buf + j * stride, width);
+}
+
+
+// Writes converted frames behind the decoder on a thread of its own, so file
+// I/O overlaps with decoding. Frames are converted into a bounded ring of
+// reused buffers, and frames queued back to back for one file go out in a
+// single writev. Without worker threads frames are written on submit.
+
+struct output_queue_t {
+    static const int    QUEUE_SIZE = 4;
+    static const size_t ALIGNMENT  = 4096;
+
+    struct frame_t {
+        uint8_t*    buf;
+        size_t      capacity;
+        size_t      size;
+        int         fd;
+    };
+
+    frame_t         frames[QUEUE_SIZE];
+    std::thread     writer;
+    bool            threaded;
+    bool            direct;
 
-    int size = min<int>(sizeof(px_t), symbol_size_in_bytes);
+    std::mutex              mutex;
+    std::condition_variable filled;
+    std::condition_variable drained;
 
-    if (size != 1) {
-        for (int i = crop_top; i < size_y - crop_bottom; i++) {
-            int ipos = (i - crop_top) * iOutStride;
-            for (int j = crop_left; j < size_x - crop_right; j++)
-                memcpy(buf + (ipos + (j - crop_left) * symbol_size_in_bytes), &imgX[i][j], size);
+    int             head;
+    int             count;
+    bool            stop;
+    bool            failed;
+
+                output_queue_t(bool threaded, bool direct);
+                ~output_queue_t();
+
+    uint8_t*    acquire(size_t size);
+    void        submit (int fd, size_t size);
+    void        flush  ();
+
+private:
+    void        drain();
+    bool        write_frames(int first, int n);
+    bool        write_all(int fd, iovec* iov, int iovcnt);
+};
+
+
+output_queue_t::output_queue_t(bool threaded, bool direct) :
+    threaded { threaded }, direct { direct },
+    head { 0 }, count { 0 }, stop { false }, failed { false }
+{
+    for (int i = 0; i < QUEUE_SIZE; ++i)
+        this->frames[i] = { nullptr, 0, 0, -1 };
+    if (this->threaded)
+        this->writer = std::thread(&output_queue_t::drain, this);
+}
+
+output_queue_t::~output_queue_t()
+{
+    if (this->threaded) {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->stop = true;
         }
-    } else {
-        for (int j = crop_top; j < size_y - crop_bottom; j++) {  
-            uint8_t* pDst = buf + (j - crop_top) * iOutStride;
-            px_t* cur_pixel = &imgX[j][crop_left];
-            for (int i = crop_left; i < size_x - crop_right; i++)
-                *(pDst++) = (uint8_t)*(cur_pixel++);
+        this->filled.notify_one();
+        this->writer.join();
+    }
+
+    for (int i = 0; i < QUEUE_SIZE; ++i)
+        free(this->frames[i].buf);
+}
+
+// Returns the buffer of the next free slot, grown to hold size bytes.
+uint8_t* output_queue_t::acquire(size_t size)
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->drained.wait(lock, [this] { return this->count < QUEUE_SIZE; });
+    if (this->failed)
+        error(500, "write_out_picture: error writing to YUV file");
+
+    // slot tail is not visible to the writer until count covers it
+    frame_t& frame = this->frames[(this->head + this->count) % QUEUE_SIZE];
+    lock.unlock();
+
+    if (frame.capacity < size) {
+        free(frame.buf);
+        frame.capacity = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        void* buf;
+        if (posix_memalign(&buf, ALIGNMENT, frame.capacity) != 0)
+            no_mem_exit("output_queue_t::acquire");
+        frame.buf = (uint8_t*)buf;
+    }
+    return frame.buf;
+}
+
+void output_queue_t::submit(int fd, size_t size)
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+    frame_t& frame = this->frames[(this->head + this->count) % QUEUE_SIZE];
+    frame.fd   = fd;
+    frame.size = size;
+
+    if (!this->threaded) {
+        if (!this->write_frames(this->head, 1))
+            error(500, "write_out_picture: error writing to YUV file");
+        return;
+    }
+
+    this->count++;
+    lock.unlock();
+    this->filled.notify_one();
+}
+
+// Waits until every submitted frame has been written.
+void output_queue_t::flush()
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->drained.wait(lock, [this] { return this->count == 0; });
+    if (this->failed)
+        error(500, "write_out_picture: error writing to YUV file");
+}
+
+void output_queue_t::drain()
+{
+    for (;;) {
+        int first, n;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->filled.wait(lock, [this] { return this->stop || this->count > 0; });
+            if (this->count == 0)
+                return;
+            first = this->head;
+            n     = this->count;
         }
+
+        bool ok = this->write_frames(first, n);
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->failed |= !ok;
+            this->head    = (this->head + n) % QUEUE_SIZE;
+            this->count  -= n;
+        }
+        this->drained.notify_all();
     }
 }
 
-// big endian
-static void img2buf_be(px_t** imgX, unsigned char* buf, int size_x, int size_y, int symbol_size_in_bytes, int crop_left, int crop_right, int crop_top, int crop_bottom, int iOutStride)
+// Writes n queued frames, one writev per run of frames for the same file.
+bool output_queue_t::write_frames(int first, int n)
 {
-    switch (symbol_size_in_bytes) {
-    case 1:
-        for (int i = crop_top; i < size_y - crop_bottom; i++) {
-            for (int j = crop_left; j < size_x - crop_right; j++) {
-                uint8_t ui8 = (uint8_t)imgX[i][j];
-                buf[(j - crop_left) + (i - crop_top) * iOutStride] = ui8;
-            }
+    iovec iov[QUEUE_SIZE];
+    bool ok = true;
+
+    for (int i = 0; i < n; ) {
+        int fd = this->frames[(first + i) % QUEUE_SIZE].fd;
+        int iovcnt = 0;
+        for (; i < n && this->frames[(first + i) % QUEUE_SIZE].fd == fd; ++i) {
+            frame_t& frame = this->frames[(first + i) % QUEUE_SIZE];
+            iov[iovcnt++] = { frame.buf, frame.size };
         }
-        break;
-    case 2:
-        for (int i = crop_top; i < size_y - crop_bottom; i++) {
-            for (int j = crop_left; j < size_x - crop_right; j++) {
-                uint16_t tmp16 = (uint16_t)imgX[i][j];
-                uint16_t ui16  = (uint16_t)((tmp16 >> 8) | ((tmp16 & 0xFF) << 8));
-                memcpy(buf + (j - crop_left + (i - crop_top) * iOutStride) * 2, &ui16, 2);
+        ok &= this->write_all(fd, iov, iovcnt);
+    }
+    return ok;
+}
+
+bool output_queue_t::write_all(int fd, iovec* iov, int iovcnt)
+{
+#ifdef O_DIRECT
+    // O_DIRECT needs block aligned lengths, the buffers are page aligned and
+    // the file offset stays aligned as long as every write was
+    if (this->direct) {
+        for (int i = 0; i < iovcnt; ++i)
+            this->direct &= iov[i].iov_len % 512 == 0;
+        int flags = fcntl(fd, F_GETFL);
+        fcntl(fd, F_SETFL, this->direct ? flags | O_DIRECT : flags & ~O_DIRECT);
+    }
+#endif
+
+    while (iovcnt > 0) {
+        ssize_t written = writev(fd, iov, iovcnt);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+#ifdef O_DIRECT
+            if (errno == EINVAL && (fcntl(fd, F_GETFL) & O_DIRECT)) {
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+                this->direct = false;
+                continue;
             }
+#endif
+            return false;
         }
-        break;
-    case 4:
-        for (int i = crop_top; i < size_y - crop_bottom; i++) {
-            for (int j = crop_left; j < size_x - crop_right; j++) {
-                uint32_t tmp32 = (uint32_t)imgX[i][j];
-                uint32_t ui32  = (uint32_t)(((tmp32 & 0x000000FF) << 24) |
-                                            ((tmp32 & 0x0000FF00) <<  8) |
-                                            ((tmp32 & 0x00FF0000) >>  8) |
-                                            ((tmp32 & 0xFF000000) >> 24));
-                memcpy(buf + (j - crop_left + (i - crop_top) * iOutStride) * 4, &ui32, 4);
-            }
+        while (iovcnt > 0 && (size_t)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (uint8_t*)iov->iov_base + written;
+            iov->iov_len -= written;
         }
-        break;
-    default:
-        error(500, "writing only to formats of 8, 16 or 32 bit allowed on big endian architecture");
-        break;
-    }  
+    }
+    return true;
+}
+
+
+void open_output_queue(VideoParameters *p_Vid)
+{
+    p_Vid->output = new output_queue_t(p_Vid->threads->size() > 1, p_Vid->p_Inp->direct_output);
+}
+
+void flush_output_queue(VideoParameters *p_Vid)
+{
+    if (p_Vid->output)
+        p_Vid->output->flush();
+}
+
+void close_output_queue(VideoParameters *p_Vid)
+{
+    if (p_Vid->output) {
+        p_Vid->output->flush();
+        delete p_Vid->output;
+        p_Vid->output = nullptr;
+    }
 }
 
 
+template <typename px_t>
 static void write_out_picture(VideoParameters *p_Vid, storable_picture *p, int p_out)
 {
     InputParameters* p_Inp = p_Vid->p_Inp;
@@ -114,116 +342,83 @@ static void write_out_picture(VideoParameters *p_Vid, storable_picture *p, int p
     int pic_unit_bitsize_on_disk = max(sps.BitDepthY, sps.BitDepthC) > 8 ? 16 : 8;
     int symbol_size_in_bytes = (pic_unit_bitsize_on_disk + 7) >> 3;
 
-    decltype(img2buf_le)* img2buf;
-    if (sizeof(char) == sizeof(px_t)) {
-        if (sizeof(char) == symbol_size_in_bytes)
-            img2buf = img2buf_byte;
-        else
-            img2buf = img2buf_le;
-    } else {
-        if (testEndian())
-            img2buf = img2buf_be;
-        else
-            img2buf = img2buf_le;
-    }
-
     bool rgb_output = sps.vui_parameters.matrix_coefficients == 0;
 
     if (p->non_existing)
         return;
-
-    int size_x_l = sps.PicWidthInMbs    * 16;
-    int size_y_l = sps.FrameHeightInMbs * 16;
-    int size_x_c = sps.PicWidthInMbs    * sps.MbWidthC;
-    int size_y_c = sps.FrameHeightInMbs * sps.MbHeightC;
+    p->wait_decoded();
 
     // note: this tone-mapping is working for RGB format only. Sharp
     if (p->seiHasTone_mapping && rgb_output) {
+        int size_x_l = sps.PicWidthInMbs    * 16;
+        int size_y_l = sps.FrameHeightInMbs * 16;
+        int size_x_c = sps.PicWidthInMbs    * sps.MbWidthC;
+        int size_y_c = sps.FrameHeightInMbs * sps.MbHeightC;
         symbol_size_in_bytes = (p->tonemapped_bit_depth > 8) ? 2 : 1;
-        tone_map(p->imgY,     p->tone_mapping_lut, size_x_l, size_y_l);
-        tone_map(p->imgUV[0], p->tone_mapping_lut, size_x_c, size_y_c);
-        tone_map(p->imgUV[1], p->tone_mapping_lut, size_x_c, size_y_c);
+        tone_map(p->img<px_t>(0), p->tone_mapping_lut, size_x_l, size_y_l);
+        tone_map(p->img<px_t>(1), p->tone_mapping_lut, size_x_c, size_y_c);
+        tone_map(p->img<px_t>(2), p->tone_mapping_lut, size_x_c, size_y_c);
     }
 
-    // should this be done only once?
-    int crop_left_l = 0, crop_right_l = 0, crop_top_l = 0, crop_bottom_l = 0;
-    int crop_left_c = 0, crop_right_c = 0, crop_top_c = 0, crop_bottom_c = 0;
-    if (sps.frame_cropping_flag) {
-        crop_left_c   = sps.frame_crop_left_offset;
-        crop_right_c  = sps.frame_crop_right_offset;
-        crop_top_c    = sps.frame_crop_top_offset    * (2 - sps.frame_mbs_only_flag);
-        crop_bottom_c = sps.frame_crop_bottom_offset * (2 - sps.frame_mbs_only_flag);
-        crop_left_l   = sps.SubWidthC  * crop_left_c;
-        crop_right_l  = sps.SubWidthC  * crop_right_c;
-        crop_top_l    = sps.SubHeightC * crop_top_c;
-        crop_bottom_l = sps.SubHeightC * crop_bottom_c;
-    }
-    int iLumaSizeX   = size_x_l - (crop_left_l + crop_right_l);
-    int iLumaSizeY   = size_y_l - (crop_top_l + crop_bottom_l);
-    int iLumaSize    = iLumaSizeX * iLumaSizeY * symbol_size_in_bytes;
-    int iChromaSizeX = size_x_c - (crop_left_c + crop_right_c);
-    int iChromaSizeY = size_y_c - (crop_top_c + crop_bottom_c);
-    int iChromaSize  = iChromaSizeX * iChromaSizeY * symbol_size_in_bytes;
-    int iFrameSize   = iLumaSize + 2 * iChromaSize;
+    decltype(row_copy<px_t>)* row;
+    if (symbol_size_in_bytes == sizeof(px_t) && (symbol_size_in_bytes == 1 || !testEndian()))
+        row = row_copy<px_t>;
+    else if (symbol_size_in_bytes == 1)
+        row = row_narrow<px_t>;
+    else
+        row = row_le16<px_t>;
+
+    int iLumaSizeX   = sps.CropWidthL;
+    int iLumaSize    = sps.CropWidthL * sps.CropHeightL * symbol_size_in_bytes;
+    int iChromaSizeX = sps.CropWidthC;
+    int iChromaSize  = sps.CropWidthC * sps.CropHeightC * symbol_size_in_bytes;
 
     // We need to further cleanup this function
     if (p_out == -1)
         return;
 
-    if (!p_Vid->pDecOuputPic.pY) {
-        p_Vid->pDecOuputPic.pY = new uint8_t[iFrameSize];
-        p_Vid->pDecOuputPic.pU = p_Vid->pDecOuputPic.pY + iLumaSize;
-        p_Vid->pDecOuputPic.pV = p_Vid->pDecOuputPic.pU + iChromaSize;
-    }
+    // planes are converted back to back into one buffer, in file order
+    size_t iFrameSize = iLumaSize;
+    if (sps.chroma_format_idc != CHROMA_FORMAT_400)
+        iFrameSize += 2 * iChromaSize;
+    else if (p_Inp->write_uv)
+        iFrameSize += 2 * (iLumaSize / 4);
+    uint8_t* buf = p_Vid->output->acquire(max<size_t>(iFrameSize, iLumaSize));
+    uint8_t* pY = buf;
 
     if (rgb_output) {
-        uint8_t* buf = new uint8_t[size_x_l * size_y_l * symbol_size_in_bytes];
-        img2buf(p->imgUV[1], buf, size_x_c, size_y_c, symbol_size_in_bytes,
-                crop_left_c, crop_right_c, crop_top_c, crop_bottom_c, iLumaSizeX * symbol_size_in_bytes);
-        if (iChromaSize != write(p_out, buf, iChromaSize))
-            error(500, "write_out_picture: error writing to RGB file");
-        delete []buf;
+        // V is converted with the luma stride, the luma plane written after
+        // it overwrites everything past its first iChromaSize bytes
+        img2buf(row, p->img<px_t>(2), buf, sps.CropLeftC, sps.CropTopC, sps.CropWidthC, sps.CropHeightC,
+                iLumaSizeX * symbol_size_in_bytes);
+        pY += iChromaSize;
     }
 
-    img2buf(p->imgY, p_Vid->pDecOuputPic.pY, size_x_l, size_y_l, symbol_size_in_bytes,
-            crop_left_l, crop_right_l, crop_top_l, crop_bottom_l, iLumaSizeX * symbol_size_in_bytes);
-    if (iLumaSize != write(p_out, p_Vid->pDecOuputPic.pY, iLumaSize))
-        error(500, "write_out_picture: error writing to YUV file");
+    img2buf(row, p->img<px_t>(0), pY, sps.CropLeftL, sps.CropTopL, sps.CropWidthL, sps.CropHeightL,
+            iLumaSizeX * symbol_size_in_bytes);
+    uint8_t* pU = pY + iLumaSize;
+    uint8_t* pV = pU + iChromaSize;
 
     if (sps.chroma_format_idc != CHROMA_FORMAT_400) {
-        img2buf(p->imgUV[0], p_Vid->pDecOuputPic.pU, size_x_c, size_y_c, symbol_size_in_bytes,
-                crop_left_c, crop_right_c, crop_top_c, crop_bottom_c, iChromaSizeX * symbol_size_in_bytes);
-        if (iChromaSize != write(p_out, p_Vid->pDecOuputPic.pU, iChromaSize))
-            error(500, "write_out_picture: error writing to YUV file");
-
-        if (!rgb_output) {
-            img2buf(p->imgUV[1], p_Vid->pDecOuputPic.pV, size_x_c, size_y_c, symbol_size_in_bytes,
-                    crop_left_c, crop_right_c, crop_top_c, crop_bottom_c, iChromaSizeX * symbol_size_in_bytes);
-            if (iChromaSize != write(p_out, p_Vid->pDecOuputPic.pV, iChromaSize))
-                error(500, "write_out_picture: error writing to YUV file");
-        }
+        img2buf(row, p->img<px_t>(1), pU, sps.CropLeftC, sps.CropTopC, sps.CropWidthC, sps.CropHeightC,
+                iChromaSizeX * symbol_size_in_bytes);
+        if (!rgb_output)
+            img2buf(row, p->img<px_t>(2), pV, sps.CropLeftC, sps.CropTopC, sps.CropWidthC, sps.CropHeightC,
+                    iChromaSizeX * symbol_size_in_bytes);
     } else if (p_Inp->write_uv) {
-        get_mem2Dpel(&p->imgUV[0], size_y_l / 2, size_x_l / 2);
-  
-        px_t cr_val = (px_t)(1 << (sps.BitDepthY - 1));
-        for (int j = 0; j < size_y_l / 2; j++) {
-            for (int i = 0; i < size_x_l / 2; i++)
-                p->imgUV[0][j][i] = cr_val;
-        }
-
         // fake out U=V=128 to make a YUV 4:2:0 stream
-        uint8_t* buf = new uint8_t[size_x_l * size_y_l * symbol_size_in_bytes];
-        img2buf(p->imgUV[0], buf, size_x_l/2, size_y_l/2, symbol_size_in_bytes,
-                crop_left_l/2, crop_right_l/2, crop_top_l/2, crop_bottom_l/2, iLumaSizeX * symbol_size_in_bytes / 2);
-        if (iLumaSize / 4 != write(p_out, buf, iLumaSize / 4))
-            error(500, "write_out_picture: error writing to YUV file");
-        if (iLumaSize / 4 != write(p_out, buf, iLumaSize / 4))
-            error(500, "write_out_picture: error writing to YUV file");
-        delete []buf;
-
-        free_mem2Dpel(p->imgUV[0]);
-        p->imgUV[0] = nullptr;
+        fill_le(pU, 1 << (sps.BitDepthY - 1), 2 * (iLumaSize / 4), symbol_size_in_bytes);
     }
+
+    p_Vid->output->submit(p_out, iFrameSize);
+}
+
+static void write_out_picture(VideoParameters *p_Vid, storable_picture *p, int p_out)
+{
+    if (p->px_size == 1)
+        write_out_picture<uint8_t >(p_Vid, p, p_out);
+    else
+        write_out_picture<uint16_t>(p_Vid, p, p_out);
 }
 
 static void write_unpaired_field(VideoParameters *p_Vid, pic_t* fs, int p_out)
@@ -233,10 +428,12 @@ static void write_unpaired_field(VideoParameters *p_Vid, pic_t* fs, int p_out)
 
     if (fs->is_used & 0x01) {
         // we have a top field
-        // construct an empty bottom field
+        // construct an empty bottom field, in the free rows of the top one
+        // unless another picture is being decoded into them
         p = fs->top_field;
-        fs->bottom_field = new storable_picture(p_Vid, BOTTOM_FIELD,
-            p->size_x, p->size_y * 2, p->size_x_cr, p->size_y_cr * 2, 1);
+        fs->bottom_field = p->planes.use_count() == 1 ?
+            new storable_picture(p_Vid, BOTTOM_FIELD, p) :
+            new storable_picture(p_Vid, BOTTOM_FIELD, p->size_x, p->size_y * 2, p->size_x_cr, p->size_y_cr * 2, 1);
         fs->bottom_field->clear();
         fs->dpb_combine_field_yuv(p_Vid);
 #if (MVC_EXTENSION_ENABLE)
@@ -247,10 +444,12 @@ static void write_unpaired_field(VideoParameters *p_Vid, pic_t* fs, int p_out)
 
     if (fs->is_used & 0x02) {
         // we have a bottom field
-        // construct an empty top field
+        // construct an empty top field, in the free rows of the bottom one
+        // unless another picture is being decoded into them
         p = fs->bottom_field;
-        fs->top_field = new storable_picture(p_Vid, TOP_FIELD,
-            p->size_x, p->size_y * 2, p->size_x_cr, p->size_y_cr * 2, 1);
+        fs->top_field = p->planes.use_count() == 1 ?
+            new storable_picture(p_Vid, TOP_FIELD, p) :
+            new storable_picture(p_Vid, TOP_FIELD, p->size_x, p->size_y * 2, p->size_x_cr, p->size_y_cr * 2, 1);
         fs->top_field->clear();
         fs->dpb_combine_field_yuv(p_Vid);
 #if (MVC_EXTENSION_ENABLE)
@@ -267,15 +466,15 @@ static void flush_direct_output(VideoParameters *p_Vid, int p_out)
     write_unpaired_field(p_Vid, p_Vid->out_buffer, p_out);
 
     if (p_Vid->out_buffer->frame) {
-        delete p_Vid->out_buffer->frame;
+        release_picture(p_Vid, p_Vid->out_buffer->frame);
         p_Vid->out_buffer->frame = nullptr;
     }
     if (p_Vid->out_buffer->top_field) {
-        delete p_Vid->out_buffer->top_field;
+        release_picture(p_Vid, p_Vid->out_buffer->top_field);
         p_Vid->out_buffer->top_field = nullptr;
     }
     if (p_Vid->out_buffer->bottom_field) {
-        delete p_Vid->out_buffer->bottom_field;
+        release_picture(p_Vid, p_Vid->out_buffer->bottom_field);
         p_Vid->out_buffer->bottom_field = nullptr;
     }
     p_Vid->out_buffer->is_used = 0;
@@ -308,7 +507,7 @@ void direct_output(VideoParameters *p_Vid, storable_picture *p, int p_out)
         write_out_picture(p_Vid, p, p_out);
         p_Vid->calculate_frame_no(p);
         if (p) {
-            delete p;
+            release_picture(p_Vid, p);
             p = nullptr;
         }
         return;
@@ -338,15 +537,15 @@ void direct_output(VideoParameters *p_Vid, storable_picture *p, int p_out)
 
         p_Vid->calculate_frame_no(p);
         if (p_Vid->out_buffer->frame) {
-            delete p_Vid->out_buffer->frame;
+            release_picture(p_Vid, p_Vid->out_buffer->frame);
             p_Vid->out_buffer->frame = nullptr;
         }
         if (p_Vid->out_buffer->top_field) {
-            delete p_Vid->out_buffer->top_field;
+            release_picture(p_Vid, p_Vid->out_buffer->top_field);
             p_Vid->out_buffer->top_field = nullptr;
         }
         if (p_Vid->out_buffer->bottom_field) {
-            delete p_Vid->out_buffer->bottom_field;
+            release_picture(p_Vid, p_Vid->out_buffer->bottom_field);
             p_Vid->out_buffer->bottom_field = nullptr;
         }
         p_Vid->out_buffer->is_used = 0;
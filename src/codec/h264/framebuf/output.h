@@ -2,6 +2,10 @@
 #define _OUTPUT_H_
 
 
+extern void open_output_queue (VideoParameters *p_Vid);
+extern void flush_output_queue(VideoParameters *p_Vid);
+extern void close_output_queue(VideoParameters *p_Vid);
+
 extern void write_stored_frame(VideoParameters *p_Vid, pic_t *fs, int p_out);
 extern void direct_output     (VideoParameters *p_Vid, storable_picture *p, int p_out);
 
@@ -1,9 +1,12 @@
 #include "global.h"
+#include "input_parameters.h"
 #include "picture.h"
 #include "memalloc.h"
 #include "sets.h"
 #include "slice.h"
 #include "erc_api.h"
+#include "thread_pool.h"
+#include "pipeline.h"
 
 using namespace vio::h264;
 
@@ -14,38 +17,162 @@ static inline int RSD(int x)
 }
 
 
+static inline size_t align64(size_t size)
+{
+    return (size + 63) & ~(size_t)63;
+}
+
+// Lays out the row pointers of a plane. The rows of the vertical padding
+// repeat the edge rows, so padding a picture only copies samples across its
+// left and right border, and a field is addressed through every other row
+// of the frame.
+template <typename px_t>
+static px_t** carve_rows(uint8_t* rows, px_t* origin, int height, int stride, int iPadY)
+{
+    px_t** array2D = (px_t**)rows + iPadY;
+    for (int i = -iPadY; i < height + iPadY; ++i)
+        array2D[i] = origin + clip3(0, height - 1, i) * stride;
+    return array2D;
+}
+
+static motion_field_t carve_motion(uint8_t* data, int dim0, int dim1)
+{
+    memset(data, 0, dim0 * dim1 * sizeof(pic_motion_params));
+    return {(pic_motion_params*)data, dim1};
+}
+
+
 storable_picture::storable_picture(VideoParameters *p_Vid, PictureStructure structure,
                                    int size_x, int size_y, int size_x_cr, int size_y_cr, int is_output)
 {
-    sps_t* sps = p_Vid->active_sps;  
+    sps_t* sps = p_Vid->active_sps;
 
-    if (structure != FRAME) {
-        size_y    /= 2;
-        size_y_cr /= 2;
+    // Samples of streams up to 8 bit deep are stored in bytes, the others
+    // in 16-bit words. The planes always hold a whole frame, so that the
+    // second field of a pair can be decoded into the rows the first one
+    // leaves free.
+    int    px_size = sps->BitDepthY > 8 || sps->BitDepthC > 8 ? 2 : 1;
+    int    num_uv  = sps->chroma_format_idc != CHROMA_FORMAT_400 ? 2 : 0;
+    int    padX    = sps->chroma_format_idc == CHROMA_FORMAT_444 ? MCBUF_LUMA_PAD_X : MCBUF_CHROMA_PAD_X;
+    int    strideY = size_x    + 2 * MCBUF_LUMA_PAD_X;
+    int    strideC = size_x_cr + 2 * padX;
+    size_t planeY  = align64(size_y    * strideY * px_size);
+    size_t planeUV = align64(size_y_cr * strideC * px_size);
+    size_t size    = planeY + num_uv * planeUV;
+
+    picture_pool_t* pool = p_Vid->pic_pool;
+    this->planes = std::shared_ptr<uint8_t>((uint8_t*)pool->acquire(size),
+                                            [pool, size](uint8_t* planes) { pool->release(planes, size); });
+
+    uint8_t* data = this->planes.get();
+    uint8_t* origin[3] = {data + MCBUF_LUMA_PAD_X * px_size, nullptr, nullptr};
+    for (int uv = 0; uv < num_uv; ++uv)
+        origin[1 + uv] = data + planeY + uv * planeUV + padX * px_size;
+
+    this->px_size = px_size;
+    if (px_size == 1)
+        this->init(p_Vid, structure, size_x, size_y, size_x_cr, size_y_cr, origin);
+    else {
+        uint16_t* origin16[3] = {(uint16_t*)origin[0], (uint16_t*)origin[1], (uint16_t*)origin[2]};
+        this->init(p_Vid, structure, size_x, size_y, size_x_cr, size_y_cr, origin16);
     }
+}
+
+// A view of the planes of owner, as a frame or as one of its fields.
+storable_picture::storable_picture(VideoParameters *p_Vid, PictureStructure structure, storable_picture* owner)
+{
+    bool field = owner->slice.structure != FRAME;
+    int  size_y    = owner->size_y    * (field ? 2 : 1);
+    int  size_y_cr = owner->size_y_cr * (field ? 2 : 1);
+    int  bottom    = owner->slice.structure == BOTTOM_FIELD ? 1 : 0;
+
+    this->planes   = owner->planes;
+    this->progress = owner->progress;
+    this->px_size  = owner->px_size;
+    if (this->px_size == 1)
+        this->init_view<uint8_t >(p_Vid, structure, owner, size_y, size_y_cr, field, bottom);
+    else
+        this->init_view<uint16_t>(p_Vid, structure, owner, size_y, size_y_cr, field, bottom);
+}
+
+template <typename px_t>
+void storable_picture::init_view(VideoParameters *p_Vid, PictureStructure structure, storable_picture* owner,
+                                 int size_y, int size_y_cr, int field, int bottom)
+{
+    px_t* origin[3];
+    origin[0] = owner->img<px_t>(0)[0] - bottom * (owner->iLumaStride >> field);
+    for (int uv = 0; uv < 2; ++uv)
+        origin[1 + uv] = owner->pixels[1 + uv] ? owner->img<px_t>(1 + uv)[0] - bottom * (owner->iChromaStride >> field) : nullptr;
+
+    this->init(p_Vid, structure, owner->size_x, size_y, owner->size_x_cr, size_y_cr, origin);
+}
+
+template <typename px_t>
+void storable_picture::init(VideoParameters *p_Vid, PictureStructure structure,
+                            int size_x, int size_y, int size_x_cr, int size_y_cr, px_t* origin[3])
+{
+    sps_t* sps = p_Vid->active_sps;
 
     this->iChromaPadX = sps->chroma_format_idc == CHROMA_FORMAT_444 ? MCBUF_LUMA_PAD_X : MCBUF_CHROMA_PAD_X;
     this->iChromaPadY = sps->chroma_format_idc == CHROMA_FORMAT_444 ? MCBUF_LUMA_PAD_Y :
                         sps->chroma_format_idc == CHROMA_FORMAT_422 ? MCBUF_CHROMA_PAD_Y * 2 : MCBUF_CHROMA_PAD_Y;
     this->iLumaStride   = size_x    + 2 * MCBUF_LUMA_PAD_X;
     this->iChromaStride = size_x_cr + 2 * this->iChromaPadX;
+    this->padded        = false;
+
+    if (structure != FRAME) {
+        int bottom = structure == BOTTOM_FIELD ? 1 : 0;
+        origin[0] += bottom * this->iLumaStride;
+        for (int uv = 0; uv < 2; ++uv) {
+            if (origin[1 + uv])
+                origin[1 + uv] += bottom * this->iChromaStride;
+        }
+        this->iLumaStride   *= 2;
+        this->iChromaStride *= 2;
+        size_y    /= 2;
+        size_y_cr /= 2;
+    }
+
+    // One 64-byte aligned buffer holds the motion info of the picture (and
+    // of each colour plane when coded separately) and the row pointers into
+    // the planes.
+    int    num_uv  = origin[1] ? 2 : 0;
+    int    num_mv  = sps->separate_colour_plane_flag ? 4 : 1;
+    size_t dataMv  = align64((size_y / 4) * (size_x / 4) * sizeof(pic_motion_params));
+    size_t flags   = align64((size_y / 4) * (size_x / 4) * sizeof(bool));
+    size_t rowsY   = align64((size_y    + 2 * MCBUF_LUMA_PAD_Y) * sizeof(px_t*));
+    size_t rowsUV  = align64((size_y_cr + 2 * this->iChromaPadY) * sizeof(px_t*));
+
+    this->pool        = p_Vid->pic_pool;
+    this->buffer_size = num_mv * (dataMv + flags) + rowsY + num_uv * rowsUV;
+    this->buffer      = this->pool->acquire(this->buffer_size);
 
-    get_mem2Dpel_pad(&this->imgY, size_y, size_x, MCBUF_LUMA_PAD_Y, MCBUF_LUMA_PAD_X);
-    if (sps->chroma_format_idc != CHROMA_FORMAT_400) {
-        get_mem2Dpel_pad(&this->imgUV[0], size_y_cr, size_x_cr, this->iChromaPadY, this->iChromaPadX);
-        get_mem2Dpel_pad(&this->imgUV[1], size_y_cr, size_x_cr, this->iChromaPadY, this->iChromaPadX);
+    uint8_t* data = (uint8_t*)this->buffer;
+    uint8_t* rows = data + num_mv * (dataMv + flags);
+
+    this->pixels[0] = carve_rows(rows, origin[0], size_y, this->iLumaStride, MCBUF_LUMA_PAD_Y);
+    rows += rowsY;
+    this->pixels[1] = this->pixels[2] = nullptr;
+    for (int uv = 0; uv < num_uv; ++uv) {
+        this->pixels[1 + uv] = carve_rows(rows, origin[1 + uv], size_y_cr, this->iChromaStride, this->iChromaPadY);
+        rows += rowsUV;
     }
 
-    get_mem2Dmp(&this->mv_info, (size_y / 4), (size_x / 4));
-    this->motion.mb_field_decoding_flag = new bool[(size_x / 4) * (size_y / 4)];
+    this->mv_info = carve_motion(data, size_y / 4, size_x / 4);
+    this->motion.mb_field_decoding_flag = (bool*)(data + dataMv);
+    data += dataMv + flags;
 
     if (sps->separate_colour_plane_flag) {
         for (int nplane = 0; nplane < 3; ++nplane) {
-            get_mem2Dmp(&this->JVmv_info[nplane], (size_y / 4), (size_x / 4));
-            this->JVmotion[nplane].mb_field_decoding_flag = new bool[(size_x / 4) * (size_y / 4)];
+            this->JVmv_info[nplane] = carve_motion(data, size_y / 4, size_x / 4);
+            this->JVmotion[nplane].mb_field_decoding_flag = (bool*)(data + dataMv);
+            data += dataMv + flags;
         }
     }
 
+    this->ref_pics[0]  = nullptr;
+    this->num_ref_pics = 1;
+
     this->sps = sps;
 
     this->top_poc = this->bottom_poc = this->poc = 0;
@@ -84,38 +211,52 @@ storable_picture::storable_picture(VideoParameters *p_Vid, PictureStructure stru
 
 storable_picture::~storable_picture()
 {
-    if (this->mv_info) {
-        free_mem2Dmp(this->mv_info);
-        this->mv_info = nullptr;
-    }
-    delete []this->motion.mb_field_decoding_flag;
+    this->pool->release(this->buffer, this->buffer_size);
+
+    if (this->seiHasTone_mapping)
+        delete this->tone_mapping_lut;
+}
+
+
+picture_pool_t::~picture_pool_t()
+{
+    this->clear();
+}
 
-    if (this->sps->separate_colour_plane_flag) {
-        for (int nplane = 0; nplane < 3; nplane++) {
-            if (this->JVmv_info[nplane]) {
-                free_mem2Dmp(this->JVmv_info[nplane]);
-                this->JVmv_info[nplane] = nullptr;
+void* picture_pool_t::acquire(size_t size)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        for (auto it = this->buffers.begin(); it != this->buffers.end(); ++it) {
+            if (it->first == size) {
+                void* buffer = it->second;
+                this->buffers.erase(it);
+                return buffer;
             }
-            delete []this->JVmotion[nplane].mb_field_decoding_flag;
         }
     }
 
-    if (this->imgY) {
-        free_mem2Dpel_pad(this->imgY, MCBUF_LUMA_PAD_Y, MCBUF_LUMA_PAD_X);
-        this->imgY = nullptr;
-    }
+    void* buffer;
+    if (posix_memalign(&buffer, 64, size) != 0)
+        no_mem_exit("picture_pool_t::acquire");
+    return buffer;
+}
 
-    if (this->imgUV[0]) {
-        free_mem2Dpel_pad(this->imgUV[0], this->iChromaPadY, this->iChromaPadX);
-        free_mem2Dpel_pad(this->imgUV[1], this->iChromaPadY, this->iChromaPadX);
-        this->imgUV[0] = nullptr;
-        this->imgUV[1] = nullptr;
-    }
+void picture_pool_t::release(void* buffer, size_t size)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->buffers.push_back({size, buffer});
+}
 
-    if (this->seiHasTone_mapping)
-        delete this->tone_mapping_lut;
+void picture_pool_t::clear()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (auto& buffer : this->buffers)
+        free(buffer.second);
+    this->buffers.clear();
 }
 
+
 bool storable_picture::is_short_ref()
 {
     return this->used_for_reference && !this->is_long_term;
@@ -126,20 +267,79 @@ bool storable_picture::is_long_ref()
     return this->used_for_reference && this->is_long_term;
 }
 
+uint8_t storable_picture::ref_pic_id(storable_picture* ref_pic)
+{
+    for (int id = 0; id < this->num_ref_pics; ++id) {
+        if (this->ref_pics[id] == ref_pic)
+            return id;
+    }
+    if (this->num_ref_pics == 256)
+        error(500, "too many distinct reference pictures in one picture");
+    this->ref_pics[this->num_ref_pics] = ref_pic;
+    return this->num_ref_pics++;
+}
+
+void storable_picture::clear()
+{
+    if (this->px_size == 1)
+        this->clear<uint8_t >();
+    else
+        this->clear<uint16_t>();
+    this->publish_rows(this->size_y);
+}
+
+template <typename px_t>
 void storable_picture::clear()
 {
+    px_t** imgY = this->img<px_t>(0);
     for (int i = 0; i < this->size_y; i++) {
         for (int j = 0; j < this->size_x; j++)
-            this->imgY[i][j] = (px_t) (1 << (this->sps->BitDepthY - 1));
+            imgY[i][j] = (px_t) (1 << (this->sps->BitDepthY - 1));
     }
-    for (int i = 0; i < this->size_y_cr; i++) {
-        for (int j = 0; j < this->size_x_cr; j++)
-            this->imgUV[0][i][j] = (px_t) (1 << (this->sps->BitDepthC - 1));
+    for (int uv = 0; uv < 2; uv++) {
+        px_t** imgUV = this->img<px_t>(1 + uv);
+        for (int i = 0; i < this->size_y_cr; i++) {
+            for (int j = 0; j < this->size_x_cr; j++)
+                imgUV[i][j] = (px_t) (1 << (this->sps->BitDepthC - 1));
+        }
     }
-    for (int i = 0; i < this->size_y_cr; i++) {
-        for (int j = 0; j < this->size_x_cr; j++)
-            this->imgUV[1][i][j] = (px_t) (1 << (this->sps->BitDepthC - 1));
+}
+
+// A frame is read through both of its fields, so frame rows 0 to rows - 1
+// need the first (rows + 1) / 2 rows of the top field and the first
+// rows / 2 rows of the bottom field.
+void storable_picture::wait_progress(int rows) const
+{
+    row_progress_t& progress = *this->progress;
+    int  bottom = this->slice.structure == BOTTOM_FIELD ? 1 : 0;
+    int  needed = min(rows, this->size_y);
+    auto ready  = [&] {
+        if (this->slice.structure == FRAME)
+            return progress.rows[0] >= (needed + 1) / 2 && progress.rows[1] >= needed / 2;
+        return progress.rows[bottom] >= needed;
+    };
+
+    if (ready())
+        return;
+    std::unique_lock<std::mutex> lock(progress.mutex);
+    progress.cond.wait(lock, ready);
+}
+
+void storable_picture::publish_rows(int rows)
+{
+    if (!this->progress)
+        return;
+
+    row_progress_t& progress = *this->progress;
+    {
+        std::lock_guard<std::mutex> lock(progress.mutex);
+        if (this->slice.structure == FRAME) {
+            progress.rows[0] = (rows + 1) / 2;
+            progress.rows[1] = rows / 2;
+        } else
+            progress.rows[this->slice.structure == BOTTOM_FIELD ? 1 : 0] = rows;
     }
+    progress.cond.notify_all();
 }
 
 void storable_picture::decode_slice_datas()
@@ -149,6 +349,8 @@ void storable_picture::decode_slice_datas()
     VideoParameters* p_Vid = first_slice.p_Vid;
 
     if (p_Vid->pNextPPS->Valid && p_Vid->pNextPPS->pic_parameter_set_id == shr.pic_parameter_set_id) {
+        if (p_Vid->pipeline)
+            p_Vid->pipeline->drain();
         pps_t tmpPPS = p_Vid->PicParSet[shr.pic_parameter_set_id];
         p_Vid->PicParSet[p_Vid->pNextPPS->pic_parameter_set_id] = *(p_Vid->pNextPPS);
         *(p_Vid->pNextPPS) = tmpPPS;
@@ -171,69 +373,84 @@ void storable_picture::decode_slice_datas()
     p_Vid->p_Dpb_layer[first_slice.view_id]->init_picture_number(first_slice);
 #endif
 
-    for (slice_t* slice : this->slice_headers) {
-        slice->init();
-        slice->decode();
+    // Slices only predict from macroblocks of their own slice, so once every
+    // slice is set up their macroblocks can be decoded concurrently. Redundant
+    // slices overwrite the macroblocks of their primary and stay in order, and
+    // slice groups break the neighbour test on the slice start address.
+    // Slices with the same list defining header fields share the reference
+    // lists of the first of them.
+    bool concurrent = first_slice.active_pps->num_slice_groups_minus1 == 0;
+    for (size_t i = 0; i < this->slice_headers.size(); ++i) {
+        slice_t* slice = this->slice_headers[i];
+        const slice_t* same = nullptr;
+        for (size_t j = 0; j < i && !same; ++j) {
+            if (slice->same_ref_lists(*this->slice_headers[j]))
+                same = this->slice_headers[j];
+        }
+        slice->init(same);
+        concurrent = concurrent && slice->header.redundant_pic_cnt == 0;
+    }
+
+    // Pictures the pipeline takes are only parsed here, exit_picture() hands
+    // them on to its threads for reconstruction and deblocking
+    if (!p_Vid->pipeline || !p_Vid->pipeline->parse(this)) {
+        if (concurrent)
+            p_Vid->threads->run(this->slice_headers.size(), [this](int i) {
+                this->slice_headers[i]->decode();
+            });
+        else {
+            for (slice_t* slice : this->slice_headers)
+                slice->decode();
+        }
+    }
 
+    for (slice_t* slice : this->slice_headers)
         p_Vid->num_dec_mb += slice->num_dec_mb;
-    }
 }
 
-void pad_buf(px_t *pImgBuf, int iWidth, int iHeight, int iStride, int iPadX, int iPadY)
+// Pads the rows of a plane horizontally, the vertical padding being made of
+// row pointers to the edge rows.
+template <typename px_t>
+static void pad_buf(px_t *pImgBuf, int iWidth, int iHeight, int iStride, int iPadX)
 {
-    int j;
-    px_t *pLine0 = pImgBuf - iPadX, *pLine;
-    int i;
-    for (i = -iPadX; i < 0; i++)
-        pImgBuf[i] = *pImgBuf;
-    for (i = 0; i < iPadX; i++)
-        pImgBuf[i+iWidth] = *(pImgBuf+iWidth-1);
-
-    for (j = -iPadY; j < 0; j++)
-        memcpy(pLine0+j*iStride, pLine0, iStride*sizeof(px_t));
-    for (j = 1; j < iHeight; j++) {
-        pLine = pLine0 + j*iStride;
-        for (i = 0; i < iPadX; i++)
-            pLine[i] = pLine[iPadX];
-        pLine += iPadX+iWidth-1;
-        for (i = 1; i < iPadX + 1; i++)
-            pLine[i] = *pLine;
+    for (int j = 0; j < iHeight; j++) {
+        px_t* pLine = pImgBuf + j * iStride;
+        std::fill(pLine - iPadX, pLine, pLine[0]);
+        std::fill(pLine + iWidth, pLine + iWidth + iPadX, pLine[iWidth - 1]);
     }
-    pLine = pLine0 + (iHeight - 1) * iStride;
-    for (j = iHeight; j < iHeight + iPadY; j++)
-        memcpy(pLine0+j*iStride,  pLine, iStride*sizeof(px_t));
 }
 
-static void pad_dec_picture(VideoParameters *p_Vid, storable_picture *dec_picture)
+// Pads luma rows y0 to y1 - 1 and the chroma rows that go with them.
+void storable_picture::pad_rows(int y0, int y1)
 {
-    sps_t* sps = p_Vid->active_sps;
+    if (this->px_size == 1)
+        this->pad_rows<uint8_t >(y0, y1);
+    else
+        this->pad_rows<uint16_t>(y0, y1);
+}
 
-    int iPadX = MCBUF_LUMA_PAD_X;
-    int iPadY = MCBUF_LUMA_PAD_Y;
-    int iWidth = dec_picture->size_x;
-    int iHeight = dec_picture->size_y;
-    int iStride = dec_picture->iLumaStride;
+template <typename px_t>
+void storable_picture::pad_rows(int y0, int y1)
+{
+    pad_buf(this->img<px_t>(0)[y0], this->size_x, y1 - y0, this->iLumaStride, MCBUF_LUMA_PAD_X);
 
-    int iChromaPadX = MCBUF_CHROMA_PAD_X;
-    int iChromaPadY = MCBUF_CHROMA_PAD_Y;
-    if (sps->chroma_format_idc == CHROMA_FORMAT_422)
-        iChromaPadY = MCBUF_CHROMA_PAD_Y * 2;
-    else if (sps->chroma_format_idc == CHROMA_FORMAT_444) {
-        iChromaPadX = MCBUF_LUMA_PAD_X;
-        iChromaPadY = MCBUF_LUMA_PAD_Y;
+    if (this->pixels[1]) {
+        int y0_cr = y0 * this->size_y_cr / this->size_y;
+        int y1_cr = y1 * this->size_y_cr / this->size_y;
+        for (int uv = 0; uv < 2; ++uv)
+            pad_buf(this->img<px_t>(1 + uv)[y0_cr], this->size_x_cr, y1_cr - y0_cr, this->iChromaStride, this->iChromaPadX);
     }
+}
 
-    pad_buf(*dec_picture->imgY, iWidth, iHeight, iStride, iPadX, iPadY);
+// Without PadReferences motion compensation clamps the blocks that cross
+// the border of an unpadded reference instead.
+static void pad_dec_picture(VideoParameters *p_Vid, storable_picture *dec_picture)
+{
+    if (!p_Vid->p_Inp->pad_references)
+        return;
 
-    if (sps->chroma_format_idc != CHROMA_FORMAT_400) {
-        iPadX   = iChromaPadX;
-        iPadY   = iChromaPadY;
-        iWidth  = dec_picture->size_x_cr;
-        iHeight = dec_picture->size_y_cr;
-        iStride = dec_picture->iChromaStride;
-        pad_buf(*dec_picture->imgUV[0], iWidth, iHeight, iStride, iPadX, iPadY);
-        pad_buf(*dec_picture->imgUV[1], iWidth, iHeight, iStride, iPadX, iPadY);
-    }
+    dec_picture->pad_rows(0, dec_picture->size_y);
+    dec_picture->padded = true;
 }
 
 void exit_picture(VideoParameters *p_Vid)
@@ -246,17 +463,24 @@ void exit_picture(VideoParameters *p_Vid)
         (sps.chroma_format_idc != CHROMA_FORMAT_444 || !sps.separate_colour_plane_flag))
         return;
 
+    // reference pictures are padded row by row as the deblocking filter
+    // finishes them, or as a whole when it leaves them alone
+    bool pad = p_Vid->p_Inp->pad_references &&
+               (p_Vid->dec_picture->used_for_reference || p_Vid->dec_picture->slice.inter_view_flag == 1);
+    if (!p_Vid->pipeline || !p_Vid->pipeline->submit(p_Vid->dec_picture, pad)) {
 #if (DISABLE_ERC == 0)
-    p_Vid->erc_errorVar->erc_picture(p_Vid->dec_picture);
+        p_Vid->erc_errorVar->erc_picture(p_Vid->dec_picture);
 #endif
-
-    first_slice.decoder.deblock_filter(first_slice);
+        if (first_slice.decoder.deblock_filter(first_slice, p_Vid->dec_picture, pad))
+            p_Vid->dec_picture->padded = pad;
+        if (pad && !p_Vid->dec_picture->padded)
+            pad_dec_picture(p_Vid, p_Vid->dec_picture);
+        p_Vid->dec_picture->publish_rows(p_Vid->dec_picture->size_y);
+    }
 
     if (p_Vid->structure != FRAME)
         p_Vid->number /= 2;
 #if (MVC_EXTENSION_ENABLE)
-    if (p_Vid->dec_picture->used_for_reference || p_Vid->dec_picture->slice.inter_view_flag == 1)
-        pad_dec_picture(p_Vid, p_Vid->dec_picture);
     p_Vid->p_Dpb_layer[p_Vid->dec_picture->slice.view_id]->store_picture(p_Vid->dec_picture);
 #endif
 
@@ -268,6 +492,16 @@ void exit_picture(VideoParameters *p_Vid)
     p_Vid->dec_picture = nullptr;
 }
 
+// Frees a picture, once the pipeline threads are done with every picture
+// handed to them so far.
+void release_picture(VideoParameters *p_Vid, storable_picture *p)
+{
+    if (p_Vid->pipeline)
+        p_Vid->pipeline->retire(p);
+    else
+        delete p;
+}
+
 
 
 picture_t::~picture_t()
@@ -295,20 +529,12 @@ void picture_t::unmark_for_reference()
     }
     this->is_reference = 0;
 
-    if (this->frame) {
-        delete []this->frame->motion.mb_field_decoding_flag;
+    if (this->frame)
         this->frame->motion.mb_field_decoding_flag = nullptr;
-    }
-
-    if (this->top_field) {
-        delete []this->top_field->motion.mb_field_decoding_flag;
+    if (this->top_field)
         this->top_field->motion.mb_field_decoding_flag = nullptr;
-    }
-
-    if (this->bottom_field) {
-        delete []this->bottom_field->motion.mb_field_decoding_flag;
+    if (this->bottom_field)
         this->bottom_field->motion.mb_field_decoding_flag = nullptr;
-    }
 }
 
 void picture_t::unmark_for_long_term_reference()
@@ -415,26 +641,10 @@ void picture_t::dpb_split_field(VideoParameters* p_Vid)
     this->poc = frame->poc;
 
     if (!p_Vid->active_sps->frame_mbs_only_flag) {
-        fs_top = this->top_field    = new storable_picture(p_Vid, TOP_FIELD,
-            frame->size_x, frame->size_y, frame->size_x_cr, frame->size_y_cr, 1);
-        fs_btm = this->bottom_field = new storable_picture(p_Vid, BOTTOM_FIELD,
-            frame->size_x, frame->size_y, frame->size_x_cr, frame->size_y_cr, 1);
-
-        for (int i = 0; i < (frame->size_y >> 1); i++)
-            memcpy(fs_top->imgY[i], frame->imgY[i * 2], frame->size_x * sizeof(px_t));
-
-        for (int i = 0; i < (frame->size_y_cr >> 1); i++) {
-            memcpy(fs_top->imgUV[0][i], frame->imgUV[0][i * 2], frame->size_x_cr * sizeof(px_t));
-            memcpy(fs_top->imgUV[1][i], frame->imgUV[1][i * 2], frame->size_x_cr * sizeof(px_t));
-        }
-
-        for (int i = 0; i < (frame->size_y >> 1); i++)
-            memcpy(fs_btm->imgY[i], frame->imgY[i * 2 + 1], frame->size_x * sizeof(px_t));
-
-        for (int i = 0; i < (frame->size_y_cr >> 1); i++) {
-            memcpy(fs_btm->imgUV[0][i], frame->imgUV[0][i * 2 + 1], frame->size_x_cr * sizeof(px_t));
-            memcpy(fs_btm->imgUV[1][i], frame->imgUV[1][i * 2 + 1], frame->size_x_cr * sizeof(px_t));
-        }
+        // the fields address every other row of the (padded) frame
+        fs_top = this->top_field    = new storable_picture(p_Vid, TOP_FIELD,    frame);
+        fs_btm = this->bottom_field = new storable_picture(p_Vid, BOTTOM_FIELD, frame);
+        fs_top->padded = fs_btm->padded = frame->padded;
 
         fs_top->sps = frame->sps;
         fs_top->pps = frame->pps;
@@ -476,11 +686,6 @@ void picture_t::dpb_split_field(VideoParameters* p_Vid)
         fs_top->slice.inter_view_flag = this->inter_view_flag[0];
         fs_btm->slice.inter_view_flag = this->inter_view_flag[1];
 #endif
-
-        if (frame->used_for_reference) {
-            pad_dec_picture(p_Vid, fs_top);
-            pad_dec_picture(p_Vid, fs_btm);
-        }
     } else {
         this->top_field     = NULL;
         this->bottom_field  = NULL;
@@ -508,31 +713,31 @@ void picture_t::dpb_split_field(VideoParameters* p_Vid)
                         fs_btm->mv_info[j][i].mv[LIST_0] = frame->mv_info[jj4][i].mv[LIST_0];
                         fs_btm->mv_info[j][i].mv[LIST_1] = frame->mv_info[jj4][i].mv[LIST_1];
                         fs_btm->mv_info[j][i].ref_idx[LIST_0] = frame->mv_info[jj4][i].ref_idx[LIST_0];
-                        fs_btm->mv_info[j][i].ref_pic[LIST_0] = NULL;
+                        fs_btm->mv_info[j][i].ref_pic_id[LIST_0] = 0;
                         if (fs_btm->mv_info[j][i].ref_idx[LIST_0] >= 0) {
                             int ref_idx = fs_btm->mv_info[j][i].ref_idx[LIST_0];
-                            fs_btm->mv_info[j][i].ref_pic[LIST_0] = ref_idx % 2 ? RefPicList0[ref_idx / 2]->top_field : RefPicList0[ref_idx / 2]->bottom_field;
+                            fs_btm->mv_info[j][i].ref_pic_id[LIST_0] = fs_btm->ref_pic_id(ref_idx % 2 ? RefPicList0[ref_idx / 2]->top_field : RefPicList0[ref_idx / 2]->bottom_field);
                         }
                         fs_btm->mv_info[j][i].ref_idx[LIST_1] = frame->mv_info[jj4][i].ref_idx[LIST_1];
-                        fs_btm->mv_info[j][i].ref_pic[LIST_1] = NULL;
+                        fs_btm->mv_info[j][i].ref_pic_id[LIST_1] = 0;
                         if (fs_btm->mv_info[j][i].ref_idx[LIST_1] >= 0) {
                             int ref_idx = fs_btm->mv_info[j][i].ref_idx[LIST_1];
-                            fs_btm->mv_info[j][i].ref_pic[LIST_1] = ref_idx % 2 ? RefPicList1[ref_idx / 2]->top_field : RefPicList1[ref_idx / 2]->bottom_field;
+                            fs_btm->mv_info[j][i].ref_pic_id[LIST_1] = fs_btm->ref_pic_id(ref_idx % 2 ? RefPicList1[ref_idx / 2]->top_field : RefPicList1[ref_idx / 2]->bottom_field);
                         }
           
                         fs_top->mv_info[j][i].mv[LIST_0] = frame->mv_info[jj][i].mv[LIST_0];
                         fs_top->mv_info[j][i].mv[LIST_1] = frame->mv_info[jj][i].mv[LIST_1];
                         fs_top->mv_info[j][i].ref_idx[LIST_0] = frame->mv_info[jj][i].ref_idx[LIST_0];
-                        fs_top->mv_info[j][i].ref_pic[LIST_0] = NULL;
+                        fs_top->mv_info[j][i].ref_pic_id[LIST_0] = 0;
                         if (fs_top->mv_info[j][i].ref_idx[LIST_0] >= 0) {
                             int ref_idx = fs_top->mv_info[j][i].ref_idx[LIST_0];
-                            fs_top->mv_info[j][i].ref_pic[LIST_0] = ref_idx % 2 ? RefPicList0[ref_idx / 2]->bottom_field : RefPicList0[ref_idx / 2]->top_field;
+                            fs_top->mv_info[j][i].ref_pic_id[LIST_0] = fs_top->ref_pic_id(ref_idx % 2 ? RefPicList0[ref_idx / 2]->bottom_field : RefPicList0[ref_idx / 2]->top_field);
                         }
                         fs_top->mv_info[j][i].ref_idx[LIST_1] = frame->mv_info[jj][i].ref_idx[LIST_1];
-                        fs_top->mv_info[j][i].ref_pic[LIST_1] = NULL;
+                        fs_top->mv_info[j][i].ref_pic_id[LIST_1] = 0;
                         if (fs_top->mv_info[j][i].ref_idx[LIST_1] >= 0) {
                             int ref_idx = fs_top->mv_info[j][i].ref_idx[LIST_1];
-                            fs_top->mv_info[j][i].ref_pic[LIST_1] = ref_idx % 2 ? RefPicList1[ref_idx / 2]->bottom_field : RefPicList1[ref_idx / 2]->top_field;
+                            fs_top->mv_info[j][i].ref_pic_id[LIST_1] = fs_top->ref_pic_id(ref_idx % 2 ? RefPicList1[ref_idx / 2]->bottom_field : RefPicList1[ref_idx / 2]->top_field);
                         }
                     }
                 }
@@ -556,18 +761,22 @@ void picture_t::dpb_split_field(VideoParameters* p_Vid)
                     // Scaling of references is done here since it will not affect spatial direct (2*0 =0)
                     if (frame->mv_info[jj][ii].ref_idx[LIST_0] == -1) {
                         fs_top->mv_info[j][i].ref_idx[LIST_0] = fs_btm->mv_info[j][i].ref_idx[LIST_0] = - 1;
-                        fs_top->mv_info[j][i].ref_pic[LIST_0] = fs_btm->mv_info[j][i].ref_pic[LIST_0] = NULL;
+                        fs_top->mv_info[j][i].ref_pic_id[LIST_0] = fs_btm->mv_info[j][i].ref_pic_id[LIST_0] = 0;
                     } else {
                         fs_top->mv_info[j][i].ref_idx[LIST_0] = fs_btm->mv_info[j][i].ref_idx[LIST_0] = frame->mv_info[jj][ii].ref_idx[LIST_0];
-                        fs_top->mv_info[j][i].ref_pic[LIST_0] = fs_btm->mv_info[j][i].ref_pic[LIST_0] = p_Vid->ppSliceList[frame->mv_info[jj][ii].slice_no]->RefPicList[LIST_0][(short) frame->mv_info[jj][ii].ref_idx[LIST_0]];
+                        storable_picture* ref_pic = p_Vid->ppSliceList[frame->mv_info[jj][ii].slice_no]->RefPicList[LIST_0][(short) frame->mv_info[jj][ii].ref_idx[LIST_0]];
+                        fs_top->mv_info[j][i].ref_pic_id[LIST_0] = fs_top->ref_pic_id(ref_pic);
+                        fs_btm->mv_info[j][i].ref_pic_id[LIST_0] = fs_btm->ref_pic_id(ref_pic);
                     }
 
                     if (frame->mv_info[jj][ii].ref_idx[LIST_1] == -1) {
                         fs_top->mv_info[j][i].ref_idx[LIST_1] = fs_btm->mv_info[j][i].ref_idx[LIST_1] = - 1;
-                        fs_top->mv_info[j][i].ref_pic[LIST_1] = fs_btm->mv_info[j][i].ref_pic[LIST_1] = NULL;
+                        fs_top->mv_info[j][i].ref_pic_id[LIST_1] = fs_btm->mv_info[j][i].ref_pic_id[LIST_1] = 0;
                     } else {
                         fs_top->mv_info[j][i].ref_idx[LIST_1] = fs_btm->mv_info[j][i].ref_idx[LIST_1] = frame->mv_info[jj][ii].ref_idx[LIST_1];
-                        fs_top->mv_info[j][i].ref_pic[LIST_1] = fs_btm->mv_info[j][i].ref_pic[LIST_1] = p_Vid->ppSliceList[frame->mv_info[jj][ii].slice_no]->RefPicList[LIST_1][(short) frame->mv_info[jj][ii].ref_idx[LIST_1]];
+                        storable_picture* ref_pic = p_Vid->ppSliceList[frame->mv_info[jj][ii].slice_no]->RefPicList[LIST_1][(short) frame->mv_info[jj][ii].ref_idx[LIST_1]];
+                        fs_top->mv_info[j][i].ref_pic_id[LIST_1] = fs_top->ref_pic_id(ref_pic);
+                        fs_btm->mv_info[j][i].ref_pic_id[LIST_1] = fs_btm->ref_pic_id(ref_pic);
                     }
                 }
             }
@@ -575,23 +784,43 @@ void picture_t::dpb_split_field(VideoParameters* p_Vid)
     }
 }
 
-void picture_t::dpb_combine_field_yuv(VideoParameters* p_Vid)
+template <typename px_t>
+static void copy_field_rows(storable_picture* frame, storable_picture* field)
 {
-    if (!this->frame)
-        this->frame = new storable_picture(p_Vid, FRAME,
-            this->top_field->size_x, this->top_field->size_y * 2,
-            this->top_field->size_x_cr, this->top_field->size_y_cr * 2, 1);
+    int bottom = field->slice.structure == BOTTOM_FIELD ? 1 : 0;
+    for (int pl = 0; pl < 3 && field->pixels[pl]; pl++) {
+        int size_x = pl ? field->size_x_cr : field->size_x;
+        int size_y = pl ? field->size_y_cr : field->size_y;
+        px_t** frm = frame->img<px_t>(pl);
+        px_t** fld = field->img<px_t>(pl);
+        for (int i = 0; i < size_y; i++)
+            memcpy(frm[i * 2 + bottom], fld[i], size_x * sizeof(px_t));
+    }
+}
 
-    for (int i = 0; i < this->top_field->size_y; i++) {
-        memcpy(this->frame->imgY[i*2],     this->top_field->imgY[i]   , this->top_field->size_x * sizeof(px_t));     // top field
-        memcpy(this->frame->imgY[i*2 + 1], this->bottom_field->imgY[i], this->bottom_field->size_x * sizeof(px_t)); // bottom field
+void picture_t::dpb_combine_field_yuv(VideoParameters* p_Vid)
+{
+    // Fields decoded into the same planes make up the frame as they are,
+    // fields from different planes are copied into a frame of their own.
+    if (!this->frame) {
+        if (this->top_field->planes == this->bottom_field->planes) {
+            this->frame = new storable_picture(p_Vid, FRAME, this->top_field);
+            if (!this->frame->progress)
+                this->frame->progress = this->bottom_field->progress;
+        } else
+            this->frame = new storable_picture(p_Vid, FRAME,
+                this->top_field->size_x, this->top_field->size_y * 2,
+                this->top_field->size_x_cr, this->top_field->size_y_cr * 2, 1);
     }
 
-    for (int j = 0; j < 2; j++) {
-        for (int i = 0; i < this->top_field->size_y_cr; i++) {
-            memcpy(this->frame->imgUV[j][i*2],     this->top_field->imgUV[j][i],    this->top_field->size_x_cr*sizeof(px_t));
-            memcpy(this->frame->imgUV[j][i*2 + 1], this->bottom_field->imgUV[j][i], this->bottom_field->size_x_cr*sizeof(px_t));
-        }
+    for (storable_picture* field : {this->top_field, this->bottom_field}) {
+        if (field->planes == this->frame->planes)
+            continue;
+        field->wait_decoded();
+        if (field->px_size == 1)
+            copy_field_rows<uint8_t >(this->frame, field);
+        else
+            copy_field_rows<uint16_t>(this->frame, field);
     }
 
     this->poc = this->frame->poc = this->frame->frame_poc = min(this->top_field->poc, this->bottom_field->poc);
@@ -616,8 +845,15 @@ void picture_t::dpb_combine_field_yuv(VideoParameters* p_Vid)
     this->top_field->bottom_field    = this->bottom_field;
     this->bottom_field->top_field    = this->top_field;
     this->bottom_field->bottom_field = this->bottom_field;
-    if (this->top_field->used_for_reference || this->bottom_field->used_for_reference)
+
+    // reference fields have padded their rows of shared planes already
+    if (this->top_field->planes == this->frame->planes && this->bottom_field->planes == this->frame->planes)
+        this->frame->padded = this->top_field->padded && this->bottom_field->padded;
+    if ((this->top_field->used_for_reference || this->bottom_field->used_for_reference) && !this->frame->padded) {
+        this->top_field->wait_decoded();
+        this->bottom_field->wait_decoded();
         pad_dec_picture(p_Vid, this->frame);
+    }
 }
 
 void picture_t::dpb_combine_field(VideoParameters* p_Vid)
@@ -642,10 +878,10 @@ void picture_t::dpb_combine_field(VideoParameters* p_Vid)
             this->frame->mv_info[jj][i].ref_idx[LIST_1] = mv_info_t.ref_idx[LIST_1];
 
             /* bug: top field list doesnot exist.*/
-            this->frame->mv_info[jj][i].ref_pic[LIST_0] = mv_info_t.ref_idx[LIST_0] >= 0 ?
-                p_Vid->ppSliceList[mv_info_t.slice_no]->RefPicList[LIST_0][(int)mv_info_t.ref_idx[LIST_0]] : NULL;
-            this->frame->mv_info[jj][i].ref_pic[LIST_1] = mv_info_t.ref_idx[LIST_1] >= 0 ?
-                p_Vid->ppSliceList[mv_info_t.slice_no]->RefPicList[LIST_1][(int)mv_info_t.ref_idx[LIST_1]] : NULL;
+            this->frame->mv_info[jj][i].ref_pic_id[LIST_0] = this->frame->ref_pic_id(mv_info_t.ref_idx[LIST_0] >= 0 ?
+                p_Vid->ppSliceList[mv_info_t.slice_no]->RefPicList[LIST_0][(int)mv_info_t.ref_idx[LIST_0]] : nullptr);
+            this->frame->mv_info[jj][i].ref_pic_id[LIST_1] = this->frame->ref_pic_id(mv_info_t.ref_idx[LIST_1] >= 0 ?
+                p_Vid->ppSliceList[mv_info_t.slice_no]->RefPicList[LIST_1][(int)mv_info_t.ref_idx[LIST_1]] : nullptr);
 
             //! association with id already known for fields.
             auto& mv_info_b = this->bottom_field->mv_info[j][i];
@@ -654,10 +890,10 @@ void picture_t::dpb_combine_field(VideoParameters* p_Vid)
             this->frame->mv_info[jj4][i].ref_idx[LIST_0] = mv_info_b.ref_idx[LIST_0];
             this->frame->mv_info[jj4][i].ref_idx[LIST_1] = mv_info_b.ref_idx[LIST_1];
 
-            this->frame->mv_info[jj4][i].ref_pic[LIST_0] = mv_info_b.ref_idx[LIST_0] >= 0 ?
-                p_Vid->ppSliceList[mv_info_b.slice_no]->RefPicList[LIST_0][(int)mv_info_b.ref_idx[LIST_0]] : NULL;
-            this->frame->mv_info[jj4][i].ref_pic[LIST_1] = mv_info_b.ref_idx[LIST_1] >= 0 ?
-                p_Vid->ppSliceList[mv_info_b.slice_no]->RefPicList[LIST_1][(int)mv_info_b.ref_idx[LIST_1]] : NULL;
+            this->frame->mv_info[jj4][i].ref_pic_id[LIST_0] = this->frame->ref_pic_id(mv_info_b.ref_idx[LIST_0] >= 0 ?
+                p_Vid->ppSliceList[mv_info_b.slice_no]->RefPicList[LIST_0][(int)mv_info_b.ref_idx[LIST_0]] : nullptr);
+            this->frame->mv_info[jj4][i].ref_pic_id[LIST_1] = this->frame->ref_pic_id(mv_info_b.ref_idx[LIST_1] >= 0 ?
+                p_Vid->ppSliceList[mv_info_b.slice_no]->RefPicList[LIST_1][(int)mv_info_b.ref_idx[LIST_1]] : nullptr);
         }
     }
 }
@@ -2,7 +2,11 @@
 #define _FRAME_BUFFER_H_
 
 
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 
@@ -63,13 +67,23 @@ struct pic_motion_params_old {
     bool*       mb_field_decoding_flag;
 };
 
+// Motion of one 4x4 block. References are kept as ids into the ref_pics
+// table of the picture holding the motion field, 0 standing for none.
 struct pic_motion_params {
-    storable_picture* ref_pic[2];
     mv_t        mv[2];
-    char        ref_idx[2];
+    int8_t      ref_idx[2];
+    uint8_t     ref_pic_id[2];
     uint8_t     slice_no;
 };
 
+// 4x4 block motion of a picture stored row after row, indexed as [y][x].
+struct motion_field_t {
+    pic_motion_params* data;
+    int         stride;
+
+    pic_motion_params* operator [] (int y) const { return this->data + y * this->stride; }
+};
+
 struct decoded_reference_picture_marking_t;
 using drpm_t = decoded_reference_picture_marking_t;
 
@@ -79,14 +93,24 @@ struct macroblock_t;
 }}
 using mb_t = vio::h264::macroblock_t;
 
+// Rows of each field parity of a picture that are decoded, deblocked and
+// padded, for pictures still being decoded on the pipeline threads. Fields
+// sharing the planes of a frame share one of these.
+struct row_progress_t {
+    std::atomic<int>        rows[2];
+    std::mutex              mutex;
+    std::condition_variable cond;
+
+    row_progress_t() { rows[0] = rows[1] = 0; }
+};
+
 
 struct storable_picture {
     sps_t*                sps;
     pps_t*                pps;
     std::vector<slice_t*> slice_headers;
     std::vector<mb_t*>    mbs;
-    pic_motion_params**   mv_infos;
-    px_t**                pixels[3];
+    void*                 pixels[3];             //!< row pointers of the Y, U and V planes
 
     int         poc;
     int         top_poc;
@@ -125,11 +149,14 @@ struct storable_picture {
     int         iChromaStride;
     int         iChromaPadX;
     int         iChromaPadY;
-    px_t**      imgY;
-    px_t**      imgUV[2];
+    bool        padded;                          //!< left and right borders repeat the edge samples
+    int         px_size;                         //!< bytes per sample, 1 up to 8 bit depth and 2 above
+
+    motion_field_t mv_info;
+    motion_field_t JVmv_info[3];
 
-    pic_motion_params** mv_info;
-    pic_motion_params** JVmv_info[3];
+    storable_picture* ref_pics[256];             //!< pictures referenced by the motion field
+    int         num_ref_pics;
 
     pic_motion_params_old motion;
     pic_motion_params_old JVmotion[3];
@@ -145,17 +172,65 @@ struct storable_picture {
     int         seiHasTone_mapping;
     int         tone_mapping_model_id;
     int         tonemapped_bit_depth;  
-    px_t*       tone_mapping_lut;                //!< tone mapping look up table
+    uint16_t*   tone_mapping_lut;                //!< tone mapping look up table
 
     bool        is_short_ref();
     bool        is_long_ref();
 
+    uint8_t     ref_pic_id(storable_picture* ref_pic);
+
+    // rows of plane pl, px_t being uint8_t or uint16_t as px_size says
+    template <typename px_t>
+    px_t**      img(int pl) const { return static_cast<px_t**>(this->pixels[pl]); }
+
     void        clear();
+    void        pad_rows(int y0, int y1);
+
+    // blocks until the first rows rows of the picture can be read, pictures
+    // without progress being complete
+    void        wait_rows(int rows) const { if (this->progress) this->wait_progress(rows); }
+    void        wait_decoded() const { this->wait_rows(this->size_y); }
+    void        publish_rows(int rows);
 
     storable_picture(VideoParameters *p_Vid, PictureStructure type, int size_x, int size_y, int size_x_cr, int size_y_cr, int is_output);
+    storable_picture(VideoParameters *p_Vid, PictureStructure type, storable_picture* owner);
     ~storable_picture();
 
     void decode_slice_datas();
+
+    std::shared_ptr<uint8_t> planes;             //!< frame sized planes, shared by the frame and its fields
+    std::shared_ptr<row_progress_t> progress;    //!< decoded rows of pictures from the pipeline, nullptr for the others
+
+private:
+    void        wait_progress(int rows) const;
+
+    template <typename px_t>
+    void        init(VideoParameters *p_Vid, PictureStructure type, int size_x, int size_y, int size_x_cr, int size_y_cr, px_t* origin[3]);
+    template <typename px_t>
+    void        init_view(VideoParameters *p_Vid, PictureStructure type, storable_picture* owner, int size_y, int size_y_cr, int field, int bottom);
+    template <typename px_t>
+    void        clear();
+    template <typename px_t>
+    void        pad_rows(int y0, int y1);
+
+    picture_pool_t* pool;
+    void*       buffer;                          //!< row pointers and motion info
+    size_t      buffer_size;
+};
+
+// Keeps the buffers of released pictures for reuse by pictures of the same
+// layout, so that decoding a sequence allocates only until the DPB, output
+// and the picture being decoded hold their steady-state number of pictures.
+struct picture_pool_t {
+    ~picture_pool_t();
+
+    void*       acquire(size_t size);
+    void        release(void* buffer, size_t size);
+    void        clear();
+
+private:
+    std::mutex  mutex;
+    std::vector<std::pair<size_t, void*>> buffers;
 };
 
 struct picture_t {
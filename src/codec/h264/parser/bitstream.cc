@@ -23,8 +23,14 @@
 
 #include <fcntl.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <utility>
 
 #include "memalloc.h"
 #include "bitstream.h"
@@ -37,13 +43,13 @@ namespace h264 {
 
 static void nal_unit_header_mvc_extension(nal_unit_t& nal)
 {
-    nal.non_idr_flag     = (nal.rbsp_byte[1] >> 6) & 1;
-    nal.priority_id      = (nal.rbsp_byte[1]     ) & 63;
-    nal.view_id          = (nal.rbsp_byte[2] << 2) | ((nal.rbsp_byte[3] >> 6) & 3);
-    nal.temporal_id      = (nal.rbsp_byte[3] >> 3) & 7;
-    nal.anchor_pic_flag  = (nal.rbsp_byte[3] >> 2) & 1;
-    nal.inter_view_flag  = (nal.rbsp_byte[3] >> 1) & 1;
-    nal.reserved_one_bit = (nal.rbsp_byte[3]     ) & 1;
+    nal.non_idr_flag     = (nal.nal_unit_byte[1] >> 6) & 1;
+    nal.priority_id      = (nal.nal_unit_byte[1]     ) & 63;
+    nal.view_id          = (nal.nal_unit_byte[2] << 2) | ((nal.nal_unit_byte[3] >> 6) & 3);
+    nal.temporal_id      = (nal.nal_unit_byte[3] >> 3) & 7;
+    nal.anchor_pic_flag  = (nal.nal_unit_byte[3] >> 2) & 1;
+    nal.inter_view_flag  = (nal.nal_unit_byte[3] >> 1) & 1;
+    nal.reserved_one_bit = (nal.nal_unit_byte[3]     ) & 1;
 
     if (nal.reserved_one_bit != 1)
         printf("Nalu Header MVC Extension: reserved_one_bit is not 1!\n");
@@ -61,15 +67,15 @@ static void nal_unit_header_svc_extension(nal_unit_t& nal)
 
 static void nal_unit(nal_unit_t& nal)
 {
-    nal.forbidden_zero_bit = (nal.rbsp_byte[0] >> 7) & 1;
-    nal.nal_ref_idc        = (nal.rbsp_byte[0] >> 5) & 3;
-    nal.nal_unit_type      = (nal.rbsp_byte[0] & 0x1f);
+    nal.forbidden_zero_bit = (nal.nal_unit_byte[0] >> 7) & 1;
+    nal.nal_ref_idc        = (nal.nal_unit_byte[0] >> 5) & 3;
+    nal.nal_unit_type      = (nal.nal_unit_byte[0] & 0x1f);
 
     nal.mvc_extension_flag = 0;
     nal.svc_extension_flag = 0;
 
     if (nal.nal_unit_type == 14 || nal.nal_unit_type == 20 || nal.nal_unit_type == 21) {
-        nal.svc_extension_flag = (nal.rbsp_byte[1] >> 7) & 1;
+        nal.svc_extension_flag = (nal.nal_unit_byte[1] >> 7) & 1;
         nal.mvc_extension_flag = ~nal.svc_extension_flag;
         if (nal.svc_extension_flag)
             nal_unit_header_svc_extension(nal);
@@ -78,59 +84,64 @@ static void nal_unit(nal_unit_t& nal)
     }
 }
 
-static int NALUtoRBSP(nal_unit_t& nal)
+// 7.4.1 Locates the emulation_prevention_three_bytes, which are dropped when
+// an Interpreter takes the RBSP. Only the zero bytes are visited, so a NAL
+// unit without 00 00 03 is scanned once and referred to in place.
+
+static int find_emulation_prevention(nal_unit_t& nal)
 {
     int nalUnitHeaderBytes = 1;
     if (nal.nal_unit_type == 14 || nal.nal_unit_type == 20 || nal.nal_unit_type == 21)
         nalUnitHeaderBytes += 3;
 
+    nal.emulation_prevention.clear();
     if (nal.num_bytes_in_nal_unit < nalUnitHeaderBytes)
-        return nal.num_bytes_in_rbsp = nal.num_bytes_in_nal_unit;
+        return 0;
 
-    int count = 0;
-    int j = nalUnitHeaderBytes;
+    const uint8_t* begin = nal.nal_unit_byte;
+    const uint8_t* end   = begin + nal.num_bytes_in_nal_unit;
+    const uint8_t* p     = begin + nalUnitHeaderBytes;
 
-    for (int i = nalUnitHeaderBytes; i < nal.num_bytes_in_nal_unit; ++i) {
-        //starting from begin_bytepos to avoid header information
+    while ((p = (const uint8_t*)memchr(p, 0x00, end - p)) != nullptr && p + 2 < end) {
+        if (p[1] != 0x00) {
+            p += 2;
+            continue;
+        }
         //in NAL unit, 0x000000, 0x000001 or 0x000002 shall not occur at any byte-aligned position
-        if (count == 2 && nal.rbsp_byte[i] < 0x03)
-            return nal.num_bytes_in_rbsp = -1;
-        if (count == 2 && nal.rbsp_byte[i] == 0x03) {
-            //check the 4th byte after 0x000003, except when cabac_zero_word is used, in which case the last three bytes of this NAL unit must be 0x000003
-            if (i < nal.num_bytes_in_nal_unit - 1 && nal.rbsp_byte[i + 1] > 0x03)
-                return nal.num_bytes_in_rbsp = -1;
-            //if cabac_zero_word is used, the final byte of this NAL unit(0x03) is discarded, and the last two bytes of RBSP must be 0x0000
-            if (i == nal.num_bytes_in_nal_unit - 1)
-                return nal.num_bytes_in_rbsp = j;
-
-            ++i;
-            count = 0;
+        if (p[2] < 0x03)
+            return -1;
+        if (p[2] > 0x03) {
+            p += 3;
+            continue;
         }
-        nal.rbsp_byte[j] = nal.rbsp_byte[i];
-        if (nal.rbsp_byte[i] == 0x00)
-            ++count;
-        else
-            count = 0;
-        ++j;
+        //check the 4th byte after 0x000003, except when cabac_zero_word is used, in which case the last three bytes of this NAL unit must be 0x000003
+        if (p + 3 < end && p[3] > 0x03)
+            return -1;
+
+        nal.emulation_prevention.push_back(p + 2 - begin);
+        p += 3;
     }
 
-    return nal.num_bytes_in_rbsp = j;
+    return 0;
 }
 
 
+// The byte stream is mapped whole when it is a regular file and NAL units refer
+// to it in place. Otherwise it is read into a window that grows to hold at least
+// one complete NAL unit, and each NAL unit is copied out of the window.
+
 struct annex_b_t {
     static const int MAX_IOBUF_SIZE = 512 * 1024;
 
     int         BitStreamFile;
     bool        is_eof;
+    bool        is_mapped;
+    uint32_t    max_size;
     size_t      iobuf_size;
     uint8_t*    iobuf_data;
     size_t      rdbuf_size;
     uint8_t*    rdbuf_data;
 
-    int32_t     nextstartcodebytes;
-    uint8_t*    Buf;
-
                 annex_b_t(uint32_t max_size);
                 ~annex_b_t();
 
@@ -141,23 +152,24 @@ struct annex_b_t {
     annex_b_t& operator>>(nal_unit_t& nal);
     uint32_t    get_nalu(nal_unit_t& nal);
 
-    inline uint32_t getChunk();
-    inline uint8_t  getfbyte();
-    inline bool     FindStartCode(uint8_t* Buf, uint32_t zeros_in_startcode);
+    inline bool getChunk();
+    inline const uint8_t* FindStartCode(const uint8_t* Buf, const uint8_t* BufEnd);
 };
 
 
 annex_b_t::annex_b_t(uint32_t max_size)
 {
     this->is_eof = false;
+    this->is_mapped = false;
+    this->max_size = max_size;
     this->iobuf_size = 0;
     this->iobuf_data = nullptr;
-    this->Buf = new uint8_t[max_size];
+    this->rdbuf_size = 0;
+    this->rdbuf_data = nullptr;
 }
 
 annex_b_t::~annex_b_t()
 {
-    delete this->Buf;
 }
 
 
@@ -168,26 +180,43 @@ void annex_b_t::open(const char* fn)
     if ((this->BitStreamFile = ::open(fn, O_RDONLY)) == -1)
         error(500, "Cannot open Annex B ByteStream file '%s'", fn);
 
-    this->is_eof = false;
+    struct stat st;
+    if (::fstat(this->BitStreamFile, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, this->BitStreamFile, 0);
+        if (data != MAP_FAILED) {
+            ::madvise(data, st.st_size, MADV_SEQUENTIAL);
+            this->is_mapped  = true;
+            this->iobuf_size = st.st_size;
+            this->iobuf_data = (uint8_t*)data;
+            this->reset();
+            return;
+        }
+    }
+
+    this->is_mapped  = false;
     this->iobuf_size = annex_b_t::MAX_IOBUF_SIZE * sizeof(uint8_t);
     this->iobuf_data = new uint8_t[this->iobuf_size];
-    this->getChunk();
+    this->reset();
 }
 
 void annex_b_t::close()
 {
+    if (this->is_mapped)
+        ::munmap(this->iobuf_data, this->iobuf_size);
+    else
+        delete []this->iobuf_data;
+    this->iobuf_data = NULL;
+
     if (this->BitStreamFile != -1) {
         ::close(this->BitStreamFile);
         this->BitStreamFile = -1;
     }
-    delete this->iobuf_data;
-    this->iobuf_data = NULL;
 }
 
 void annex_b_t::reset()
 {
-    this->is_eof     = false;
-    this->rdbuf_size = 0;
+    this->is_eof     = this->is_mapped;
+    this->rdbuf_size = this->is_mapped ? this->iobuf_size : 0;
     this->rdbuf_data = this->iobuf_data;
 }
 
@@ -200,130 +229,215 @@ annex_b_t& annex_b_t::operator>>(nal_unit_t& nal)
 
 uint32_t annex_b_t::get_nalu(nal_unit_t& nal)
 {
-    uint32_t pos = 0;
-    uint8_t* pBuf = this->Buf;
-    //uint8_t* pBuf = nal.buf;
+    size_t pos = 0;
 
-    if (this->nextstartcodebytes != 0) {
-        for (int i = 0; i < this->nextstartcodebytes - 1; ++i) {
-            *pBuf++ = 0;
-            pos++;
-        }
-        *pBuf++ = 1;
-        pos++;
-    } else {
-        while (!this->is_eof) {
+    // leading_zero_8bits, zero_byte and start_code_prefix_one_3bytes
+    while (true) {
+        while (pos < this->rdbuf_size && this->rdbuf_data[pos] == 0)
             pos++;
-            if ((*pBuf++ = this->getfbyte()) != 0)
-                break;
-        }
+        if (pos < this->rdbuf_size || !this->getChunk())
+            break;
     }
 
-    if (this->is_eof) {
+    if (pos == this->rdbuf_size) {
+        this->rdbuf_data += pos;
+        this->rdbuf_size  = 0;
         nal.num_bytes_in_nal_unit = pos == 0 ? 0 : -1;
         return nal.num_bytes_in_nal_unit;
     }
 
-    if (*(pBuf - 1) != 1 || pos < 3) {
+    if (this->rdbuf_data[pos] != 1 || pos < 2) {
         nal.num_bytes_in_nal_unit = -1;
         return nal.num_bytes_in_nal_unit;
     }
 
-    int LeadingZero8BitsCount = pos;
-    bool info2 = false, info3 = false;
-
-    //pBuf = nal.buf;
-
-    bool StartCodeFound = false;
-    while (!StartCodeFound) {
-        if (this->is_eof) {
-            pBuf -= 2;
-            while (*pBuf-- == 0)
-                pos--;
-
-            nal.num_bytes_in_nal_unit = (pos - 1) - LeadingZero8BitsCount;
-            memcpy(nal.rbsp_byte, this->Buf + LeadingZero8BitsCount, nal.num_bytes_in_nal_unit);
-            this->nextstartcodebytes = 0;
-            nal_unit(nal);
-            return pos - 1;
+    // the NAL unit runs up to the next start code prefix, or to the end of the stream
+    size_t begin = pos + 1;
+    size_t end;
+    size_t from = begin;
+    while (true) {
+        const uint8_t* next = this->FindStartCode(this->rdbuf_data + from, this->rdbuf_data + this->rdbuf_size);
+        if (next) {
+            end = next - this->rdbuf_data;
+            break;
+        }
+        from = max(begin, this->rdbuf_size - min<size_t>(this->rdbuf_size, 2));
+        if (!this->getChunk()) {
+            end = this->rdbuf_size;
+            break;
         }
-
-        pos++;
-        *pBuf++ = this->getfbyte();
-        info3 = this->FindStartCode(pBuf - 4, 3);
-        if (!info3) {
-            info2 = this->FindStartCode(pBuf - 3, 2);
-            StartCodeFound = info2;
-        } else
-            StartCodeFound = true;
     }
 
-    // Here, we have found another start code (and read length of startcode bytes more than we should
-    // have.  Hence, go back in the file
-    if (info3) { //if the detected start code is 00 00 01, trailing_zero_8bits is sure not to be present
-        pBuf -= 5;
-        while (*pBuf-- == 0)
-            pos--;
-        this->nextstartcodebytes = 4;
-    } else if (info2)
-        this->nextstartcodebytes = 3;
-    else {
-        printf(" Panic: Error in next start code search \n");
+    // trailing_zero_8bits and the zero_byte of the next start code
+    while (end > begin && this->rdbuf_data[end - 1] == 0)
+        end--;
+
+    if (end - begin > this->max_size) {
+        printf(" Panic: NAL unit exceeds %u bytes \n", this->max_size);
         return -1;
     }
 
-    pos -= this->nextstartcodebytes;
-
-    // Here the leading zeros(if any), Start code, the complete NALU, trailing zeros(if any)
-    // and the next start code is in the Buf.
-    // The size of Buf is pos - rewind, pos are the number of bytes excluding the next
-    // start code, and (pos) - LeadingZero8BitsCount
-    // is the size of the NALU.
+    nal.num_bytes_in_nal_unit = end - begin;
+    nal.nal_unit_byte = this->rdbuf_data + begin;
+    this->rdbuf_data += end;
+    this->rdbuf_size -= end;
+
+    // the 64-bit cache loads of the Interpreter read up to PADDING_SIZE bytes
+    // beyond the NAL unit, which the window moves on and the map may not have
+    if (!this->is_mapped || this->rdbuf_size < nal_unit_t::PADDING_SIZE) {
+        nal.buffer.resize(nal.num_bytes_in_nal_unit + nal_unit_t::PADDING_SIZE);
+        memcpy(nal.buffer.data(), nal.nal_unit_byte, nal.num_bytes_in_nal_unit);
+        nal.nal_unit_byte = nal.buffer.data();
+    }
 
-    nal.num_bytes_in_nal_unit = pos - LeadingZero8BitsCount;
-    memcpy(nal.rbsp_byte, this->Buf + LeadingZero8BitsCount, nal.num_bytes_in_nal_unit);
     nal.lost_packets = 0;
     nal_unit(nal);
 
-    return pos;
+    return end;
 }
 
 
-inline uint32_t annex_b_t::getChunk()
+inline bool annex_b_t::getChunk()
 {
-    size_t reads = ::read(this->BitStreamFile, this->iobuf_data, this->iobuf_size);
-    if (0 == reads) {
+    if (this->is_eof)
+        return false;
+
+    // keep the unread bytes in front and make room behind them
+    if (this->rdbuf_data != this->iobuf_data) {
+        memmove(this->iobuf_data, this->rdbuf_data, this->rdbuf_size);
+        this->rdbuf_data = this->iobuf_data;
+    }
+    if (this->rdbuf_size == this->iobuf_size) {
+        uint8_t* iobuf_data = new uint8_t[this->iobuf_size * 2];
+        memcpy(iobuf_data, this->iobuf_data, this->rdbuf_size);
+        delete []this->iobuf_data;
+        this->iobuf_size *= 2;
+        this->iobuf_data = iobuf_data;
+        this->rdbuf_data = iobuf_data;
+    }
+
+    ssize_t reads = ::read(this->BitStreamFile, this->iobuf_data + this->rdbuf_size, this->iobuf_size - this->rdbuf_size);
+    if (reads <= 0) {
         this->is_eof = true;
-        return 0;
+        return false;
     }
 
-    this->rdbuf_size = reads;
-    this->rdbuf_data = this->iobuf_data;
-    return reads;
+    this->rdbuf_size += reads;
+    return true;
 }
 
-inline uint8_t annex_b_t::getfbyte()
+inline const uint8_t* annex_b_t::FindStartCode(const uint8_t* Buf, const uint8_t* BufEnd)
 {
-    if (0 == this->rdbuf_size) {
-        if (0 == this->getChunk())
-            return 0;
+    // look for the 0x01 first, it is rare in coded data
+    while (Buf + 2 < BufEnd) {
+        const uint8_t* one = (const uint8_t*)memchr(Buf + 2, 0x01, BufEnd - (Buf + 2));
+        if (!one)
+            return nullptr;
+        if (one[-1] == 0x00 && one[-2] == 0x00)
+            return one - 2;
+        Buf = one - 1;
     }
+    return nullptr;
+}
+
+
+// Reads NAL units ahead of the decoder on a thread of its own, so start code
+// and emulation prevention scanning and file I/O overlap with decoding. The
+// queue is bounded and its NAL units are handed over by swap.
+
+struct nal_queue_t {
+    static const int QUEUE_SIZE = 8;
+
+    bitstream_t*    bitstream;
+    std::thread     reader;
+
+    std::mutex              mutex;
+    std::condition_variable filled;
+    std::condition_variable drained;
 
-    --(this->rdbuf_size);
-    return *this->rdbuf_data++;
+    nal_unit_t*     nals[QUEUE_SIZE];
+    int             rets[QUEUE_SIZE];
+    int             head;
+    int             count;
+    bool            stop;
+
+                nal_queue_t(bitstream_t* bitstream, uint32_t max_size);
+                ~nal_queue_t();
+
+    void        fill();
+    int         pop (nal_unit_t& nal);
+};
+
+
+nal_queue_t::nal_queue_t(bitstream_t* bitstream, uint32_t max_size) :
+    bitstream { bitstream },
+    head { 0 }, count { 0 }, stop { false }
+{
+    for (int i = 0; i < QUEUE_SIZE; ++i)
+        this->nals[i] = new nal_unit_t(max_size);
+    this->reader = std::thread(&nal_queue_t::fill, this);
 }
 
-inline bool annex_b_t::FindStartCode(uint8_t* Buf, uint32_t zeros_in_startcode)
+nal_queue_t::~nal_queue_t()
 {
-    for (int i = 0; i < zeros_in_startcode; ++i) {
-        if (*Buf++ != 0)
-            return false;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stop = true;
     }
-    return *Buf == 1;
+    this->drained.notify_one();
+    this->reader.join();
+
+    for (int i = 0; i < QUEUE_SIZE; ++i)
+        delete this->nals[i];
+}
+
+void nal_queue_t::fill()
+{
+    int tail = 0;
+    int ret;
+
+    do {
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->drained.wait(lock, [this] { return this->stop || this->count < QUEUE_SIZE; });
+            if (this->stop)
+                return;
+        }
+
+        // slot tail is not visible to pop() until count covers it
+        ret = this->bitstream->read(*this->nals[tail]);
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->rets[tail] = ret;
+            this->count++;
+        }
+        this->filled.notify_one();
+        tail = (tail + 1) % QUEUE_SIZE;
+    } while (ret > 0);
+}
+
+int nal_queue_t::pop(nal_unit_t& nal)
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->filled.wait(lock, [this] { return this->count > 0; });
+
+    // the end of stream or an error stays at the head for later calls
+    int ret = this->rets[this->head];
+    if (ret <= 0)
+        return ret;
+
+    std::swap(nal, *this->nals[this->head]);
+
+    this->head = (this->head + 1) % QUEUE_SIZE;
+    this->count--;
+    lock.unlock();
+    this->drained.notify_one();
+    return ret;
 }
 
 
-void bitstream_t::open(const char* name, type format, uint32_t max_size)
+void bitstream_t::open(const char* name, type format, uint32_t max_size, bool threaded)
 {
     this->FileFormat = format;
 
@@ -337,10 +451,17 @@ void bitstream_t::open(const char* name, type format, uint32_t max_size)
         this->annex_b->open(name);
         break;
     }
+
+    this->prefetch = threaded ? new nal_queue_t(this, max_size) : nullptr;
 }
 
 void bitstream_t::close()
 {
+    if (this->prefetch) {
+        delete this->prefetch;
+        this->prefetch = nullptr;
+    }
+
     switch (this->FileFormat) {
     case type::RTP:
         close_rtp(&this->BitStreamFile);
@@ -354,7 +475,10 @@ void bitstream_t::close()
 }
 
 
-bitstream_t& bitstream_t::operator>>(nal_unit_t& nal)
+// Returns the NAL unit size, 0 at the end of stream, -1 if the NAL unit
+// could not be read and -2 if its emulation prevention is broken.
+
+int bitstream_t::read(nal_unit_t& nal)
 {
     int ret;
 
@@ -368,20 +492,27 @@ bitstream_t& bitstream_t::operator>>(nal_unit_t& nal)
         break;
     }
 
-    if (ret < 0) {
+    if (ret <= 0)
+        return ret < 0 ? -1 : 0;
+
+    return find_emulation_prevention(nal) < 0 ? -2 : ret;
+}
+
+bitstream_t& bitstream_t::operator>>(nal_unit_t& nal)
+{
+    int ret = this->prefetch ? this->prefetch->pop(nal) : this->read(nal);
+
+    if (ret == -1) {
         error(601, "Error while getting the NALU in file format %s, exit\n",
                    this->FileFormat == type::ANNEX_B ? "Annex B" : "RTP");
     }
+    if (ret == -2)
+        error(602, "Invalid startcode emulation prevention found.");
     if (ret == 0) {
-        nal.num_bytes_in_rbsp = 0;
+        nal.num_bytes_in_nal_unit = 0;
         return *this;
     }
 
-    ret = NALUtoRBSP(nal);
-
-    if (ret < 0)
-        error(602, "Invalid startcode emulation prevention found.");
-
     // Got a NALU
     if (nal.forbidden_zero_bit)
         error(603, "Found NALU with forbidden_zero_bit set, bit error?");
@@ -389,6 +520,5 @@ bitstream_t& bitstream_t::operator>>(nal_unit_t& nal)
     return *this;
 }
 
-
 }
 }
@@ -31,6 +31,7 @@ namespace h264 {
 
 struct nal_unit_t;
 struct annex_b_t;
+struct nal_queue_t;
 
 struct bitstream_t {
     enum class type { ANNEX_B, RTP };
@@ -38,11 +39,14 @@ struct bitstream_t {
     type        FileFormat;
     int         BitStreamFile;
     annex_b_t*  annex_b;
+    nal_queue_t* prefetch;
 
-    void        open (const char* name, type format, uint32_t max_size);
+    void        open (const char* name, type format, uint32_t max_size, bool threaded = false);
     void        close();
 
     bitstream_t& operator>>(nal_unit_t& nal);
+
+    int         read (nal_unit_t& nal);
 };
 
 
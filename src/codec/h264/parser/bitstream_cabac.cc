@@ -21,6 +21,8 @@
  * ===========================================================================
  */
 
+#include <vector>
+
 #include "slice.h"
 #include "bitstream_cabac.h"
 
@@ -1181,13 +1183,10 @@ static const char INIT_ONE_P[3][14*10][2] = {
 void cabac_context_t::init(int8_t m, int8_t n, uint8_t SliceQpY)
 {
     uint8_t preCtxState = clip3(1, 126, ((m * clip3<uint8_t>(0, 51, SliceQpY)) >> 4) + n);
-    if (preCtxState <= 63) {
-        this->pStateIdx = 63 - preCtxState;
-        this->valMPS    = 0;
-    } else {
-        this->pStateIdx = preCtxState - 64;
-        this->valMPS    = 1;
-    }
+    if (preCtxState <= 63)
+        this->state = (63 - preCtxState) << 1 | 0;
+    else
+        this->state = (preCtxState - 64) << 1 | 1;
 }
 
 
@@ -1212,7 +1211,29 @@ void cabac_context_t::init(int8_t m, int8_t n, uint8_t SliceQpY)
     } \
 }
 
+// The initial states depend only on the slice type class, cabac_init_idc and
+// SliceQpY, so each slice copies them from images made once for all of the
+// 7 x 52 combinations: I slices first, then P and B for every cabac_init_idc.
 void cabac_contexts_t::init(uint8_t slice_type, uint8_t cabac_init_idc, uint8_t SliceQpY)
+{
+    static const std::vector<cabac_contexts_t> images = [] {
+        std::vector<cabac_contexts_t> images(7 * 52);
+        for (int qp = 0; qp < 52; ++qp) {
+            images[qp].init_states(I_slice, 0, qp);
+            for (int idc = 0; idc < 3; ++idc) {
+                images[(1 + idc) * 52 + qp].init_states(P_slice, idc, qp);
+                images[(4 + idc) * 52 + qp].init_states(B_slice, idc, qp);
+            }
+        }
+        return images;
+    }();
+
+    int type = slice_type == I_slice || slice_type == SI_slice ? 0 :
+               slice_type == P_slice || slice_type == SP_slice ? 1 + cabac_init_idc : 4 + cabac_init_idc;
+    *this = images[type * 52 + clip3<uint8_t>(0, 51, SliceQpY)];
+}
+
+void cabac_contexts_t::init_states(uint8_t slice_type, uint8_t cabac_init_idc, uint8_t SliceQpY)
 {
     IBIARI_CTX_INIT1 (NUM_DELTA_QP_CTX, this->delta_qp_contexts,         INIT_DELTA_QP, 0, SliceQpY);
     IBIARI_CTX_INIT1 (NUM_IPR_CTX,      this->ipr_contexts,              INIT_IPR,      0, SliceQpY);
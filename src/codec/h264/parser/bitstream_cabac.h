@@ -32,8 +32,7 @@ namespace h264 {
 
 
 struct cabac_context_t {
-    uint8_t pStateIdx; // index into state-table CP
-    uint8_t valMPS;    // Least Probable Symbol 0/1 CP
+    uint8_t state;     // pStateIdx << 1 | valMPS
 
     void init(int8_t m, int8_t n, uint8_t SliceQpY);
 };
@@ -80,6 +79,9 @@ struct cabac_contexts_t {
     cabac_context_t one_contexts              [NUM_ONE_CTX];
 
     void init(uint8_t slice_type, uint8_t cabac_init_idc, uint8_t SliceQpY);
+
+private:
+    void init_states(uint8_t slice_type, uint8_t cabac_init_idc, uint8_t SliceQpY);
 };
 
 
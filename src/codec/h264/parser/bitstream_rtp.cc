@@ -82,10 +82,12 @@ int get_nalu_from_rtp(nal_unit_t& nal, int BitStreamFile)
         assert(p->paylen < nal.max_size);
 
         nal.num_bytes_in_nal_unit = p->paylen;
-        memcpy(nal.rbsp_byte, p->payload, p->paylen);
-        nal.forbidden_zero_bit = (nal.rbsp_byte[0] >> 7) & 1;
-        nal.nal_ref_idc        = (nal.rbsp_byte[0] >> 5) & 3;
-        nal.nal_unit_type      = (nal.rbsp_byte[0] & 0x1f);
+        nal.buffer.resize(p->paylen + nal_unit_t::PADDING_SIZE);
+        memcpy(nal.buffer.data(), p->payload, p->paylen);
+        nal.nal_unit_byte = nal.buffer.data();
+        nal.forbidden_zero_bit = (nal.nal_unit_byte[0] >> 7) & 1;
+        nal.nal_ref_idc        = (nal.nal_unit_byte[0] >> 5) & 3;
+        nal.nal_unit_type      = (nal.nal_unit_byte[0] & 0x1f);
         if (nal.lost_packets)
             printf("Warning: RTP sequence number discontinuity detected\n");
     }
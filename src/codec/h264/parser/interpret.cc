@@ -37,24 +37,46 @@ Interpreter::Interpreter(uint32_t size) :
 Interpreter::Interpreter(const nal_unit_t& nal) :
     nal_unit_t { nal.max_size }
 {
-    int nalUnitHeaderBytes = 1;
-    if (nal.nal_unit_type == 14 || nal.nal_unit_type == 20 || nal.nal_unit_type == 21)
-        nalUnitHeaderBytes += 3;
-
-    memcpy(this->rbsp_byte, &nal.rbsp_byte[nalUnitHeaderBytes], nal.num_bytes_in_rbsp - nalUnitHeaderBytes);
-    this->num_bytes_in_rbsp = nal.num_bytes_in_rbsp - nalUnitHeaderBytes;
-    this->frame_bitoffset = 0;
+    *this = nal;
 }
 
+// The RBSP is the NAL unit after its header. It is referred to in place when
+// the NAL unit lives in the mapped byte stream and has no emulation prevention
+// bytes, otherwise the runs between them are copied into buffer in one pass.
+
 Interpreter& Interpreter::operator=(const nal_unit_t& nal)
 {
-    int nalUnitHeaderBytes = 1;
+    uint32_t nalUnitHeaderBytes = 1;
     if (nal.nal_unit_type == 14 || nal.nal_unit_type == 20 || nal.nal_unit_type == 21)
         nalUnitHeaderBytes += 3;
 
-    memcpy(this->rbsp_byte, &nal.rbsp_byte[nalUnitHeaderBytes], nal.num_bytes_in_rbsp - nalUnitHeaderBytes);
-    this->num_bytes_in_rbsp = nal.num_bytes_in_rbsp - nalUnitHeaderBytes;
     this->frame_bitoffset = 0;
+    if (nal.num_bytes_in_nal_unit <= nalUnitHeaderBytes) {
+        this->rbsp_byte = nal.nal_unit_byte + nal.num_bytes_in_nal_unit;
+        this->num_bytes_in_rbsp = 0;
+        return *this;
+    }
+
+    const uint8_t* src = nal.nal_unit_byte;
+    if (nal.in_place() && nal.emulation_prevention.empty()) {
+        this->rbsp_byte = src + nalUnitHeaderBytes;
+        this->num_bytes_in_rbsp = nal.num_bytes_in_nal_unit - nalUnitHeaderBytes;
+        return *this;
+    }
+
+    this->buffer.resize(nal.num_bytes_in_nal_unit + PADDING_SIZE);
+    uint8_t* dst = this->buffer.data();
+    uint32_t pos = nalUnitHeaderBytes;
+    for (uint32_t epb : nal.emulation_prevention) {
+        memcpy(dst, src + pos, epb - pos);
+        dst += epb - pos;
+        pos  = epb + 1;
+    }
+    memcpy(dst, src + pos, nal.num_bytes_in_nal_unit - pos);
+    dst += nal.num_bytes_in_nal_unit - pos;
+
+    this->rbsp_byte = this->buffer.data();
+    this->num_bytes_in_rbsp = dst - this->buffer.data();
     return *this;
 }
 
@@ -70,7 +92,7 @@ bool Interpreter::more_data_in_byte_stream(void)
 
 bool Interpreter::more_rbsp_data(void)
 {
-    uint8_t* buffer       = this->rbsp_byte;
+    const uint8_t* buffer = this->rbsp_byte;
     int      totbitoffset = this->frame_bitoffset;
     int      bytecount    = this->num_bytes_in_rbsp;
 
@@ -80,7 +102,7 @@ bool Interpreter::more_rbsp_data(void)
         return true;
 
     int      bitoffset = 7 - (totbitoffset & 7);
-    uint8_t* cur_byte  = &buffer[byteoffset];
+    const uint8_t* cur_byte = &buffer[byteoffset];
     int      ctr_bit   = ((*cur_byte) >> (bitoffset--)) & 1;
 
     if (ctr_bit == 0)
@@ -97,58 +119,74 @@ bool Interpreter::more_rbsp_trailing_data(void)
     return false;
 }
 
+// 64 bits starting at the byte of the current position, shifted so that the
+// current bit is the msb. At least 57 bits are valid, the rest are zero.
+
+inline uint64_t Interpreter::cache(void)
+{
+    const uint8_t* curbyte = &this->rbsp_byte[this->frame_bitoffset >> 3];
+    uint64_t bits = ((uint64_t)curbyte[0] << 56) | ((uint64_t)curbyte[1] << 48) |
+                    ((uint64_t)curbyte[2] << 40) | ((uint64_t)curbyte[3] << 32) |
+                    ((uint64_t)curbyte[4] << 24) | ((uint64_t)curbyte[5] << 16) |
+                    ((uint64_t)curbyte[6] <<  8) | ((uint64_t)curbyte[7]      );
+    return bits << (this->frame_bitoffset & 7);
+}
+
 uint32_t Interpreter::next_bits(uint8_t n)
 {
-    uint8_t* buffer       = this->rbsp_byte;
-    int      totbitoffset = this->frame_bitoffset;
-    uint32_t bitcount     = this->num_bytes_in_rbsp * 8 + 7;
+    uint32_t bitcount = this->num_bytes_in_rbsp * 8 + 7;
 
-    if (totbitoffset + n > bitcount) 
+    if (n == 0 || this->frame_bitoffset + n > bitcount)
         return 0;
 
-    int      bitoffset  = 7 - (totbitoffset & 7);
-    int      byteoffset = (totbitoffset >> 3);
-    uint8_t* curbyte = &buffer[byteoffset];
-    uint32_t inf = 0;
-
-    while (n--) {
-        inf <<= 1;
-        inf |= ((*curbyte) >> (bitoffset--)) & 1;    
-        if (bitoffset == -1) {
-            curbyte++;
-            bitoffset = 7;
-        }
-    }
-
-    return inf;
+    return this->cache() >> (64 - n);
 }
 
 uint32_t Interpreter::read_bits(uint8_t n)
 {
-    uint8_t* buffer       = this->rbsp_byte;
-    int      totbitoffset = this->frame_bitoffset;
-    uint32_t bitcount     = this->num_bytes_in_rbsp * 8 + 7;
+    uint32_t bitcount = this->num_bytes_in_rbsp * 8 + 7;
 
-    if (totbitoffset + n > bitcount) 
+    if (n == 0 || this->frame_bitoffset + n > bitcount)
         return 0;
 
+    uint32_t inf = this->cache() >> (64 - n);
     this->frame_bitoffset += n;
+    return inf;
+}
+
+// no end of rbsp check, bits beyond it read as padding. For VLC lookups which
+// consume only the matched codeword with skip_bits().
+
+uint32_t Interpreter::peek_bits(uint8_t n)
+{
+    return this->cache() >> (64 - n);
+}
 
-    int      bitoffset  = 7 - (totbitoffset & 7);
-    int      byteoffset = (totbitoffset >> 3);
-    uint8_t* curbyte = &buffer[byteoffset];
-    uint32_t inf = 0;
-
-    while (n--) {
-        inf <<= 1;
-        inf |= ((*curbyte) >> (bitoffset--)) & 1;    
-        if (bitoffset == -1) {
-            curbyte++;
-            bitoffset = 7;
+void Interpreter::skip_bits(uint32_t n)
+{
+    this->frame_bitoffset += n;
+}
+
+int Interpreter::leading_zero_bits(void)
+{
+    uint32_t bitcount = this->num_bytes_in_rbsp * 8 + 7;
+    int leadingZeroBits;
+
+    if (this->frame_bitoffset < bitcount) {
+        uint64_t bits = this->cache();
+        leadingZeroBits = bits ? __builtin_clzll(bits) : 64;
+        if (leadingZeroBits < 57 && this->frame_bitoffset + leadingZeroBits + 1 <= bitcount) {
+            this->frame_bitoffset += leadingZeroBits + 1;
+            return leadingZeroBits;
         }
     }
 
-    return inf;
+    // codeword crosses the end of rbsp
+    uint32_t b;
+    leadingZeroBits = -1;
+    for (b = 0; !b; leadingZeroBits++)
+        b = this->read_bits(1);
+    return leadingZeroBits;
 }
 
 uint32_t Interpreter::u(uint8_t n, const char* name)
@@ -174,13 +212,9 @@ uint32_t Interpreter::b(uint8_t n, const char* name)
 
 uint32_t Interpreter::ue(const char* name)
 {
-    int leadingZeroBits = -1;
-    uint32_t b;
+    int leadingZeroBits = this->leading_zero_bits();
     uint32_t codeNum;
 
-    for (b = 0; !b; leadingZeroBits++)
-        b = this->read_bits(1);
-
     codeNum = (1 << leadingZeroBits) - 1 + this->read_bits(leadingZeroBits);
     return codeNum;
 }
@@ -224,13 +258,7 @@ InterpreterRbsp::InterpreterRbsp(const nal_unit_t& nal) :
 
 InterpreterRbsp& InterpreterRbsp::operator=(const nal_unit_t& nal)
 {
-    int nalUnitHeaderBytes = 1;
-    if (nal.nal_unit_type == 14 || nal.nal_unit_type == 20 || nal.nal_unit_type == 21)
-        nalUnitHeaderBytes += 3;
-
-    memcpy(this->rbsp_byte, &nal.rbsp_byte[nalUnitHeaderBytes], nal.num_bytes_in_rbsp - nalUnitHeaderBytes);
-    this->num_bytes_in_rbsp = nal.num_bytes_in_rbsp - nalUnitHeaderBytes;
-    this->frame_bitoffset = 0;
+    Interpreter::operator=(nal);
     return *this;
 }
 
@@ -248,7 +276,6 @@ InterpreterSEI::InterpreterSEI(const InterpreterRbsp& rbsp)
 
 InterpreterSEI::~InterpreterSEI()
 {
-    this->rbsp_byte = nullptr;
 }
 
 
@@ -297,13 +324,32 @@ static const uint8_t transIdxMPS[64] = {
     57, 58, 59, 60, 61, 62, 62, 63
 };
 
-static const uint8_t renorm_table_32[32] = {
-    6, 5, 4, 4, 3, 3, 3, 3,
-    2, 2, 2, 2, 2, 2, 2, 2,
-    1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1
-};
+// Tables 9-44 and 9-45 merged, indexed by the packed context state pStateIdx << 1 | valMPS
+
+static const struct cabac_state_table_t {
+    struct {
+        uint8_t rangeTabLPS[4];
+        uint8_t transIdx[2]; // packed state after MPS, LPS
+    } state[128];
+
+    cabac_state_table_t()
+    {
+        for (int pStateIdx = 0; pStateIdx < 64; ++pStateIdx) {
+            for (int valMPS = 0; valMPS < 2; ++valMPS) {
+                auto& st = this->state[pStateIdx << 1 | valMPS];
+                for (int qCodIRangeIdx = 0; qCodIRangeIdx < 4; ++qCodIRangeIdx)
+                    st.rangeTabLPS[qCodIRangeIdx] = rangeTabLPS[pStateIdx][qCodIRangeIdx];
+                st.transIdx[0] = transIdxMPS[pStateIdx] << 1 | valMPS;
+                st.transIdx[1] = transIdxLPS[pStateIdx] << 1 | (pStateIdx == 0 ? 1 - valMPS : valMPS);
+            }
+        }
+    }
+} cabac_states;
 
+// codIOffset keeps bitsLeft bits beyond the 9-bit register of the spec. Comparisons
+// against codIRange << bitsLeft are exact, renormalization only decrements bitsLeft
+// and the register is refilled 16 bits at a time once fewer than 7 bits are left,
+// which covers the largest renormalization so that no op ever runs dry.
 
 void cabac_engine_t::init(InterpreterRbsp* dp)
 {
@@ -313,27 +359,25 @@ void cabac_engine_t::init(InterpreterRbsp* dp)
     this->dp = dp;
     this->codIRange  = 510;
     this->codIOffset = this->dp->read_bits(9);
+    this->bitsLeft   = 0;
+    this->refill();
 }
 
 bool cabac_engine_t::decode_decision(cabac_context_t* ctx)
 {
-    uint8_t qCodIRangeIdx = (this->codIRange >> 6) & 3;
-    uint8_t codIRangeLPS  = rangeTabLPS[ctx->pStateIdx][qCodIRangeIdx];
-    uint8_t binVal;
+    auto& st = cabac_states.state[ctx->state];
+    uint32_t codIRangeLPS = st.rangeTabLPS[(this->codIRange >> 6) & 3];
 
     this->codIRange -= codIRangeLPS;
 
-    if (this->codIOffset < this->codIRange) {
-        binVal = ctx->valMPS;
-        ctx->pStateIdx = transIdxMPS[ctx->pStateIdx];
-    } else {
-        binVal = !ctx->valMPS;
-        this->codIOffset -= this->codIRange;
-        this->codIRange = codIRangeLPS;
-        if (ctx->pStateIdx == 0)
-            ctx->valMPS = 1 - ctx->valMPS; 
-        ctx->pStateIdx = transIdxLPS[ctx->pStateIdx];
-    }
+    uint32_t scaledRange = this->codIRange << this->bitsLeft;
+    uint32_t lps = (int32_t)(scaledRange - 1 - this->codIOffset) >> 31;
+
+    this->codIOffset -= scaledRange & lps;
+    this->codIRange  ^= (this->codIRange ^ codIRangeLPS) & lps;
+
+    bool binVal = (ctx->state ^ lps) & 1;
+    ctx->state = st.transIdx[lps & 1];
 
     this->renormD();
 
@@ -342,42 +386,73 @@ bool cabac_engine_t::decode_decision(cabac_context_t* ctx)
 
 bool cabac_engine_t::decode_bypass()
 {
-    uint8_t binVal;
+    uint32_t scaledRange = this->codIRange << --this->bitsLeft;
+    bool binVal = this->codIOffset >= scaledRange;
 
-    this->codIOffset = (this->codIOffset << 1) | this->dp->read_bits(1);
+    if (binVal)
+        this->codIOffset -= scaledRange;
+    if (this->bitsLeft < 7)
+        this->refill();
 
-    if (this->codIOffset < this->codIRange)
-        binVal = 0;
-    else {
-        binVal = 1;
-        this->codIOffset -= this->codIRange;
+    return binVal;
+}
+
+uint32_t cabac_engine_t::decode_bypass(uint8_t numBins)
+{
+    // n bypass bins read MSB first are the quotient of the n-bit extended offset by codIRange
+    uint32_t bins = 0;
+
+    while (numBins > 0) {
+        uint8_t n = min<int>(numBins, this->bitsLeft);
+        this->bitsLeft -= n;
+
+        uint32_t scaledRange = this->codIRange << this->bitsLeft;
+        uint32_t q = this->codIOffset / scaledRange;
+        this->codIOffset -= q * scaledRange;
+
+        bins = (bins << n) | q;
+        numBins -= n;
+        if (this->bitsLeft < 7)
+            this->refill();
     }
 
-    return binVal;
+    return bins;
 }
 
 bool cabac_engine_t::decode_terminate()
 {
-    uint8_t binVal;
-
     this->codIRange -= 2;
 
-    if (this->codIOffset < this->codIRange) {
-        binVal = 0;
+    if (this->codIOffset < (this->codIRange << this->bitsLeft)) {
         this->renormD();
-    } else
-        binVal = 1;
+        return 0;
+    }
 
-    return binVal;
+    // Parsing ends here (end of slice or I_PCM), give the bits read ahead back to dp
+    this->dp->frame_bitoffset -= this->bitsLeft;
+    this->codIOffset >>= this->bitsLeft;
+    this->bitsLeft = 0;
+    return 1;
 }
 
 void cabac_engine_t::renormD()
 {
-    if (this->codIRange < 256) {
-        int renorm = renorm_table_32[(this->codIRange >> 3) & 0x1F];
-        this->codIRange <<= renorm;
-        this->codIOffset = (this->codIOffset << renorm) | this->dp->read_bits(renorm);
-    }
+    int renorm = __builtin_clz(this->codIRange) - 23;
+    this->codIRange <<= renorm;
+    this->bitsLeft   -= renorm;
+    if (this->bitsLeft < 7)
+        this->refill();
+}
+
+void cabac_engine_t::refill()
+{
+    uint32_t bits = 0;
+    if ((this->dp->frame_bitoffset >> 3) <= (int)this->dp->num_bytes_in_rbsp)
+        bits = this->dp->peek_bits(16);
+    this->dp->skip_bits(16);
+
+    this->codIOffset = (this->codIOffset << 16) | bits;
+    this->bitsLeft  += 16;
 }
 
 uint32_t cabac_engine_t::u(cabac_context_t* ctx, uint8_t* ctxIdxIncs, uint8_t maxBinIdxCtx)
@@ -410,8 +485,7 @@ int32_t cabac_engine_t::ueg(cabac_context_t* ctx, uint8_t* ctxIdxIncs, uint8_t m
     if (b) {
         while (this->decode_bypass())
             bins += (1 << k++);
-        while (k--)
-            bins += (this->decode_bypass() << k);
+        bins += this->decode_bypass(k);
     }
     if (bins != 0) {
         if (this->decode_bypass())
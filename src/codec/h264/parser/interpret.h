@@ -50,6 +50,9 @@ public:
 
     uint32_t    next_bits(uint8_t n);
     uint32_t    read_bits(uint8_t n);
+    uint32_t    peek_bits(uint8_t n);
+    void        skip_bits(uint32_t n);
+    int         leading_zero_bits(void);
 
     uint32_t    u (uint8_t n,   const char* name="");
     int32_t     i (uint8_t n,   const char* name="");
@@ -64,9 +67,11 @@ public:
     uint32_t    te(const char* name="");
 
 public:
+    uint32_t    num_bytes_in_rbsp;
+    const uint8_t* rbsp_byte;           //!< into the NAL unit it was taken from, or into buffer
     int         frame_bitoffset;
 private:
-    nal_unit_t  nal;
+    inline uint64_t cache(void);
 
 public:
     VideoParameters *p_Vid;
@@ -192,15 +197,18 @@ struct cabac_context_t;
 
 struct cabac_engine_t {
     InterpreterRbsp* dp;
-    uint16_t    codIRange;
-    uint16_t    codIOffset;
+    uint32_t    codIRange;
+    uint32_t    codIOffset; // scaled by 2^bitsLeft, the low bits are read ahead of the 9-bit register
+    int         bitsLeft;
 
     void        init(InterpreterRbsp* dp);
 
     bool        decode_decision (cabac_context_t* ctx);
     bool        decode_bypass   ();
+    uint32_t    decode_bypass   (uint8_t numBins);
     bool        decode_terminate();
     void        renormD();
+    void        refill();
 
     uint32_t    u  (cabac_context_t* ctx, uint8_t* ctxIdxIncs, uint8_t maxBinIdxCtx);
     uint32_t    tu (cabac_context_t* ctx, uint8_t* ctxIdxIncs, uint8_t maxBinIdxCtx, uint32_t cMax);
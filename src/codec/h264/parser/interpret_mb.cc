@@ -216,6 +216,9 @@ void Parser::Macroblock::parse()
                     nextMb.slice_nr = mb.slice_nr;
                     nextMb.mbAddrX  = mb.mbAddrX + 1;
                     nextMb.mb_field_decoding_flag = mb.mb_field_decoding_flag;
+                    // init() has not run for it yet, the pair shares its neighbours
+                    nextMb.mbA      = mb.mbA;
+                    nextMb.mbB      = mb.mbB;
                     SyntaxElement se { nextMb };
 
                     //check_next_mb
@@ -298,7 +301,7 @@ void Parser::Macroblock::parse()
                 slice.parser.is_reset_coeff = true;
                 slice.parser.mb_skip_run = -1;
             } else
-                memset(mb.nz_coeff, 0, 3 * 16 * sizeof(uint8_t));
+                memset(mb.ctx->nz_coeff, 0, 3 * 16 * sizeof(uint8_t));
             return;
         }
     }
@@ -412,7 +415,7 @@ void Parser::Macroblock::parse_i_pcm()
     // for deblocking filter
     this->update_qp(0);
 
-    memset(mb.nz_coeff, 16, 3 * 16 * sizeof(byte));
+    memset(mb.ctx->nz_coeff, 16, 3 * 16 * sizeof(byte));
 
     // for CABAC decoding of MB skip flag
     mb.mb_skip_flag = 0;
@@ -431,7 +434,7 @@ void Parser::Macroblock::parse_i_pcm()
             auto& mv = mv_info[mb.mb.y * 4 + y][mb.mb.x * 4 + x];
             mv.slice_no = mb.slice_nr;
             for (int list = 0; list < 2; list++) {
-                mv.ref_pic[list] = NULL;
+                mv.ref_pic_id[list] = 0;
                 mv.ref_idx[list] = -1;
                 mv.mv     [list] = {0, 0};
             }
@@ -511,7 +514,7 @@ void Parser::Macroblock::mb_pred_intra()
             auto& mv = mv_info[mb.mb.y * 4 + y][mb.mb.x * 4 + x];
             mv.slice_no = mb.slice_nr;
             for (int list = 0; list < 2; list++) {
-                mv.ref_pic[list] = NULL;
+                mv.ref_pic_id[list] = 0;
                 mv.ref_idx[list] = -1;
                 mv.mv     [list] = {0, 0};
             }
@@ -582,7 +585,7 @@ void Parser::Macroblock::mb_pred_inter()
                 auto& mv = mv_info[mb.mb.y * 4 + y][mb.mb.x * 4 + x];
                 mv.slice_no = mb.slice_nr;
                 for (int list = 0; list < 2; list++) {
-                    mv.ref_pic[list] = NULL;
+                    mv.ref_pic_id[list] = 0;
                     mv.ref_idx[list] = -1;
                     mv.mv     [list] = {0, 0};
                 }
@@ -608,16 +611,16 @@ void Parser::Macroblock::mb_pred_inter()
     if (shr.slice_type == B_slice)
         this->mvd_l(LIST_1);
 
-    pic_motion_params** p_mv_info = slice.dec_picture->mv_info;
+    auto p_mv_info = slice.dec_picture->mv_info;
     // record reference picture Ids for deblocking decisions
     for (int j4 = 0; j4 < 4; j4++) {
         for (int i4 = 0; i4 < 4; ++i4) {
             auto mv_info = &p_mv_info[mb.mb.y * 4 + j4][mb.mb.x * 4 + i4];
             int  ref_idx = mv_info->ref_idx[LIST_0];
-            mv_info->ref_pic[LIST_0] = get_ref_pic(mb, slice.RefPicList[LIST_0], ref_idx);
+            mv_info->ref_pic_id[LIST_0] = get_ref_pic_id(mb, LIST_0, ref_idx);
             if (shr.slice_type == B_slice) {
                 ref_idx = mv_info->ref_idx[LIST_1];
-                mv_info->ref_pic[LIST_1] = get_ref_pic(mb, slice.RefPicList[LIST_1], ref_idx);
+                mv_info->ref_pic_id[LIST_1] = get_ref_pic_id(mb, LIST_1, ref_idx);
             }
         }
     }
@@ -664,7 +667,7 @@ void Parser::Macroblock::mvd_l(int list)
     int step_h0 = BLOCK_STEP[mb.mb_type][0];
     int step_v0 = BLOCK_STEP[mb.mb_type][1];
 
-    auto mvd_l = (list == 0) ? mb.mvd_l0 : mb.mvd_l1;
+    auto mvd_l = (list == 0) ? mb.ctx->mvd_l0 : mb.ctx->mvd_l1;
 
     for (int y8 = 0; y8 < 4; y8 += step_v0) {
         for (int x8 = 0; x8 < 4; x8 += step_h0) {
@@ -755,8 +758,6 @@ void Parser::Macroblock::erc_dpl()
 
         mb_t* mbA = slice.neighbour.get_mb(&slice, false, mb.mbAddrX, {-1, 0});
         mb_t* mbB = slice.neighbour.get_mb(&slice, false, mb.mbAddrX, {0, -1});
-        mbA = mbA && mbA->slice_nr == mb.slice_nr ? mbA : nullptr;
-        mbB = mbB && mbB->slice_nr == mb.slice_nr ? mbB : nullptr;
 
         if (!(pps.constrained_intra_pred_flag && mb.is_intra_block)) {
             if (mbA)
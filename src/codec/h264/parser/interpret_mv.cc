@@ -32,10 +32,6 @@ void neighbour_mv(mb_t& mb, nb_mv_t nb_mv[3], int listSuffixFlag, int i, int j,
     nb_t nbB = slice.neighbour.get_neighbour(&slice, false, mb.mbAddrX, {i * 4          , j * 4 - 1});
     nb_t nbC = slice.neighbour.get_neighbour(&slice, false, mb.mbAddrX, {i * 4 + step_h4, j * 4 - 1});
     nb_t nbD = slice.neighbour.get_neighbour(&slice, false, mb.mbAddrX, {i * 4 - 1      , j * 4 - 1});
-    nbA.mb = nbA.mb && nbA.mb->slice_nr == mb.slice_nr ? nbA.mb : nullptr;
-    nbB.mb = nbB.mb && nbB.mb->slice_nr == mb.slice_nr ? nbB.mb : nullptr;
-    nbC.mb = nbC.mb && nbC.mb->slice_nr == mb.slice_nr ? nbC.mb : nullptr;
-    nbD.mb = nbD.mb && nbD.mb->slice_nr == mb.slice_nr ? nbD.mb : nullptr;
 
     if (j > 0) {
         if (i < 2) { // first column of 8x8 blocks
@@ -172,12 +168,12 @@ void Parser::Macroblock::skip_macroblock()
           !nb_mv[1].available || (refIdxLXB == 0 && mvLXB == mv_t{0, 0})))
         mvpLX = predict_mv(nb_mv, refIdxLX, 0, 0, 16, 16);
 
-    storable_picture* ref_pic = get_ref_pic(mb, slice.RefPicList[0], refIdxLX);
+    uint8_t ref_pic_id = get_ref_pic_id(mb, LIST_0, refIdxLX);
 
     for (int y = 0; y < 4; ++y) {
         for (int x = 0; x < 4; ++x) {
             auto mv_info = &slice.dec_picture->mv_info[mb.mb.y * 4 + y][mb.mb.x * 4 + x];
-            mv_info->ref_pic[list] = ref_pic;
+            mv_info->ref_pic_id[list] = ref_pic_id;
             mv_info->ref_idx[list] = refIdxLX;
             mv_info->mv     [list] = mvpLX;
         }
@@ -186,10 +182,10 @@ void Parser::Macroblock::skip_macroblock()
     mb.CodedBlockPatternLuma   = 0;
     mb.CodedBlockPatternChroma = 0;
     if (!pps.entropy_coding_mode_flag)
-        memset(mb.nz_coeff, 0, 3 * 16 * sizeof(uint8_t));
+        memset(mb.ctx->nz_coeff, 0, 3 * 16 * sizeof(uint8_t));
 }
 
-pic_motion_params* get_colocated(mb_t& mb, int i, int j)
+pic_motion_params* get_colocated(mb_t& mb, int i, int j, storable_picture*& col_pic)
 {
     slice_t& slice = *mb.p_Slice;
     sps_t& sps = *slice.active_sps;
@@ -206,40 +202,29 @@ pic_motion_params* get_colocated(mb_t& mb, int i, int j)
     int i4 = mb.mb.x * 4 + i;
     int j4 = block_y_aff + j;
 
-    pic_motion_params* colocated;
-    if (sps.direct_8x8_inference_flag)
-        colocated = &ref_pic->mv_info[RSD(j4)][RSD(i4)];
-    else
-        colocated = &ref_pic->mv_info[j4][i4];
-
+    col_pic = ref_pic;
+    int field_shift = 0;
     if (sps.direct_8x8_inference_flag) {
         if (shr.MbaffFrameFlag) {
             if (!mb.mb_field_decoding_flag &&
                 (ref_pic->slice.iCodingType == FIELD_CODING || ref_pic->motion.mb_field_decoding_flag[mb.mbAddrX])) {
-                if (abs(slice.dec_picture->poc - ref_pic->bottom_field->poc) >
-                    abs(slice.dec_picture->poc - ref_pic->top_field->poc))
-                    colocated = &ref_pic->top_field->mv_info[RSD(j4) >> 1][RSD(i4)];
-                else
-                    colocated = &ref_pic->bottom_field->mv_info[RSD(j4) >> 1][RSD(i4)];
+                col_pic = slice.colocated_field;
+                field_shift = 1;
             }
         } else if (!sps.frame_mbs_only_flag && !shr.field_pic_flag && ref_pic->slice.iCodingType == FIELD_CODING) {
-            if (abs(slice.dec_picture->poc - ref_pic->bottom_field->poc) >
-                abs(slice.dec_picture->poc - ref_pic->top_field->poc) )
-                colocated = &ref_pic->top_field->mv_info[RSD(j4) >> 1][RSD(i4)];
-            else
-                colocated = &ref_pic->bottom_field->mv_info[RSD(j4) >> 1][RSD(i4)];
-        } else if (shr.field_pic_flag && ref_pic->slice.iCodingType != FIELD_CODING) {
-            if (!shr.bottom_field_flag)
-                colocated = &ref_pic->frame->top_field->mv_info[RSD(j4)][RSD(i4)];
-            else
-                colocated = &ref_pic->frame->bottom_field->mv_info[RSD(j4)][RSD(i4)];
-        }
+            col_pic = slice.colocated_field;
+            field_shift = 1;
+        } else if (shr.field_pic_flag && ref_pic->slice.iCodingType != FIELD_CODING)
+            col_pic = slice.colocated_field;
     }
 
-    return colocated;
+    if (sps.direct_8x8_inference_flag)
+        return &col_pic->mv_info[RSD(j4) >> field_shift][RSD(i4)];
+    else
+        return &col_pic->mv_info[j4][i4];
 }
 
-static int MapColToList0(mb_t& mb, pic_motion_params* colocated)
+static int MapColToList0(mb_t& mb, storable_picture* col_pic, pic_motion_params* colocated)
 {
     slice_t& slice = *mb.p_Slice;
     sps_t& sps = *slice.active_sps;
@@ -249,7 +234,7 @@ static int MapColToList0(mb_t& mb, pic_motion_params* colocated)
                                 slice.RefPicSize[LIST_0] * (1 + (shr.MbaffFrameFlag && mb.mb_field_decoding_flag)));
 
     int  refList = colocated->ref_idx[LIST_0] == -1 ? LIST_1 : LIST_0;
-    auto ref_pic = colocated->ref_pic[refList];
+    auto ref_pic = col_pic->ref_pics[colocated->ref_pic_id[refList]];
 
     bool direct_8x8 = sps.direct_8x8_inference_flag && (
         (shr.MbaffFrameFlag && !mb.mb_field_decoding_flag && ref_pic->slice.structure != FRAME) ||
@@ -284,32 +269,6 @@ static int MapColToList0(mb_t& mb, pic_motion_params* colocated)
     return mapped_idx;
 }
 
-static int DistScaleFactor(mb_t& mb, int ref_idx)
-{
-    slice_t& slice = *mb.p_Slice;
-    shr_t& shr = slice.header;
-
-    storable_picture* dec_picture = slice.p_Vid->dec_picture;
-    storable_picture* ref_pic0 = get_ref_pic(mb, slice.RefPicList[LIST_0], ref_idx);
-    storable_picture* ref_pic1 = get_ref_pic(mb, slice.RefPicList[LIST_1], 0);
-
-    if (ref_pic0->is_long_term)
-        return 9999;
-
-    int curPoc = (!shr.MbaffFrameFlag || !mb.mb_field_decoding_flag) ? dec_picture->poc :
-                 (mb.mbAddrX % 2 == 0) ? dec_picture->top_poc : dec_picture->bottom_poc;
-
-    int tb = clip3(-128, 127, curPoc - ref_pic0->poc);
-    int td = clip3(-128, 127, ref_pic1->poc - ref_pic0->poc);
-    if (td == 0)
-        return 9999;
-    int tx = (16384 + abs(td / 2)) / td;
-
-    int DistScaleFactor = clip3(-1024, 1023, (tb * tx + 32) >> 6);
-
-    return DistScaleFactor;
-}
-
 void Parser::Macroblock::get_direct_temporal()
 {
     bool has_direct = (mb.SubMbType[0] == 0) | (mb.SubMbType[1] == 0) |
@@ -327,7 +286,8 @@ void Parser::Macroblock::get_direct_temporal()
         int i = ((block4x4 / 4) % 2) * 2 + ((block4x4 % 4) % 2);
         int j = ((block4x4 / 4) / 2) * 2 + ((block4x4 % 4) / 2);
 
-        auto colocated = vio::h264::get_colocated(mb, i, j);
+        storable_picture* col_pic;
+        auto colocated = vio::h264::get_colocated(mb, i, j, col_pic);
         int  refList = colocated->ref_idx[LIST_0] == -1 ? LIST_1 : LIST_0;
         int  ref_idx = colocated->ref_idx[refList];
 
@@ -337,7 +297,7 @@ void Parser::Macroblock::get_direct_temporal()
             mv_info->mv[LIST_0] = {0, 0};
             mv_info->mv[LIST_1] = {0, 0};
         } else { // co-located skip or inter mode
-            auto ref_pic = colocated->ref_pic[refList];
+            auto ref_pic = col_pic->ref_pics[colocated->ref_pic_id[refList]];
             mv_t mvCol   = colocated->mv     [refList];
             if (sps.direct_8x8_inference_flag) {
                 if ((shr.MbaffFrameFlag && !mb.mb_field_decoding_flag && ref_pic->slice.structure != FRAME) ||
@@ -348,8 +308,9 @@ void Parser::Macroblock::get_direct_temporal()
                     mvCol.mv_y /= 2;
             }
 
-            int mapped_idx = MapColToList0(mb, colocated);
-            int mv_scale = DistScaleFactor(mb, mapped_idx);
+            int mapped_idx = MapColToList0(mb, col_pic, colocated);
+            int k = shr.MbaffFrameFlag && mb.mb_field_decoding_flag ? 1 + mb.mbAddrX % 2 : 0;
+            int mv_scale = slice.DistScaleFactor[k][mapped_idx];
             mv_info->ref_idx[LIST_0] = (char) mapped_idx;
             //! In such case, an array is needed for each different reference.
             if (mv_scale == 9999) {
@@ -363,8 +324,8 @@ void Parser::Macroblock::get_direct_temporal()
         }
         // store reference picture ID determined by direct mode
         mv_info->ref_idx[LIST_1] = 0;
-        mv_info->ref_pic[LIST_0] = get_ref_pic(mb, slice.RefPicList[LIST_0], (short)mv_info->ref_idx[LIST_0]);
-        mv_info->ref_pic[LIST_1] = get_ref_pic(mb, slice.RefPicList[LIST_1], (short)mv_info->ref_idx[LIST_1]);
+        mv_info->ref_pic_id[LIST_0] = get_ref_pic_id(mb, LIST_0, mv_info->ref_idx[LIST_0]);
+        mv_info->ref_pic_id[LIST_1] = get_ref_pic_id(mb, LIST_1, mv_info->ref_idx[LIST_1]);
     }
 }
 
@@ -409,7 +370,8 @@ void Parser::Macroblock::get_direct_spatial()
 
         bool colZeroFlag = false;
         if (!get_ref_pic(mb, slice.RefPicList[LIST_1], 0)->is_long_term) {
-            auto colocated = vio::h264::get_colocated(mb, i, j);
+            storable_picture* col_pic;
+            auto colocated = vio::h264::get_colocated(mb, i, j, col_pic);
             colZeroFlag =
                 (colocated->ref_idx[LIST_0] == 0 &&
                    abs(colocated->mv[LIST_0].mv_x) >> 1 == 0 && abs(colocated->mv[LIST_0].mv_y) >> 1 == 0) ||
@@ -418,8 +380,8 @@ void Parser::Macroblock::get_direct_spatial()
         }
 
         auto mv_info = &slice.dec_picture->mv_info[mb.mb.y * 4 + j][mb.mb.x * 4 + i];
-        mv_info->ref_pic[LIST_0] = refIdxL0 == -1 ? nullptr : get_ref_pic(mb, slice.RefPicList[LIST_0], refIdxL0);
-        mv_info->ref_pic[LIST_1] = refIdxL1 == -1 ? nullptr : get_ref_pic(mb, slice.RefPicList[LIST_1], refIdxL1);
+        mv_info->ref_pic_id[LIST_0] = get_ref_pic_id(mb, LIST_0, refIdxL0);
+        mv_info->ref_pic_id[LIST_1] = get_ref_pic_id(mb, LIST_1, refIdxL1);
         mv_info->ref_idx[LIST_0] = refIdxL0;
         mv_info->ref_idx[LIST_1] = refIdxL1;
         mv_info->mv[LIST_0] = (directZeroPredictionFlag || refIdxL0 < 0 || (refIdxL0 == 0 && colZeroFlag)) ? mv_t{0, 0} : pmvl0;
@@ -207,6 +207,20 @@ void InterpreterRbsp::seq_parameter_set_data(sps_t& sps)
                (16 * sps.FrameHeightInMbs / sps.CropUnitY) - (sps.frame_crop_bottom_offset + 1));
     }
 
+    // output window of each plane, so that output does not rederive it per frame
+    uint32_t crop_left   = sps.frame_cropping_flag ? sps.frame_crop_left_offset   : 0;
+    uint32_t crop_right  = sps.frame_cropping_flag ? sps.frame_crop_right_offset  : 0;
+    uint32_t crop_top    = sps.frame_cropping_flag ? sps.frame_crop_top_offset    * (2 - sps.frame_mbs_only_flag) : 0;
+    uint32_t crop_bottom = sps.frame_cropping_flag ? sps.frame_crop_bottom_offset * (2 - sps.frame_mbs_only_flag) : 0;
+    sps.CropLeftL   = sps.SubWidthC  * crop_left;
+    sps.CropTopL    = sps.SubHeightC * crop_top;
+    sps.CropWidthL  = sps.PicWidthInSamplesL    - sps.SubWidthC  * (crop_left + crop_right);
+    sps.CropHeightL = sps.FrameHeightInMbs * 16 - sps.SubHeightC * (crop_top + crop_bottom);
+    sps.CropLeftC   = crop_left;
+    sps.CropTopC    = crop_top;
+    sps.CropWidthC  = sps.MbWidthC  ? sps.PicWidthInSamplesC                  - (crop_left + crop_right) : 0;
+    sps.CropHeightC = sps.MbHeightC ? sps.FrameHeightInMbs * sps.MbHeightC - (crop_top + crop_bottom) : 0;
+
     sps.vui_parameters_present_flag = this->u(1, "SPS: vui_parameters_present_flag");
     sps.vui_parameters.matrix_coefficients = 2;
     if (sps.vui_parameters_present_flag)
@@ -96,10 +96,7 @@ void Parser::Residual::residual_block_cavlc(uint8_t ctxBlockCat, uint8_t startId
             int level_prefix, level_suffix;
             int levelSuffixSize, levelCode;
 
-            int leadingZeroBits = -1;
-            for (int b = 0; !b; leadingZeroBits++)
-                b = dp->read_bits(1);
-            level_prefix = leadingZeroBits;
+            level_prefix = dp->leading_zero_bits();
 
             levelSuffixSize = (level_prefix == 14 && suffixLength == 0) ? 4 :
                               (level_prefix >= 15) ? level_prefix - 3 : suffixLength;
@@ -146,7 +143,7 @@ void Parser::Residual::residual_block_cavlc(uint8_t ctxBlockCat, uint8_t startId
     }
 
     if (ac)
-        mb.nz_coeff[pl][j][i] = TotalCoeff;
+        mb.ctx->nz_coeff[pl][j][i] = TotalCoeff;
 
     int coeffNum = startIdx - 1;
     //for (int k = TotalCoeff - 1; k >= 0; k--) {
@@ -288,27 +285,25 @@ typedef enum {
     CR_8x8        = 14  // ctxBlockCat = 13 =
 } CABACBlockTypes;
 
-static uint32_t unary_exp_golomb_level_decode(cabac_engine_t* dep_dp, cabac_context_t* ctx, int* ctxIdxIncs)
+static uint32_t unary_exp_golomb_level_decode(cabac_engine_t* dep_dp, cabac_context_t* ctx0, cabac_context_t* ctx1)
 {
-    const uint32_t cMax = 13;
+    const uint32_t uCoff = 14;
 
-    if (!dep_dp->decode_decision(ctx + ctxIdxIncs[0]))
+    if (!dep_dp->decode_decision(ctx0))
         return 0;
 
-    uint32_t bins = -1;
-    bool b;
-    for (b = 1; b && (bins + 1 < cMax); ++bins)
-        b = dep_dp->decode_decision(ctx + ctxIdxIncs[1]);
-    if (!b)
-        return bins + 1;
+    uint32_t bins = 1;
+    while (bins < uCoff && dep_dp->decode_decision(ctx1))
+        ++bins;
+    if (bins < uCoff)
+        return bins;
 
     uint32_t k = 0;
     while (dep_dp->decode_bypass())
         bins += (1 << k++);
-    while (k--)
-        bins += (dep_dp->decode_bypass() << k);
+    bins += dep_dp->decode_bypass(k);
 
-    return bins + 1 + 1;
+    return bins;
 }
 
 
@@ -357,64 +352,54 @@ void Parser::Residual::residual_block_cabac(uint8_t ctxBlockCat, uint8_t startId
     cabac_context_t* map_ctx  = slice.parser.mot_ctx.map_contexts [field] + type2ctx_map[context];
     cabac_context_t* last_ctx = slice.parser.mot_ctx.last_contexts[field] + type2ctx_map[context];
 
-    int coeff_val[64], *coeff;
-    int numCoeff = endIdx + 1;
-    int ii = startIdx;
-    coeff = coeff_val;// + startIdx;
-
-    ii = 0;
-    while (ii < numCoeff - 1) {
-        bool significant_coeff_flag = cabac.decode_decision(map_ctx + pos2ctx_Map[ii]);
-        *(coeff++) = significant_coeff_flag;
-        if (significant_coeff_flag) {
-            bool last_significant_coeff_flag = cabac.decode_decision(last_ctx + pos2ctx_Last[ii]);
-            if (last_significant_coeff_flag)
-                numCoeff = ii + 1;
+    // significance map, keeping only the scan positions of the nonzero coefficients
+    uint8_t runarr[64];
+    int     levarr[64];
+    int     numCoeff = 0;
+
+    int ii;
+    for (ii = 0; ii < endIdx; ++ii) {
+        if (cabac.decode_decision(map_ctx + pos2ctx_Map[ii])) {
+            if (cabac.decode_decision(last_ctx + pos2ctx_Last[ii]))
+                break;
+            runarr[numCoeff++] = startIdx + ii;
         }
-        ii++;
     }
+    runarr[numCoeff++] = startIdx + ii;
 
+    // levels in reverse scan order
     cabac_context_t* one_ctx = slice.parser.mot_ctx.one_contexts + type2ctx_one[context];
-
-    coeff = coeff_val + numCoeff - 1;
-    *coeff = 1;
+    cabac_context_t* abs_ctx = one_ctx + 5;
+    int maxNumDecodAbsLevelGt1 = ctxBlockCat == CHROMA_DC ? 3 : 4;
 
     int numDecodAbsLevelEq1 = 0;
     int numDecodAbsLevelGt1 = 0;
 
-    int i = chroma ? blkIdx % 2 : ((blkIdx / 4) % 2) * 2 + (blkIdx % 4) % 2;
-    int j = chroma ? blkIdx / 2 : ((blkIdx / 4) / 2) * 2 + (blkIdx % 4) / 2;
+    for (int k = numCoeff - 1; k >= 0; --k) {
+        cabac_context_t* ctx0 = one_ctx + (numDecodAbsLevelGt1 != 0 ? 0 : min(4, 1 + numDecodAbsLevelEq1));
+        cabac_context_t* ctx1 = abs_ctx + min(maxNumDecodAbsLevelGt1, numDecodAbsLevelGt1);
+        int32_t coeff_abs_level_minus1 = unary_exp_golomb_level_decode(&cabac, ctx0, ctx1);
+        bool    coeff_sign_flag = cabac.decode_bypass();
 
-    for (ii = numCoeff - 1 + startIdx; ii >= startIdx; ii--) {
-        if (*coeff) {
-            int ctxIdxIncs[] = {
-                (numDecodAbsLevelGt1 != 0 ? 0 : min(4, 1 + numDecodAbsLevelEq1)),
-                5 + min(4 - (ctxBlockCat == CHROMA_DC ? 1 : 0), numDecodAbsLevelGt1)
-            };
-            int32_t coeff_abs_level_minus1 = unary_exp_golomb_level_decode(&cabac, one_ctx, ctxIdxIncs);
-            bool    coeff_sign_flag = cabac.decode_bypass();
-            int32_t coeffLevel = (coeff_abs_level_minus1 + 1) * (1 - 2 * coeff_sign_flag);
+        levarr[k] = coeff_sign_flag ? -(coeff_abs_level_minus1 + 1) : coeff_abs_level_minus1 + 1;
 
-            *coeff = coeffLevel;
+        numDecodAbsLevelEq1 += (coeff_abs_level_minus1 == 0);
+        numDecodAbsLevelGt1 += (coeff_abs_level_minus1 != 0);
+    }
 
-            numDecodAbsLevelEq1 += (coeff_abs_level_minus1 == 0);
-            numDecodAbsLevelGt1 += (coeff_abs_level_minus1 != 0);
+    int i = chroma ? blkIdx % 2 : ((blkIdx / 4) % 2) * 2 + (blkIdx % 4) % 2;
+    int j = chroma ? blkIdx / 2 : ((blkIdx / 4) / 2) * 2 + (blkIdx % 4) / 2;
 
-            //if (!ac)
-            //    assert(startIdx + ii < numCoeff);
-            if (!chroma) {
-                if (!ac)
-                    slice.decoder.coeff_luma_dc(&mb, pl, i, j, ii, *coeff);
-                else
-                    slice.decoder.coeff_luma_ac(&mb, pl, i, j, ii, *coeff);
-            } else {
-                if (!ac)
-                    slice.decoder.coeff_chroma_dc(&mb, pl, i, j, ii, *coeff);
-                else
-                    slice.decoder.coeff_chroma_ac(&mb, pl, i, j, ii, *coeff);
-            }
-        }
-        coeff--;
+    if (!chroma) {
+        if (!ac)
+            slice.decoder.coeff_luma_dc(&mb, pl, i, j, numCoeff, runarr, levarr);
+        else
+            slice.decoder.coeff_luma_ac(&mb, pl, i, j, numCoeff, runarr, levarr);
+    } else {
+        if (!ac)
+            slice.decoder.coeff_chroma_dc(&mb, pl, i, j, numCoeff, runarr, levarr);
+        else
+            slice.decoder.coeff_chroma_ac(&mb, pl, i, j, numCoeff, runarr, levarr);
     }
 }
 
@@ -442,7 +427,7 @@ void Parser::Residual::residual_luma(ColorPlane pl)
                     if (!pps.entropy_coding_mode_flag) {
                         int i = (i8x8 % 2) * 2 + (i4x4 % 2);
                         int j = (i8x8 / 2) * 2 + (i4x4 / 2);
-                        mb.nz_coeff[pl][j][i] = 0;
+                        mb.ctx->nz_coeff[pl][j][i] = 0;
                     }
                 }
             }
@@ -453,7 +438,7 @@ void Parser::Residual::residual_luma(ColorPlane pl)
                 if (!pps.entropy_coding_mode_flag) {
                     int i = (i8x8 % 2) * 2 + (i4x4 % 2);
                     int j = (i8x8 / 2) * 2 + (i4x4 / 2);
-                    mb.nz_coeff[pl][j][i] = 0;
+                    mb.ctx->nz_coeff[pl][j][i] = 0;
                 }
             }
         }
@@ -485,7 +470,7 @@ void Parser::Residual::residual_chroma()
                     if (!pps.entropy_coding_mode_flag) {
                         int i = (i4x4 % 2);
                         int j = (i4x4 / 2) + (i8x8 * 2);
-                        mb.nz_coeff[iCbCr + 1][j][i] = 0;
+                        mb.ctx->nz_coeff[iCbCr + 1][j][i] = 0;
                     }
                 }
             }
@@ -603,6 +603,131 @@ static const uint8_t run_before_code[15][16] = {
 };
 
 
+// Lookup tables built once from the code tables above. The first level is
+// indexed by the next `bits` bits of the stream; codewords longer than that
+// continue in a second level table of the shortest length covering them.
+
+class vlc_table_t {
+public:
+    static const uint8_t PEEK_BITS = 16;
+
+    vlc_table_t(uint8_t bits, int num, const uint8_t* lengths, const uint8_t* codes,
+                uint8_t (*value)(int k) = nullptr);
+
+    uint8_t     decode(Interpreter* dp) const;
+
+private:
+    struct entry_t {
+        uint8_t     value;  // syntax element value or second level bits
+        int8_t      length; // codeword length, < 0 for second level, 0 for invalid
+        uint16_t    offset; // second level table start
+    };
+
+    uint8_t     bits;
+    std::vector<entry_t> entries;
+};
+
+vlc_table_t::vlc_table_t(uint8_t bits, int num, const uint8_t* lengths, const uint8_t* codes,
+                         uint8_t (*value)(int k)) :
+    bits { bits }, entries ( 1 << bits, entry_t { 0, 0, 0 } )
+{
+    for (int k = 0; k < num; ++k) {
+        if (lengths[k] > bits) {
+            entry_t& e = this->entries[codes[k] >> (lengths[k] - bits)];
+            e.value = max<uint8_t>(e.value, lengths[k] - bits);
+            e.length = -1;
+        }
+    }
+    for (int i = 0; i < (1 << bits); ++i) {
+        if (this->entries[i].length < 0) {
+            this->entries[i].offset = this->entries.size();
+            this->entries.resize(this->entries.size() + (1 << this->entries[i].value), entry_t { 0, 0, 0 });
+        }
+    }
+
+    for (int k = 0; k < num; ++k) {
+        uint8_t length = lengths[k];
+        uint8_t val    = value ? value(k) : k;
+        if (length == 0)
+            continue;
+        if (length <= bits) {
+            int first = codes[k] << (bits - length);
+            for (int i = 0; i < (1 << (bits - length)); ++i)
+                this->entries[first + i] = entry_t { val, (int8_t)length, 0 };
+        } else {
+            const entry_t& e = this->entries[codes[k] >> (length - bits)];
+            uint8_t sub_bits = e.value;
+            int first = e.offset + ((codes[k] & ((1 << (length - bits)) - 1)) << (sub_bits - (length - bits)));
+            for (int i = 0; i < (1 << (sub_bits - (length - bits))); ++i)
+                this->entries[first + i] = entry_t { val, (int8_t)length, 0 };
+        }
+    }
+}
+
+inline uint8_t vlc_table_t::decode(Interpreter* dp) const
+{
+    uint32_t code = dp->peek_bits(PEEK_BITS);
+    const entry_t* e = &this->entries[code >> (PEEK_BITS - this->bits)];
+    if (e->length < 0) {
+        uint8_t sub_bits = e->value;
+        e = &this->entries[e->offset + ((code >> (PEEK_BITS - this->bits - sub_bits)) & ((1 << sub_bits) - 1))];
+    }
+
+    assert(e->length > 0);
+    dp->skip_bits(e->length);
+    return e->value;
+}
+
+static uint8_t coeff_token_value(int k)
+{
+    int TrailingOnes = k / 17;
+    int TotalCoeff   = k % 17;
+    return (TotalCoeff << 2) | (TrailingOnes);
+}
+
+static const vlc_table_t coeff_token_tables[5] = {
+    { 8, 4 * 17, coeff_token_length[0][0], coeff_token_code[0][0], coeff_token_value },
+    { 8, 4 * 17, coeff_token_length[1][0], coeff_token_code[1][0], coeff_token_value },
+    { 8, 4 * 17, coeff_token_length[2][0], coeff_token_code[2][0], coeff_token_value },
+    { 8, 4 * 17, coeff_token_length[3][0], coeff_token_code[3][0], coeff_token_value },
+    { 8, 4 * 17, coeff_token_length[4][0], coeff_token_code[4][0], coeff_token_value }
+};
+
+#define TOTAL_ZEROS_TABLE(yuv, tab) \
+    { 9, 16, total_zeros_length[yuv][tab], total_zeros_code[yuv][tab] }
+
+static const vlc_table_t total_zeros_tables_420[3] = {
+    TOTAL_ZEROS_TABLE(0,  0), TOTAL_ZEROS_TABLE(0,  1), TOTAL_ZEROS_TABLE(0,  2)
+};
+static const vlc_table_t total_zeros_tables_422[7] = {
+    TOTAL_ZEROS_TABLE(1,  0), TOTAL_ZEROS_TABLE(1,  1), TOTAL_ZEROS_TABLE(1,  2),
+    TOTAL_ZEROS_TABLE(1,  3), TOTAL_ZEROS_TABLE(1,  4), TOTAL_ZEROS_TABLE(1,  5),
+    TOTAL_ZEROS_TABLE(1,  6)
+};
+static const vlc_table_t total_zeros_tables_4x4[15] = {
+    TOTAL_ZEROS_TABLE(2,  0), TOTAL_ZEROS_TABLE(2,  1), TOTAL_ZEROS_TABLE(2,  2),
+    TOTAL_ZEROS_TABLE(2,  3), TOTAL_ZEROS_TABLE(2,  4), TOTAL_ZEROS_TABLE(2,  5),
+    TOTAL_ZEROS_TABLE(2,  6), TOTAL_ZEROS_TABLE(2,  7), TOTAL_ZEROS_TABLE(2,  8),
+    TOTAL_ZEROS_TABLE(2,  9), TOTAL_ZEROS_TABLE(2, 10), TOTAL_ZEROS_TABLE(2, 11),
+    TOTAL_ZEROS_TABLE(2, 12), TOTAL_ZEROS_TABLE(2, 13), TOTAL_ZEROS_TABLE(2, 14)
+};
+static const vlc_table_t* total_zeros_tables[3] = {
+    total_zeros_tables_420, total_zeros_tables_422, total_zeros_tables_4x4
+};
+
+#undef TOTAL_ZEROS_TABLE
+
+static const vlc_table_t run_before_tables[7] = {
+    { 11, 16, run_before_length[0], run_before_code[0] },
+    { 11, 16, run_before_length[1], run_before_code[1] },
+    { 11, 16, run_before_length[2], run_before_code[2] },
+    { 11, 16, run_before_length[3], run_before_code[3] },
+    { 11, 16, run_before_length[4], run_before_code[4] },
+    { 11, 16, run_before_length[5], run_before_code[5] },
+    { 11, 16, run_before_length[6], run_before_code[6] }
+};
+
+
 uint8_t Parser::SyntaxElement::coeff_token(int nC)
 {
     InterpreterRbsp* dp = &slice.parser.partArr[slice.parser.dp_mode ? (mb.is_intra_block ? 1 : 2) : 0];
@@ -618,21 +743,9 @@ uint8_t Parser::SyntaxElement::coeff_token(int nC)
         return (TotalCoeff << 2) | (TrailingOnes);
     }
 
-    int tab = (nC == -2) ? 4 : (nC == -1) ? 3 : (nC < 2) ? 0 : (nC < 4) ? 1 : (nC < 8) ? 2 : 5;
-
-    for (int TrailingOnes = 0; TrailingOnes < 4; TrailingOnes++) {
-        for (int TotalCoeff = 0; TotalCoeff < 17; TotalCoeff++) {
-            int length = coeff_token_length[tab][TrailingOnes][TotalCoeff];
-            int code   = coeff_token_code  [tab][TrailingOnes][TotalCoeff];
-            if (length > 0 && dp->next_bits(length) == code) {
-                dp->read_bits(length);
-                return (TotalCoeff << 2) | (TrailingOnes);
-            }
-        }
-    }
+    int tab = (nC == -2) ? 4 : (nC == -1) ? 3 : (nC < 2) ? 0 : (nC < 4) ? 1 : 2;
 
-    assert(false);
-    return -1;
+    return coeff_token_tables[tab].decode(dp);
 }
 
 uint8_t Parser::SyntaxElement::total_zeros(int yuv, int tzVlcIndex)
@@ -641,17 +754,7 @@ uint8_t Parser::SyntaxElement::total_zeros(int yuv, int tzVlcIndex)
 
     int tab = tzVlcIndex - 1;
 
-    for (int total_zeros = 0; total_zeros < 16; total_zeros++) {
-        int length = total_zeros_length[yuv][tab][total_zeros];
-        int code   = total_zeros_code  [yuv][tab][total_zeros];
-        if (length > 0 && dp->next_bits(length) == code) {
-            dp->read_bits(length);
-            return total_zeros;
-        }
-    }
-
-    assert(false);
-    return -1;
+    return total_zeros_tables[yuv][tab].decode(dp);
 }
 
 uint8_t Parser::SyntaxElement::run_before(uint8_t zerosLeft)
@@ -660,19 +763,8 @@ uint8_t Parser::SyntaxElement::run_before(uint8_t zerosLeft)
 
     int tab = min<int>(zerosLeft, 7) - 1;
 
-    for (int run_before = 0; run_before < 16; run_before++) {
-        int length = run_before_length[tab][run_before];
-        int code   = run_before_code  [tab][run_before];
-        if (length > 0 && dp->next_bits(length) == code) {
-            dp->read_bits(length);
-            return run_before;
-        }
-    }
-
-    assert(false);
-    return -1;
+    return run_before_tables[tab].decode(dp);
 }
 
-
 }
 }
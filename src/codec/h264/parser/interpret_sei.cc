@@ -55,7 +55,8 @@ struct tone_mapping_t {
 };
 
 // tone map using the look-up-table generated according to SEI tone mapping message
-void tone_map (px_t** imgX, px_t* lut, int size_x, int size_y)
+template <typename px_t>
+void tone_map (px_t** imgX, const uint16_t* lut, int size_x, int size_y)
 {
     for (int i = 0; i < size_y; ++i) {
         for (int j = 0; j < size_x; ++j)
@@ -63,6 +64,9 @@ void tone_map (px_t** imgX, px_t* lut, int size_x, int size_y)
     }
 }
 
+template void tone_map<uint8_t >(uint8_t**  imgX, const uint16_t* lut, int size_x, int size_y);
+template void tone_map<uint16_t>(uint16_t** imgX, const uint16_t* lut, int size_x, int size_y);
+
 void init_tone_mapping_sei(ToneMappingSEI *seiToneMapping) 
 {
     seiToneMapping->seiHasTone_mapping = 0;
@@ -956,31 +960,31 @@ void InterpreterSEI::tone_mapping_info(uint32_t payloadSize)
                     p_Vid->seiToneMapping->lut[i] = 0;
 
                 for (int i = seiToneMappingTmp.min_value + 1; i < seiToneMappingTmp.max_value; ++i)
-                    p_Vid->seiToneMapping->lut[i] = (px_t) ((i-seiToneMappingTmp.min_value) * (max_output_num-1)/(seiToneMappingTmp.max_value- seiToneMappingTmp.min_value));
+                    p_Vid->seiToneMapping->lut[i] = (uint16_t) ((i-seiToneMappingTmp.min_value) * (max_output_num-1)/(seiToneMappingTmp.max_value- seiToneMappingTmp.min_value));
 
                 for (int i = seiToneMappingTmp.max_value; i < max_coded_num; ++i)
-                    p_Vid->seiToneMapping->lut[i] = (px_t) (max_output_num - 1);
+                    p_Vid->seiToneMapping->lut[i] = (uint16_t) (max_output_num - 1);
                 break;
             case 1: // sigmoid mapping
                 for (int i = 0; i < max_coded_num; ++i) {
                     double tmp = 1.0 + exp( -6*(double)(i-seiToneMappingTmp.sigmoid_midpoint)/seiToneMappingTmp.sigmoid_width);
-                    p_Vid->seiToneMapping->lut[i] = (px_t)( (double)(max_output_num-1)/ tmp + 0.5);
+                    p_Vid->seiToneMapping->lut[i] = (uint16_t)( (double)(max_output_num-1)/ tmp + 0.5);
                 }
                 break;
             case 2: // user defined table
                 if (0 < max_output_num - 1) {
                     for (int j = 0; j < max_output_num - 1; ++j) {
                         for (int i = seiToneMappingTmp.start_of_coded_interval[j]; i<seiToneMappingTmp.start_of_coded_interval[j+1]; i++) 
-                            p_Vid->seiToneMapping->lut[i] = (px_t) j;
+                            p_Vid->seiToneMapping->lut[i] = (uint16_t) j;
                     }
-                    p_Vid->seiToneMapping->lut[i] = (px_t) (max_output_num - 1);
+                    p_Vid->seiToneMapping->lut[i] = (uint16_t) (max_output_num - 1);
                 }
                 break;
             case 3: // piecewise linear mapping
                 for (int j = 0; j < seiToneMappingTmp.num_pivots + 1; ++j) {
                     double slope = (double)(seiToneMappingTmp.target_pivot_value[j+1] - seiToneMappingTmp.target_pivot_value[j])/(seiToneMappingTmp.coded_pivot_value[j+1]-seiToneMappingTmp.coded_pivot_value[j]);
                     for (int i = seiToneMappingTmp.coded_pivot_value[j]; i <= seiToneMappingTmp.coded_pivot_value[j+1]; i++) 
-                        p_Vid->seiToneMapping->lut[i] = (px_t) (seiToneMappingTmp.target_pivot_value[j] + (int)(( (i - seiToneMappingTmp.coded_pivot_value[j]) * slope)));
+                        p_Vid->seiToneMapping->lut[i] = (uint16_t) (seiToneMappingTmp.target_pivot_value[j] + (int)(( (i - seiToneMappingTmp.coded_pivot_value[j]) * slope)));
                 }
                 break;
             default:
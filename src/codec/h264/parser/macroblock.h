@@ -75,8 +75,19 @@ enum {
     B_4x4          =  7
 };
 
+// Syntax element values that only the macroblocks to the right and below
+// look at while parsing. Slices keep them for the last two macroblock rows
+// (pair rows for MBAFF) instead of for every macroblock of the picture.
+struct mb_ctx_t {
+    int16_t     mvd_l0  [4][4][2];
+    int16_t     mvd_l1  [4][4][2];
+    uint8_t     nz_coeff[3][4][4]; // cavlc
+    uint64_t    cbp_bits[3];       // cabac
+};
+
 struct macroblock_t {
     slice_t*    p_Slice;
+    mb_ctx_t*   ctx;
     int         mbAddrX;
 
     struct {
@@ -84,6 +95,13 @@ struct macroblock_t {
         int32_t y;
     } mb;
 
+    // Left, above, above right and above left macroblocks of the same slice
+    // (the top macroblocks of those pairs for MBAFF), nullptr if unavailable
+    macroblock_t* mbA;
+    macroblock_t* mbB;
+    macroblock_t* mbC;
+    macroblock_t* mbD;
+
     bool        is_intra_block;
 
     short       slice_nr;
@@ -102,8 +120,6 @@ struct macroblock_t {
     uint8_t     intra_chroma_pred_mode;
     uint8_t     ref_idx_l0[4];
     uint8_t     ref_idx_l1[4];
-    int16_t     mvd_l0    [4][4][2];
-    int16_t     mvd_l1    [4][4][2];
 
     uint8_t     SubMbType    [4];
     uint8_t     SubMbPredMode[4];
@@ -119,15 +135,7 @@ struct macroblock_t {
     uint8_t     qp_scaled[3];
     bool        TransformBypassModeFlag;
 
-    uint8_t     nz_coeff[3][4][4]; // cavlc
-    uint64_t    cbp_bits[3];       // cabac
-    uint64_t    cbp_blks[3];       // deblock
-
-    bool        fieldMbInFrameFlag;
-    bool        filterVerEdgeFlag[2][4];
-    bool        filterHorEdgeFlag[2][5];
-    uint8_t     strength_ver[4][16]; // bS
-    uint8_t     strength_hor[5][16]; // bS
+    uint64_t    cbp_blks[3];       // deblock, residual blocks
 
     void        create(slice_t& slice);
     void        init(slice_t& slice);
@@ -84,25 +84,25 @@ mb_t* Neighbour::get_mb(slice_t* slice, bool chroma, int mbAddr, const pos_t& of
     int maxW = !chroma ? 16 : sps.MbWidthC;
     int maxH = !chroma ? 16 : sps.MbHeightC;
 
-    loc_t loc {};
-
+    mb_t* curr = &this->mb_data[mbAddr];
     if (!shr.MbaffFrameFlag) {
-        loc.x = mbAddr % sps.PicWidthInMbs * maxW;
-        loc.y = mbAddr / sps.PicWidthInMbs * maxH;
-        loc.x += offset.x;
+        if (offset.y < 0)
+            return offset.x < 0 ? curr->mbD : offset.x < maxW ? curr->mbB : curr->mbC;
+        if (offset.y >= maxH || offset.x >= maxW)
+            return nullptr;
+        return offset.x < 0 ? curr->mbA : curr;
+    }
+
+    loc_t loc {};
+    loc.x = (mbAddr / 2) % sps.PicWidthInMbs * maxW;
+    loc.y = (mbAddr / 2) / sps.PicWidthInMbs * maxH * 2;
+    loc.x += offset.x;
+    if (curr->mb_field_decoding_flag == 0) {
+        loc.y += mbAddr % 2 * maxH;
         loc.y += offset.y;
     } else {
-        loc.x = (mbAddr / 2) % sps.PicWidthInMbs * maxW;
-        loc.y = (mbAddr / 2) / sps.PicWidthInMbs * maxH * 2;
-        mb_t* mb = &this->mb_data[mbAddr];
-        loc.x += offset.x;
-        if (mb->mb_field_decoding_flag == 0) {
-            loc.y += mbAddr % 2 * maxH;
-            loc.y += offset.y;
-        } else {
-            loc.y += mbAddr % 2;
-            loc.y += offset.y * 2;
-        }
+        loc.y += mbAddr % 2;
+        loc.y += offset.y * 2;
     }
 
     if (loc.x < 0 || loc.x >= sps.PicWidthInMbs * maxW)
@@ -110,14 +110,17 @@ mb_t* Neighbour::get_mb(slice_t* slice, bool chroma, int mbAddr, const pos_t& of
     if (loc.y < 0 || loc.y >= shr.PicHeightInMbs * maxH)
         return nullptr;
 
-    mbAddr = (shr.MbaffFrameFlag == 0) ?
-        ((loc.y / maxH) * sps.PicWidthInMbs + (loc.x / maxW)) :
-        ((loc.y / (maxH * 2)) * sps.PicWidthInMbs + (loc.x / maxW)) * 2;
+    mbAddr = ((loc.y / (maxH * 2)) * sps.PicWidthInMbs + (loc.x / maxW)) * 2;
+    // Macroblocks before the slice start belong to another slice, which may
+    // still be decoding on another thread, so don't look at them at all
+    if (mbAddr < (int)shr.first_mb_in_slice * 2)
+        return nullptr;
 
     mb_t* mb = &this->mb_data[mbAddr];
-    if (shr.MbaffFrameFlag)
-        mb += ((mb->mb_field_decoding_flag == 0) ? (loc.y & maxH) : (loc.y & 1)) ? 1 : 0;
-    return mb;
+    mb += ((mb->mb_field_decoding_flag == 0) ? (loc.y & maxH) : (loc.y & 1)) ? 1 : 0;
+    // later macroblocks of the slice may be parsed already when the picture
+    // is reconstructed on the pipeline, they are still not available
+    return mb->slice_nr == curr->slice_nr && mb <= curr ? mb : nullptr;
 }
 
 nb_t Neighbour::get_neighbour(slice_t* slice, bool chroma, int mbAddr, const pos_t& offset)
@@ -128,25 +131,24 @@ nb_t Neighbour::get_neighbour(slice_t* slice, bool chroma, int mbAddr, const pos
     int maxW = !chroma ? 16 : sps.MbWidthC;
     int maxH = !chroma ? 16 : sps.MbHeightC;
 
-    loc_t loc {};
-
+    mb_t* curr = &this->mb_data[mbAddr];
     if (!shr.MbaffFrameFlag) {
-        loc.x = mbAddr % sps.PicWidthInMbs * maxW;
-        loc.y = mbAddr / sps.PicWidthInMbs * maxH;
-        loc.x += offset.x;
+        mb_t* mb = this->get_mb(slice, chroma, mbAddr, offset);
+        if (!mb)
+            return {nullptr, 0, 0};
+        return {mb, curr->mb.x * maxW + offset.x, curr->mb.y * maxH + offset.y};
+    }
+
+    loc_t loc {};
+    loc.x = (mbAddr / 2) % sps.PicWidthInMbs * maxW;
+    loc.y = (mbAddr / 2) / sps.PicWidthInMbs * maxH * 2;
+    loc.x += offset.x;
+    if (curr->mb_field_decoding_flag == 0) {
+        loc.y += mbAddr % 2 * maxH;
         loc.y += offset.y;
     } else {
-        loc.x = (mbAddr / 2) % sps.PicWidthInMbs * maxW;
-        loc.y = (mbAddr / 2) / sps.PicWidthInMbs * maxH * 2;
-        mb_t* mb = &this->mb_data[mbAddr];
-        loc.x += offset.x;
-        if (mb->mb_field_decoding_flag == 0) {
-            loc.y += mbAddr % 2 * maxH;
-            loc.y += offset.y;
-        } else {
-            loc.y += mbAddr % 2;
-            loc.y += offset.y * 2;
-        }
+        loc.y += mbAddr % 2;
+        loc.y += offset.y * 2;
     }
 
     if (loc.x < 0 || loc.x >= sps.PicWidthInMbs * maxW)
@@ -154,20 +156,20 @@ nb_t Neighbour::get_neighbour(slice_t* slice, bool chroma, int mbAddr, const pos
     if (loc.y < 0 || loc.y >= shr.PicHeightInMbs * maxH)
         return {nullptr, 0, 0};
 
-    mbAddr = (shr.MbaffFrameFlag == 0) ?
-        ((loc.y / maxH) * sps.PicWidthInMbs + (loc.x / maxW)) :
-        ((loc.y / (maxH * 2)) * sps.PicWidthInMbs + (loc.x / maxW)) * 2;
+    mbAddr = ((loc.y / (maxH * 2)) * sps.PicWidthInMbs + (loc.x / maxW)) * 2;
+    if (mbAddr < (int)shr.first_mb_in_slice * 2)
+        return {nullptr, 0, 0};
 
     mb_t* mb = &this->mb_data[mbAddr];
     pos_t pos {loc.x, loc.y};
-    if (shr.MbaffFrameFlag) {
-        if (mb->mb_field_decoding_flag == 0)
-            mb += (loc.y & maxH) ? 1 : 0;
-        else {
-            mb += (loc.y & 1) ? 1 : 0;
-            pos.y = loc.y / (maxH * 2) * (maxH * 2) + (loc.y % (maxH * 2)) / 2 + (loc.y & 1) * maxH;
-        }
+    if (mb->mb_field_decoding_flag == 0)
+        mb += (loc.y & maxH) ? 1 : 0;
+    else {
+        mb += (loc.y & 1) ? 1 : 0;
+        pos.y = loc.y / (maxH * 2) * (maxH * 2) + (loc.y % (maxH * 2)) / 2 + (loc.y & 1) * maxH;
     }
+    if (mb->slice_nr != curr->slice_nr || mb > curr)
+        return {nullptr, 0, 0};
 
     return {mb, pos.x, pos.y};
 }
@@ -270,8 +272,6 @@ int Neighbour::predict_nnz(mb_t* mb, int pl, int i, int j)
 
     nb_t nbA = slice->neighbour.get_neighbour(slice, chroma, mb->mbAddrX, {i - 1, j});
     nb_t nbB = slice->neighbour.get_neighbour(slice, chroma, mb->mbAddrX, {i, j - 1});
-    nbA.mb = nbA.mb && nbA.mb->slice_nr == mb->slice_nr ? nbA.mb : nullptr;
-    nbB.mb = nbB.mb && nbB.mb->slice_nr == mb->slice_nr ? nbB.mb : nullptr;
 
     if (pps.constrained_intra_pred_flag && slice->parser.dp_mode == vio::h264::PAR_DP_3) {
         if (mb->is_intra_block) {
@@ -292,7 +292,7 @@ int Neighbour::predict_nnz(mb_t* mb, int pl, int i, int j)
         //else if (nbA.mb->mb_type == I_PCM)
         //    nA = 16;
         //else
-            nA = nbA.mb->nz_coeff[pl][(nbA.y % nH) / 4][(nbA.x % nW) / 4];
+            nA = nbA.mb->ctx->nz_coeff[pl][(nbA.y % nH) / 4][(nbA.x % nW) / 4];
     }
 
     uint8_t nB = 0;
@@ -304,7 +304,7 @@ int Neighbour::predict_nnz(mb_t* mb, int pl, int i, int j)
         //else if (nbB.mb->mb_type == I_PCM)
         //    nB = 16;
         //else
-            nB = nbB.mb->nz_coeff[pl][(nbB.y % nH) / 4][(nbB.x % nW) / 4];
+            nB = nbB.mb->ctx->nz_coeff[pl][(nbB.y % nH) / 4][(nbB.x % nW) / 4];
     }
 
     uint8_t nC = nA + nB;
@@ -324,8 +324,6 @@ uint8_t intra_4x4_pred_mode(mb_t& mb, int bx, int by)
     nb_t nbA = slice.neighbour.get_neighbour(&slice, false, mb.mbAddrX, {bx - 1, by});
     nb_t nbB = slice.neighbour.get_neighbour(&slice, false, mb.mbAddrX, {bx, by - 1});
 
-    nbA.mb = nbA.mb && nbA.mb->slice_nr == mb.slice_nr ? nbA.mb : nullptr;
-    nbB.mb = nbB.mb && nbB.mb->slice_nr == mb.slice_nr ? nbB.mb : nullptr;
 
     //get from array and decode
     if (pps.constrained_intra_pred_flag) {
@@ -366,8 +364,6 @@ uint8_t intra_8x8_pred_mode(mb_t& mb, int bx, int by)
 
     nb_t nbA = slice.neighbour.get_neighbour(&slice, false, mb.mbAddrX, {bx - 1, by});
     nb_t nbB = slice.neighbour.get_neighbour(&slice, false, mb.mbAddrX, {bx, by - 1});
-    nbA.mb = nbA.mb && nbA.mb->slice_nr == mb.slice_nr ? nbA.mb : nullptr;
-    nbB.mb = nbB.mb && nbB.mb->slice_nr == mb.slice_nr ? nbB.mb : nullptr;
 
     //get from array and decode
     if (pps.constrained_intra_pred_flag) {
@@ -416,8 +412,6 @@ int CtxIdxInc::mb_skip_flag()
 {
     mb_t* mbA = this->get_mb(&slice, false, mb.mbAddrX, {-1, 0});
     mb_t* mbB = this->get_mb(&slice, false, mb.mbAddrX, {0, -1});
-    mbA = mbA && mbA->slice_nr == mb.slice_nr ? mbA : nullptr;
-    mbB = mbB && mbB->slice_nr == mb.slice_nr ? mbB : nullptr;
 
     int condTermFlagA = mbA && !mbA->mb_skip_flag ? 1 : 0;
     int condTermFlagB = mbB && !mbB->mb_skip_flag ? 1 : 0;
@@ -428,17 +422,9 @@ int CtxIdxInc::mb_skip_flag()
 
 int CtxIdxInc::mb_field_decoding_flag()
 {
-    shr_t& shr = slice.header;
-
-    int topMbAddr = shr.MbaffFrameFlag ? mb.mbAddrX & ~1 : mb.mbAddrX;
-
-    mb_t* mbA = this->get_mb(&slice, false, topMbAddr, {-1, 0});
-    mb_t* mbB = this->get_mb(&slice, false, topMbAddr, {0, -1});
-    mbA = mbA && mbA->slice_nr == mb.slice_nr ? mbA : nullptr;
-    mbB = mbB && mbB->slice_nr == mb.slice_nr ? mbB : nullptr;
-
-    int condTermFlagA = mbA && mbA->mb_field_decoding_flag ? 1 : 0;
-    int condTermFlagB = mbB && mbB->mb_field_decoding_flag ? 1 : 0;
+    // both macroblocks of the left and above pairs share the flag
+    int condTermFlagA = mb.mbA && mb.mbA->mb_field_decoding_flag ? 1 : 0;
+    int condTermFlagB = mb.mbB && mb.mbB->mb_field_decoding_flag ? 1 : 0;
     int ctxIdxInc = condTermFlagA + condTermFlagB;
 
     return ctxIdxInc;
@@ -448,8 +434,6 @@ int CtxIdxInc::mb_type_si_slice()
 {
     mb_t* mbA = this->get_mb(&slice, false, mb.mbAddrX, {-1, 0});
     mb_t* mbB = this->get_mb(&slice, false, mb.mbAddrX, {0, -1});
-    mbA = mbA && mbA->slice_nr == mb.slice_nr ? mbA : nullptr;
-    mbB = mbB && mbB->slice_nr == mb.slice_nr ? mbB : nullptr;
 
     int condTermFlagA = mbA && mbA->mb_type != SI ? 1 : 0;
     int condTermFlagB = mbB && mbB->mb_type != SI ? 1 : 0;
@@ -462,8 +446,6 @@ int CtxIdxInc::mb_type_i_slice()
 {
     mb_t* mbA = this->get_mb(&slice, false, mb.mbAddrX, {-1, 0});
     mb_t* mbB = this->get_mb(&slice, false, mb.mbAddrX, {0, -1});
-    mbA = mbA && mbA->slice_nr == mb.slice_nr ? mbA : nullptr;
-    mbB = mbB && mbB->slice_nr == mb.slice_nr ? mbB : nullptr;
 
     int condTermFlagA = mbA && mbA->mb_type != I_4x4 && mbA->mb_type != I_8x8 ? 1 : 0;
     int condTermFlagB = mbB && mbB->mb_type != I_4x4 && mbB->mb_type != I_8x8 ? 1 : 0;
@@ -476,8 +458,6 @@ int CtxIdxInc::mb_type_b_slice()
 {
     mb_t* mbA = this->get_mb(&slice, false, mb.mbAddrX, {-1, 0});
     mb_t* mbB = this->get_mb(&slice, false, mb.mbAddrX, {0, -1});
-    mbA = mbA && mbA->slice_nr == mb.slice_nr ? mbA : nullptr;
-    mbB = mbB && mbB->slice_nr == mb.slice_nr ? mbB : nullptr;
 
     int condTermFlagA = mbA && mbA->mb_type != 0 ? 1 : 0;
     int condTermFlagB = mbB && mbB->mb_type != 0 ? 1 : 0;
@@ -490,8 +470,6 @@ int CtxIdxInc::transform_size_8x8_flag()
 {
     mb_t* mbA = this->get_mb(&slice, false, mb.mbAddrX, {-1, 0});
     mb_t* mbB = this->get_mb(&slice, false, mb.mbAddrX, {0, -1});
-    mbA = mbA && mbA->slice_nr == mb.slice_nr ? mbA : nullptr;
-    mbB = mbB && mbB->slice_nr == mb.slice_nr ? mbB : nullptr;
 
     int condTermFlagA = mbA && mbA->transform_size_8x8_flag ? 1 : 0;
     int condTermFlagB = mbB && mbB->transform_size_8x8_flag ? 1 : 0;
@@ -504,8 +482,6 @@ int CtxIdxInc::intra_chroma_pred_mode()
 {
     mb_t* mbA = this->get_mb(&slice, false, mb.mbAddrX, {-1, 0});
     mb_t* mbB = this->get_mb(&slice, false, mb.mbAddrX, {0, -1});
-    mbA = mbA && mbA->slice_nr == mb.slice_nr ? mbA : nullptr;
-    mbB = mbB && mbB->slice_nr == mb.slice_nr ? mbB : nullptr;
 
     int condTermFlagA = mbA && mbA->intra_chroma_pred_mode != 0 && mbA->mb_type != I_PCM ? 1 : 0;
     int condTermFlagB = mbB && mbB->intra_chroma_pred_mode != 0 && mbB->mb_type != I_PCM ? 1 : 0;
@@ -520,8 +496,6 @@ int CtxIdxInc::ref_idx_l(uint8_t list, uint8_t x0, uint8_t y0)
 
     nb_t nbA = this->get_neighbour(&slice, false, mb.mbAddrX, {x0 * 4 - 1, y0 * 4});
     nb_t nbB = this->get_neighbour(&slice, false, mb.mbAddrX, {x0 * 4, y0 * 4 - 1});
-    nbA.mb = nbA.mb && nbA.mb->slice_nr == mb.slice_nr ? nbA.mb : nullptr;
-    nbB.mb = nbB.mb && nbB.mb->slice_nr == mb.slice_nr ? nbB.mb : nullptr;
 
     int condTermFlagA = 0;
     int condTermFlagB = 0;
@@ -577,8 +551,6 @@ int CtxIdxInc::mvd_l(uint8_t list, uint8_t x0, uint8_t y0, bool compIdx)
 
     nb_t nbA = this->get_neighbour(&slice, false, mb.mbAddrX, {x0 * 4 - 1, y0 * 4});
     nb_t nbB = this->get_neighbour(&slice, false, mb.mbAddrX, {x0 * 4, y0 * 4 - 1});
-    nbA.mb = nbA.mb && nbA.mb->slice_nr == mb.slice_nr ? nbA.mb : nullptr;
-    nbB.mb = nbB.mb && nbB.mb->slice_nr == mb.slice_nr ? nbB.mb : nullptr;
 
     int absMvdCompA = 0;
     int absMvdCompB = 0;
@@ -594,7 +566,7 @@ int CtxIdxInc::mvd_l(uint8_t list, uint8_t x0, uint8_t y0, bool compIdx)
 
         if (!(nbA.mb->mb_type == P_Skip || nbA.mb->mb_type == B_Skip ||
               nbA.mb->is_intra_block || predModeEqualFlagA == 0)) {
-            auto mvd_lX = (list == 0) ? nbA.mb->mvd_l0 : nbA.mb->mvd_l1;
+            auto mvd_lX = (list == 0) ? nbA.mb->ctx->mvd_l0 : nbA.mb->ctx->mvd_l1;
             absMvdCompA = abs(mvd_lX[(nbA.y & 15) / 4][(nbA.x & 15) / 4][compIdx]);
             if (shr.MbaffFrameFlag && compIdx) {
                 if (!mb.mb_field_decoding_flag && nbA.mb->mb_field_decoding_flag)
@@ -614,7 +586,7 @@ int CtxIdxInc::mvd_l(uint8_t list, uint8_t x0, uint8_t y0, bool compIdx)
 
         if (!(nbB.mb->mb_type == P_Skip || nbB.mb->mb_type == B_Skip ||
               nbB.mb->is_intra_block || predModeEqualFlagB == 0)) {
-            auto mvd_lX = (list == 0) ? nbB.mb->mvd_l0 : nbB.mb->mvd_l1;
+            auto mvd_lX = (list == 0) ? nbB.mb->ctx->mvd_l0 : nbB.mb->ctx->mvd_l1;
             absMvdCompB = abs(mvd_lX[(nbB.y & 15) / 4][(nbB.x & 15) / 4][compIdx]);
             if (shr.MbaffFrameFlag && compIdx) {
                 if (!mb.mb_field_decoding_flag && nbB.mb->mb_field_decoding_flag)
@@ -636,8 +608,6 @@ int CtxIdxInc::coded_block_pattern_luma(uint8_t x0, uint8_t y0, uint8_t coded_bl
 {
     nb_t nbA = this->get_neighbour(&slice, false, mb.mbAddrX, {x0 * 4 - 1, y0 * 4});
     nb_t nbB = this->get_neighbour(&slice, false, mb.mbAddrX, {x0 * 4, y0 * 4 - 1});
-    nbA.mb = nbA.mb && nbA.mb->slice_nr == mb.slice_nr ? nbA.mb : nullptr;
-    nbB.mb = nbB.mb && nbB.mb->slice_nr == mb.slice_nr ? nbB.mb : nullptr;
 
     int cbp_a = 0x3F, cbp_b = 0x3F;
     int cbp_a_idx = 0, cbp_b_idx = 0;
@@ -671,8 +641,6 @@ int CtxIdxInc::coded_block_pattern_chroma()
 {
     mb_t* mbA = this->get_mb(&slice, false, mb.mbAddrX, {-1, 0});
     mb_t* mbB = this->get_mb(&slice, false, mb.mbAddrX, {0, -1});
-    mbA = mbA && mbA->slice_nr == mb.slice_nr ? mbA : nullptr;
-    mbB = mbB && mbB->slice_nr == mb.slice_nr ? mbB : nullptr;
 
     int condTermFlagA = mbA && (mbA->mb_type == I_PCM || mbA->CodedBlockPatternChroma) ? 1 : 0;
     int condTermFlagB = mbB && (mbB->mb_type == I_PCM || mbB->CodedBlockPatternChroma) ? 1 : 0;
@@ -709,8 +677,6 @@ int coded_block_flag_ctxIdxInc(mb_t& mb, int pl, bool chroma, bool ac, int blkId
 
     nb_t nbA = slice.neighbour.get_neighbour(&slice, chroma, mb.mbAddrX, {i * 4 - 1, j * 4});
     nb_t nbB = slice.neighbour.get_neighbour(&slice, chroma, mb.mbAddrX, {i * 4, j * 4 - 1});
-    nbA.mb = nbA.mb && nbA.mb->slice_nr == mb.slice_nr ? nbA.mb : nullptr;
-    nbB.mb = nbB.mb && nbB.mb->slice_nr == mb.slice_nr ? nbB.mb : nullptr;
 
     int nW = !chroma ? 16 : sps.MbWidthC;
     int nH = !chroma ? 16 : sps.MbHeightC;
@@ -728,13 +694,13 @@ int coded_block_flag_ctxIdxInc(mb_t& mb, int pl, bool chroma, bool ac, int blkId
         if (nbA.mb->mb_type == I_PCM)
             condTermFlagA = 1;
         else
-            condTermFlagA = (nbA.mb->cbp_bits[temp_pl] >> (bit + bit_pos_a)) & 1;
+            condTermFlagA = (nbA.mb->ctx->cbp_bits[temp_pl] >> (bit + bit_pos_a)) & 1;
     }
     if (nbB.mb) {
         if (nbB.mb->mb_type == I_PCM)
             condTermFlagB = 1;
         else
-            condTermFlagB = (nbB.mb->cbp_bits[temp_pl] >> (bit + bit_pos_b)) & 1;
+            condTermFlagB = (nbB.mb->ctx->cbp_bits[temp_pl] >> (bit + bit_pos_b)) & 1;
     }
     int ctxIdxInc = condTermFlagA + 2 * condTermFlagB;
 
@@ -760,7 +726,7 @@ void update_coded_block_flag(mb_t* mb, int pl, bool chroma, bool ac, int blkIdx)
     int cbp = (mb->transform_size_8x8_flag && !chroma && ac ? 0x33 : 0x01);
     int bit = (y_dc ? 0 : y_ac ? 1 : u_dc ? 17 : v_dc ? 18 : u_ac ? 19 : 35) + (ac ? j * 4 + i : 0);
 
-    mb->cbp_bits[temp_pl] |= ((uint64_t)cbp << bit);
+    mb->ctx->cbp_bits[temp_pl] |= ((uint64_t)cbp << bit);
 }
 
     
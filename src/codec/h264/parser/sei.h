@@ -14,14 +14,15 @@ typedef struct tone_mapping_struct_s {
     unsigned int  model_id;
     unsigned int  count;
 
-    px_t lut[1<<MAX_CODED_BIT_DEPTH];       //<! look up table for mapping the coded data value to output data value
+    uint16_t lut[1<<MAX_CODED_BIT_DEPTH];      //<! look up table for mapping the coded data value to output data value
 
     int        payloadSize;
 } ToneMappingSEI;
 
 struct slice_t;
 
-void tone_map               (px_t **imgX, px_t *lut, int size_x, int size_y);
+template <typename px_t>
+void tone_map               (px_t **imgX, const uint16_t *lut, int size_x, int size_y);
 void init_tone_mapping_sei  (ToneMappingSEI *seiToneMapping);
 void update_tone_mapping_sei(ToneMappingSEI *seiToneMapping);
 
@@ -74,6 +74,7 @@ enum {
 
 struct nal_unit_t {
     static const uint32_t MAX_NAL_UNIT_SIZE = 8000000;
+    static const uint32_t PADDING_SIZE      = 8; // for 64-bit cache loads beyond the last byte
 
     enum {
         NALU_TYPE_SLICE    =  1,
@@ -101,8 +102,9 @@ struct nal_unit_t {
     uint32_t    max_size;
 
     uint32_t    num_bytes_in_nal_unit;
-    uint32_t    num_bytes_in_rbsp;
-    uint8_t*    rbsp_byte;
+    const uint8_t* nal_unit_byte;         //!< into the mapped byte stream, or into buffer
+    std::vector<uint32_t> emulation_prevention; //!< offsets of the emulation_prevention_three_bytes
+    std::vector<uint8_t>  buffer;         //!< bytes that cannot be referred to in place
 
     bool        forbidden_zero_bit;                                   // f(1)
     uint8_t     nal_ref_idc;                                          // u(2)
@@ -119,12 +121,10 @@ struct nal_unit_t {
     bool        reserved_one_bit;                                     // u(1)
 
     nal_unit_t(uint32_t size=MAX_NAL_UNIT_SIZE) :
-        max_size { size }, rbsp_byte { new uint8_t[size] } {}
+        max_size { size }, num_bytes_in_nal_unit { 0 }, nal_unit_byte { nullptr } {}
 
-    ~nal_unit_t() {
-        if (this->rbsp_byte)
-            delete []this->rbsp_byte;
-    }
+    // whether nal_unit_byte refers to the byte stream, which outlives the NAL unit
+    bool        in_place() const { return this->nal_unit_byte != this->buffer.data(); }
 };
 
 
@@ -257,6 +257,14 @@ typedef struct seq_parameter_set_t {
     uint32_t    FrameHeightInMbs;
     uint8_t     CropUnitX;
     uint8_t     CropUnitY;
+    uint32_t    CropLeftL;
+    uint32_t    CropTopL;
+    uint32_t    CropWidthL;
+    uint32_t    CropHeightL;
+    uint32_t    CropLeftC;
+    uint32_t    CropTopC;
+    uint32_t    CropWidthC;
+    uint32_t    CropHeightC;
     uint8_t     MaxDpbFrames;
 } sps_t;
 
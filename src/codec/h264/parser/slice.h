@@ -18,6 +18,7 @@ struct cabac_contexts_t;
 
 using vio::h264::cabac_contexts_t;
 using vio::h264::mb_t;
+using vio::h264::mb_ctx_t;
 
 using vio::h264::Neighbour;
 using vio::h264::Parser;
@@ -149,6 +150,10 @@ struct slice_t {
     int               ref_flag[17]; //!< 0: i-th previous frame is incorrect
     char              RefPicSize[2];
     storable_picture* RefPicList[2][33];
+    uint8_t           RefPicId[2][3][33]; //!< dec_picture->ref_pics ids of RefPicList frames, top and bottom fields
+    int16_t           implicit_weight[3][32][32]; //!< implicit bi-pred w1 (w0 = 64 - w1) of frame, top and bottom field macroblocks
+    int16_t           DistScaleFactor[3][32]; //!< temporal direct scaling of list 0 references, 9999 to keep mvCol
+    storable_picture* colocated_field; //!< field of RefPicList[1][0] read for colocated motion of the other structure
 
     unsigned    num_dec_mb;
     short       current_slice_nr;
@@ -160,13 +165,18 @@ struct slice_t {
 
     int         listinterviewidx0;
     int         listinterviewidx1;
-    pic_t**     fs_listinterview0;
-    pic_t**     fs_listinterview1;
+    pic_t*      fs_listinterview0[MAX_LIST_SIZE];
+    pic_t*      fs_listinterview1[MAX_LIST_SIZE];
 
     int         dpB_NotPresent;    //!< non-zero, if data partition B is lost
     int         dpC_NotPresent;    //!< non-zero, if data partition C is lost
 
-    px_t***     mb_pred; // IntraPrediction()
+    // IntraPrediction(), read as 8 or 16-bit samples as dec_picture->px_size says
+    template <typename px_t>
+    px_t      (*mb_pred(int pl))[16] { return reinterpret_cast<px_t (*)[16][16]>(this->mb_pred_data)[pl]; }
+    alignas(16) uint16_t mb_pred_data[3][16][16];
+
+    std::vector<mb_ctx_t> mb_ctx; //!< parse context of the last two macroblock (pair) rows
 
     Neighbour   neighbour;
     Parser      parser;
@@ -177,16 +187,18 @@ struct slice_t {
     storable_picture* dec_picture;
 
     slice_t();
-    ~slice_t();
 
     void        init_lists    ();
     void        init_ref_lists();
+    void        init_list_factors();
+    void        copy_ref_lists(const slice_t& slice);
+    bool        same_ref_lists(const slice_t& slice) const;
 
     void        decode_poc();
     void        init_slice_group_map();
 
     int         NextMbAddress(int n);
-    void        init();
+    void        init(const slice_t* same);
     void        decode();
 
     bool        operator!=(const slice_t& slice);
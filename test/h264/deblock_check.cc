@@ -0,0 +1,143 @@
+/*
+ * =============================================================================
+ *
+ *   This confidential and proprietary software may be used only
+ *  as authorized by a licensing agreement from Thumb o'Cat Inc.
+ *  In the event of publication, the following notice is applicable:
+ *
+ *       Copyright (C) 2013 - 2013 Thumb o'Cat
+ *                     All right reserved.
+ *
+ *   The entire notice above must be reproduced on all authorized copies.
+ *
+ * =============================================================================
+ *
+ *  File      : deblock_check.cc
+ *  Author(s) : Luuvish
+ *  Version   : 1.0
+ *  Revision  :
+ *      1.0 June 16, 2013    first release
+ *
+ * =============================================================================
+ */
+
+// Compares filter_lines against filter_normal and filter_strong on random
+// edges: 8, 10 and 12-bit samples, vertical and horizontal edges, luma and
+// chroma style filtering. Exits non-zero on the first mismatch.
+//
+//   deblock_check [iterations [seed]]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+#include "deblock_filter.h"
+
+using namespace vio::h264;
+
+
+#if defined(__SSE2__)
+
+// 8 lines of 8 samples across the edge at column or row 4 of a 16x16 block
+static const int STRIDE = 16;
+
+template <typename px_t>
+static bool check(std::mt19937& rng, int BitDepth, bool verticalEdgeFlag, bool chromaStyleFilteringFlag)
+{
+    int maxval = (1 << BitDepth) - 1;
+    int scale  = 1 << (BitDepth - 8);
+
+    // the limits of TABLE_ALPHA, TABLE_BETA and TABLE_TC0
+    int alpha = std::uniform_int_distribution<int>(0, 255 * scale)(rng);
+    int beta  = std::uniform_int_distribution<int>(0,  18 * scale)(rng);
+
+    px_t simd[STRIDE * STRIDE];
+    px_t ref [STRIDE * STRIDE];
+    int16_t bS[8], tc0[8];
+
+    // samples close to a base value so that most lines pass the alpha and
+    // beta tests, with the odd outlier to exercise the others
+    int base   = std::uniform_int_distribution<int>(0, maxval)(rng);
+    int spread = std::uniform_int_distribution<int>(0, 2)(rng) == 0 ? maxval : std::max(alpha, 4);
+    std::uniform_int_distribution<int> sample(-spread / 2, spread / 2);
+    for (int i = 0; i < STRIDE * STRIDE; ++i)
+        ref[i] = simd[i] = (px_t) clip3(0, maxval, base + sample(rng));
+
+    for (int pel = 0; pel < 8; ++pel) {
+        bS [pel] = std::uniform_int_distribution<int>(0, 4)(rng);
+        tc0[pel] = bS[pel] > 0 && bS[pel] < 4 ?
+                   std::uniform_int_distribution<int>(0, 25 * scale)(rng) : 0;
+    }
+
+    int incQ = verticalEdgeFlag ? 1 : STRIDE;
+    int nxtQ = verticalEdgeFlag ? STRIDE : 1;
+    int offset = verticalEdgeFlag ? 4 : 4 * STRIDE;
+
+    filter_lines(simd + offset, incQ, nxtQ, verticalEdgeFlag,
+                 bS, tc0, alpha, beta, chromaStyleFilteringFlag, BitDepth);
+
+    for (int pel = 0; pel < 8; ++pel) {
+        px_t* pixQ = ref + offset + pel * nxtQ;
+        if (bS[pel] == 4)
+            filter_strong(pixQ, incQ, alpha, beta, bS[pel], chromaStyleFilteringFlag);
+        else if (bS[pel] > 0)
+            filter_normal(pixQ, incQ, alpha, beta, bS[pel], chromaStyleFilteringFlag, tc0[pel], BitDepth);
+    }
+
+    if (memcmp(simd, ref, sizeof(ref)) == 0)
+        return true;
+
+    printf("mismatch: %d-bit %s edge%s, alpha %d beta %d\n", BitDepth,
+           verticalEdgeFlag ? "vertical" : "horizontal",
+           chromaStyleFilteringFlag ? " chroma style" : "", alpha, beta);
+    for (int pel = 0; pel < 8; ++pel) {
+        printf("  line %d bS %d tc0 %3d:", pel, bS[pel], tc0[pel]);
+        for (int i = -4; i < 4; ++i) {
+            int k = offset + pel * nxtQ + i * incQ;
+            printf(simd[k] == ref[k] ? " %4d" : " %4d/%d", simd[k], ref[k]);
+        }
+        printf("\n");
+    }
+    return false;
+}
+
+template <typename px_t>
+static bool check_all(std::mt19937& rng, int BitDepth, int iterations)
+{
+    for (int dir = 0; dir < 2; ++dir) {
+        for (int chroma = 0; chroma < 2; ++chroma) {
+            for (int n = 0; n < iterations; ++n) {
+                if (!check<px_t>(rng, BitDepth, dir == 0, chroma != 0))
+                    return false;
+            }
+            printf("%2d-bit %d-byte %-10s %-6s %d edges OK\n", BitDepth, (int) sizeof(px_t),
+                   dir == 0 ? "vertical" : "horizontal", chroma ? "chroma" : "luma", iterations);
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 20000;
+    unsigned seed  = argc > 2 ? strtoul(argv[2], NULL, 0) : 1;
+
+    std::mt19937 rng(seed);
+
+    bool ok = check_all<uint8_t >(rng,  8, iterations) &&
+              check_all<uint16_t>(rng,  8, iterations) &&
+              check_all<uint16_t>(rng, 10, iterations) &&
+              check_all<uint16_t>(rng, 12, iterations);
+    return ok ? 0 : 1;
+}
+
+#else
+
+int main()
+{
+    printf("filter_lines needs SSE2, nothing to check\n");
+    return 0;
+}
+
+#endif